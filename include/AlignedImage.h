@@ -0,0 +1,478 @@
+//=============================================================================
+// Copyright (c) 2001-2018 FLIR Systems, Inc. All Rights Reserved.
+//
+// This software is the confidential and proprietary information of FLIR
+// Integrated Imaging Solutions, Inc. ("Confidential Information"). You
+// shall not disclose such Confidential Information and shall use it only in
+// accordance with the terms of the license agreement you entered into
+// with FLIR Integrated Imaging Solutions, Inc. (FLIR).
+//
+// FLIR MAKES NO REPRESENTATIONS OR WARRANTIES ABOUT THE SUITABILITY OF THE
+// SOFTWARE, EITHER EXPRESSED OR IMPLIED, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+// PURPOSE, OR NON-INFRINGEMENT. FLIR SHALL NOT BE LIABLE FOR ANY DAMAGES
+// SUFFERED BY LICENSEE AS A RESULT OF USING, MODIFYING OR DISTRIBUTING
+// THIS SOFTWARE OR ITS DERIVATIVES.
+//=============================================================================
+
+#ifndef FLIR_FC2_ALIGNEDIMAGE_H
+#define FLIR_FC2_ALIGNEDIMAGE_H
+
+#include "FlyCapture2Platform.h"
+#include "FlyCapture2Defs.h"
+#include "Error.h"
+#include "Image.h"
+
+#include <stdlib.h>
+#include <string.h>
+#if defined(_WIN32) || defined(_WIN64)
+#include <malloc.h>
+#endif
+#if __cplusplus >= 201103L || ( defined(_MSC_VER) && _MSC_VER >= 1700 )
+#include <atomic>
+#include "MemoryBudget.h"
+#define FLIR_FC2_ATOMIC_DEFAULTS
+#define FLIR_FC2_ALIGNEDIMAGE_BUDGET
+#endif
+
+namespace FlyCapture2
+{
+	class MemoryBudget;
+
+	/** Default stride and base pointer alignment, in bytes. */
+	static const unsigned int sk_defaultStrideAlignment = 64;
+
+	namespace Detail
+	{
+		// Read on every Allocate() from any number of capture threads and
+		// written rarely, so it is kept lock free where the compiler allows.
+#ifdef FLIR_FC2_ATOMIC_DEFAULTS
+		inline std::atomic<unsigned int>& DefaultStrideAlignment()
+		{
+			static std::atomic<unsigned int> s_alignment( sk_defaultStrideAlignment );
+			return s_alignment;
+		}
+#else
+		inline volatile unsigned int& DefaultStrideAlignment()
+		{
+			static volatile unsigned int s_alignment = sk_defaultStrideAlignment;
+			return s_alignment;
+		}
+#endif
+
+		inline bool IsPowerOfTwo( unsigned int value )
+		{
+			return value != 0 && ( value & ( value - 1 ) ) == 0;
+		}
+
+		inline void* AllocateAligned( size_t size, unsigned int alignment )
+		{
+#if defined(_WIN32) || defined(_WIN64)
+			return _aligned_malloc( size, alignment );
+#else
+			void* pMem = NULL;
+			if ( alignment < sizeof(void*) )
+			{
+				alignment = sizeof(void*);
+			}
+			return posix_memalign( &pMem, alignment, size ) == 0 ? pMem : NULL;
+#endif
+		}
+
+		inline void FreeAligned( void* pMem )
+		{
+#if defined(_WIN32) || defined(_WIN64)
+			_aligned_free( pMem );
+#else
+			free( pMem );
+#endif
+		}
+	}
+
+	/**
+	 * Set the default stride alignment. This alignment will be used by any
+	 * AlignedImage that does not specify its own alignment. The alignment
+	 * used is determined at the time of the Allocate() or Convert() call,
+	 * therefore the most recent execution of this function will take
+	 * precedence. The default is shared within the current process.
+	 *
+	 * @param alignment The alignment in bytes. Must be a power of two.
+	 *
+	 * @see GetDefaultStrideAlignment()
+	 *
+	 * @return PGRERROR_OK, or PGRERROR_INVALID_PARAMETER if the alignment is
+	 *         not a power of two.
+	 */
+	inline ErrorType SetDefaultStrideAlignment( unsigned int alignment )
+	{
+		if ( !Detail::IsPowerOfTwo( alignment ) )
+		{
+			return PGRERROR_INVALID_PARAMETER;
+		}
+
+		Detail::DefaultStrideAlignment() = alignment;
+		return PGRERROR_OK;
+	}
+
+	/**
+	 * Get the default stride alignment.
+	 *
+	 * @see SetDefaultStrideAlignment()
+	 *
+	 * @return The default stride alignment in bytes.
+	 */
+	inline unsigned int GetDefaultStrideAlignment()
+	{
+		return Detail::DefaultStrideAlignment();
+	}
+
+	/**
+	 * Calculate the smallest stride that holds a row of the specified
+	 * format and is a multiple of the alignment.
+	 *
+	 * @param cols Columns in the image.
+	 * @param format Pixel format.
+	 * @param alignment The alignment in bytes. Must be a power of two.
+	 *
+	 * @return The aligned stride in bytes, or 0 if the stride does not fit
+	 *         in 32 bits.
+	 */
+	inline unsigned int CalculateAlignedStride(
+			unsigned int cols,
+			PixelFormat  format,
+			unsigned int alignment )
+	{
+		const unsigned long long rowBytes =
+			( static_cast<unsigned long long>( cols ) * Image::DetermineBitsPerPixel( format ) + 7 ) / 8;
+		const unsigned long long stride =
+			( rowBytes + alignment - 1 ) & ~static_cast<unsigned long long>( alignment - 1 );
+		return stride > 0xFFFFFFFFULL ? 0 : static_cast<unsigned int>( stride );
+	}
+
+	/**
+	 * Estimate the memory of a conversion destination held in an
+	 * AlignedImage with the default stride alignment.
+	 *
+	 * @param rows Rows in the image.
+	 * @param cols Columns in the image.
+	 * @param format Destination pixel format.
+	 *
+	 * @return The conversion buffer size in bytes.
+	 */
+	inline unsigned long long EstimateConversionBytes( unsigned int rows, unsigned int cols, PixelFormat format )
+	{
+		return static_cast<unsigned long long>( rows ) *
+			CalculateAlignedStride( cols, format, GetDefaultStrideAlignment() );
+	}
+
+	/**
+	 * An image whose buffer starts on an aligned address and whose stride
+	 * is a multiple of the same alignment. The buffer is owned by the
+	 * AlignedImage and is reused by subsequent calls as long as it is large
+	 * enough, so steady state conversion does not allocate.
+	 *
+	 * In C++11 builds the buffer can be accounted in a MemoryBudget, see
+	 * SetMemoryBudget().
+	 *
+	 * Operations on AlignedImage objects are not thread safe.
+	 */
+	class AlignedImage
+	{
+		public:
+
+			/**
+			 * Default constructor.
+			 *
+			 * @param alignment Stride and base pointer alignment in bytes, or
+			 *                  0 to use the default stride alignment.
+			 */
+			explicit AlignedImage( unsigned int alignment = 0 )
+				: m_pBuffer(NULL), m_bufferSize(0), m_alignment(alignment),
+				  m_pBudget(NULL), m_pReserveBudget(NULL)
+			{
+			}
+
+			/**
+			 * Default destructor. Releases the aligned buffer.
+			 */
+			~AlignedImage()
+			{
+				m_image.ReleaseBuffer();
+				Detail::FreeAligned( m_pBuffer );
+				ReserveBudget( 0 );
+			}
+
+#ifdef FLIR_FC2_ALIGNEDIMAGE_BUDGET
+			/**
+			 * Account the buffer in a memory budget, as conversion memory
+			 * owned by this image. A buffer that would exceed the limit is
+			 * not allocated and Allocate() or Convert() fails with
+			 * PGRERROR_MEMORY_ALLOCATION_FAILED. The budget must outlive the
+			 * image or the next call.
+			 *
+			 * @param pBudget The budget, or NULL to stop accounting.
+			 *
+			 * @return PGRERROR_OK, or PGRERROR_MEMORY_ALLOCATION_FAILED if
+			 *         the current buffer does not fit in the new budget, in
+			 *         which case the previous budget is kept.
+			 */
+			ErrorType SetMemoryBudget( MemoryBudget* pBudget )
+			{
+				if ( pBudget == m_pBudget )
+				{
+					return PGRERROR_OK;
+				}
+				if ( pBudget != NULL )
+				{
+					const ErrorType error = pBudget->Reserve( this, MEMORY_CONVERSION, m_bufferSize );
+					if ( error != PGRERROR_OK )
+					{
+						return error;
+					}
+				}
+				ReserveBudget( 0 );
+
+				m_pBudget = pBudget;
+				m_pReserveBudget = &ReserveConversionBytes;
+				return PGRERROR_OK;
+			}
+#endif
+
+			/**
+			 * Get the alignment used by this image.
+			 *
+			 * @return The alignment in bytes.
+			 */
+			unsigned int GetAlignment() const
+			{
+				return m_alignment != 0 ? m_alignment : GetDefaultStrideAlignment();
+			}
+
+			/**
+			 * Set the alignment used by this image. Takes effect on the next
+			 * call to Allocate() or Convert().
+			 *
+			 * @param alignment The alignment in bytes, or 0 to use the default
+			 *                  stride alignment.
+			 *
+			 * @return PGRERROR_OK, or PGRERROR_INVALID_PARAMETER if the
+			 *         alignment is not 0 or a power of two.
+			 */
+			ErrorType SetAlignment( unsigned int alignment )
+			{
+				if ( alignment != 0 && !Detail::IsPowerOfTwo( alignment ) )
+				{
+					return PGRERROR_INVALID_PARAMETER;
+				}
+
+				m_alignment = alignment;
+				return PGRERROR_OK;
+			}
+
+			/**
+			 * Size the image for the specified dimensions. The contents of
+			 * the buffer are undefined after this call.
+			 *
+			 * @param rows Rows in the image.
+			 * @param cols Columns in the image.
+			 * @param format Pixel format.
+			 * @param bayerFormat Format of the Bayer tiled raw image.
+			 *
+			 * @return PGRERROR_OK, PGRERROR_INVALID_PARAMETER for an empty image
+			 *         or one larger than 4 GB, or
+			 *         PGRERROR_MEMORY_ALLOCATION_FAILED if the buffer could not
+			 *         be allocated or does not fit in the memory budget.
+			 */
+			ErrorType Allocate(
+					unsigned int    rows,
+					unsigned int    cols,
+					PixelFormat     format,
+					BayerTileFormat bayerFormat = NONE )
+			{
+				const unsigned int alignment = GetAlignment();
+				const unsigned int stride = CalculateAlignedStride( cols, format, alignment );
+				const unsigned long long totalSize = static_cast<unsigned long long>( rows ) * stride;
+
+				if ( totalSize == 0 || totalSize > 0xFFFFFFFFULL )
+				{
+					return PGRERROR_INVALID_PARAMETER;
+				}
+
+				const unsigned int dataSize = static_cast<unsigned int>( totalSize );
+
+				if ( dataSize > m_bufferSize || !IsAligned( m_pBuffer, alignment ) )
+				{
+					if ( dataSize > m_bufferSize )
+					{
+						const ErrorType error = ReserveBudget( dataSize );
+						if ( error != PGRERROR_OK )
+						{
+							return error;
+						}
+					}
+					m_image.ReleaseBuffer();
+					Detail::FreeAligned( m_pBuffer );
+					m_bufferSize = 0;
+
+					m_pBuffer = static_cast<unsigned char*>( Detail::AllocateAligned( dataSize, alignment ) );
+					if ( m_pBuffer == NULL )
+					{
+						ReserveBudget( 0 );
+						return PGRERROR_MEMORY_ALLOCATION_FAILED;
+					}
+					m_bufferSize = dataSize;
+					// Never refused: the buffer did not grow beyond the
+					// reservation made above.
+					ReserveBudget( dataSize );
+				}
+
+				m_image = Image( rows, cols, stride, m_pBuffer, m_bufferSize, format, bayerFormat );
+				return PGRERROR_OK;
+			}
+
+			/**
+			 * Convert an image into this image. The conversion writes
+			 * directly into the aligned buffer where the library permits it;
+			 * otherwise the converted rows are moved into place, reusing the
+			 * buffer.
+			 *
+			 * @param source The image to convert.
+			 * @param format Output format of the converted image.
+			 *
+			 * @return PGRERROR_OK, or the type of the error that caused the
+			 *         allocation or conversion to fail.
+			 */
+			ErrorType Convert( const Image& source, PixelFormat format )
+			{
+				ErrorType result = Allocate( source.GetRows(), source.GetCols(), format );
+				if ( result != PGRERROR_OK )
+				{
+					return result;
+				}
+
+				const unsigned int alignedStride = m_image.GetStride();
+
+				Error error = source.Convert( format, &m_image );
+				if ( error != PGRERROR_OK )
+				{
+					return error.GetType();
+				}
+
+				return Repack( alignedStride );
+			}
+
+			/**
+			 * Convert an image into this image, using the default output
+			 * format of the library.
+			 *
+			 * @param source The image to convert.
+			 *
+			 * @return PGRERROR_OK, or the type of the error that caused the
+			 *         allocation or conversion to fail.
+			 */
+			ErrorType Convert( const Image& source )
+			{
+				return Convert( source, Image::GetDefaultOutputFormat() );
+			}
+
+			/**
+			 * Get the image backed by the aligned buffer. The returned Image
+			 * does not own the buffer and is invalidated by the next call to
+			 * Allocate() or Convert().
+			 *
+			 * @return The aligned image.
+			 */
+			Image& GetImage() { return m_image; }
+
+			const Image& GetImage() const { return m_image; }
+
+		private:
+
+#ifdef FLIR_FC2_ALIGNEDIMAGE_BUDGET
+			static ErrorType ReserveConversionBytes( MemoryBudget* pBudget, const void* pOwner, unsigned int bytes )
+			{
+				return pBudget->Reserve( pOwner, MEMORY_CONVERSION, bytes );
+			}
+#endif
+
+			// Set the reservation of the buffer in the memory budget, if
+			// any; 0 releases it. The budget is reached through the
+			// function stored by SetMemoryBudget(), so that this class
+			// does not depend on MemoryBudget in C++98 builds.
+			ErrorType ReserveBudget( unsigned int bytes )
+			{
+				return m_pBudget != NULL ? m_pReserveBudget( m_pBudget, this, bytes ) : PGRERROR_OK;
+			}
+
+			static bool IsAligned( const void* pMem, unsigned int alignment )
+			{
+				return pMem != NULL && ( reinterpret_cast<size_t>(pMem) & ( alignment - 1 ) ) == 0;
+			}
+
+			ErrorType Repack( unsigned int alignedStride )
+			{
+				unsigned int rows = 0;
+				unsigned int cols = 0;
+				unsigned int stride = 0;
+				PixelFormat format = UNSPECIFIED_PIXEL_FORMAT;
+				BayerTileFormat bayerFormat = NONE;
+				m_image.GetDimensions( &rows, &cols, &stride, &format, &bayerFormat );
+
+				const unsigned char* pConverted = m_image.GetData();
+				if ( pConverted == m_pBuffer && stride == alignedStride )
+				{
+					return PGRERROR_OK;
+				}
+
+				const unsigned int rowBytes = ( cols * Image::DetermineBitsPerPixel( format ) + 7 ) / 8;
+				if ( pConverted == m_pBuffer )
+				{
+					// Spreading rows out in place only works if they move
+					// forward; a foreign buffer can have any stride.
+					if ( stride > alignedStride )
+					{
+						return PGRERROR_IMAGE_CONSISTENCY_ERROR;
+					}
+
+					// Tightly packed in our own buffer: spread the rows out,
+					// last row first so no row is overwritten before it moves.
+					for ( unsigned int row = rows; row-- > 1; )
+					{
+						memmove( m_pBuffer + row * alignedStride, m_pBuffer + row * stride, rowBytes );
+					}
+				}
+				else
+				{
+					for ( unsigned int row = 0; row < rows; row++ )
+					{
+						memcpy( m_pBuffer + row * alignedStride, pConverted + row * stride, rowBytes );
+					}
+				}
+
+				// Re-point the converted image at the aligned buffer in place so
+				// its timestamp and metadata are kept.
+				Error error = m_image.SetData( m_pBuffer, m_bufferSize );
+				if ( error == PGRERROR_OK )
+				{
+					error = m_image.SetDimensions( rows, cols, alignedStride, format, bayerFormat );
+				}
+
+				return error.GetType();
+			}
+
+			AlignedImage( const AlignedImage& );
+			AlignedImage& operator=( const AlignedImage& );
+
+			Image          m_image;
+			unsigned char* m_pBuffer;
+			unsigned int   m_bufferSize;
+			unsigned int   m_alignment;
+			MemoryBudget*  m_pBudget;
+			ErrorType    (*m_pReserveBudget)( MemoryBudget*, const void*, unsigned int );
+	};
+}
+
+#undef FLIR_FC2_ATOMIC_DEFAULTS
+#undef FLIR_FC2_ALIGNEDIMAGE_BUDGET
+
+#endif // FLIR_FC2_ALIGNEDIMAGE_H
@@ -0,0 +1,661 @@
+//=============================================================================
+// Copyright (c) 2001-2018 FLIR Systems, Inc. All Rights Reserved.
+//
+// This software is the confidential and proprietary information of FLIR
+// Integrated Imaging Solutions, Inc. ("Confidential Information"). You
+// shall not disclose such Confidential Information and shall use it only in
+// accordance with the terms of the license agreement you entered into
+// with FLIR Integrated Imaging Solutions, Inc. (FLIR).
+//
+// FLIR MAKES NO REPRESENTATIONS OR WARRANTIES ABOUT THE SUITABILITY OF THE
+// SOFTWARE, EITHER EXPRESSED OR IMPLIED, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+// PURPOSE, OR NON-INFRINGEMENT. FLIR SHALL NOT BE LIABLE FOR ANY DAMAGES
+// SUFFERED BY LICENSEE AS A RESULT OF USING, MODIFYING OR DISTRIBUTING
+// THIS SOFTWARE OR ITS DERIVATIVES.
+//=============================================================================
+
+
+#ifndef FLIR_FC2_BACKGROUNDRECORDER_H
+#define FLIR_FC2_BACKGROUNDRECORDER_H
+
+#include "FlyCapture2Platform.h"
+#include "FlyCapture2Defs.h"
+#include "Error.h"
+#include "Image.h"
+#include "FlyCapture2Video.h"
+#include "RawSequence.h"
+#include "MemoryBudget.h"
+
+#if !defined(_MSC_VER) && __cplusplus < 201103L
+#error "BackgroundRecorder.h requires C++11"
+#endif
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace FlyCapture2
+{
+	/**
+	 * Destination of a BackgroundRecorder. Sinks are called from the
+	 * writer thread only.
+	 */
+	class RecordingSink
+	{
+		public:
+
+			virtual ~RecordingSink() {}
+
+			/**
+			 * Write a frame.
+			 *
+			 * @param image The frame. The sink may modify it.
+			 * @param timeStamp Time stamp of the frame.
+			 * @param metadata Metadata of the frame.
+			 * @param index Index of the frame in the recording.
+			 *
+			 * @return PGRERROR_OK, or the error of the write.
+			 */
+			virtual ErrorType Write(
+					Image&               image,
+					const TimeStamp&     timeStamp,
+					const ImageMetadata& metadata,
+					unsigned long long   index ) = 0;
+
+			/**
+			 * Finish the recording.
+			 *
+			 * @return PGRERROR_OK, or the error of the close.
+			 */
+			virtual ErrorType Close() = 0;
+	};
+
+	/**
+	 * Records to a raw sequence file, which keeps every frame bit exact
+	 * with its time stamp and metadata. The file is created with the
+	 * geometry of the first frame written after construction or Close().
+	 */
+	class RawSequenceSink : public RecordingSink
+	{
+		public:
+
+			/**
+			 * @param pFilename Name of the file to create.
+			 */
+			explicit RawSequenceSink( const char* pFilename )
+				: m_filename( pFilename != NULL ? pFilename : "" ),
+				  m_isOpen( false )
+			{
+			}
+
+			virtual ErrorType Write(
+					Image&               image,
+					const TimeStamp&     timeStamp,
+					const ImageMetadata& metadata,
+					unsigned long long   /*index*/ )
+			{
+				if ( !m_isOpen )
+				{
+					const ErrorType error = m_writer.Open( m_filename.c_str(), image );
+					if ( error != PGRERROR_OK )
+					{
+						return error;
+					}
+					m_isOpen = true;
+				}
+				return m_writer.Append( image, timeStamp, metadata );
+			}
+
+			virtual ErrorType Close()
+			{
+				m_isOpen = false;
+				return m_writer.Close();
+			}
+
+		private:
+
+			std::string       m_filename;
+			bool              m_isOpen;
+			RawSequenceWriter m_writer;
+	};
+
+	/**
+	 * Records each frame to its own file with Image::Save().
+	 */
+	class ImageSeriesSink : public RecordingSink
+	{
+		public:
+
+			/**
+			 * @param pPattern printf pattern of the file names, taking the
+			 *                 frame index as an unsigned long long, such as
+			 *                 "frame-%06llu.png".
+			 * @param format File format, or FROM_FILE_EXT.
+			 */
+			ImageSeriesSink( const char* pPattern, ImageFileFormat format = FROM_FILE_EXT )
+				: m_pattern( pPattern != NULL ? pPattern : "" ),
+				  m_format( format )
+			{
+			}
+
+			virtual ErrorType Write(
+					Image&               image,
+					const TimeStamp&     /*timeStamp*/,
+					const ImageMetadata& /*metadata*/,
+					unsigned long long   index )
+			{
+				char filename[1024];
+				const int length = snprintf( filename, sizeof(filename), m_pattern.c_str(), index );
+				if ( length < 0 || length >= static_cast<int>( sizeof(filename) ) )
+				{
+					return PGRERROR_INVALID_PARAMETER;
+				}
+				return image.Save( filename, m_format ).GetType();
+			}
+
+			virtual ErrorType Close()
+			{
+				return PGRERROR_OK;
+			}
+
+		private:
+
+			std::string     m_pattern;
+			ImageFileFormat m_format;
+	};
+
+	namespace Detail
+	{
+		template <class OptionT>
+		inline void PrepareVideoOption( OptionT*, const Image& )
+		{
+		}
+
+		inline void PrepareVideoOption( H264Option* pOption, const Image& image )
+		{
+			if ( pOption->width == 0 || pOption->height == 0 )
+			{
+				pOption->width = image.GetCols();
+				pOption->height = image.GetRows();
+			}
+		}
+	}
+
+	/**
+	 * Records to a video file with FlyCapture2Video. OptionT is AVIOption,
+	 * MJPGOption or H264Option. The file is opened on the first frame
+	 * written after construction or Close(); an H264 size left at 0 is
+	 * taken from it.
+	 */
+	template <class OptionT>
+	class VideoSink : public RecordingSink
+	{
+		public:
+
+			/**
+			 * @param pFilename Name of the file to create.
+			 * @param option Encoding options.
+			 * @param maximumFileSizeMB Size in MB at which a new file is
+			 *                          started, or 0 for the default.
+			 */
+			VideoSink( const char* pFilename, const OptionT& option, unsigned int maximumFileSizeMB = 0 )
+				: m_filename( pFilename != NULL ? pFilename : "" ),
+				  m_option( option ),
+				  m_maximumFileSizeMB( maximumFileSizeMB ),
+				  m_isOpen( false )
+			{
+			}
+
+			virtual ErrorType Write(
+					Image&               image,
+					const TimeStamp&     /*timeStamp*/,
+					const ImageMetadata& /*metadata*/,
+					unsigned long long   /*index*/ )
+			{
+				if ( !m_isOpen )
+				{
+					Detail::PrepareVideoOption( &m_option, image );
+					if ( m_maximumFileSizeMB != 0 )
+					{
+						m_video.SetMaximumFileSize( m_maximumFileSizeMB );
+					}
+					const Error error = m_video.Open( m_filename.c_str(), &m_option );
+					if ( error != PGRERROR_OK )
+					{
+						return error.GetType();
+					}
+					m_isOpen = true;
+				}
+				return m_video.Append( &image ).GetType();
+			}
+
+			virtual ErrorType Close()
+			{
+				if ( !m_isOpen )
+				{
+					return PGRERROR_OK;
+				}
+
+				m_isOpen = false;
+				return m_video.Close().GetType();
+			}
+
+		private:
+
+			std::string      m_filename;
+			OptionT          m_option;
+			unsigned int     m_maximumFileSizeMB;
+			bool             m_isOpen;
+			FlyCapture2Video m_video;
+	};
+
+	/** Progress of a BackgroundRecorder. */
+	struct RecorderStats
+	{
+		/** Frames waiting to be written. */
+		unsigned int numQueued;
+		/** Largest number of frames the queue holds. */
+		unsigned int capacity;
+		/** Most frames waiting at once. */
+		unsigned int peakQueued;
+		/** Frames passed to Record(). */
+		unsigned long long numRecorded;
+		/** Frames written by the sink. */
+		unsigned long long numWritten;
+		/** Frames dropped because the queue was full. */
+		unsigned long long numDropped;
+		/** Frames the sink failed to write. */
+		unsigned long long numWriteErrors;
+		/** Image bytes written. */
+		unsigned long long bytesWritten;
+		/**
+		 * Write rate in MB/s, measured over at least a second between
+		 * calls to GetStats(). It drops to 0 when the sink stops making
+		 * progress, and is 0 when not recording.
+		 */
+		double writeRateMBps;
+		/** Time since Start(). */
+		std::chrono::nanoseconds elapsed;
+
+		RecorderStats()
+		{
+			numQueued = 0;
+			capacity = 0;
+			peakQueued = 0;
+			numRecorded = 0;
+			numWritten = 0;
+			numDropped = 0;
+			numWriteErrors = 0;
+			bytesWritten = 0;
+			writeRateMBps = 0.0;
+			elapsed = std::chrono::nanoseconds::zero();
+		}
+	};
+
+	/**
+	 * The BackgroundRecorder class streams frames to a RecordingSink on a
+	 * writer thread, so recording does not slow down the thread that
+	 * retrieves frames.
+	 *
+	 * Record() copies a frame into a bounded queue and returns. The copies
+	 * reuse a fixed pool of images, so after the first pass through the
+	 * pool no memory is allocated. A full queue drops the frame rather
+	 * than blocking; the counters show queue occupancy, write rate and
+	 * drops, so the capacity can be sized to cover bursts of the storage.
+	 * With a MemoryBudget, the pool is reserved as encoder memory owned by
+	 * the recorder, one largest frame per pool image, and a frame that
+	 * would grow it beyond the limit is dropped.
+	 *
+	 * Record() works with any acquisition mode, including trigger mode. It
+	 * only consumes the frames it is given; a ViewerPipeline frame
+	 * observer or an image event callback can feed it. Frames of virtual
+	 * cameras carry their time stamp and metadata out of band, so pass
+	 * them to Record() explicitly to keep them in the recording.
+	 */
+	class BackgroundRecorder
+	{
+		public:
+
+			typedef std::chrono::steady_clock Clock;
+
+			/**
+			 * @param capacity Largest number of frames waiting to be
+			 *                 written.
+			 * @param pBudget Optional budget to account the frame pool in.
+			 *                It must outlive the recorder.
+			 */
+			explicit BackgroundRecorder( unsigned int capacity = 64, MemoryBudget* pBudget = NULL )
+				: m_capacity( capacity > 0 ? capacity : 1 ),
+				  m_pBudget( pBudget ),
+				  m_pSink( NULL ),
+				  m_running( false ),
+				  m_stopping( false ),
+				  m_numCopying( 0 ),
+				  m_largestFrameBytes( 0 ),
+				  m_reservedBytes( 0 ),
+				  m_rateBytes( 0 ),
+				  m_writeRateMBps( 0.0 )
+			{
+			}
+
+			/**
+			 * Default destructor. Stops recording, writing queued frames.
+			 */
+			~BackgroundRecorder()
+			{
+				Stop();
+				for ( size_t i = 0; i < m_pool.size(); i++ )
+				{
+					delete m_pool[i];
+				}
+				if ( m_pBudget != NULL )
+				{
+					m_pBudget->Release( this, MEMORY_ENCODER );
+				}
+			}
+
+			/**
+			 * Start a recording.
+			 *
+			 * @param pSink The destination, which must outlive the
+			 *              recording.
+			 *
+			 * @return PGRERROR_OK, PGRERROR_INVALID_PARAMETER, or
+			 *         PGRERROR_ISOCH_ALREADY_STARTED.
+			 */
+			ErrorType Start( RecordingSink* pSink )
+			{
+				if ( pSink == NULL )
+				{
+					return PGRERROR_INVALID_PARAMETER;
+				}
+
+				std::lock_guard<std::mutex> lock( m_mutex );
+				if ( m_running )
+				{
+					return PGRERROR_ISOCH_ALREADY_STARTED;
+				}
+
+				m_pSink = pSink;
+				m_stats = RecorderStats();
+				m_stats.capacity = m_capacity;
+				m_startTime = Clock::now();
+				m_rateTime = m_startTime;
+				m_rateBytes = 0;
+				m_writeRateMBps = 0.0;
+				m_running = true;
+				m_stopping = false;
+				m_thread = std::thread( &BackgroundRecorder::WriterLoop, this );
+				return PGRERROR_OK;
+			}
+
+			/**
+			 * Stop the recording and close the sink.
+			 *
+			 * @param discardQueued Whether to drop frames not yet written
+			 *                      instead of writing them.
+			 *
+			 * @return PGRERROR_OK, or the error of closing the sink.
+			 */
+			ErrorType Stop( bool discardQueued = false )
+			{
+				{
+					std::lock_guard<std::mutex> lock( m_mutex );
+					if ( !m_running || m_stopping )
+					{
+						return PGRERROR_OK;
+					}
+
+					m_stopping = true;
+					if ( discardQueued )
+					{
+						m_stats.numDropped += m_queue.size();
+						for ( size_t i = 0; i < m_queue.size(); i++ )
+						{
+							m_free.push_back( m_queue[i].pImage );
+						}
+						m_queue.clear();
+					}
+					m_condition.notify_all();
+				}
+
+				m_thread.join();
+				const ErrorType error = m_pSink->Close();
+
+				std::lock_guard<std::mutex> lock( m_mutex );
+				m_running = false;
+				m_stopping = false;
+				m_pSink = NULL;
+				return error;
+			}
+
+			/**
+			 * Check whether a recording is in progress.
+			 *
+			 * @return Whether Start() succeeded and Stop() has not been
+			 *         called.
+			 */
+			bool IsRecording() const
+			{
+				std::lock_guard<std::mutex> lock( m_mutex );
+				return m_running && !m_stopping;
+			}
+
+			/**
+			 * Queue a copy of a frame for writing, with the time stamp and
+			 * metadata of the image. May be called from any thread, such as
+			 * a capture callback.
+			 *
+			 * @param image The frame.
+			 *
+			 * @return Whether the frame was queued; false if not recording or
+			 *         if the queue is full.
+			 */
+			bool Record( const Image& image )
+			{
+				return Record( image, image.GetTimeStamp(), image.GetMetadata() );
+			}
+
+			/**
+			 * Queue a copy of a frame for writing, with a time stamp and
+			 * metadata delivered out of band, such as in the
+			 * VirtualFrameInfo of a virtual camera or the FrameTag of a
+			 * ViewerPipeline. May be called from any thread.
+			 *
+			 * @param image The frame.
+			 * @param timeStamp Time stamp of the frame.
+			 * @param metadata Metadata of the frame.
+			 *
+			 * @return Whether the frame was queued; false if not recording,
+			 *         if the queue is full or if the frame does not fit in
+			 *         the memory budget.
+			 */
+			bool Record( const Image& image, const TimeStamp& timeStamp, const ImageMetadata& metadata )
+			{
+				Image* pImage = NULL;
+				{
+					std::lock_guard<std::mutex> lock( m_mutex );
+					if ( !m_running || m_stopping )
+					{
+						return false;
+					}
+
+					m_stats.numRecorded++;
+					if ( m_queue.size() + m_numCopying >= m_capacity || !ReservePool( image.GetDataSize() ) )
+					{
+						m_stats.numDropped++;
+						return false;
+					}
+
+					if ( m_free.empty() )
+					{
+						m_pool.push_back( new Image() );
+						m_free.push_back( m_pool.back() );
+					}
+					pImage = m_free.back();
+					m_free.pop_back();
+					m_numCopying++;
+				}
+
+				// Copy outside the lock so the writer is not held up.
+				const bool copied = pImage->DeepCopy( &image ) == PGRERROR_OK;
+
+				std::lock_guard<std::mutex> lock( m_mutex );
+				m_numCopying--;
+				if ( !copied )
+				{
+					m_free.push_back( pImage );
+					m_stats.numDropped++;
+					return false;
+				}
+
+				QueuedFrame frame;
+				frame.pImage = pImage;
+				frame.timeStamp = timeStamp;
+				frame.metadata = metadata;
+				m_queue.push_back( frame );
+				m_stats.peakQueued = std::max( m_stats.peakQueued, static_cast<unsigned int>( m_queue.size() ) );
+				m_condition.notify_one();
+				return true;
+			}
+
+			/**
+			 * Get the progress of the current or last recording.
+			 *
+			 * @param pStats Receives the progress.
+			 */
+			void GetStats( RecorderStats* pStats ) const
+			{
+				std::lock_guard<std::mutex> lock( m_mutex );
+				*pStats = m_stats;
+				pStats->numQueued = static_cast<unsigned int>( m_queue.size() );
+				if ( !m_running )
+				{
+					return;
+				}
+
+				// Sample the bytes written rather than timing the writes, so
+				// a sink that blocks shows a falling rate while it blocks.
+				const Clock::time_point now = Clock::now();
+				const double seconds = std::chrono::duration<double>( now - m_rateTime ).count();
+				if ( seconds >= 1.0 )
+				{
+					m_writeRateMBps = ( m_stats.bytesWritten - m_rateBytes ) / seconds / ( 1024.0 * 1024.0 );
+					m_rateTime = now;
+					m_rateBytes = m_stats.bytesWritten;
+				}
+				pStats->writeRateMBps = m_writeRateMBps;
+				if ( !m_stopping )
+				{
+					pStats->elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>( now - m_startTime );
+				}
+			}
+
+		private:
+
+			struct QueuedFrame
+			{
+				Image* pImage;
+				TimeStamp timeStamp;
+				ImageMetadata metadata;
+			};
+
+			// Grow the budget reservation to cover the pool, including an
+			// image about to be added, at the largest frame size seen.
+			// Called with the mutex held.
+			bool ReservePool( unsigned long long frameBytes )
+			{
+				if ( m_pBudget == NULL )
+				{
+					return true;
+				}
+
+				const unsigned long long numImages = m_pool.size() + ( m_free.empty() ? 1 : 0 );
+				const unsigned long long largestFrameBytes = std::max( m_largestFrameBytes, frameBytes );
+				const unsigned long long bytes = numImages * largestFrameBytes;
+				if ( bytes > m_reservedBytes )
+				{
+					if ( m_pBudget->Reserve( this, MEMORY_ENCODER, bytes ) != PGRERROR_OK )
+					{
+						return false;
+					}
+					m_reservedBytes = bytes;
+				}
+				m_largestFrameBytes = largestFrameBytes;
+				return true;
+			}
+
+			void WriterLoop()
+			{
+				unsigned long long index = 0;
+				for (;;)
+				{
+					QueuedFrame frame;
+					{
+						std::unique_lock<std::mutex> lock( m_mutex );
+						m_condition.wait( lock, [this] {
+							return !m_queue.empty() || ( m_stopping && m_numCopying == 0 ); } );
+						if ( m_queue.empty() )
+						{
+							break;
+						}
+						frame = m_queue.front();
+						m_queue.pop_front();
+					}
+
+					Image* pImage = frame.pImage;
+					const ErrorType error = m_pSink->Write( *pImage, frame.timeStamp, frame.metadata, index );
+					const unsigned long long bytes = static_cast<unsigned long long>( pImage->GetRows() ) * pImage->GetStride();
+
+					std::lock_guard<std::mutex> lock( m_mutex );
+					m_free.push_back( pImage );
+					if ( error != PGRERROR_OK )
+					{
+						m_stats.numWriteErrors++;
+						continue;
+					}
+
+					index++;
+					m_stats.numWritten++;
+					m_stats.bytesWritten += bytes;
+				}
+
+				std::lock_guard<std::mutex> lock( m_mutex );
+				m_stats.elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>( Clock::now() - m_startTime );
+			}
+
+			BackgroundRecorder( const BackgroundRecorder& );
+			BackgroundRecorder& operator=( const BackgroundRecorder& );
+
+			const unsigned int  m_capacity;
+			MemoryBudget* const m_pBudget;
+			RecordingSink*      m_pSink;
+			std::thread         m_thread;
+
+			mutable std::mutex         m_mutex;
+			std::condition_variable    m_condition;
+			bool                       m_running;
+			bool                       m_stopping;
+			unsigned int               m_numCopying;
+			std::vector<Image*>        m_pool;
+			std::vector<Image*>        m_free;
+			std::deque<QueuedFrame>    m_queue;
+			unsigned long long         m_largestFrameBytes;
+			unsigned long long         m_reservedBytes;
+			RecorderStats              m_stats;
+			Clock::time_point          m_startTime;
+			// Sample of bytesWritten the write rate is measured from.
+			mutable Clock::time_point  m_rateTime;
+			mutable unsigned long long m_rateBytes;
+			mutable double             m_writeRateMBps;
+	};
+}
+
+#endif // FLIR_FC2_BACKGROUNDRECORDER_H
@@ -0,0 +1,255 @@
+//=============================================================================
+// Copyright (c) 2001-2018 FLIR Systems, Inc. All Rights Reserved.
+//
+// This software is the confidential and proprietary information of FLIR
+// Integrated Imaging Solutions, Inc. ("Confidential Information"). You
+// shall not disclose such Confidential Information and shall use it only in
+// accordance with the terms of the license agreement you entered into
+// with FLIR Integrated Imaging Solutions, Inc. (FLIR).
+//
+// FLIR MAKES NO REPRESENTATIONS OR WARRANTIES ABOUT THE SUITABILITY OF THE
+// SOFTWARE, EITHER EXPRESSED OR IMPLIED, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+// PURPOSE, OR NON-INFRINGEMENT. FLIR SHALL NOT BE LIABLE FOR ANY DAMAGES
+// SUFFERED BY LICENSEE AS A RESULT OF USING, MODIFYING OR DISTRIBUTING
+// THIS SOFTWARE OR ITS DERIVATIVES.
+//=============================================================================
+
+#ifndef FLIR_FLYCAPTURE2FRAMECALLBACK_C_H
+#define FLIR_FLYCAPTURE2FRAMECALLBACK_C_H
+
+//=============================================================================
+// Frame descriptor callback for the FlyCapture2 C API.
+//
+// This file defines a capture callback that receives a compact, read-only
+// description of each frame instead of an fc2Image. The descriptor is built
+// on the stack of the callback thread; no memory is allocated per frame. The
+// functions are defined inline in this header and are implemented on top of
+// fc2StartCaptureCallback(), so the library's fc2Image callback still runs
+// underneath: this is a more convenient interface, not a faster path. The
+// buffer is requeued when the callback returns; the C API offers no way to
+// release it earlier or to keep it longer without copying.
+//=============================================================================
+
+#include "FlyCapture2Platform_C.h"
+#include "FlyCapture2Defs_C.h"
+#include "FlyCapture2_C.h"
+
+#include <string.h>
+
+#if defined(__cplusplus) || ( defined(__STDC_VERSION__) && __STDC_VERSION__ >= 199901L )
+#define FC2_FRAME_INLINE static inline
+#else
+#define FC2_FRAME_INLINE static __inline
+#endif
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#define FC2_FRAME_ATOMIC_INCREMENT( pValue ) \
+    ( (unsigned long long)_InterlockedIncrement64( (volatile long long*)(pValue) ) - 1 )
+#else
+#define FC2_FRAME_ATOMIC_INCREMENT( pValue ) \
+    __sync_fetch_and_add( (pValue), 1ULL )
+#endif
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+    /** Optional fields to fill in each fc2FrameDescriptor. */
+    typedef enum _fc2FrameDescriptorFields
+    {
+        /** Only the buffer, dimensions and frame ID are filled. */
+        FC2_FRAME_FIELDS_NONE = 0x0,
+        /** Fill the timeStamp field. */
+        FC2_FRAME_FIELDS_TIMESTAMP = 0x1,
+        /** Fill the metadata field. */
+        FC2_FRAME_FIELDS_METADATA = 0x2,
+        /**
+         * Use the embedded frame counter as the frame ID instead of the
+         * delivery count. Implies FC2_FRAME_FIELDS_METADATA. The frame
+         * counter must be enabled in the embedded image info of the camera.
+         */
+        FC2_FRAME_FIELDS_EMBEDDED_FRAME_ID = 0x4,
+        /** Fill all optional fields, keeping the delivery count as frame ID. */
+        FC2_FRAME_FIELDS_ALL = FC2_FRAME_FIELDS_TIMESTAMP | FC2_FRAME_FIELDS_METADATA,
+        FC2_FRAME_FIELDS_FORCE_32BITS = FULL_32BIT_VALUE
+
+    } fc2FrameDescriptorFields;
+
+    /** Source of the frameId field of an fc2FrameDescriptor. */
+    typedef enum _fc2FrameIdSource
+    {
+        /**
+         * Number of frames delivered to the callback before this one.
+         * Strictly increasing, but does not count frames the library
+         * dropped.
+         */
+        FC2_FRAME_ID_DELIVERY_COUNT,
+        /**
+         * The embedded frame counter of the camera. Counts dropped frames,
+         * but wraps at 2^32 and is 0 if the counter is not enabled.
+         */
+        FC2_FRAME_ID_EMBEDDED_COUNTER,
+        FC2_FRAME_ID_FORCE_32BITS = FULL_32BIT_VALUE
+
+    } fc2FrameIdSource;
+
+    /**
+     * Compact description of a received frame. The data pointer is only
+     * valid until the callback returns. Fields that were not requested are
+     * zero.
+     */
+    typedef struct _fc2FrameDescriptor
+    {
+        /** Pointer to the image data. */
+        const unsigned char* pData;
+        /** Size of the image buffer, in bytes. */
+        unsigned int dataSize;
+        /** Actual size of the received data, in bytes. */
+        unsigned int receivedDataSize;
+        /** Rows in the image. */
+        unsigned int rows;
+        /** Columns in the image. */
+        unsigned int cols;
+        /** Number of bytes between rows of the image. */
+        unsigned int stride;
+        /** Pixel format of the image. */
+        fc2PixelFormat format;
+        /** Bayer tile format of the image. */
+        fc2BayerTileFormat bayerFormat;
+        /** Frame ID, from the source given by frameIdSource. */
+        unsigned long long frameId;
+        /**
+         * Source of frameId, fixed for the lifetime of the registration by
+         * FC2_FRAME_FIELDS_EMBEDDED_FRAME_ID.
+         */
+        fc2FrameIdSource frameIdSource;
+        /** Timestamp of the image. */
+        fc2TimeStamp timeStamp;
+        /** Metadata embedded in the image. */
+        fc2ImageMetadata metadata;
+
+    } fc2FrameDescriptor;
+
+    /**
+     * Frame callback function prototype. It is possible for this function
+     * to be called simultaneously. Therefore, users must make sure that code
+     * in the callback is thread safe.
+     */
+    typedef void (*fc2FrameCallback)( const fc2FrameDescriptor* pFrame, void* pCallbackData );
+
+    /**
+     * State of a frame callback registration. The structure is owned by the
+     * caller and must stay valid until capture is stopped.
+     */
+    typedef struct _fc2FrameCallbackContext
+    {
+        /** The user callback. */
+        fc2FrameCallback pCallback;
+        /** Data passed to the user callback. */
+        void* pCallbackData;
+        /** Bit field of fc2FrameDescriptorFields to fill. */
+        unsigned int fields;
+        /** Number of frames delivered so far. */
+        volatile unsigned long long frameCount;
+
+    } fc2FrameCallbackContext;
+
+    FC2_FRAME_INLINE void
+        fc2InternalFrameCallback(
+                fc2Image* pImage,
+                void* pCallbackData )
+    {
+        fc2FrameCallbackContext* pContext = (fc2FrameCallbackContext*)pCallbackData;
+        fc2FrameDescriptor frame;
+
+        frame.pData = pImage->pData;
+        frame.dataSize = pImage->dataSize;
+        frame.receivedDataSize = pImage->receivedDataSize;
+        frame.rows = pImage->rows;
+        frame.cols = pImage->cols;
+        frame.stride = pImage->stride;
+        frame.format = pImage->format;
+        frame.bayerFormat = pImage->bayerFormat;
+
+        /* Only the fields that were not requested are cleared. */
+        if ( pContext->fields & FC2_FRAME_FIELDS_TIMESTAMP )
+        {
+            frame.timeStamp = fc2GetImageTimeStamp( pImage );
+        }
+        else
+        {
+            memset( &frame.timeStamp, 0, sizeof(frame.timeStamp) );
+        }
+
+        if ( !( pContext->fields & ( FC2_FRAME_FIELDS_METADATA | FC2_FRAME_FIELDS_EMBEDDED_FRAME_ID ) ) ||
+             fc2GetImageMetadata( pImage, &frame.metadata ) != FC2_ERROR_OK )
+        {
+            memset( &frame.metadata, 0, sizeof(frame.metadata) );
+        }
+
+        if ( pContext->fields & FC2_FRAME_FIELDS_EMBEDDED_FRAME_ID )
+        {
+            frame.frameId = frame.metadata.embeddedFrameCounter;
+            frame.frameIdSource = FC2_FRAME_ID_EMBEDDED_COUNTER;
+        }
+        else
+        {
+            frame.frameId = FC2_FRAME_ATOMIC_INCREMENT( &pContext->frameCount );
+            frame.frameIdSource = FC2_FRAME_ID_DELIVERY_COUNT;
+        }
+
+        pContext->pCallback( &frame, pContext->pCallbackData );
+    }
+
+    /**
+     * Starts isochronous image capture with a frame descriptor callback.
+     * The callback receives a descriptor of each frame instead of an
+     * fc2Image. Only the fields requested are filled, so that frames that
+     * only need the pixel data do not pay for reading the timestamp or
+     * metadata.
+     *
+     * @see fc2StartCaptureCallback()
+     * @see fc2StopCapture()
+     *
+     * @param context The fc2Context to be used.
+     * @param pCallbackContext Caller-owned registration state. Must stay
+     *                         valid until capture is stopped.
+     * @param pCallbackFn A function to be called when a new image is received.
+     * @param pCallbackData A pointer to data that can be passed to the
+     *                      callback function. A NULL pointer is acceptable.
+     * @param fields Bit field of fc2FrameDescriptorFields to fill.
+     *
+     * @return A fc2Error indicating the success or failure of the function.
+     */
+    FC2_FRAME_INLINE fc2Error
+        fc2StartCaptureFrameCallback(
+                fc2Context context,
+                fc2FrameCallbackContext* pCallbackContext,
+                fc2FrameCallback pCallbackFn,
+                void* pCallbackData,
+                unsigned int fields )
+    {
+        if ( pCallbackContext == NULL || pCallbackFn == NULL )
+        {
+            return FC2_ERROR_INVALID_PARAMETER;
+        }
+
+        pCallbackContext->pCallback = pCallbackFn;
+        pCallbackContext->pCallbackData = pCallbackData;
+        pCallbackContext->fields = fields;
+        pCallbackContext->frameCount = 0;
+
+        return fc2StartCaptureCallback( context, fc2InternalFrameCallback, pCallbackContext );
+    }
+
+#ifdef __cplusplus
+};
+#endif
+
+#undef FC2_FRAME_INLINE
+#undef FC2_FRAME_ATOMIC_INCREMENT
+
+#endif // FLIR_FLYCAPTURE2FRAMECALLBACK_C_H
@@ -0,0 +1,387 @@
+//=============================================================================
+// Copyright (c) 2001-2018 FLIR Systems, Inc. All Rights Reserved.
+//
+// This software is the confidential and proprietary information of FLIR
+// Integrated Imaging Solutions, Inc. ("Confidential Information"). You
+// shall not disclose such Confidential Information and shall use it only in
+// accordance with the terms of the license agreement you entered into
+// with FLIR Integrated Imaging Solutions, Inc. (FLIR).
+//
+// FLIR MAKES NO REPRESENTATIONS OR WARRANTIES ABOUT THE SUITABILITY OF THE
+// SOFTWARE, EITHER EXPRESSED OR IMPLIED, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+// PURPOSE, OR NON-INFRINGEMENT. FLIR SHALL NOT BE LIABLE FOR ANY DAMAGES
+// SUFFERED BY LICENSEE AS A RESULT OF USING, MODIFYING OR DISTRIBUTING
+// THIS SOFTWARE OR ITS DERIVATIVES.
+//=============================================================================
+
+#ifndef FLIR_FLYCAPTURE2IMAGEPOOL_C_H
+#define FLIR_FLYCAPTURE2IMAGEPOOL_C_H
+
+//=============================================================================
+// Image pool for the FlyCapture2 C API.
+//
+// This file defines a fixed-size pool of fc2Image objects that are created
+// once and reused, so that retrieving and converting images does not create
+// or destroy an fc2Image per frame. The functions are defined inline in this
+// header and are implemented on top of the FlyCapture2 C API.
+//=============================================================================
+
+#include "FlyCapture2Platform_C.h"
+#include "FlyCapture2Defs_C.h"
+#include "FlyCapture2_C.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__cplusplus) || ( defined(__STDC_VERSION__) && __STDC_VERSION__ >= 199901L )
+#define FC2_POOL_INLINE static inline
+#else
+#define FC2_POOL_INLINE static __inline
+#endif
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+    /**
+     * A fixed-size pool of fc2Image objects. All memory is allocated by
+     * fc2CreateImagePool(). Operations on a pool are not thread safe; it is
+     * recommended that a pool shared between threads be protected by a
+     * mutex.
+     *
+     * An fc2Image that has been filled by fc2RetrieveBuffer() holds on to
+     * the camera buffer until the next retrieval into the same fc2Image.
+     * In BUFFER_FRAMES mode the pool should therefore be smaller than the
+     * numBuffers setting of the camera.
+     */
+    typedef struct _fc2ImagePool
+    {
+        /** Images owned by the pool. */
+        fc2Image* pImages;
+        /** Indices of the images that are not leased. */
+        unsigned int* pFreeList;
+        /** Nonzero for each image that is currently leased. */
+        unsigned char* pLeased;
+        /** Number of images owned by the pool. */
+        unsigned int numImages;
+        /** Number of images that are not leased. */
+        unsigned int numFree;
+
+    } fc2ImagePool;
+
+    /**
+     * Create an image pool. All images are created up front.
+     *
+     * @see fc2DestroyImagePool()
+     *
+     * @param pPool Pointer to the pool to be created.
+     * @param numImages Number of images in the pool.
+     *
+     * @return A fc2Error indicating the success or failure of the function.
+     */
+    FC2_POOL_INLINE fc2Error
+        fc2CreateImagePool(
+                fc2ImagePool* pPool,
+                unsigned int numImages )
+    {
+        unsigned int i;
+        fc2Error error = FC2_ERROR_OK;
+
+        if ( pPool == NULL || numImages == 0 )
+        {
+            return FC2_ERROR_INVALID_PARAMETER;
+        }
+
+        memset( pPool, 0, sizeof(fc2ImagePool) );
+        pPool->pImages = (fc2Image*)calloc( numImages, sizeof(fc2Image) );
+        pPool->pFreeList = (unsigned int*)calloc( numImages, sizeof(unsigned int) );
+        pPool->pLeased = (unsigned char*)calloc( numImages, sizeof(unsigned char) );
+        if ( pPool->pImages == NULL || pPool->pFreeList == NULL || pPool->pLeased == NULL )
+        {
+            free( pPool->pImages );
+            free( pPool->pFreeList );
+            free( pPool->pLeased );
+            memset( pPool, 0, sizeof(fc2ImagePool) );
+            return FC2_ERROR_MEMORY_ALLOCATION_FAILED;
+        }
+
+        for ( i = 0; i < numImages; i++ )
+        {
+            error = fc2CreateImage( &pPool->pImages[i] );
+            if ( error != FC2_ERROR_OK )
+            {
+                break;
+            }
+
+            pPool->pFreeList[i] = i;
+            pPool->numImages = i + 1;
+        }
+
+        pPool->numFree = pPool->numImages;
+
+        if ( error != FC2_ERROR_OK )
+        {
+            for ( i = 0; i < pPool->numImages; i++ )
+            {
+                fc2DestroyImage( &pPool->pImages[i] );
+            }
+            free( pPool->pImages );
+            free( pPool->pFreeList );
+            free( pPool->pLeased );
+            memset( pPool, 0, sizeof(fc2ImagePool) );
+        }
+
+        return error;
+    }
+
+    /**
+     * Destroy an image pool and all of its images. Images that are still
+     * leased become invalid.
+     *
+     * @see fc2CreateImagePool()
+     *
+     * @param pPool The pool to be destroyed.
+     *
+     * @return A fc2Error indicating the success or failure of the function.
+     */
+    FC2_POOL_INLINE fc2Error
+        fc2DestroyImagePool(
+                fc2ImagePool* pPool )
+    {
+        unsigned int i;
+
+        if ( pPool == NULL )
+        {
+            return FC2_ERROR_INVALID_PARAMETER;
+        }
+
+        for ( i = 0; i < pPool->numImages; i++ )
+        {
+            fc2DestroyImage( &pPool->pImages[i] );
+        }
+
+        free( pPool->pImages );
+        free( pPool->pFreeList );
+        free( pPool->pLeased );
+        memset( pPool, 0, sizeof(fc2ImagePool) );
+
+        return FC2_ERROR_OK;
+    }
+
+    /**
+     * Lease an image from the pool. The image keeps the buffer and
+     * dimensions it had when it was last released.
+     *
+     * @see fc2ReleasePoolImage()
+     *
+     * @param pPool The pool to be used.
+     * @param ppImage Pointer to receive the leased image.
+     *
+     * @return FC2_ERROR_OK, or FC2_ERROR_BUFFER_TOO_SMALL if every image in
+     *         the pool is leased.
+     */
+    FC2_POOL_INLINE fc2Error
+        fc2AcquirePoolImage(
+                fc2ImagePool* pPool,
+                fc2Image** ppImage )
+    {
+        if ( pPool == NULL || ppImage == NULL )
+        {
+            return FC2_ERROR_INVALID_PARAMETER;
+        }
+
+        if ( pPool->numFree == 0 )
+        {
+            return FC2_ERROR_BUFFER_TOO_SMALL;
+        }
+
+        pPool->numFree--;
+        pPool->pLeased[ pPool->pFreeList[ pPool->numFree ] ] = 1;
+        *ppImage = &pPool->pImages[ pPool->pFreeList[ pPool->numFree ] ];
+
+        return FC2_ERROR_OK;
+    }
+
+    /**
+     * Return a leased image to the pool.
+     *
+     * @see fc2AcquirePoolImage()
+     *
+     * @param pPool The pool the image was leased from.
+     * @param pImage The image to return.
+     *
+     * @return FC2_ERROR_OK, or FC2_ERROR_INVALID_PARAMETER if the image is
+     *         not from the pool or is not currently leased.
+     */
+    FC2_POOL_INLINE fc2Error
+        fc2ReleasePoolImage(
+                fc2ImagePool* pPool,
+                fc2Image* pImage )
+    {
+        unsigned int index;
+
+        if ( pPool == NULL ||
+             pImage < pPool->pImages ||
+             pImage >= pPool->pImages + pPool->numImages )
+        {
+            return FC2_ERROR_INVALID_PARAMETER;
+        }
+
+        index = (unsigned int)( pImage - pPool->pImages );
+        if ( !pPool->pLeased[index] )
+        {
+            return FC2_ERROR_INVALID_PARAMETER;
+        }
+
+        pPool->pLeased[index] = 0;
+        pPool->pFreeList[ pPool->numFree ] = index;
+        pPool->numFree++;
+
+        return FC2_ERROR_OK;
+    }
+
+    /**
+     * Lease an image from the pool and retrieve the next image from the
+     * camera into it. On failure the image is returned to the pool.
+     *
+     * @see fc2RetrieveBuffer()
+     * @see fc2ReleasePoolImage()
+     *
+     * @param context The fc2Context to be used.
+     * @param pPool The pool to be used.
+     * @param ppImage Pointer to receive the leased image.
+     *
+     * @return A fc2Error indicating the success or failure of the function.
+     */
+    FC2_POOL_INLINE fc2Error
+        fc2RetrievePoolBuffer(
+                fc2Context context,
+                fc2ImagePool* pPool,
+                fc2Image** ppImage )
+    {
+        fc2Image* pImage = NULL;
+        fc2Error error = fc2AcquirePoolImage( pPool, &pImage );
+        if ( error != FC2_ERROR_OK )
+        {
+            return error;
+        }
+
+        error = fc2RetrieveBuffer( context, pImage );
+        if ( error != FC2_ERROR_OK )
+        {
+            fc2ReleasePoolImage( pPool, pImage );
+            return error;
+        }
+
+        *ppImage = pImage;
+        return FC2_ERROR_OK;
+    }
+
+    /**
+     * Convert an image into a caller-provided buffer. The conversion writes
+     * directly into the buffer where the library permits it; otherwise the
+     * converted rows are copied into it. The scratch image carries the
+     * conversion state between calls and should be kept for the lifetime of
+     * the conversion loop, for example by leasing it from a pool.
+     *
+     * @see fc2ConvertImageTo()
+     *
+     * @param format Output format of the converted image.
+     * @param pImageIn Input image.
+     * @param pScratch Scratch image used for the conversion.
+     * @param pData Destination buffer.
+     * @param dataSize Size of the destination buffer in bytes.
+     * @param stride Number of bytes between rows in the destination buffer.
+     *
+     * @return FC2_ERROR_OK, FC2_ERROR_BUFFER_TOO_SMALL if the buffer or stride
+     *         cannot hold the converted image, or the error returned by the
+     *         conversion.
+     */
+    FC2_POOL_INLINE fc2Error
+        fc2ConvertImageToBuffer(
+                fc2PixelFormat format,
+                fc2Image* pImageIn,
+                fc2Image* pScratch,
+                unsigned char* pData,
+                unsigned int dataSize,
+                unsigned int stride )
+    {
+        unsigned int bitsPerPixel = 0;
+        unsigned int rowBytes;
+        unsigned int row;
+        const unsigned char* pConverted;
+        fc2Error error;
+
+        if ( pImageIn == NULL || pScratch == NULL || pData == NULL )
+        {
+            return FC2_ERROR_INVALID_PARAMETER;
+        }
+
+        error = fc2DetermineBitsPerPixel( format, &bitsPerPixel );
+        if ( error != FC2_ERROR_OK )
+        {
+            return error;
+        }
+
+        rowBytes = (unsigned int)( ( (unsigned long long)pImageIn->cols * bitsPerPixel + 7 ) / 8 );
+        if ( stride < rowBytes ||
+             (unsigned long long)pImageIn->rows * stride > dataSize )
+        {
+            return FC2_ERROR_BUFFER_TOO_SMALL;
+        }
+
+        error = fc2SetImageData( pScratch, pData, dataSize );
+        if ( error == FC2_ERROR_OK )
+        {
+            error = fc2SetImageDimensions(
+                    pScratch, pImageIn->rows, pImageIn->cols, stride, format, FC2_BT_NONE );
+        }
+        if ( error == FC2_ERROR_OK )
+        {
+            error = fc2ConvertImageTo( format, pImageIn, pScratch );
+        }
+        if ( error != FC2_ERROR_OK )
+        {
+            return error;
+        }
+
+        pConverted = pScratch->pData;
+        if ( pConverted == pData && pScratch->stride == stride )
+        {
+            return FC2_ERROR_OK;
+        }
+
+        if ( pConverted == pData )
+        {
+            /* Only rows that move forward can be spread out in place. */
+            if ( pScratch->stride > stride )
+            {
+                return FC2_ERROR_IMAGE_CONSISTENCY_ERROR;
+            }
+
+            /* Spread tightly packed rows out, last row first. */
+            for ( row = pScratch->rows; row-- > 1; )
+            {
+                memmove( pData + row * stride, pData + row * pScratch->stride, rowBytes );
+            }
+        }
+        else
+        {
+            for ( row = 0; row < pScratch->rows; row++ )
+            {
+                memcpy( pData + row * stride, pConverted + row * pScratch->stride, rowBytes );
+            }
+        }
+
+        return FC2_ERROR_OK;
+    }
+
+#ifdef __cplusplus
+};
+#endif
+
+#undef FC2_POOL_INLINE
+
+#endif // FLIR_FLYCAPTURE2IMAGEPOOL_C_H
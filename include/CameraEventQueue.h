@@ -0,0 +1,546 @@
+//=============================================================================
+// Copyright (c) 2001-2018 FLIR Systems, Inc. All Rights Reserved.
+//
+// This software is the confidential and proprietary information of FLIR
+// Integrated Imaging Solutions, Inc. ("Confidential Information"). You
+// shall not disclose such Confidential Information and shall use it only in
+// accordance with the terms of the license agreement you entered into
+// with FLIR Integrated Imaging Solutions, Inc. (FLIR).
+//
+// FLIR MAKES NO REPRESENTATIONS OR WARRANTIES ABOUT THE SUITABILITY OF THE
+// SOFTWARE, EITHER EXPRESSED OR IMPLIED, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+// PURPOSE, OR NON-INFRINGEMENT. FLIR SHALL NOT BE LIABLE FOR ANY DAMAGES
+// SUFFERED BY LICENSEE AS A RESULT OF USING, MODIFYING OR DISTRIBUTING
+// THIS SOFTWARE OR ITS DERIVATIVES.
+//=============================================================================
+
+
+#ifndef FLIR_FC2_CAMERAEVENTQUEUE_H
+#define FLIR_FC2_CAMERAEVENTQUEUE_H
+
+#include "FlyCapture2Platform.h"
+#include "FlyCapture2Defs.h"
+#include "Error.h"
+
+#if !defined(_MSC_VER) && __cplusplus < 201103L
+#error "CameraEventQueue.h requires C++11"
+#endif
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <string.h>
+
+#if defined(__linux__)
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+#endif
+
+namespace FlyCapture2
+{
+	/** A device event captured by a CameraEventQueue. */
+	struct CameraEvent
+	{
+		/** Maximum length of the event name, including the terminator. */
+		static const unsigned int sk_maxNameLength = 64;
+		/** Maximum number of bytes of event data kept with the event. */
+		static const unsigned int sk_maxDataSize = 64;
+
+		/** Camera that raised the event, as passed to Attach(). */
+		const void* pCamera;
+		/** Name the event was registered under. */
+		char name[sk_maxNameLength];
+		/** Device register the event maps to. */
+		unsigned long long id;
+		/** Index of the event since the queue was created. Gaps mark events lost to overflow. */
+		unsigned long long sequence;
+		/** Time stamp of the event on the device clock. */
+		unsigned long long deviceTimestamp;
+		/** Device time stamp mapped to the host steady clock. */
+		std::chrono::steady_clock::time_point hostTime;
+		/** Host time the library delivered the event. */
+		std::chrono::steady_clock::time_point receivedTime;
+		/** Size of the event data reported by the library. */
+		unsigned int dataSize;
+		/** Event data, truncated to sk_maxDataSize bytes. */
+		unsigned char data[sk_maxDataSize];
+
+		CameraEvent()
+		{
+			pCamera = NULL;
+			memset( name, 0, sizeof(name) );
+			id = 0;
+			sequence = 0;
+			deviceTimestamp = 0;
+			dataSize = 0;
+			memset( data, 0, sizeof(data) );
+		}
+	};
+
+	/** Statistics of a CameraEventQueue. */
+	struct CameraEventQueueStats
+	{
+		/** Events delivered by the library. */
+		unsigned long long numReceived;
+		/** Events fetched by the consumer. */
+		unsigned long long numFetched;
+		/** Events discarded because the queue was full. */
+		unsigned long long numOverflows;
+		/** Events whose data did not fit in CameraEvent::data. */
+		unsigned long long numDataTruncated;
+		/** Largest number of events waiting in the queue. */
+		unsigned int highWatermark;
+
+		CameraEventQueueStats()
+		{
+			numReceived = 0;
+			numFetched = 0;
+			numOverflows = 0;
+			numDataTruncated = 0;
+			highWatermark = 0;
+		}
+	};
+
+	/**
+	 * The CameraEventQueue class decouples the handling of device events
+	 * from the library thread that delivers them.
+	 *
+	 * Events registered through Attach() are not handled in the
+	 * CameraEventCallback. The callback copies the event into a bounded
+	 * ring and returns. Producers serialize on a mutex held only for the
+	 * copy; the consumer never takes it and only exchanges atomic indices
+	 * with the producers, so a slow consumer cannot stall event
+	 * processing. When the ring is full the newest event is discarded and
+	 * counted as an overflow. The consumer fetches events in batches with
+	 * Fetch(), blocks for them with Wait(), or polls the descriptor
+	 * returned by GetFd() from its own event loop. Producers only signal
+	 * the descriptor when it is not already signalled, so high event rates
+	 * do not cost a system call each; Fetch() clears it with one read.
+	 *
+	 * Device time stamps are mapped to the host steady clock by tracking,
+	 * for each camera, the smallest observed difference between the
+	 * reception time and the device time over a sliding window, which
+	 * follows slow drift between the clocks.
+	 *
+	 * Any number of cameras can deliver into one queue. There must be a
+	 * single consumer, which also makes the Attach() and Detach() calls.
+	 */
+	class CameraEventQueue
+	{
+		public:
+
+			typedef std::chrono::steady_clock Clock;
+
+			/**
+			 * Construct a queue.
+			 *
+			 * @param capacity Maximum number of queued events, rounded up to
+			 *                 a power of two.
+			 */
+			explicit CameraEventQueue( unsigned int capacity = 1024 )
+				: m_head( 0 ),
+				  m_tail( 0 ),
+				  m_signalPending( false ),
+				  m_sequence( 0 ),
+				  m_tickPeriodNs( 1.0 ),
+				  m_numReceived( 0 ),
+				  m_numFetched( 0 ),
+				  m_numOverflows( 0 ),
+				  m_numDataTruncated( 0 ),
+				  m_highWatermark( 0 )
+			{
+				unsigned int size = 1;
+				while ( size < capacity )
+				{
+					size <<= 1;
+				}
+				m_events.resize( size );
+				m_mask = size - 1;
+
+#if defined(__linux__)
+				m_eventFd = eventfd( 0, EFD_CLOEXEC | EFD_NONBLOCK );
+#endif
+			}
+
+			/**
+			 * Default destructor. Cameras must be detached first.
+			 */
+			~CameraEventQueue()
+			{
+				for ( size_t i = 0; i < m_sources.size(); i++ )
+				{
+					delete m_sources[i];
+				}
+#if defined(__linux__)
+				if ( m_eventFd >= 0 )
+				{
+					close( m_eventFd );
+				}
+#endif
+			}
+
+			/**
+			 * Set the frequency of the device clock used for the event time
+			 * stamps. The default of 1 GHz matches GenICam cameras, which
+			 * report time stamps in nanoseconds. Call before attaching.
+			 *
+			 * @param frequencyHz Device clock frequency in Hz.
+			 */
+			void SetDeviceClockFrequency( double frequencyHz )
+			{
+				m_tickPeriodNs = 1e9 / frequencyHz;
+			}
+
+			/**
+			 * Route device events of a camera into the queue.
+			 *
+			 * @param pCamera The camera, such as a Camera, GigECamera or
+			 *                VirtualCamera.
+			 * @param pEventName The event to register, or NULL for all
+			 *                   events.
+			 *
+			 * @return The result of RegisterEvent() or RegisterAllEvents().
+			 */
+			template <class CameraT>
+			ErrorType Attach( CameraT* pCamera, const char* pEventName = NULL )
+			{
+				EventOptions options;
+				options.EventCallbackFcn = &CameraEventQueue::OnEvent;
+				options.EventName = pEventName;
+				options.EventUserData = GetSource( pCamera );
+				options.EventUserDataSize = sizeof(Source);
+				return pEventName != NULL ?
+					GetErrorType( pCamera->RegisterEvent( &options ) ) :
+					GetErrorType( pCamera->RegisterAllEvents( &options ) );
+			}
+
+			/**
+			 * Stop routing device events of a camera into the queue.
+			 *
+			 * @param pCamera The camera.
+			 * @param pEventName The event passed to Attach().
+			 *
+			 * @return The result of DeregisterEvent() or
+			 *         DeregisterAllEvents().
+			 */
+			template <class CameraT>
+			ErrorType Detach( CameraT* pCamera, const char* pEventName = NULL )
+			{
+				if ( pEventName == NULL )
+				{
+					return GetErrorType( pCamera->DeregisterAllEvents() );
+				}
+
+				EventOptions options;
+				memset( &options, 0, sizeof(options) );
+				options.EventName = pEventName;
+				return GetErrorType( pCamera->DeregisterEvent( &options ) );
+			}
+
+			/**
+			 * Fetch queued events without blocking.
+			 *
+			 * @param pEvents Array to receive the events, oldest first.
+			 * @param maxEvents Size of the array.
+			 *
+			 * @return The number of events fetched.
+			 */
+			unsigned int Fetch( CameraEvent* pEvents, unsigned int maxEvents )
+			{
+				// Clear the descriptor, then the flag, then drain. A producer
+				// that finds the flag set has published its event before
+				// the flag is cleared, so the drain or the check below sees
+				// it; one that finds it clear signals again. The descriptor
+				// is read even when the flag is clear, as a producer may
+				// write it just after an earlier clear. The flag and head
+				// accesses on both sides are sequentially consistent.
+				ClearFd();
+				m_signalPending.store( false );
+
+				const unsigned long long tail = m_tail.load( std::memory_order_relaxed );
+				const unsigned long long head = m_head.load();
+				const unsigned int count = static_cast<unsigned int>(
+					std::min<unsigned long long>( head - tail, maxEvents ) );
+				for ( unsigned int i = 0; i < count; i++ )
+				{
+					pEvents[i] = m_events[( tail + i ) & m_mask];
+				}
+				m_tail.store( tail + count, std::memory_order_release );
+				m_numFetched.fetch_add( count, std::memory_order_relaxed );
+
+				// Events left behind by a short array, or published during
+				// the drain, must stay signalled.
+				if ( m_head.load() != tail + count )
+				{
+					Signal();
+				}
+				return count;
+			}
+
+			/**
+			 * Wait for events and fetch them.
+			 *
+			 * @param pEvents Array to receive the events, oldest first.
+			 * @param maxEvents Size of the array.
+			 * @param timeout Longest time to wait for the first event.
+			 *
+			 * @return The number of events fetched, 0 on timeout.
+			 */
+			unsigned int Wait( CameraEvent* pEvents, unsigned int maxEvents, std::chrono::milliseconds timeout )
+			{
+				const Clock::time_point deadline = Clock::now() + timeout;
+				for (;;)
+				{
+					const unsigned int count = Fetch( pEvents, maxEvents );
+					const Clock::time_point now = Clock::now();
+					if ( count != 0 || now >= deadline )
+					{
+						return count;
+					}
+
+					const int waitMs = static_cast<int>( std::chrono::duration_cast<std::chrono::milliseconds>(
+						deadline - now + std::chrono::microseconds( 999 ) ).count() );
+#if defined(__linux__)
+					if ( m_eventFd >= 0 )
+					{
+						struct pollfd pfd;
+						pfd.fd = m_eventFd;
+						pfd.events = POLLIN;
+						pfd.revents = 0;
+						poll( &pfd, 1, waitMs );
+						continue;
+					}
+#endif
+					std::this_thread::sleep_for( std::chrono::milliseconds( std::min( waitMs, 1 ) ) );
+				}
+			}
+
+			/**
+			 * Get a descriptor that becomes readable when events are queued,
+			 * for use with poll(), select() or epoll. Do not read from it;
+			 * Fetch() clears it. It can occasionally be readable with no
+			 * event queued, in which case Fetch() returns 0.
+			 *
+			 * @return The descriptor, or -1 if not supported on the platform.
+			 */
+			int GetFd() const
+			{
+#if defined(__linux__)
+				return m_eventFd;
+#else
+				return -1;
+#endif
+			}
+
+			/**
+			 * Get the number of events waiting to be fetched.
+			 *
+			 * @return The number of queued events.
+			 */
+			unsigned int GetNumQueued() const
+			{
+				return static_cast<unsigned int>(
+					m_head.load( std::memory_order_acquire ) - m_tail.load( std::memory_order_acquire ) );
+			}
+
+			/**
+			 * Get the statistics of the queue.
+			 *
+			 * @param pStats Receives the statistics.
+			 */
+			void GetStats( CameraEventQueueStats* pStats ) const
+			{
+				pStats->numReceived = m_numReceived.load( std::memory_order_relaxed );
+				pStats->numFetched = m_numFetched.load( std::memory_order_relaxed );
+				pStats->numOverflows = m_numOverflows.load( std::memory_order_relaxed );
+				pStats->numDataTruncated = m_numDataTruncated.load( std::memory_order_relaxed );
+				pStats->highWatermark = m_highWatermark.load( std::memory_order_relaxed );
+			}
+
+		private:
+
+			static ErrorType GetErrorType( const Error& error ) { return error.GetType(); }
+			static ErrorType GetErrorType( ErrorType error ) { return error; }
+
+			// Number of events over which the smallest offset is taken.
+			static const unsigned int sk_offsetWindow = 256;
+
+			// Registration context of one camera. The device clock mapping
+			// is guarded by the producer mutex.
+			struct Source
+			{
+				CameraEventQueue* pQueue;
+				const void* pCamera;
+				unsigned int windowCount;
+				bool haveOffset;
+				long long currentMinNs;
+				long long previousMinNs;
+			};
+
+			Source* GetSource( const void* pCamera )
+			{
+				for ( size_t i = 0; i < m_sources.size(); i++ )
+				{
+					if ( m_sources[i]->pCamera == pCamera )
+					{
+						return m_sources[i];
+					}
+				}
+
+				// Sources live as long as the queue, so that a callback
+				// racing with Detach() never sees a dangling context.
+				Source* pSource = new Source();
+				pSource->pQueue = this;
+				pSource->pCamera = pCamera;
+				pSource->windowCount = 0;
+				pSource->haveOffset = false;
+				pSource->currentMinNs = 0;
+				pSource->previousMinNs = 0;
+				m_sources.push_back( pSource );
+				return pSource;
+			}
+
+			static void OnEvent( void* pData )
+			{
+				const EventCallbackData* pEventData = static_cast<const EventCallbackData*>( pData );
+				Source* pSource = static_cast<Source*>( pEventData->EventUserData );
+				pSource->pQueue->Push( pSource, *pEventData );
+			}
+
+			void Push( Source* pSource, const EventCallbackData& eventData )
+			{
+				const Clock::time_point receivedTime = Clock::now();
+
+				std::unique_lock<std::mutex> lock( m_producerMutex );
+				m_numReceived.fetch_add( 1, std::memory_order_relaxed );
+				const unsigned long long sequence = m_sequence++;
+				const Clock::time_point hostTime = MapDeviceTime( pSource, eventData.EventTimestamp, receivedTime );
+
+				const unsigned long long head = m_head.load( std::memory_order_relaxed );
+				const unsigned long long tail = m_tail.load( std::memory_order_acquire );
+				if ( head - tail > m_mask )
+				{
+					lock.unlock();
+					m_numOverflows.fetch_add( 1, std::memory_order_relaxed );
+					return;
+				}
+
+				CameraEvent& event = m_events[head & m_mask];
+				event.pCamera = pSource->pCamera;
+				if ( eventData.EventName != NULL )
+				{
+					strncpy( event.name, eventData.EventName, sizeof(event.name) - 1 );
+					event.name[sizeof(event.name) - 1] = '\0';
+				}
+				else
+				{
+					event.name[0] = '\0';
+				}
+				event.id = eventData.EventID;
+				event.sequence = sequence;
+				event.deviceTimestamp = eventData.EventTimestamp;
+				event.hostTime = hostTime;
+				event.receivedTime = receivedTime;
+				event.dataSize = static_cast<unsigned int>( eventData.EventDataSize );
+				const size_t copySize = eventData.EventData != NULL ?
+					std::min<size_t>( eventData.EventDataSize, sizeof(event.data) ) : 0;
+				memcpy( event.data, eventData.EventData, copySize );
+				if ( copySize < eventData.EventDataSize )
+				{
+					m_numDataTruncated.fetch_add( 1, std::memory_order_relaxed );
+				}
+
+				m_head.store( head + 1 );
+				lock.unlock();
+
+				const unsigned int depth = static_cast<unsigned int>( head + 1 - tail );
+				unsigned int highWatermark = m_highWatermark.load( std::memory_order_relaxed );
+				while ( depth > highWatermark &&
+						!m_highWatermark.compare_exchange_weak( highWatermark, depth, std::memory_order_relaxed ) )
+				{
+				}
+
+				Signal();
+			}
+
+			// Called with the producer mutex held.
+			Clock::time_point MapDeviceTime( Source* pSource, unsigned long long deviceTimestamp, Clock::time_point receivedTime )
+			{
+				const long long deviceNs = static_cast<long long>( deviceTimestamp * m_tickPeriodNs );
+				const long long offsetNs = std::chrono::duration_cast<std::chrono::nanoseconds>(
+					receivedTime.time_since_epoch() ).count() - deviceNs;
+
+				// Sliding minimum over the current and the previous window.
+				if ( !pSource->haveOffset || pSource->windowCount == sk_offsetWindow )
+				{
+					pSource->previousMinNs = pSource->haveOffset ? pSource->currentMinNs : offsetNs;
+					pSource->currentMinNs = offsetNs;
+					pSource->windowCount = 0;
+					pSource->haveOffset = true;
+				}
+				pSource->currentMinNs = std::min( pSource->currentMinNs, offsetNs );
+				pSource->windowCount++;
+
+				const long long bestOffsetNs = std::min( pSource->currentMinNs, pSource->previousMinNs );
+				return Clock::time_point( std::chrono::duration_cast<Clock::duration>(
+					std::chrono::nanoseconds( deviceNs + bestOffsetNs ) ) );
+			}
+
+			void Signal()
+			{
+				if ( !m_signalPending.exchange( true ) )
+				{
+#if defined(__linux__)
+					if ( m_eventFd >= 0 )
+					{
+						const unsigned long long one = 1;
+						ssize_t result = write( m_eventFd, &one, sizeof(one) );
+						(void)result;
+					}
+#endif
+				}
+			}
+
+			void ClearFd()
+			{
+#if defined(__linux__)
+				if ( m_eventFd >= 0 )
+				{
+					unsigned long long value;
+					ssize_t result = read( m_eventFd, &value, sizeof(value) );
+					(void)result;
+				}
+#endif
+			}
+
+			CameraEventQueue( const CameraEventQueue& );
+			CameraEventQueue& operator=( const CameraEventQueue& );
+
+			std::vector<CameraEvent>            m_events;
+			unsigned long long                  m_mask;
+			std::atomic<unsigned long long>     m_head;
+			std::atomic<unsigned long long>     m_tail;
+			std::mutex                          m_producerMutex;
+			std::atomic<bool>                   m_signalPending;
+#if defined(__linux__)
+			int                                 m_eventFd;
+#endif
+
+			std::vector<Source*>                m_sources;
+			unsigned long long                  m_sequence;
+			double                              m_tickPeriodNs;
+
+			std::atomic<unsigned long long>     m_numReceived;
+			std::atomic<unsigned long long>     m_numFetched;
+			std::atomic<unsigned long long>     m_numOverflows;
+			std::atomic<unsigned long long>     m_numDataTruncated;
+			std::atomic<unsigned int>           m_highWatermark;
+	};
+}
+
+#endif // FLIR_FC2_CAMERAEVENTQUEUE_H
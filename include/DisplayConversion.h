@@ -0,0 +1,608 @@
+//=============================================================================
+// Copyright (c) 2001-2018 FLIR Systems, Inc. All Rights Reserved.
+//
+// This software is the confidential and proprietary information of FLIR
+// Integrated Imaging Solutions, Inc. ("Confidential Information"). You
+// shall not disclose such Confidential Information and shall use it only in
+// accordance with the terms of the license agreement you entered into
+// with FLIR Integrated Imaging Solutions, Inc. (FLIR).
+//
+// FLIR MAKES NO REPRESENTATIONS OR WARRANTIES ABOUT THE SUITABILITY OF THE
+// SOFTWARE, EITHER EXPRESSED OR IMPLIED, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+// PURPOSE, OR NON-INFRINGEMENT. FLIR SHALL NOT BE LIABLE FOR ANY DAMAGES
+// SUFFERED BY LICENSEE AS A RESULT OF USING, MODIFYING OR DISTRIBUTING
+// THIS SOFTWARE OR ITS DERIVATIVES.
+//=============================================================================
+
+
+#ifndef FLIR_FC2_DISPLAYCONVERSION_H
+#define FLIR_FC2_DISPLAYCONVERSION_H
+
+#include "FlyCapture2Platform.h"
+#include "FlyCapture2Defs.h"
+#include "Error.h"
+#include "Image.h"
+
+#if !defined(_MSC_VER) && __cplusplus < 201103L
+#error "DisplayConversion.h requires C++11"
+#endif
+
+#include <algorithm>
+#include <functional>
+#include <mutex>
+#include <vector>
+
+namespace FlyCapture2
+{
+	/** Region of a source image, in source pixels. */
+	struct DisplayRegion
+	{
+		unsigned int left;
+		unsigned int top;
+		/** Width of the region, or 0 for the rest of the image. */
+		unsigned int width;
+		/** Height of the region, or 0 for the rest of the image. */
+		unsigned int height;
+
+		DisplayRegion()
+		{
+			left = 0;
+			top = 0;
+			width = 0;
+			height = 0;
+		}
+	};
+
+	/** How ConvertForDisplay() combines source pixels. */
+	enum DisplayFilter
+	{
+		/** Take one source pixel or Bayer quad per displayed pixel. */
+		DISPLAY_FILTER_NEAREST,
+		/** Average all source pixels or Bayer quads under a displayed pixel. */
+		DISPLAY_FILTER_BOX
+	};
+
+	namespace Detail
+	{
+		// Layout of a source cell: one pixel, or one 2x2 quad for Bayer
+		// data. Offsets are in bytes from the top left of the cell; the
+		// two green offsets are averaged.
+		struct DisplayCellLayout
+		{
+			unsigned int cellSize;
+			unsigned int bytesPerSample;
+			size_t cellBytes;
+			size_t rOffset;
+			size_t g1Offset;
+			size_t g2Offset;
+			size_t bOffset;
+		};
+
+		inline bool GetDisplayCellLayout( const Image& source, DisplayCellLayout* pLayout )
+		{
+			const PixelFormat format = source.GetPixelFormat();
+			const size_t stride = source.GetStride();
+			const bool isBayer = source.GetBayerTileFormat() != NONE;
+
+			DisplayCellLayout layout;
+			layout.cellSize = 1;
+			layout.bytesPerSample = 1;
+			unsigned int rIndex = 0;
+			unsigned int bIndex = 0;
+			unsigned int gIndex = 0;
+
+			switch ( format )
+			{
+				case PIXEL_FORMAT_MONO8:
+					break;
+				case PIXEL_FORMAT_MONO16:
+					layout.bytesPerSample = 2;
+					break;
+				case PIXEL_FORMAT_RAW8:
+					layout.cellSize = isBayer ? 2 : 1;
+					break;
+				case PIXEL_FORMAT_RAW16:
+					layout.cellSize = isBayer ? 2 : 1;
+					layout.bytesPerSample = 2;
+					break;
+				case PIXEL_FORMAT_RGB8:
+					gIndex = 1;
+					bIndex = 2;
+					break;
+				case PIXEL_FORMAT_RGBU:
+					gIndex = 1;
+					bIndex = 2;
+					break;
+				case PIXEL_FORMAT_BGR:
+				case PIXEL_FORMAT_BGRU:
+					rIndex = 2;
+					gIndex = 1;
+					break;
+				default:
+					return false;
+			}
+
+			const unsigned int channels =
+				( format == PIXEL_FORMAT_RGB8 || format == PIXEL_FORMAT_BGR ) ? 3 :
+				( format == PIXEL_FORMAT_RGBU || format == PIXEL_FORMAT_BGRU ) ? 4 : 1;
+			const size_t sample = layout.bytesPerSample;
+
+			if ( layout.cellSize == 1 )
+			{
+				layout.rOffset = rIndex * sample;
+				layout.g1Offset = gIndex * sample;
+				layout.g2Offset = gIndex * sample;
+				layout.bOffset = bIndex * sample;
+				layout.cellBytes = channels * sample;
+			}
+			else
+			{
+				// Positions in the quad: 0 top left, 1 top right,
+				// 2 bottom left, 3 bottom right.
+				const size_t offsets[4] = { 0, sample, stride, stride + sample };
+				unsigned int r = 0, g1 = 1, g2 = 2, b = 3;
+				switch ( source.GetBayerTileFormat() )
+				{
+					case RGGB: r = 0; g1 = 1; g2 = 2; b = 3; break;
+					case GRBG: g1 = 0; r = 1; b = 2; g2 = 3; break;
+					case GBRG: g1 = 0; b = 1; r = 2; g2 = 3; break;
+					case BGGR: b = 0; g1 = 1; g2 = 2; r = 3; break;
+					default: return false;
+				}
+				layout.rOffset = offsets[r];
+				layout.g1Offset = offsets[g1];
+				layout.g2Offset = offsets[g2];
+				layout.bOffset = offsets[b];
+				layout.cellBytes = 2 * sample;
+			}
+
+			*pLayout = layout;
+			return true;
+		}
+
+		inline unsigned int GetDisplayPixelBytes( PixelFormat format )
+		{
+			switch ( format )
+			{
+				case PIXEL_FORMAT_MONO8: return 1;
+				case PIXEL_FORMAT_RGB8:
+				case PIXEL_FORMAT_BGR: return 3;
+				case PIXEL_FORMAT_RGBU:
+				case PIXEL_FORMAT_BGRU: return 4;
+				default: return 0;
+			}
+		}
+
+		inline unsigned int ReadDisplaySample( const unsigned char* pSample, unsigned int bytesPerSample )
+		{
+			// 16 bit data is MSB aligned, so the high byte is the 8 bit value.
+			return bytesPerSample == 1 ? pSample[0] :
+				*reinterpret_cast<const unsigned short*>( pSample ) >> 8;
+		}
+
+		template <PixelFormat DestFormat>
+		inline void WriteDisplayPixel(
+				unsigned char* pDest,
+				unsigned int   r,
+				unsigned int   g,
+				unsigned int   b )
+		{
+			switch ( DestFormat )
+			{
+				case PIXEL_FORMAT_MONO8:
+					pDest[0] = static_cast<unsigned char>( ( r + 2 * g + b ) >> 2 );
+					break;
+				case PIXEL_FORMAT_RGB8:
+					pDest[0] = static_cast<unsigned char>( r );
+					pDest[1] = static_cast<unsigned char>( g );
+					pDest[2] = static_cast<unsigned char>( b );
+					break;
+				case PIXEL_FORMAT_RGBU:
+					pDest[0] = static_cast<unsigned char>( r );
+					pDest[1] = static_cast<unsigned char>( g );
+					pDest[2] = static_cast<unsigned char>( b );
+					pDest[3] = 0xFF;
+					break;
+				case PIXEL_FORMAT_BGR:
+					pDest[0] = static_cast<unsigned char>( b );
+					pDest[1] = static_cast<unsigned char>( g );
+					pDest[2] = static_cast<unsigned char>( r );
+					break;
+				default:
+					pDest[0] = static_cast<unsigned char>( b );
+					pDest[1] = static_cast<unsigned char>( g );
+					pDest[2] = static_cast<unsigned char>( r );
+					pDest[3] = 0xFF;
+					break;
+			}
+		}
+
+		// Averages (or samples) the cells under each displayed pixel. Rows
+		// are read in order, accumulating into one sum per displayed column.
+		template <unsigned int BytesPerSample, PixelFormat DestFormat>
+		void DownscaleCells(
+				const unsigned char*      pRegion,
+				size_t                    sourceStride,
+				const DisplayCellLayout&  layout,
+				unsigned int              cellsY,
+				const std::vector<unsigned int>& colStart,
+				const std::vector<unsigned int>& colEnd,
+				unsigned char*            pDest,
+				size_t                    destStride,
+				unsigned int              destRows,
+				DisplayFilter             filter )
+		{
+			const unsigned int destCols = static_cast<unsigned int>( colStart.size() );
+			const unsigned int destPixelBytes = GetDisplayPixelBytes( DestFormat );
+			const size_t cellRowBytes = sourceStride * layout.cellSize;
+			std::vector<unsigned int> sums( destCols * 3 );
+
+			// Sums are scaled by 2^32 / count instead of divided, since
+			// the division would dominate the loop. The reciprocals only
+			// change with the number of rows averaged. They are rounded
+			// up so that averages ending in exactly one half still round
+			// up.
+			std::vector<unsigned long long> scales( destCols );
+			unsigned int scaleRows = 0;
+
+			for ( unsigned int y = 0; y < destRows; y++ )
+			{
+				const unsigned int rowStart = static_cast<unsigned int>( static_cast<unsigned long long>( y ) * cellsY / destRows );
+				unsigned int rowEnd = static_cast<unsigned int>( static_cast<unsigned long long>( y + 1 ) * cellsY / destRows );
+				if ( filter == DISPLAY_FILTER_NEAREST || rowEnd <= rowStart )
+				{
+					rowEnd = rowStart + 1;
+				}
+				if ( rowEnd - rowStart != scaleRows )
+				{
+					scaleRows = rowEnd - rowStart;
+					for ( unsigned int x = 0; x < destCols; x++ )
+					{
+						const unsigned long long count = static_cast<unsigned long long>( scaleRows ) *
+							( filter == DISPLAY_FILTER_NEAREST ? 1 : colEnd[x] - colStart[x] );
+						scales[x] = ( ( 1ULL << 32 ) + count - 1 ) / count;
+					}
+				}
+
+				std::fill( sums.begin(), sums.end(), 0u );
+				for ( unsigned int cy = rowStart; cy < rowEnd; cy++ )
+				{
+					const unsigned char* pRow = pRegion + cy * cellRowBytes;
+					for ( unsigned int x = 0; x < destCols; x++ )
+					{
+						const unsigned int end = filter == DISPLAY_FILTER_NEAREST ? colStart[x] + 1 : colEnd[x];
+						unsigned int r = 0, g = 0, b = 0;
+						for ( unsigned int cx = colStart[x]; cx < end; cx++ )
+						{
+							const unsigned char* pCell = pRow + cx * layout.cellBytes;
+							r += ReadDisplaySample( pCell + layout.rOffset, BytesPerSample );
+							g += ReadDisplaySample( pCell + layout.g1Offset, BytesPerSample ) +
+								 ReadDisplaySample( pCell + layout.g2Offset, BytesPerSample );
+							b += ReadDisplaySample( pCell + layout.bOffset, BytesPerSample );
+						}
+						sums[x * 3] += r;
+						sums[x * 3 + 1] += g;
+						sums[x * 3 + 2] += b;
+					}
+				}
+
+				unsigned char* pOut = pDest + y * destStride;
+				for ( unsigned int x = 0; x < destCols; x++ )
+				{
+					const unsigned long long scale = scales[x];
+					WriteDisplayPixel<DestFormat>(
+						pOut + x * destPixelBytes,
+						static_cast<unsigned int>( ( sums[x * 3] * scale + ( 1ULL << 31 ) ) >> 32 ),
+						static_cast<unsigned int>( ( sums[x * 3 + 1] * scale + ( 1ULL << 32 ) ) >> 33 ),
+						static_cast<unsigned int>( ( sums[x * 3 + 2] * scale + ( 1ULL << 31 ) ) >> 32 ) );
+				}
+			}
+		}
+	}
+
+	namespace Detail
+	{
+		template <unsigned int BytesPerSample>
+		void DownscaleCells(
+				const unsigned char*      pRegion,
+				size_t                    sourceStride,
+				const DisplayCellLayout&  layout,
+				unsigned int              cellsY,
+				const std::vector<unsigned int>& colStart,
+				const std::vector<unsigned int>& colEnd,
+				unsigned char*            pDest,
+				size_t                    destStride,
+				unsigned int              destRows,
+				PixelFormat               destFormat,
+				DisplayFilter             filter )
+		{
+			// One instantiation per output format keeps the format switch
+			// out of the per-pixel loop.
+			switch ( destFormat )
+			{
+				case PIXEL_FORMAT_MONO8:
+					DownscaleCells<BytesPerSample, PIXEL_FORMAT_MONO8>( pRegion, sourceStride, layout, cellsY,
+						colStart, colEnd, pDest, destStride, destRows, filter );
+					break;
+				case PIXEL_FORMAT_RGB8:
+					DownscaleCells<BytesPerSample, PIXEL_FORMAT_RGB8>( pRegion, sourceStride, layout, cellsY,
+						colStart, colEnd, pDest, destStride, destRows, filter );
+					break;
+				case PIXEL_FORMAT_RGBU:
+					DownscaleCells<BytesPerSample, PIXEL_FORMAT_RGBU>( pRegion, sourceStride, layout, cellsY,
+						colStart, colEnd, pDest, destStride, destRows, filter );
+					break;
+				case PIXEL_FORMAT_BGR:
+					DownscaleCells<BytesPerSample, PIXEL_FORMAT_BGR>( pRegion, sourceStride, layout, cellsY,
+						colStart, colEnd, pDest, destStride, destRows, filter );
+					break;
+				default:
+					DownscaleCells<BytesPerSample, PIXEL_FORMAT_BGRU>( pRegion, sourceStride, layout, cellsY,
+						colStart, colEnd, pDest, destStride, destRows, filter );
+					break;
+			}
+		}
+	}
+
+	/**
+	 * Convert an image directly to the size it is displayed at. Only the
+	 * visible region is read, and Bayer data is reduced by taking each
+	 * 2x2 quad as one colour pixel, so a large sensor shown in a small
+	 * window costs about as much as the window, not the sensor.
+	 *
+	 * The direct path handles MONO8, MONO16, RAW8, RAW16, RGB8, BGR, RGBU
+	 * and BGRU sources. When the region is shown larger than its Bayer
+	 * quads, or the source is in another format, the whole image is
+	 * converted with Image::Convert() first; at 1:1 with no region that is
+	 * the only step.
+	 *
+	 * If pDest already has the requested size and format the pixels are
+	 * written into its buffer; otherwise it receives a new buffer.
+	 *
+	 * @param source The image to convert.
+	 * @param pDest The displayed image.
+	 * @param destCols Columns of the displayed image.
+	 * @param destRows Rows of the displayed image.
+	 * @param region Part of the source that is visible.
+	 * @param destFormat MONO8, RGB8, BGR, RGBU or BGRU.
+	 * @param filter How to combine source pixels.
+	 *
+	 * @return PGRERROR_OK, PGRERROR_INVALID_PARAMETER, or the error of
+	 *         Image::Convert().
+	 */
+	inline ErrorType ConvertForDisplay(
+			const Image&         source,
+			Image*               pDest,
+			unsigned int         destCols,
+			unsigned int         destRows,
+			const DisplayRegion& region = DisplayRegion(),
+			PixelFormat          destFormat = PIXEL_FORMAT_BGRU,
+			DisplayFilter        filter = DISPLAY_FILTER_BOX )
+	{
+		const unsigned int destPixelBytes = Detail::GetDisplayPixelBytes( destFormat );
+		if ( pDest == NULL || pDest == &source || destCols == 0 || destRows == 0 || destPixelBytes == 0 ||
+			 region.left >= source.GetCols() || region.top >= source.GetRows() )
+		{
+			return PGRERROR_INVALID_PARAMETER;
+		}
+
+		unsigned int left = region.left;
+		unsigned int top = region.top;
+		unsigned int right = ( region.width == 0 || region.width > source.GetCols() - left ) ?
+			source.GetCols() : left + region.width;
+		unsigned int bottom = ( region.height == 0 || region.height > source.GetRows() - top ) ?
+			source.GetRows() : top + region.height;
+
+		Detail::DisplayCellLayout layout;
+		const bool isSupported = Detail::GetDisplayCellLayout( source, &layout );
+		if ( isSupported && layout.cellSize == 2 )
+		{
+			// Keep whole quads so the colour phase does not change.
+			left &= ~1u;
+			top &= ~1u;
+			right &= ~1u;
+			bottom &= ~1u;
+		}
+
+		const unsigned int cellsX = isSupported ? ( right - left ) / layout.cellSize : 0;
+		const unsigned int cellsY = isSupported ? ( bottom - top ) / layout.cellSize : 0;
+		if ( !isSupported || cellsX == 0 || cellsY == 0 ||
+			 ( layout.cellSize > 1 && ( destCols > cellsX || destRows > cellsY ) ) )
+		{
+			if ( region.left == 0 && region.top == 0 &&
+				 destCols == source.GetCols() && destRows == source.GetRows() &&
+				 ( region.width == 0 || region.width == destCols ) &&
+				 ( region.height == 0 || region.height == destRows ) )
+			{
+				return source.Convert( destFormat, pDest ).GetType();
+			}
+
+			Image converted;
+			Error error = source.Convert( destFormat, &converted );
+			if ( error != PGRERROR_OK )
+			{
+				return error.GetType();
+			}
+			if ( !Detail::GetDisplayCellLayout( converted, &layout ) || layout.cellSize != 1 )
+			{
+				return PGRERROR_NOT_IMPLEMENTED;
+			}
+			return ConvertForDisplay( converted, pDest, destCols, destRows, region, destFormat, filter );
+		}
+
+		std::vector<unsigned int> colStart( destCols );
+		std::vector<unsigned int> colEnd( destCols );
+		for ( unsigned int x = 0; x < destCols; x++ )
+		{
+			colStart[x] = static_cast<unsigned int>( static_cast<unsigned long long>( x ) * cellsX / destCols );
+			colEnd[x] = static_cast<unsigned int>( static_cast<unsigned long long>( x + 1 ) * cellsX / destCols );
+			if ( colEnd[x] <= colStart[x] )
+			{
+				colEnd[x] = colStart[x] + 1;
+			}
+		}
+
+		// Write in place when pDest already has the right geometry, as it
+		// does from the second frame on; otherwise build the image aside.
+		const size_t destStride = static_cast<size_t>( destCols ) * destPixelBytes;
+		const bool inPlace =
+			pDest->GetCols() == destCols && pDest->GetRows() == destRows &&
+			pDest->GetPixelFormat() == destFormat && pDest->GetStride() == destStride &&
+			pDest->GetData() != NULL && pDest->GetDataSize() >= destStride * destRows;
+		std::vector<unsigned char> scratch;
+		unsigned char* pOut = pDest->GetData();
+		if ( !inPlace )
+		{
+			scratch.resize( destStride * destRows );
+			pOut = &scratch[0];
+		}
+
+		const unsigned char* pRegion = source.GetData() +
+			static_cast<size_t>( top ) * source.GetStride() +
+			static_cast<size_t>( left / layout.cellSize ) * layout.cellBytes;
+		if ( layout.bytesPerSample == 1 )
+		{
+			Detail::DownscaleCells<1>( pRegion, source.GetStride(), layout, cellsY, colStart, colEnd,
+				pOut, destStride, destRows, destFormat, filter );
+		}
+		else
+		{
+			Detail::DownscaleCells<2>( pRegion, source.GetStride(), layout, cellsY, colStart, colEnd,
+				pOut, destStride, destRows, destFormat, filter );
+		}
+
+		if ( !inPlace )
+		{
+			Image wrapper( destRows, destCols, static_cast<unsigned int>( destStride ), pOut,
+				static_cast<unsigned int>( scratch.size() ), destFormat );
+			return pDest->DeepCopy( &wrapper ).GetType();
+		}
+		return PGRERROR_OK;
+	}
+
+	/**
+	 * The DisplayConverter class holds the current display size and
+	 * visible region of a viewer and converts frames to it. The viewer
+	 * updates the target as the window is resized or panned, while
+	 * conversion threads call Convert(). Its conversion function can be
+	 * passed to ViewerPipeline::Start().
+	 */
+	class DisplayConverter
+	{
+		public:
+
+			DisplayConverter()
+				: m_destCols( 0 ),
+				  m_destRows( 0 ),
+				  m_destFormat( PIXEL_FORMAT_BGRU ),
+				  m_filter( DISPLAY_FILTER_BOX )
+			{
+			}
+
+			/**
+			 * Set the size frames are displayed at and the visible region.
+			 *
+			 * @param destCols Displayed columns, or 0 to show the region
+			 *                 at 1:1.
+			 * @param destRows Displayed rows, or 0 to show the region at
+			 *                 1:1.
+			 * @param region The visible region of the frame.
+			 */
+			void SetTarget( unsigned int destCols, unsigned int destRows, const DisplayRegion& region = DisplayRegion() )
+			{
+				std::lock_guard<std::mutex> lock( m_mutex );
+				m_destCols = destCols;
+				m_destRows = destRows;
+				m_region = region;
+			}
+
+			/**
+			 * Set the pixel format of displayed frames. The default is BGRU.
+			 *
+			 * @param format MONO8, RGB8, BGR, RGBU or BGRU.
+			 */
+			void SetPixelFormat( PixelFormat format )
+			{
+				std::lock_guard<std::mutex> lock( m_mutex );
+				m_destFormat = format;
+			}
+
+			/**
+			 * Set how source pixels are combined. The default is
+			 * DISPLAY_FILTER_BOX.
+			 *
+			 * @param filter The filter.
+			 */
+			void SetFilter( DisplayFilter filter )
+			{
+				std::lock_guard<std::mutex> lock( m_mutex );
+				m_filter = filter;
+			}
+
+			/**
+			 * Convert a frame for the current target.
+			 *
+			 * @param source The frame.
+			 * @param pDest The displayed image.
+			 *
+			 * @return As ConvertForDisplay().
+			 */
+			ErrorType Convert( const Image& source, Image* pDest ) const
+			{
+				unsigned int destCols;
+				unsigned int destRows;
+				DisplayRegion region;
+				PixelFormat destFormat;
+				DisplayFilter filter;
+				{
+					std::lock_guard<std::mutex> lock( m_mutex );
+					destCols = m_destCols;
+					destRows = m_destRows;
+					region = m_region;
+					destFormat = m_destFormat;
+					filter = m_filter;
+				}
+
+				if ( region.left >= source.GetCols() || region.top >= source.GetRows() )
+				{
+					return PGRERROR_INVALID_PARAMETER;
+				}
+				if ( destCols == 0 )
+				{
+					destCols = region.width != 0 ? region.width : source.GetCols() - region.left;
+				}
+				if ( destRows == 0 )
+				{
+					destRows = region.height != 0 ? region.height : source.GetRows() - region.top;
+				}
+				return ConvertForDisplay( source, pDest, destCols, destRows, region, destFormat, filter );
+			}
+
+			/**
+			 * Get a function calling Convert() on this object, for
+			 * ViewerPipeline::Start(). The object must outlive the
+			 * pipeline.
+			 *
+			 * @return The conversion function.
+			 */
+			std::function<ErrorType( const Image&, Image* )> GetConvertFunction() const
+			{
+				return [this]( const Image& source, Image* pDest ) { return Convert( source, pDest ); };
+			}
+
+		private:
+
+			DisplayConverter( const DisplayConverter& );
+			DisplayConverter& operator=( const DisplayConverter& );
+
+			mutable std::mutex m_mutex;
+			unsigned int       m_destCols;
+			unsigned int       m_destRows;
+			DisplayRegion      m_region;
+			PixelFormat        m_destFormat;
+			DisplayFilter      m_filter;
+	};
+}
+
+#endif // FLIR_FC2_DISPLAYCONVERSION_H
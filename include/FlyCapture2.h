@@ -48,6 +48,8 @@
 #include "Camera.h"
 #include "GigECamera.h"
 #include "Image.h"
+#include "ImageView.h"
+#include "AlignedImage.h"
 
 //=============================================================================
 // Utility classes
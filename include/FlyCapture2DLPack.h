@@ -0,0 +1,213 @@
+//=============================================================================
+// Copyright (c) 2001-2018 FLIR Systems, Inc. All Rights Reserved.
+//
+// This software is the confidential and proprietary information of FLIR
+// Integrated Imaging Solutions, Inc. ("Confidential Information"). You
+// shall not disclose such Confidential Information and shall use it only in
+// accordance with the terms of the license agreement you entered into
+// with FLIR Integrated Imaging Solutions, Inc. (FLIR).
+//
+// FLIR MAKES NO REPRESENTATIONS OR WARRANTIES ABOUT THE SUITABILITY OF THE
+// SOFTWARE, EITHER EXPRESSED OR IMPLIED, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+// PURPOSE, OR NON-INFRINGEMENT. FLIR SHALL NOT BE LIABLE FOR ANY DAMAGES
+// SUFFERED BY LICENSEE AS A RESULT OF USING, MODIFYING OR DISTRIBUTING
+// THIS SOFTWARE OR ITS DERIVATIVES.
+//=============================================================================
+
+#ifndef FLIR_FLYCAPTURE2DLPACK_H
+#define FLIR_FLYCAPTURE2DLPACK_H
+
+//=============================================================================
+// Optional zero-copy interoperability between FlyCapture2 images and DLPack
+// tensors. This header is not included by FlyCapture2.h; include it after
+// making dlpack/dlpack.h available on the include path.
+//=============================================================================
+
+#include "FlyCapture2Platform.h"
+#include "FlyCapture2Defs.h"
+#include "Image.h"
+#include "ImageView.h"
+
+#include <stdint.h>
+#include <dlpack/dlpack.h>
+
+// DLTensor::ctx was renamed to device in DLPack v0.5. Releases up to v0.5
+// write DLPACK_VERSION in octal (v0.5 is 050), later ones in decimal (60).
+#if defined(DLPACK_MAJOR_VERSION) || ( defined(DLPACK_VERSION) && DLPACK_VERSION >= 050 )
+#define FLIR_FC2_DLTENSOR_DEVICE device
+#else
+#define FLIR_FC2_DLTENSOR_DEVICE ctx
+#endif
+
+namespace FlyCapture2
+{
+	namespace Detail
+	{
+		/** Storage kept alive for the lifetime of an exported tensor. */
+		struct DLPackImageContext
+		{
+			DLManagedTensor tensor;
+			Image           image;
+			int64_t         shape[3];
+			int64_t         strides[3];
+		};
+
+		inline void DeleteDLPackImageContext( DLManagedTensor* pTensor )
+		{
+			delete static_cast<DLPackImageContext*>( pTensor->manager_ctx );
+		}
+
+		inline void SetDLTensorCPUDevice( DLTensor* pTensor )
+		{
+			pTensor->FLIR_FC2_DLTENSOR_DEVICE.device_type = kDLCPU;
+			pTensor->FLIR_FC2_DLTENSOR_DEVICE.device_id = 0;
+		}
+
+		inline bool IsDLTensorOnCPU( const DLTensor& tensor )
+		{
+			return tensor.FLIR_FC2_DLTENSOR_DEVICE.device_type == kDLCPU;
+		}
+	}
+
+	/**
+	 * Export an image as a DLPack tensor without copying the pixel data.
+	 * Single channel formats are exported with shape (rows, cols) and
+	 * multi-channel formats with shape (rows, cols, channels). The tensor
+	 * holds a reference to the image buffer, in the same way as a copy of
+	 * the Image would, so a buffer retrieved from a camera is not requeued
+	 * until the consumer calls the deleter of the returned tensor.
+	 *
+	 * @param image The image to export.
+	 *
+	 * @return The managed tensor, or NULL if the image is empty, is in a
+	 *         packed or compressed format, or has a stride that is not a
+	 *         multiple of the channel size.
+	 */
+	inline DLManagedTensor* ExportToDLPack( const Image& image )
+	{
+		unsigned int rows = 0;
+		unsigned int cols = 0;
+		unsigned int stride = 0;
+		PixelFormat format = UNSPECIFIED_PIXEL_FORMAT;
+		image.GetDimensions( &rows, &cols, &stride, &format );
+
+		unsigned int bitsPerChannel = 0;
+		unsigned int numChannels = 0;
+		bool isSigned = false;
+		if ( image.GetData() == NULL ||
+			 !GetChannelLayout( format, &bitsPerChannel, &numChannels, &isSigned ) ||
+			 stride % ( bitsPerChannel / 8 ) != 0 )
+		{
+			return NULL;
+		}
+
+		Detail::DLPackImageContext* pContext = new Detail::DLPackImageContext();
+		pContext->image = image;
+
+		pContext->shape[0] = rows;
+		pContext->shape[1] = cols;
+		pContext->shape[2] = numChannels;
+		pContext->strides[0] = stride / ( bitsPerChannel / 8 );
+		pContext->strides[1] = numChannels;
+		pContext->strides[2] = 1;
+
+		DLTensor& tensor = pContext->tensor.dl_tensor;
+		tensor.data = pContext->image.GetData();
+		Detail::SetDLTensorCPUDevice( &tensor );
+		tensor.ndim = numChannels == 1 ? 2 : 3;
+		tensor.dtype.code = static_cast<uint8_t>( isSigned ? kDLInt : kDLUInt );
+		tensor.dtype.bits = static_cast<uint8_t>( bitsPerChannel );
+		tensor.dtype.lanes = 1;
+		tensor.shape = pContext->shape;
+		tensor.strides = pContext->strides;
+		tensor.byte_offset = 0;
+
+		pContext->tensor.manager_ctx = pContext;
+		pContext->tensor.deleter = Detail::DeleteDLPackImageContext;
+
+		return &pContext->tensor;
+	}
+
+	/**
+	 * Wrap a DLPack tensor as an Image without copying, so it can be used
+	 * with Image::Convert() and Image::Save(). Ownership of the tensor is
+	 * not transferred to the Image object. It is the user's responsibility
+	 * to keep the tensor alive while the image is in use.
+	 *
+	 * The tensor must reside in CPU memory, have shape (rows, cols) or
+	 * (rows, cols, channels), have interleaved channels and contiguous
+	 * columns, and its element type and channel count must match the
+	 * specified pixel format.
+	 *
+	 * @param tensor The tensor to wrap.
+	 * @param format Pixel format of the tensor data.
+	 * @param pImage The image to attach the tensor data to.
+	 *
+	 * @return PGRERROR_OK, or PGRERROR_INVALID_PARAMETER if the tensor cannot
+	 *         be represented as an image of the specified format.
+	 */
+	inline ErrorType WrapDLPackTensor(
+			const DLTensor& tensor,
+			PixelFormat     format,
+			Image*          pImage )
+	{
+		unsigned int bitsPerChannel = 0;
+		unsigned int numChannels = 0;
+		bool isSigned = false;
+		if ( pImage == NULL ||
+			 !Detail::IsDLTensorOnCPU( tensor ) ||
+			 !GetChannelLayout( format, &bitsPerChannel, &numChannels, &isSigned ) )
+		{
+			return PGRERROR_INVALID_PARAMETER;
+		}
+
+		const int expectedNDim = numChannels == 1 ? 2 : 3;
+		const uint8_t expectedCode = static_cast<uint8_t>( isSigned ? kDLInt : kDLUInt );
+		if ( tensor.ndim != expectedNDim ||
+			 tensor.dtype.code != expectedCode ||
+			 tensor.dtype.bits != bitsPerChannel ||
+			 tensor.dtype.lanes != 1 ||
+			 ( expectedNDim == 3 && tensor.shape[2] != numChannels ) )
+		{
+			return PGRERROR_INVALID_PARAMETER;
+		}
+
+		const int64_t rows = tensor.shape[0];
+		const int64_t cols = tensor.shape[1];
+		const int64_t bytesPerChannel = bitsPerChannel / 8;
+		int64_t rowStride = cols * numChannels;
+		if ( tensor.strides != NULL )
+		{
+			const bool contiguousColumns = tensor.strides[1] == numChannels &&
+				( expectedNDim == 2 || tensor.strides[2] == 1 );
+			if ( !contiguousColumns || tensor.strides[0] < rowStride )
+			{
+				return PGRERROR_INVALID_PARAMETER;
+			}
+			rowStride = tensor.strides[0];
+		}
+
+		// The last row only needs to hold the pixels, not a full stride,
+		// which matters for a slice of a larger tensor.
+		const int64_t stride = rowStride * bytesPerChannel;
+		const int64_t dataSize = ( rows - 1 ) * stride + cols * numChannels * bytesPerChannel;
+		if ( rows <= 0 || cols <= 0 || stride > 0xFFFFFFFFLL || dataSize > 0xFFFFFFFFLL )
+		{
+			return PGRERROR_INVALID_PARAMETER;
+		}
+
+		*pImage = Image(
+				static_cast<unsigned int>( rows ),
+				static_cast<unsigned int>( cols ),
+				static_cast<unsigned int>( stride ),
+				static_cast<unsigned char*>( tensor.data ) + tensor.byte_offset,
+				static_cast<unsigned int>( dataSize ),
+				format );
+		return PGRERROR_OK;
+	}
+}
+
+#undef FLIR_FC2_DLTENSOR_DEVICE
+
+#endif // FLIR_FLYCAPTURE2DLPACK_H
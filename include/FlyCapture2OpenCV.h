@@ -0,0 +1,305 @@
+//=============================================================================
+// Copyright (c) 2001-2018 FLIR Systems, Inc. All Rights Reserved.
+//
+// This software is the confidential and proprietary information of FLIR
+// Integrated Imaging Solutions, Inc. ("Confidential Information"). You
+// shall not disclose such Confidential Information and shall use it only in
+// accordance with the terms of the license agreement you entered into
+// with FLIR Integrated Imaging Solutions, Inc. (FLIR).
+//
+// FLIR MAKES NO REPRESENTATIONS OR WARRANTIES ABOUT THE SUITABILITY OF THE
+// SOFTWARE, EITHER EXPRESSED OR IMPLIED, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+// PURPOSE, OR NON-INFRINGEMENT. FLIR SHALL NOT BE LIABLE FOR ANY DAMAGES
+// SUFFERED BY LICENSEE AS A RESULT OF USING, MODIFYING OR DISTRIBUTING
+// THIS SOFTWARE OR ITS DERIVATIVES.
+//=============================================================================
+
+#ifndef FLIR_FLYCAPTURE2OPENCV_H
+#define FLIR_FLYCAPTURE2OPENCV_H
+
+//=============================================================================
+// Optional zero-copy interoperability between FlyCapture2 images and OpenCV
+// matrices. This header is not included by FlyCapture2.h; include it after
+// making the OpenCV core headers available on the include path. OpenCV 3
+// or later is required.
+//=============================================================================
+
+#include "FlyCapture2Platform.h"
+#include "FlyCapture2Defs.h"
+#include "Error.h"
+#include "Image.h"
+#include "ImageView.h"
+
+#include <opencv2/core/core.hpp>
+
+namespace FlyCapture2
+{
+	namespace Detail
+	{
+		inline int GetMatType( PixelFormat format )
+		{
+			unsigned int bitsPerChannel = 0;
+			unsigned int numChannels = 0;
+			bool isSigned = false;
+			if ( !GetChannelLayout( format, &bitsPerChannel, &numChannels, &isSigned ) )
+			{
+				return -1;
+			}
+
+			const int depth = bitsPerChannel == 8 ? CV_8U : ( isSigned ? CV_16S : CV_16U );
+			return CV_MAKETYPE( depth, static_cast<int>( numChannels ) );
+		}
+
+#if CV_VERSION_MAJOR >= 4
+		typedef cv::AccessFlag MatAccessFlag;
+#else
+		typedef int MatAccessFlag;
+#endif
+
+		/**
+		 * Allocator of matrices that share an image buffer. The UMatData
+		 * of such a matrix owns a copy of the Image, so the buffer stays
+		 * referenced until the last matrix sharing it is released. New
+		 * allocations, such as from cv::Mat::create(), are passed to the
+		 * standard allocator.
+		 */
+		class ImageMatAllocator : public cv::MatAllocator
+		{
+			public:
+
+				virtual cv::UMatData* allocate(
+						int                 dims,
+						const int*          sizes,
+						int                 type,
+						void*               data,
+						size_t*             step,
+						MatAccessFlag       flags,
+						cv::UMatUsageFlags  usageFlags ) const
+				{
+					return cv::Mat::getStdAllocator()->allocate( dims, sizes, type, data, step, flags, usageFlags );
+				}
+
+				virtual bool allocate(
+						cv::UMatData*       data,
+						MatAccessFlag       accessFlags,
+						cv::UMatUsageFlags  usageFlags ) const
+				{
+					return cv::Mat::getStdAllocator()->allocate( data, accessFlags, usageFlags );
+				}
+
+				virtual void deallocate( cv::UMatData* data ) const
+				{
+					if ( data == NULL )
+					{
+						return;
+					}
+
+					delete static_cast<Image*>( data->handle );
+					data->handle = NULL;
+					delete data;
+				}
+		};
+
+		inline ImageMatAllocator* GetImageMatAllocator()
+		{
+			// Never destroyed, so matrices released during static
+			// destruction still find their allocator.
+			static ImageMatAllocator* s_pAllocator = new ImageMatAllocator();
+			return s_pAllocator;
+		}
+	}
+
+	/**
+	 * Create a cv::Mat header over the pixels of an image without copying.
+	 * The matrix does not hold a reference to the image buffer; the Image
+	 * must outlive it. Use ImageMat when the matrix needs to keep the buffer
+	 * alive. Channels keep the order of the pixel format, so images in
+	 * PIXEL_FORMAT_BGR or PIXEL_FORMAT_BGRU match the OpenCV convention.
+	 *
+	 * @param image The image to view.
+	 * @param pMat The matrix header to fill.
+	 *
+	 * @return true if the matrix was filled, false if the image is empty or
+	 *         is in a packed or compressed format.
+	 */
+	inline bool ImageToMat( const Image& image, cv::Mat* pMat )
+	{
+		unsigned int rows = 0;
+		unsigned int cols = 0;
+		unsigned int stride = 0;
+		PixelFormat format = UNSPECIFIED_PIXEL_FORMAT;
+		image.GetDimensions( &rows, &cols, &stride, &format );
+
+		const int type = Detail::GetMatType( format );
+		if ( type < 0 || image.GetData() == NULL || pMat == NULL )
+		{
+			return false;
+		}
+
+		*pMat = cv::Mat(
+				static_cast<int>( rows ),
+				static_cast<int>( cols ),
+				type,
+				image.GetData(),
+				stride );
+		return true;
+	}
+
+	/**
+	 * Create a cv::Mat over the pixels of an image without copying, holding
+	 * a reference to the image buffer. Every copy or region of the matrix
+	 * shares that reference, so a buffer retrieved from a camera is not
+	 * requeued until the last of them is released.
+	 *
+	 * @param image The image to share.
+	 * @param pMat The matrix to fill.
+	 *
+	 * @return true if the matrix was filled, false if the image is empty or
+	 *         is in a packed or compressed format.
+	 */
+	inline bool ImageToSharedMat( const Image& image, cv::Mat* pMat )
+	{
+		cv::Mat mat;
+		if ( !ImageToMat( image, &mat ) )
+		{
+			return false;
+		}
+
+		Detail::ImageMatAllocator* pAllocator = Detail::GetImageMatAllocator();
+		cv::UMatData* pData = new cv::UMatData( pAllocator );
+		pData->handle = new Image( image );
+		pData->data = mat.data;
+		pData->origdata = mat.data;
+		pData->size = static_cast<size_t>( mat.dataend - mat.datastart );
+		pData->refcount = 1;
+
+		mat.u = pData;
+		mat.allocator = pAllocator;
+		*pMat = mat;
+		return true;
+	}
+
+	/**
+	 * Wrap a cv::Mat as an Image without copying, so it can be used with
+	 * Image::Convert() and Image::Save(). Ownership of the matrix data is not
+	 * transferred to the Image object. It is the user's responsibility to
+	 * keep the matrix alive while the image is in use.
+	 *
+	 * @param mat The two dimensional matrix to wrap.
+	 * @param format Pixel format of the matrix data. Its channel count and
+	 *               depth must match the type of the matrix.
+	 * @param pImage The image to attach the matrix data to.
+	 *
+	 * @return PGRERROR_OK, or PGRERROR_INVALID_PARAMETER if the matrix cannot
+	 *         be represented as an image of the specified format.
+	 */
+	inline ErrorType WrapMat( const cv::Mat& mat, PixelFormat format, Image* pImage )
+	{
+		if ( pImage == NULL ||
+			 mat.dims != 2 ||
+			 mat.empty() ||
+			 mat.type() != Detail::GetMatType( format ) )
+		{
+			return PGRERROR_INVALID_PARAMETER;
+		}
+
+		// The last row only needs to hold the pixels, not a full stride,
+		// which matters for a region of a larger matrix.
+		const size_t stride = mat.step[0];
+		const size_t dataSize = stride * static_cast<size_t>( mat.rows - 1 ) + mat.elemSize() * mat.cols;
+		if ( stride > 0xFFFFFFFFu || dataSize > 0xFFFFFFFFu )
+		{
+			return PGRERROR_INVALID_PARAMETER;
+		}
+
+		*pImage = Image(
+				static_cast<unsigned int>( mat.rows ),
+				static_cast<unsigned int>( mat.cols ),
+				static_cast<unsigned int>( stride ),
+				const_cast<unsigned char*>( mat.ptr<unsigned char>() ),
+				static_cast<unsigned int>( dataSize ),
+				format );
+		return PGRERROR_OK;
+	}
+
+	/**
+	 * A cv::Mat that shares the buffer of an image. The matrix holds a
+	 * reference to the image buffer, in the same way as a copy of the Image
+	 * would, and so does every matrix copied out of GetMat(), so a buffer
+	 * retrieved from a camera is not requeued while any of them exists.
+	 */
+	class ImageMat
+	{
+		public:
+
+			/**
+			 * Default constructor. Creates an empty matrix.
+			 */
+			ImageMat() {}
+
+			/**
+			 * Construct a matrix that shares the buffer of an image. The
+			 * matrix is empty if the image cannot be represented as a
+			 * cv::Mat.
+			 *
+			 * @param image The image to share.
+			 */
+			explicit ImageMat( const Image& image ) { Attach( image ); }
+
+			/**
+			 * Share the buffer of an image, releasing any previously shared
+			 * buffer.
+			 *
+			 * @param image The image to share.
+			 *
+			 * @return true if the matrix was filled, false if the image is
+			 *         empty or is in a packed or compressed format.
+			 */
+			bool Attach( const Image& image )
+			{
+				m_mat.release();
+				m_image = image;
+				if ( !ImageToSharedMat( m_image, &m_mat ) )
+				{
+					m_image.ReleaseBuffer();
+					return false;
+				}
+				return true;
+			}
+
+			/**
+			 * Release this object's reference to the image buffer.
+			 * Matrices copied out of GetMat() keep their own.
+			 */
+			void Release()
+			{
+				m_mat.release();
+				m_image.ReleaseBuffer();
+			}
+
+			/**
+			 * Get the matrix header.
+			 *
+			 * @return The matrix sharing the image buffer.
+			 */
+			const cv::Mat& GetMat() const { return m_mat; }
+
+			/**
+			 * Get the image the matrix shares its buffer with.
+			 *
+			 * @return The shared image.
+			 */
+			const Image& GetImage() const { return m_image; }
+
+		private:
+
+			ImageMat( const ImageMat& );
+			ImageMat& operator=( const ImageMat& );
+
+			Image   m_image;
+			cv::Mat m_mat;
+	};
+}
+
+#endif // FLIR_FLYCAPTURE2OPENCV_H
@@ -345,6 +345,9 @@ namespace FlyCapture2
 
 			/**
 			 * Get the size of the buffer associated with the image, in bytes.
+			 * Image sizes are limited to 32 bits; buffers larger than 4 GB can
+			 * be accessed through an ImageView and processed region by region
+			 * with WrapImageView().
 			 *
 			 * @return The size of the buffer, in bytes.
 			 */
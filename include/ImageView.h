@@ -0,0 +1,756 @@
+//=============================================================================
+// Copyright (c) 2001-2018 FLIR Systems, Inc. All Rights Reserved.
+//
+// This software is the confidential and proprietary information of FLIR
+// Integrated Imaging Solutions, Inc. ("Confidential Information"). You
+// shall not disclose such Confidential Information and shall use it only in
+// accordance with the terms of the license agreement you entered into
+// with FLIR Integrated Imaging Solutions, Inc. (FLIR).
+//
+// FLIR MAKES NO REPRESENTATIONS OR WARRANTIES ABOUT THE SUITABILITY OF THE
+// SOFTWARE, EITHER EXPRESSED OR IMPLIED, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+// PURPOSE, OR NON-INFRINGEMENT. FLIR SHALL NOT BE LIABLE FOR ANY DAMAGES
+// SUFFERED BY LICENSEE AS A RESULT OF USING, MODIFYING OR DISTRIBUTING
+// THIS SOFTWARE OR ITS DERIVATIVES.
+//=============================================================================
+
+#ifndef FLIR_FC2_IMAGEVIEW_H
+#define FLIR_FC2_IMAGEVIEW_H
+
+#include "FlyCapture2Platform.h"
+#include "FlyCapture2Defs.h"
+#include "Image.h"
+
+#include <cstddef>
+#include <iterator>
+
+namespace FlyCapture2
+{
+	/**
+	 * @defgroup ImageViewPixels Typed pixel structures
+	 *
+	 * Memory layouts of the byte addressable pixel formats. Packed formats
+	 * (MONO12, RAW12, 411YUV8, 422YUV8 and JPEG) have no per-pixel layout
+	 * and cannot be viewed.
+	 */
+
+	/*@{*/
+
+	/** A 24 bit RGB pixel. */
+	struct PixelRGB8
+	{
+		unsigned char r;
+		unsigned char g;
+		unsigned char b;
+	};
+
+	/** A 24 bit BGR pixel. */
+	struct PixelBGR8
+	{
+		unsigned char b;
+		unsigned char g;
+		unsigned char r;
+	};
+
+	/** A 32 bit RGBU pixel. */
+	struct PixelRGBU8
+	{
+		unsigned char r;
+		unsigned char g;
+		unsigned char b;
+		unsigned char u;
+	};
+
+	/** A 32 bit BGRU pixel. */
+	struct PixelBGRU8
+	{
+		unsigned char b;
+		unsigned char g;
+		unsigned char r;
+		unsigned char u;
+	};
+
+	/** A 24 bit YUV 4:4:4 pixel, as transmitted by the camera. */
+	struct PixelYUV444
+	{
+		unsigned char u;
+		unsigned char y;
+		unsigned char v;
+	};
+
+	/** A 48 bit RGB pixel. */
+	struct PixelRGB16
+	{
+		unsigned short r;
+		unsigned short g;
+		unsigned short b;
+	};
+
+	/** A 48 bit signed RGB pixel. */
+	struct PixelSignedRGB16
+	{
+		short r;
+		short g;
+		short b;
+	};
+
+	/** A 48 bit BGR pixel. */
+	struct PixelBGR16
+	{
+		unsigned short b;
+		unsigned short g;
+		unsigned short r;
+	};
+
+	/** A 64 bit BGRU pixel. */
+	struct PixelBGRU16
+	{
+		unsigned short b;
+		unsigned short g;
+		unsigned short r;
+		unsigned short u;
+	};
+
+	/*@}*/
+
+	/**
+	 * Compile time description of a pixel format. Only byte addressable
+	 * formats are specialized; instantiating a view of any other format is
+	 * a compile error.
+	 */
+	template <PixelFormat Fmt>
+	struct PixelFormatTraits;
+
+#define FLIR_FC2_PIXEL_FORMAT_TRAITS( fmt, pixelType, bpp, channels ) \
+	template <> \
+	struct PixelFormatTraits<fmt> \
+	{ \
+		typedef pixelType PixelType; \
+		static const unsigned int BitsPerPixel = bpp; \
+		static const unsigned int NumChannels = channels; \
+		typedef char SizeCheck[ (sizeof(pixelType) * 8 == bpp) ? 1 : -1 ]; \
+	}
+
+	FLIR_FC2_PIXEL_FORMAT_TRAITS( PIXEL_FORMAT_MONO8, unsigned char, 8, 1 );
+	FLIR_FC2_PIXEL_FORMAT_TRAITS( PIXEL_FORMAT_RAW8, unsigned char, 8, 1 );
+	FLIR_FC2_PIXEL_FORMAT_TRAITS( PIXEL_FORMAT_MONO16, unsigned short, 16, 1 );
+	FLIR_FC2_PIXEL_FORMAT_TRAITS( PIXEL_FORMAT_RAW16, unsigned short, 16, 1 );
+	FLIR_FC2_PIXEL_FORMAT_TRAITS( PIXEL_FORMAT_S_MONO16, short, 16, 1 );
+	FLIR_FC2_PIXEL_FORMAT_TRAITS( PIXEL_FORMAT_444YUV8, PixelYUV444, 24, 3 );
+	FLIR_FC2_PIXEL_FORMAT_TRAITS( PIXEL_FORMAT_RGB8, PixelRGB8, 24, 3 );
+	FLIR_FC2_PIXEL_FORMAT_TRAITS( PIXEL_FORMAT_BGR, PixelBGR8, 24, 3 );
+	FLIR_FC2_PIXEL_FORMAT_TRAITS( PIXEL_FORMAT_RGBU, PixelRGBU8, 32, 4 );
+	FLIR_FC2_PIXEL_FORMAT_TRAITS( PIXEL_FORMAT_BGRU, PixelBGRU8, 32, 4 );
+	FLIR_FC2_PIXEL_FORMAT_TRAITS( PIXEL_FORMAT_RGB16, PixelRGB16, 48, 3 );
+	FLIR_FC2_PIXEL_FORMAT_TRAITS( PIXEL_FORMAT_S_RGB16, PixelSignedRGB16, 48, 3 );
+	FLIR_FC2_PIXEL_FORMAT_TRAITS( PIXEL_FORMAT_BGR16, PixelBGR16, 48, 3 );
+	FLIR_FC2_PIXEL_FORMAT_TRAITS( PIXEL_FORMAT_BGRU16, PixelBGRU16, 64, 4 );
+
+#undef FLIR_FC2_PIXEL_FORMAT_TRAITS
+
+	/**
+	 * Get the channel layout of a byte addressable pixel format. This is
+	 * the run time counterpart of PixelFormatTraits.
+	 *
+	 * @param format The pixel format.
+	 * @param pBitsPerChannel Receives the bits per channel (8 or 16).
+	 * @param pNumChannels Receives the number of interleaved channels.
+	 * @param pIsSigned Receives whether the channels are signed.
+	 *
+	 * @return true if the format is byte addressable, false for packed or
+	 *         compressed formats.
+	 */
+	inline bool GetChannelLayout(
+			PixelFormat   format,
+			unsigned int* pBitsPerChannel,
+			unsigned int* pNumChannels,
+			bool*         pIsSigned )
+	{
+		unsigned int bitsPerChannel = 8;
+		unsigned int numChannels = 1;
+		bool isSigned = false;
+
+		switch ( format )
+		{
+			case PIXEL_FORMAT_MONO8:
+			case PIXEL_FORMAT_RAW8:
+				break;
+			case PIXEL_FORMAT_MONO16:
+			case PIXEL_FORMAT_RAW16:
+				bitsPerChannel = 16;
+				break;
+			case PIXEL_FORMAT_S_MONO16:
+				bitsPerChannel = 16;
+				isSigned = true;
+				break;
+			case PIXEL_FORMAT_444YUV8:
+			case PIXEL_FORMAT_RGB8:
+			case PIXEL_FORMAT_BGR:
+				numChannels = 3;
+				break;
+			case PIXEL_FORMAT_RGBU:
+			case PIXEL_FORMAT_BGRU:
+				numChannels = 4;
+				break;
+			case PIXEL_FORMAT_RGB16:
+			case PIXEL_FORMAT_BGR16:
+				bitsPerChannel = 16;
+				numChannels = 3;
+				break;
+			case PIXEL_FORMAT_S_RGB16:
+				bitsPerChannel = 16;
+				numChannels = 3;
+				isSigned = true;
+				break;
+			case PIXEL_FORMAT_BGRU16:
+				bitsPerChannel = 16;
+				numChannels = 4;
+				break;
+			default:
+				return false;
+		}
+
+		*pBitsPerChannel = bitsPerChannel;
+		*pNumChannels = numChannels;
+		*pIsSigned = isSigned;
+		return true;
+	}
+
+	/**
+	 * Random access iterator that steps through memory with a fixed byte
+	 * stride, such as down a column of an image.
+	 */
+	template <typename T>
+	class StridedIterator
+	{
+		public:
+
+			typedef std::random_access_iterator_tag iterator_category;
+			typedef T value_type;
+			typedef std::ptrdiff_t difference_type;
+			typedef T* pointer;
+			typedef T& reference;
+
+			StridedIterator() : m_pPos(NULL), m_stride(0) {}
+
+			StridedIterator( T* pPos, std::ptrdiff_t stride )
+				: m_pPos(pPos), m_stride(stride) {}
+
+			T& operator*() const { return *m_pPos; }
+			T* operator->() const { return m_pPos; }
+			T& operator[]( std::ptrdiff_t n ) const { return *Advance( m_pPos, n ); }
+
+			StridedIterator& operator++() { m_pPos = Advance( m_pPos, 1 ); return *this; }
+			StridedIterator& operator--() { m_pPos = Advance( m_pPos, -1 ); return *this; }
+			StridedIterator operator++( int ) { StridedIterator tmp( *this ); ++*this; return tmp; }
+			StridedIterator operator--( int ) { StridedIterator tmp( *this ); --*this; return tmp; }
+			StridedIterator& operator+=( std::ptrdiff_t n ) { m_pPos = Advance( m_pPos, n ); return *this; }
+			StridedIterator& operator-=( std::ptrdiff_t n ) { m_pPos = Advance( m_pPos, -n ); return *this; }
+			StridedIterator operator+( std::ptrdiff_t n ) const { return StridedIterator( Advance( m_pPos, n ), m_stride ); }
+			StridedIterator operator-( std::ptrdiff_t n ) const { return StridedIterator( Advance( m_pPos, -n ), m_stride ); }
+
+			std::ptrdiff_t operator-( const StridedIterator& other ) const
+			{
+				return ( reinterpret_cast<const char*>(m_pPos) -
+						 reinterpret_cast<const char*>(other.m_pPos) ) / m_stride;
+			}
+
+			bool operator==( const StridedIterator& other ) const { return m_pPos == other.m_pPos; }
+			bool operator!=( const StridedIterator& other ) const { return m_pPos != other.m_pPos; }
+			bool operator<( const StridedIterator& other ) const { return *this - other < 0; }
+			bool operator>( const StridedIterator& other ) const { return *this - other > 0; }
+			bool operator<=( const StridedIterator& other ) const { return *this - other <= 0; }
+			bool operator>=( const StridedIterator& other ) const { return *this - other >= 0; }
+
+		private:
+
+			T* Advance( T* pPos, std::ptrdiff_t n ) const
+			{
+				const char* pBytes = reinterpret_cast<const char*>(pPos) + n * m_stride;
+				return reinterpret_cast<T*>( const_cast<char*>(pBytes) );
+			}
+
+			T* m_pPos;
+			std::ptrdiff_t m_stride;
+	};
+
+	/**
+	 * A contiguous run of pixels, typically one row of an image. The
+	 * iterators are plain pointers so loops over a span can be vectorized
+	 * by the compiler.
+	 */
+	template <typename T>
+	class PixelSpan
+	{
+		public:
+
+			typedef T* iterator;
+
+			PixelSpan() : m_pBegin(NULL), m_size(0) {}
+
+			PixelSpan( T* pBegin, std::size_t size )
+				: m_pBegin(pBegin), m_size(size) {}
+
+			T* begin() const { return m_pBegin; }
+			T* end() const { return m_pBegin + m_size; }
+			T* data() const { return m_pBegin; }
+			std::size_t size() const { return m_size; }
+			bool empty() const { return m_size == 0; }
+			T& operator[]( std::size_t index ) const { return m_pBegin[index]; }
+
+		private:
+
+			T* m_pBegin;
+			std::size_t m_size;
+	};
+
+	/**
+	 * Common implementation of ImageView and ConstImageView. All accessors
+	 * are non-virtual and inline. Offsets are computed in std::size_t, so a
+	 * view can span buffers larger than the 4 GB addressable by the Image
+	 * class.
+	 */
+	template <typename PixelT, typename ByteT>
+	class BasicImageView
+	{
+		public:
+
+			typedef PixelT PixelType;
+			typedef PixelSpan<PixelT> RowSpan;
+			typedef StridedIterator<PixelT> ColumnIterator;
+
+			/**
+			 * Get the number of rows in the view.
+			 *
+			 * @return The number of rows.
+			 */
+			std::size_t GetRows() const { return m_rows; }
+
+			/**
+			 * Get the number of columns in the view.
+			 *
+			 * @return The number of columns.
+			 */
+			std::size_t GetCols() const { return m_cols; }
+
+			/**
+			 * Get the stride of the view.
+			 *
+			 * @return The number of bytes between rows of the view.
+			 */
+			std::size_t GetStride() const { return m_stride; }
+
+			/**
+			 * Get a pointer to the first byte of the view.
+			 *
+			 * @return A pointer to the image data.
+			 */
+			ByteT* GetData() const { return m_pData; }
+
+			/**
+			 * Check whether the view refers to any data.
+			 *
+			 * @return true if the view has no data attached.
+			 */
+			bool IsEmpty() const { return m_pData == NULL || m_rows == 0 || m_cols == 0; }
+
+			/**
+			 * Get a pointer to the first pixel of a row.
+			 *
+			 * @param row The row to return.
+			 *
+			 * @return A pointer to the first pixel of the row.
+			 */
+			PixelT* RowPtr( std::size_t row ) const
+			{
+				return reinterpret_cast<PixelT*>( m_pData + row * m_stride );
+			}
+
+			/**
+			 * Get a row of the view as a contiguous span of pixels.
+			 *
+			 * @param row The row to return.
+			 *
+			 * @return The pixels of the row.
+			 */
+			RowSpan Row( std::size_t row ) const { return RowSpan( RowPtr(row), m_cols ); }
+
+			/**
+			 * Get an iterator to the top of a column.
+			 *
+			 * @param col The column to iterate.
+			 *
+			 * @return An iterator to the first pixel of the column.
+			 */
+			ColumnIterator ColumnBegin( std::size_t col ) const
+			{
+				return ColumnIterator( RowPtr(0) + col, static_cast<std::ptrdiff_t>(m_stride) );
+			}
+
+			/**
+			 * Get an iterator one past the bottom of a column.
+			 *
+			 * @param col The column to iterate.
+			 *
+			 * @return An iterator past the last pixel of the column.
+			 */
+			ColumnIterator ColumnEnd( std::size_t col ) const
+			{
+				return ColumnBegin(col) + static_cast<std::ptrdiff_t>(m_rows);
+			}
+
+			/**
+			 * Indexing operator.
+			 *
+			 * @param row The row of the pixel to return.
+			 * @param col The column of the pixel to return.
+			 *
+			 * @return The specified pixel.
+			 */
+			PixelT& operator()( std::size_t row, std::size_t col ) const
+			{
+				return RowPtr(row)[col];
+			}
+
+			/**
+			 * Get a view of a rectangular region of this view. The region
+			 * shares the underlying buffer. No bounds checking is performed.
+			 *
+			 * @param row First row of the region.
+			 * @param col First column of the region.
+			 * @param rows Number of rows in the region.
+			 * @param cols Number of columns in the region.
+			 *
+			 * @return A view of the region.
+			 */
+			BasicImageView SubView(
+					std::size_t row,
+					std::size_t col,
+					std::size_t rows,
+					std::size_t cols ) const
+			{
+				return BasicImageView(
+						reinterpret_cast<ByteT*>( RowPtr(row) + col ),
+						rows,
+						cols,
+						m_stride );
+			}
+
+		protected:
+
+			BasicImageView()
+				: m_pData(NULL), m_rows(0), m_cols(0), m_stride(0) {}
+
+			BasicImageView(
+					ByteT*      pData,
+					std::size_t rows,
+					std::size_t cols,
+					std::size_t stride )
+				: m_pData(pData), m_rows(rows), m_cols(cols), m_stride(stride) {}
+
+			ByteT*      m_pData;
+			std::size_t m_rows;
+			std::size_t m_cols;
+			std::size_t m_stride;
+	};
+
+	/**
+	 * A typed, non-owning view of the pixels of an image. Accessing pixels
+	 * through a view avoids the virtual calls of the Image accessors, which
+	 * allows per-pixel loops to be inlined and vectorized. The view does not
+	 * hold a reference to the image buffer; the Image it was obtained from
+	 * must outlive it and must not be passed to RetrieveBuffer() or
+	 * Convert() while the view is in use.
+	 *
+	 * @see GetImageView()
+	 */
+	template <PixelFormat Fmt>
+	class ImageView : public BasicImageView<typename PixelFormatTraits<Fmt>::PixelType, unsigned char>
+	{
+		public:
+
+			typedef BasicImageView<typename PixelFormatTraits<Fmt>::PixelType, unsigned char> Base;
+
+			/** Pixel format of the view. */
+			static const PixelFormat Format = Fmt;
+
+			/** Bits per pixel of the view. */
+			static const unsigned int BitsPerPixel = PixelFormatTraits<Fmt>::BitsPerPixel;
+
+			/** Number of channels per pixel. */
+			static const unsigned int NumChannels = PixelFormatTraits<Fmt>::NumChannels;
+
+			/**
+			 * Default constructor. Creates an empty view.
+			 */
+			ImageView() {}
+
+			/**
+			 * Construct a view of a buffer. Ownership of the buffer is not
+			 * transferred to the view.
+			 *
+			 * @param pData Pointer to the first pixel.
+			 * @param rows Rows in the view.
+			 * @param cols Columns in the view.
+			 * @param stride Number of bytes between rows.
+			 */
+			ImageView(
+					unsigned char* pData,
+					std::size_t    rows,
+					std::size_t    cols,
+					std::size_t    stride )
+				: Base( pData, rows, cols, stride ) {}
+
+			/**
+			 * Conversion from an untyped view of the same buffer.
+			 */
+			ImageView( const Base& other ) : Base( other ) {}
+
+			/**
+			 * Get a view of a rectangular region of this view. The region
+			 * shares the underlying buffer. No bounds checking is performed.
+			 *
+			 * @param row First row of the region.
+			 * @param col First column of the region.
+			 * @param rows Number of rows in the region.
+			 * @param cols Number of columns in the region.
+			 *
+			 * @return A view of the region.
+			 */
+			ImageView SubView(
+					std::size_t row,
+					std::size_t col,
+					std::size_t rows,
+					std::size_t cols ) const
+			{
+				return ImageView( Base::SubView( row, col, rows, cols ) );
+			}
+	};
+
+	/**
+	 * A typed, read-only, non-owning view of the pixels of an image.
+	 *
+	 * @see ImageView
+	 * @see GetImageView()
+	 */
+	template <PixelFormat Fmt>
+	class ConstImageView : public BasicImageView<const typename PixelFormatTraits<Fmt>::PixelType, const unsigned char>
+	{
+		public:
+
+			typedef BasicImageView<const typename PixelFormatTraits<Fmt>::PixelType, const unsigned char> Base;
+
+			/** Pixel format of the view. */
+			static const PixelFormat Format = Fmt;
+
+			/** Bits per pixel of the view. */
+			static const unsigned int BitsPerPixel = PixelFormatTraits<Fmt>::BitsPerPixel;
+
+			/** Number of channels per pixel. */
+			static const unsigned int NumChannels = PixelFormatTraits<Fmt>::NumChannels;
+
+			/**
+			 * Default constructor. Creates an empty view.
+			 */
+			ConstImageView() {}
+
+			/**
+			 * Construct a view of a buffer. Ownership of the buffer is not
+			 * transferred to the view.
+			 *
+			 * @param pData Pointer to the first pixel.
+			 * @param rows Rows in the view.
+			 * @param cols Columns in the view.
+			 * @param stride Number of bytes between rows.
+			 */
+			ConstImageView(
+					const unsigned char* pData,
+					std::size_t          rows,
+					std::size_t          cols,
+					std::size_t          stride )
+				: Base( pData, rows, cols, stride ) {}
+
+			/**
+			 * Conversion from an untyped view of the same buffer.
+			 */
+			ConstImageView( const Base& other ) : Base( other ) {}
+
+			/**
+			 * Get a view of a rectangular region of this view. The region
+			 * shares the underlying buffer. No bounds checking is performed.
+			 *
+			 * @param row First row of the region.
+			 * @param col First column of the region.
+			 * @param rows Number of rows in the region.
+			 * @param cols Number of columns in the region.
+			 *
+			 * @return A view of the region.
+			 */
+			ConstImageView SubView(
+					std::size_t row,
+					std::size_t col,
+					std::size_t rows,
+					std::size_t cols ) const
+			{
+				return ConstImageView( Base::SubView( row, col, rows, cols ) );
+			}
+
+			/**
+			 * Conversion from a writable view of the same format.
+			 */
+			ConstImageView( const ImageView<Fmt>& other )
+				: Base( other.GetData(), other.GetRows(), other.GetCols(), other.GetStride() ) {}
+	};
+
+	/**
+	 * Check whether an image can be viewed with the specified pixel format.
+	 * The pixel format must match exactly, the stride must hold a full row
+	 * and the buffer must hold every row.
+	 *
+	 * @param image The image to check.
+	 * @param format The pixel format of the view.
+	 * @param bitsPerPixel The bits per pixel of the view.
+	 * @param pData Receives the image data pointer on success.
+	 * @param pRows Receives the number of rows on success.
+	 * @param pCols Receives the number of columns on success.
+	 * @param pStride Receives the stride on success.
+	 *
+	 * @return true if the image can be viewed.
+	 */
+	inline bool CheckImageView(
+			const Image&          image,
+			PixelFormat           format,
+			unsigned int          bitsPerPixel,
+			unsigned char**       pData,
+			std::size_t*          pRows,
+			std::size_t*          pCols,
+			std::size_t*          pStride )
+	{
+		unsigned int rows = 0;
+		unsigned int cols = 0;
+		unsigned int stride = 0;
+		PixelFormat pixelFormat = UNSPECIFIED_PIXEL_FORMAT;
+
+		image.GetDimensions( &rows, &cols, &stride, &pixelFormat );
+
+		unsigned char* pImageData = image.GetData();
+		const std::size_t rowBytes = ( static_cast<std::size_t>(cols) * bitsPerPixel ) / 8;
+		const std::size_t requiredSize = rows == 0 ? 0 :
+			static_cast<std::size_t>(rows - 1) * stride + rowBytes;
+
+		if ( pixelFormat != format ||
+			 pImageData == NULL ||
+			 stride < rowBytes ||
+			 requiredSize > image.GetDataSize() )
+		{
+			return false;
+		}
+
+		*pData = pImageData;
+		*pRows = rows;
+		*pCols = cols;
+		*pStride = stride;
+		return true;
+	}
+
+	/**
+	 * Get a typed view of an image. The pixel format of the image must
+	 * match the format of the view exactly.
+	 *
+	 * @param image The image to view.
+	 * @param pView The view to fill.
+	 *
+	 * @return true if the view was filled, false if the image is empty or
+	 *         is not in the format of the view.
+	 */
+	template <PixelFormat Fmt>
+	inline bool GetImageView( Image& image, ImageView<Fmt>* pView )
+	{
+		unsigned char* pData = NULL;
+		std::size_t rows = 0, cols = 0, stride = 0;
+
+		if ( !CheckImageView( image, Fmt, ImageView<Fmt>::BitsPerPixel, &pData, &rows, &cols, &stride ) )
+		{
+			return false;
+		}
+
+		*pView = ImageView<Fmt>( pData, rows, cols, stride );
+		return true;
+	}
+
+	/**
+	 * Get a typed, read-only view of an image. The pixel format of the
+	 * image must match the format of the view exactly.
+	 *
+	 * @param image The image to view.
+	 * @param pView The view to fill.
+	 *
+	 * @return true if the view was filled, false if the image is empty or
+	 *         is not in the format of the view.
+	 */
+	template <PixelFormat Fmt>
+	inline bool GetImageView( const Image& image, ConstImageView<Fmt>* pView )
+	{
+		unsigned char* pData = NULL;
+		std::size_t rows = 0, cols = 0, stride = 0;
+
+		if ( !CheckImageView( image, Fmt, ConstImageView<Fmt>::BitsPerPixel, &pData, &rows, &cols, &stride ) )
+		{
+			return false;
+		}
+
+		*pView = ConstImageView<Fmt>( pData, rows, cols, stride );
+		return true;
+	}
+
+	/**
+	 * Attach the pixels of a view to an Image without copying, so a region
+	 * of a buffer larger than the Image class can address (such as one tile
+	 * of a multi-camera mosaic) can be used with Image::Convert(),
+	 * Image::Save() and Image::CalculateStatistics() in place. Ownership of
+	 * the buffer is not transferred to the Image object.
+	 *
+	 * @param view The view to attach.
+	 * @param pImage The image to attach the view to.
+	 * @param bayerFormat Format of the Bayer tiled raw image.
+	 *
+	 * @return PGRERROR_OK, or PGRERROR_INVALID_PARAMETER if the view is empty
+	 *         or spans more than 4 GB.
+	 */
+	template <PixelFormat Fmt>
+	inline ErrorType WrapImageView(
+			const ImageView<Fmt>& view,
+			Image*                pImage,
+			BayerTileFormat       bayerFormat = NONE )
+	{
+		const std::size_t rowBytes = view.GetCols() * ( ImageView<Fmt>::BitsPerPixel / 8 );
+		if ( pImage == NULL || view.IsEmpty() )
+		{
+			return PGRERROR_INVALID_PARAMETER;
+		}
+
+		// The last row only needs to hold the pixels, not a full stride.
+		const unsigned long long span =
+			static_cast<unsigned long long>( view.GetRows() - 1 ) * view.GetStride() + rowBytes;
+		if ( view.GetRows() > 0xFFFFFFFFULL ||
+			 view.GetCols() > 0xFFFFFFFFULL ||
+			 view.GetStride() > 0xFFFFFFFFULL ||
+			 span > 0xFFFFFFFFULL )
+		{
+			return PGRERROR_INVALID_PARAMETER;
+		}
+
+		*pImage = Image(
+				static_cast<unsigned int>( view.GetRows() ),
+				static_cast<unsigned int>( view.GetCols() ),
+				static_cast<unsigned int>( view.GetStride() ),
+				view.GetData(),
+				static_cast<unsigned int>( span ),
+				Fmt,
+				bayerFormat );
+		return PGRERROR_OK;
+	}
+}
+
+#endif // FLIR_FC2_IMAGEVIEW_H
@@ -0,0 +1,461 @@
+//=============================================================================
+// Copyright (c) 2001-2018 FLIR Systems, Inc. All Rights Reserved.
+//
+// This software is the confidential and proprietary information of FLIR
+// Integrated Imaging Solutions, Inc. ("Confidential Information"). You
+// shall not disclose such Confidential Information and shall use it only in
+// accordance with the terms of the license agreement you entered into
+// with FLIR Integrated Imaging Solutions, Inc. (FLIR).
+//
+// FLIR MAKES NO REPRESENTATIONS OR WARRANTIES ABOUT THE SUITABILITY OF THE
+// SOFTWARE, EITHER EXPRESSED OR IMPLIED, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+// PURPOSE, OR NON-INFRINGEMENT. FLIR SHALL NOT BE LIABLE FOR ANY DAMAGES
+// SUFFERED BY LICENSEE AS A RESULT OF USING, MODIFYING OR DISTRIBUTING
+// THIS SOFTWARE OR ITS DERIVATIVES.
+//=============================================================================
+
+
+#ifndef FLIR_FC2_MEMORYBUDGET_H
+#define FLIR_FC2_MEMORYBUDGET_H
+
+#include "FlyCapture2Platform.h"
+#include "FlyCapture2Defs.h"
+#include "Error.h"
+#include "Image.h"
+#include "CameraBase.h"
+
+#if !defined(_MSC_VER) && __cplusplus < 201103L
+#error "MemoryBudget.h requires C++11"
+#endif
+
+#include <map>
+#include <mutex>
+
+namespace FlyCapture2
+{
+	/** Categories of memory accounted by a MemoryBudget. */
+	enum MemoryCategory
+	{
+		MEMORY_CAPTURE_BUFFERS, /**< Buffers the library receives images into. */
+		MEMORY_CONVERSION, /**< Destination and scratch images of conversions. */
+		MEMORY_ENCODER, /**< Frames queued for video encoding or recording. */
+		MEMORY_CACHE, /**< Caches, pools and other retained buffers. */
+		NUM_MEMORY_CATEGORIES
+	};
+
+	/** Memory use broken down by category. */
+	struct MemoryFootprint
+	{
+		/** Bytes in each MemoryCategory. */
+		unsigned long long bytes[NUM_MEMORY_CATEGORIES];
+
+		MemoryFootprint()
+		{
+			for ( unsigned int i = 0; i < NUM_MEMORY_CATEGORIES; i++ )
+			{
+				bytes[i] = 0;
+			}
+		}
+
+		/**
+		 * Get the sum of all categories.
+		 *
+		 * @return The total in bytes.
+		 */
+		unsigned long long GetTotal() const
+		{
+			unsigned long long total = 0;
+			for ( unsigned int i = 0; i < NUM_MEMORY_CATEGORIES; i++ )
+			{
+				total += bytes[i];
+			}
+			return total;
+		}
+	};
+
+	/**
+	 * Estimate the size of a packed frame.
+	 *
+	 * @param rows Rows in the frame.
+	 * @param cols Columns in the frame.
+	 * @param format Pixel format of the frame.
+	 *
+	 * @return The frame size in bytes.
+	 */
+	inline unsigned long long EstimateFrameBytes( unsigned int rows, unsigned int cols, PixelFormat format )
+	{
+		return static_cast<unsigned long long>( rows ) *
+			( ( static_cast<unsigned long long>( cols ) * Image::DetermineBitsPerPixel( format ) + 7 ) / 8 );
+	}
+
+	/**
+	 * Number of capture buffers the library allocates when
+	 * FC2Config::numBuffers is 0.
+	 */
+	static const unsigned int sk_defaultNumCaptureBuffers = 10;
+
+	/**
+	 * Estimate the memory the library allocates for capture with a
+	 * configuration. Each buffer is rounded up to the transfer packet size
+	 * as SetUserBuffers() recommends.
+	 *
+	 * @param config The capture configuration. A numBuffers of 0 counts
+	 *               as the library default.
+	 * @param frameBytes Size of a frame in the current mode.
+	 * @param packetSize Transfer packet size: 1024 for USB3, 1 for GigE.
+	 *
+	 * @return The capture buffer size in bytes.
+	 */
+	inline unsigned long long EstimateCaptureBufferBytes(
+			const FC2Config&   config,
+			unsigned long long frameBytes,
+			unsigned int       packetSize = 1024 )
+	{
+		const unsigned long long bufferBytes = packetSize > 1 ?
+			( frameBytes + packetSize - 1 ) / packetSize * packetSize : frameBytes;
+		const unsigned int numBuffers = config.numBuffers > 0 ? config.numBuffers : sk_defaultNumCaptureBuffers;
+		return bufferBytes * numBuffers;
+	}
+
+	/**
+	 * The MemoryBudget class accounts memory per camera and category
+	 * against a hard limit, so that an oversized configuration is rejected
+	 * up front with an error rather than failing to allocate, or being
+	 * killed, in the middle of a stream.
+	 *
+	 * Each owner, usually a camera, holds one reservation per category.
+	 * Reserve() replaces the owner's reservation in that category and is
+	 * refused if the new total would exceed the limit, leaving the old
+	 * reservation in place. BudgetedSetConfiguration(),
+	 * BudgetedStartCapture() and BudgetedStopCapture() keep the capture
+	 * buffer reservation of a camera in step with its configuration.
+	 * Conversion, encoder and cache memory is reserved by the code that
+	 * owns it: AlignedImage, WarmCapture, BackgroundRecorder,
+	 * ViewerPipeline and StatisticsWorker take an optional budget and
+	 * reserve under their own address as owner, and other code can size
+	 * its reservations with EstimateFrameBytes() and, from AlignedImage.h,
+	 * EstimateConversionBytes().
+	 *
+	 * A process-wide budget is returned by GetProcessMemoryBudget().
+	 * MemoryBudget is thread safe.
+	 */
+	class MemoryBudget
+	{
+		public:
+
+			MemoryBudget()
+				: m_limit( 0 ),
+				  m_peak( 0 ),
+				  m_numRejections( 0 )
+			{
+			}
+
+			/**
+			 * Set the limit. Existing reservations are kept even if they
+			 * exceed it; only new reservations are refused.
+			 *
+			 * @param limitBytes The limit in bytes, or 0 for no limit.
+			 */
+			void SetLimit( unsigned long long limitBytes )
+			{
+				std::lock_guard<std::mutex> lock( m_mutex );
+				m_limit = limitBytes;
+			}
+
+			/**
+			 * Get the limit.
+			 *
+			 * @return The limit in bytes, or 0 for no limit.
+			 */
+			unsigned long long GetLimit() const
+			{
+				std::lock_guard<std::mutex> lock( m_mutex );
+				return m_limit;
+			}
+
+			/**
+			 * Set the reservation of an owner in a category.
+			 *
+			 * @param pOwner The owner, usually a camera.
+			 * @param category The category.
+			 * @param bytes The new reservation, replacing the previous one.
+			 *
+			 * @return PGRERROR_OK; PGRERROR_INVALID_PARAMETER for a bad
+			 *         category; or PGRERROR_MEMORY_ALLOCATION_FAILED if the
+			 *         limit would be exceeded.
+			 */
+			ErrorType Reserve( const void* pOwner, MemoryCategory category, unsigned long long bytes )
+			{
+				if ( category < 0 || category >= NUM_MEMORY_CATEGORIES )
+				{
+					return PGRERROR_INVALID_PARAMETER;
+				}
+
+				std::lock_guard<std::mutex> lock( m_mutex );
+				MemoryFootprint& footprint = m_owners[pOwner];
+				const unsigned long long current = footprint.bytes[category];
+				const unsigned long long total = m_total.GetTotal() - current + bytes;
+				if ( m_limit != 0 && bytes > current && total > m_limit )
+				{
+					m_numRejections++;
+					if ( footprint.GetTotal() == 0 )
+					{
+						m_owners.erase( pOwner );
+					}
+					return PGRERROR_MEMORY_ALLOCATION_FAILED;
+				}
+
+				footprint.bytes[category] = bytes;
+				m_total.bytes[category] = m_total.bytes[category] - current + bytes;
+				m_peak = total > m_peak ? total : m_peak;
+				if ( footprint.GetTotal() == 0 )
+				{
+					m_owners.erase( pOwner );
+				}
+				return PGRERROR_OK;
+			}
+
+			/**
+			 * Check whether a reservation would be granted, without making
+			 * it.
+			 *
+			 * @param pOwner The owner.
+			 * @param category The category.
+			 * @param bytes The prospective reservation.
+			 *
+			 * @return Whether Reserve() would succeed.
+			 */
+			bool CanReserve( const void* pOwner, MemoryCategory category, unsigned long long bytes ) const
+			{
+				std::lock_guard<std::mutex> lock( m_mutex );
+				const std::map<const void*, MemoryFootprint>::const_iterator it = m_owners.find( pOwner );
+				const unsigned long long current = it != m_owners.end() ? it->second.bytes[category] : 0;
+				return m_limit == 0 || bytes <= current || m_total.GetTotal() - current + bytes <= m_limit;
+			}
+
+			/**
+			 * Release the reservation of an owner in a category.
+			 *
+			 * @param pOwner The owner.
+			 * @param category The category.
+			 */
+			void Release( const void* pOwner, MemoryCategory category )
+			{
+				Reserve( pOwner, category, 0 );
+			}
+
+			/**
+			 * Release every reservation of an owner.
+			 *
+			 * @param pOwner The owner.
+			 */
+			void ReleaseAll( const void* pOwner )
+			{
+				std::lock_guard<std::mutex> lock( m_mutex );
+				const std::map<const void*, MemoryFootprint>::iterator it = m_owners.find( pOwner );
+				if ( it == m_owners.end() )
+				{
+					return;
+				}
+
+				for ( unsigned int i = 0; i < NUM_MEMORY_CATEGORIES; i++ )
+				{
+					m_total.bytes[i] -= it->second.bytes[i];
+				}
+				m_owners.erase( it );
+			}
+
+			/**
+			 * Get the reservations of an owner.
+			 *
+			 * @param pOwner The owner.
+			 * @param pFootprint Receives the reservations by category.
+			 */
+			void GetFootprint( const void* pOwner, MemoryFootprint* pFootprint ) const
+			{
+				std::lock_guard<std::mutex> lock( m_mutex );
+				const std::map<const void*, MemoryFootprint>::const_iterator it = m_owners.find( pOwner );
+				*pFootprint = it != m_owners.end() ? it->second : MemoryFootprint();
+			}
+
+			/**
+			 * Get the reservations of all owners.
+			 *
+			 * @param pFootprint Receives the totals by category.
+			 */
+			void GetTotalFootprint( MemoryFootprint* pFootprint ) const
+			{
+				std::lock_guard<std::mutex> lock( m_mutex );
+				*pFootprint = m_total;
+			}
+
+			/**
+			 * Get the largest total reached.
+			 *
+			 * @return The peak in bytes.
+			 */
+			unsigned long long GetPeak() const
+			{
+				std::lock_guard<std::mutex> lock( m_mutex );
+				return m_peak;
+			}
+
+			/**
+			 * Get the number of reservations refused.
+			 *
+			 * @return The number of rejections.
+			 */
+			unsigned long long GetNumRejections() const
+			{
+				std::lock_guard<std::mutex> lock( m_mutex );
+				return m_numRejections;
+			}
+
+		private:
+
+			MemoryBudget( const MemoryBudget& );
+			MemoryBudget& operator=( const MemoryBudget& );
+
+			mutable std::mutex                      m_mutex;
+			std::map<const void*, MemoryFootprint>  m_owners;
+			MemoryFootprint                         m_total;
+			unsigned long long                      m_limit;
+			unsigned long long                      m_peak;
+			unsigned long long                      m_numRejections;
+	};
+
+	/**
+	 * Get the process-wide memory budget, which has no limit until one is
+	 * set.
+	 *
+	 * @return The process budget.
+	 */
+	inline MemoryBudget& GetProcessMemoryBudget()
+	{
+		static MemoryBudget s_budget;
+		return s_budget;
+	}
+
+	namespace Detail
+	{
+		inline ErrorType GetBudgetErrorType( const Error& error ) { return error.GetType(); }
+		inline ErrorType GetBudgetErrorType( ErrorType error ) { return error; }
+	}
+
+	/**
+	 * Apply a configuration if its capture buffers fit in the budget.
+	 *
+	 * @param pCamera The camera, such as a Camera, GigECamera or
+	 *                VirtualCamera.
+	 * @param pConfig The configuration to apply. A numBuffers of 0 keeps
+	 *                the current number of buffers of the camera.
+	 * @param frameBytes Size of a frame in the current mode.
+	 * @param pBudget The budget, or NULL for the process budget.
+	 *
+	 * @return PGRERROR_OK; PGRERROR_MEMORY_ALLOCATION_FAILED, without
+	 *         applying the configuration, if it does not fit; or the error
+	 *         of SetConfiguration(), in which case the reservation is
+	 *         restored.
+	 */
+	template <class CameraT>
+	ErrorType BudgetedSetConfiguration(
+			CameraT*           pCamera,
+			const FC2Config*   pConfig,
+			unsigned long long frameBytes,
+			MemoryBudget*      pBudget = NULL )
+	{
+		MemoryBudget& budget = pBudget != NULL ? *pBudget : GetProcessMemoryBudget();
+		MemoryFootprint previous;
+		budget.GetFootprint( pCamera, &previous );
+
+		// SetConfiguration() leaves the number of buffers alone when it is
+		// 0, so the reservation is for the camera's current number.
+		FC2Config config = *pConfig;
+		if ( config.numBuffers == 0 )
+		{
+			FC2Config current;
+			if ( Detail::GetBudgetErrorType( pCamera->GetConfiguration( &current ) ) == PGRERROR_OK )
+			{
+				config.numBuffers = current.numBuffers;
+			}
+		}
+
+		ErrorType error = budget.Reserve(
+			pCamera, MEMORY_CAPTURE_BUFFERS, EstimateCaptureBufferBytes( config, frameBytes ) );
+		if ( error != PGRERROR_OK )
+		{
+			return error;
+		}
+
+		error = Detail::GetBudgetErrorType( pCamera->SetConfiguration( pConfig ) );
+		if ( error != PGRERROR_OK )
+		{
+			budget.Reserve( pCamera, MEMORY_CAPTURE_BUFFERS, previous.bytes[MEMORY_CAPTURE_BUFFERS] );
+		}
+		return error;
+	}
+
+	/**
+	 * Start capture if the capture buffers of the current configuration fit
+	 * in the budget.
+	 *
+	 * @param pCamera The camera.
+	 * @param frameBytes Size of a frame in the current mode.
+	 * @param callbackFn Optional image callback.
+	 * @param pCallbackData Data passed to the callback.
+	 * @param pBudget The budget, or NULL for the process budget.
+	 *
+	 * @return PGRERROR_OK; PGRERROR_MEMORY_ALLOCATION_FAILED, without
+	 *         starting, if the buffers do not fit; or the error of
+	 *         GetConfiguration() or StartCapture().
+	 */
+	template <class CameraT>
+	ErrorType BudgetedStartCapture(
+			CameraT*           pCamera,
+			unsigned long long frameBytes,
+			ImageEventCallback callbackFn = NULL,
+			const void*        pCallbackData = NULL,
+			MemoryBudget*      pBudget = NULL )
+	{
+		MemoryBudget& budget = pBudget != NULL ? *pBudget : GetProcessMemoryBudget();
+		FC2Config config;
+		ErrorType error = Detail::GetBudgetErrorType( pCamera->GetConfiguration( &config ) );
+		if ( error != PGRERROR_OK )
+		{
+			return error;
+		}
+
+		error = budget.Reserve( pCamera, MEMORY_CAPTURE_BUFFERS, EstimateCaptureBufferBytes( config, frameBytes ) );
+		if ( error != PGRERROR_OK )
+		{
+			return error;
+		}
+
+		error = Detail::GetBudgetErrorType( pCamera->StartCapture( callbackFn, pCallbackData ) );
+		if ( error != PGRERROR_OK && error != PGRERROR_ISOCH_ALREADY_STARTED )
+		{
+			budget.Release( pCamera, MEMORY_CAPTURE_BUFFERS );
+		}
+		return error;
+	}
+
+	/**
+	 * Stop capture and release the capture buffer reservation.
+	 *
+	 * @param pCamera The camera.
+	 * @param pBudget The budget, or NULL for the process budget.
+	 *
+	 * @return The error of StopCapture().
+	 */
+	template <class CameraT>
+	ErrorType BudgetedStopCapture( CameraT* pCamera, MemoryBudget* pBudget = NULL )
+	{
+		MemoryBudget& budget = pBudget != NULL ? *pBudget : GetProcessMemoryBudget();
+		const ErrorType error = Detail::GetBudgetErrorType( pCamera->StopCapture() );
+		budget.Release( pCamera, MEMORY_CAPTURE_BUFFERS );
+		return error;
+	}
+}
+
+#endif // FLIR_FC2_MEMORYBUDGET_H
@@ -0,0 +1,391 @@
+//=============================================================================
+// Copyright (c) 2001-2018 FLIR Systems, Inc. All Rights Reserved.
+//
+// This software is the confidential and proprietary information of FLIR
+// Integrated Imaging Solutions, Inc. ("Confidential Information"). You
+// shall not disclose such Confidential Information and shall use it only in
+// accordance with the terms of the license agreement you entered into
+// with FLIR Integrated Imaging Solutions, Inc. (FLIR).
+//
+// FLIR MAKES NO REPRESENTATIONS OR WARRANTIES ABOUT THE SUITABILITY OF THE
+// SOFTWARE, EITHER EXPRESSED OR IMPLIED, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+// PURPOSE, OR NON-INFRINGEMENT. FLIR SHALL NOT BE LIABLE FOR ANY DAMAGES
+// SUFFERED BY LICENSEE AS A RESULT OF USING, MODIFYING OR DISTRIBUTING
+// THIS SOFTWARE OR ITS DERIVATIVES.
+//=============================================================================
+
+#ifndef FLIR_FC2_MULTICAMERATRIGGER_H
+#define FLIR_FC2_MULTICAMERATRIGGER_H
+
+#include "FlyCapture2Platform.h"
+#include "FlyCapture2Defs.h"
+#include "Error.h"
+#include "TriggerScheduler.h"
+
+#if !defined(_MSC_VER) && __cplusplus < 201103L
+#error "MultiCameraTrigger.h requires C++11"
+#endif
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace FlyCapture2
+{
+	/** Outcome of one coordinated trigger fired by MultiCameraTrigger. */
+	struct MultiCameraTriggerResult
+	{
+		/** Time every camera was due to be triggered. */
+		std::chrono::steady_clock::time_point targetTime;
+		/** Time the trigger write to each camera was issued. */
+		std::vector<std::chrono::steady_clock::time_point> issueTimes;
+		/** Time the trigger write to each camera completed. */
+		std::vector<std::chrono::steady_clock::time_point> completionTimes;
+		/** Result of the trigger write to each camera. */
+		std::vector<ErrorType> errors;
+		/** Spread between the earliest and latest issue times. */
+		std::chrono::nanoseconds issueSkew;
+		/**
+		 * Spread between the earliest and latest completion times. This
+		 * bounds the skew between the exposures of the cameras.
+		 */
+		std::chrono::nanoseconds completionSkew;
+		/** Number of cameras that failed to accept the trigger. */
+		unsigned int numFailures;
+
+		MultiCameraTriggerResult()
+		{
+			issueSkew = std::chrono::nanoseconds::zero();
+			completionSkew = std::chrono::nanoseconds::zero();
+			numFailures = 0;
+		}
+	};
+
+	/** Statistics of a MultiCameraTrigger. */
+	struct MultiCameraTriggerStats
+	{
+		/** Coordinated triggers fired. */
+		unsigned long long numFires;
+		/** Camera trigger writes that failed. */
+		unsigned long long numFailures;
+		/** Mean issue skew, in nanoseconds. */
+		double meanIssueSkewNs;
+		/** Largest issue skew, in nanoseconds. */
+		long long maxIssueSkewNs;
+		/** Mean completion skew, in nanoseconds. */
+		double meanCompletionSkewNs;
+		/** Largest completion skew, in nanoseconds. */
+		long long maxCompletionSkewNs;
+
+		MultiCameraTriggerStats()
+		{
+			numFires = 0;
+			numFailures = 0;
+			meanIssueSkewNs = 0.0;
+			maxIssueSkewNs = 0;
+			meanCompletionSkewNs = 0.0;
+			maxCompletionSkewNs = 0;
+		}
+	};
+
+	/**
+	 * The MultiCameraTrigger class fires a software trigger on several
+	 * cameras at the same instant, and reports how closely it succeeded.
+	 *
+	 * The broadcast flag of FireSoftwareTrigger() only applies to 1394
+	 * buses. On USB3 and GigE each camera needs its own register write, and
+	 * writing them one after another accumulates the latency of every write
+	 * as skew between the first and last camera. MultiCameraTrigger instead
+	 * keeps one worker thread per camera. Fire() hands all workers a common
+	 * target time slightly in the future; each worker waits for it with a
+	 * PrecisionSleeper and issues its write, so the writes to different
+	 * cameras and buses proceed concurrently and the skew is set by the
+	 * variation of a single write rather than the sum of all of them.
+	 *
+	 * Trigger mode must already be enabled with a software source. The
+	 * class works with any camera type providing FireSoftwareTrigger(),
+	 * such as Camera, GigECamera or VirtualCamera. Concurrent calls to
+	 * Fire() are serialized.
+	 */
+	template <class CameraT>
+	class MultiCameraTrigger
+	{
+		public:
+
+			typedef std::chrono::steady_clock Clock;
+
+			MultiCameraTrigger()
+				: m_leadTime( std::chrono::microseconds( 500 ) ),
+				  m_spinThreshold( std::chrono::microseconds( 100 ) ),
+				  m_running( false ),
+				  m_generation( 0 ),
+				  m_numPending( 0 ),
+				  m_issueSkewSum( 0.0 ),
+				  m_completionSkewSum( 0.0 )
+			{
+			}
+
+			/**
+			 * Default destructor. Stops the worker threads.
+			 */
+			~MultiCameraTrigger()
+			{
+				StopWorkers();
+			}
+
+			/**
+			 * Set the cameras to trigger and start a worker thread for each
+			 * of them. The cameras must outlive the trigger or the next
+			 * call to SetCameras().
+			 *
+			 * @param ppCameras Array of cameras.
+			 * @param numCameras Number of cameras.
+			 */
+			void SetCameras( CameraT** ppCameras, unsigned int numCameras )
+			{
+				std::lock_guard<std::mutex> fireLock( m_fireMutex );
+				StopWorkers();
+
+				m_cameras.assign( ppCameras, ppCameras + numCameras );
+				m_slots.assign( numCameras, Slot() );
+				m_generation = 0;
+				m_running = true;
+				for ( unsigned int i = 0; i < numCameras; i++ )
+				{
+					m_workers.push_back( std::thread( &MultiCameraTrigger::WorkerLoop, this, i ) );
+				}
+			}
+
+			/**
+			 * Set how far in the future Fire() schedules the trigger. It must
+			 * cover the time for every worker to be woken, or the late ones
+			 * add to the skew. The default is 500 us.
+			 *
+			 * @param leadTime The lead time.
+			 */
+			void SetLeadTime( std::chrono::nanoseconds leadTime )
+			{
+				std::lock_guard<std::mutex> fireLock( m_fireMutex );
+				m_leadTime = leadTime;
+			}
+
+			/**
+			 * Set how long before the target time the workers stop blocking
+			 * and start spinning. Spinning workers each occupy a CPU, so keep
+			 * this at zero when there are fewer CPUs than cameras. The
+			 * default is 100 us.
+			 *
+			 * @param threshold The spin threshold.
+			 */
+			void SetSpinThreshold( std::chrono::nanoseconds threshold )
+			{
+				std::lock_guard<std::mutex> fireLock( m_fireMutex );
+				m_spinThreshold = threshold;
+			}
+
+			/**
+			 * Trigger every camera at the same time and wait for all the
+			 * writes to complete.
+			 *
+			 * @param pResult Optional pointer to receive the timing of each
+			 *                write and the achieved skew.
+			 *
+			 * @return PGRERROR_OK; PGRERROR_NOT_INTITIALIZED if no cameras are
+			 *         set; or the first error reported by a camera.
+			 */
+			ErrorType Fire( MultiCameraTriggerResult* pResult = NULL )
+			{
+				std::lock_guard<std::mutex> fireLock( m_fireMutex );
+				if ( m_cameras.empty() )
+				{
+					return PGRERROR_NOT_INTITIALIZED;
+				}
+
+				const Clock::time_point targetTime = Clock::now() + m_leadTime;
+				{
+					std::unique_lock<std::mutex> lock( m_mutex );
+					m_targetTime = targetTime;
+					m_numPending = static_cast<unsigned int>( m_cameras.size() );
+					m_generation++;
+					m_startCondition.notify_all();
+					m_doneCondition.wait( lock, [this]{ return m_numPending == 0; } );
+				}
+
+				ErrorType result = PGRERROR_OK;
+				unsigned int numFailures = 0;
+				Clock::time_point firstIssue = m_slots[0].issueTime;
+				Clock::time_point lastIssue = firstIssue;
+				Clock::time_point firstCompletion = m_slots[0].completionTime;
+				Clock::time_point lastCompletion = firstCompletion;
+				for ( size_t i = 0; i < m_slots.size(); i++ )
+				{
+					const Slot& slot = m_slots[i];
+					firstIssue = std::min( firstIssue, slot.issueTime );
+					lastIssue = std::max( lastIssue, slot.issueTime );
+					firstCompletion = std::min( firstCompletion, slot.completionTime );
+					lastCompletion = std::max( lastCompletion, slot.completionTime );
+					if ( slot.error != PGRERROR_OK )
+					{
+						numFailures++;
+						if ( result == PGRERROR_OK )
+						{
+							result = slot.error;
+						}
+					}
+				}
+
+				const std::chrono::nanoseconds issueSkew =
+					std::chrono::duration_cast<std::chrono::nanoseconds>( lastIssue - firstIssue );
+				const std::chrono::nanoseconds completionSkew =
+					std::chrono::duration_cast<std::chrono::nanoseconds>( lastCompletion - firstCompletion );
+
+				{
+					std::lock_guard<std::mutex> statsLock( m_statsMutex );
+					m_stats.numFires++;
+					m_stats.numFailures += numFailures;
+					m_stats.maxIssueSkewNs = std::max( m_stats.maxIssueSkewNs, static_cast<long long>( issueSkew.count() ) );
+					m_stats.maxCompletionSkewNs = std::max( m_stats.maxCompletionSkewNs, static_cast<long long>( completionSkew.count() ) );
+					m_issueSkewSum += static_cast<double>( issueSkew.count() );
+					m_completionSkewSum += static_cast<double>( completionSkew.count() );
+				}
+
+				if ( pResult != NULL )
+				{
+					pResult->targetTime = targetTime;
+					pResult->issueTimes.resize( m_slots.size() );
+					pResult->completionTimes.resize( m_slots.size() );
+					pResult->errors.resize( m_slots.size() );
+					for ( size_t i = 0; i < m_slots.size(); i++ )
+					{
+						pResult->issueTimes[i] = m_slots[i].issueTime;
+						pResult->completionTimes[i] = m_slots[i].completionTime;
+						pResult->errors[i] = m_slots[i].error;
+					}
+					pResult->issueSkew = issueSkew;
+					pResult->completionSkew = completionSkew;
+					pResult->numFailures = numFailures;
+				}
+				return result;
+			}
+
+			/**
+			 * Get the statistics since the last reset.
+			 *
+			 * @param pStats Receives the statistics.
+			 */
+			void GetStats( MultiCameraTriggerStats* pStats ) const
+			{
+				std::lock_guard<std::mutex> statsLock( m_statsMutex );
+				*pStats = m_stats;
+				if ( m_stats.numFires != 0 )
+				{
+					pStats->meanIssueSkewNs = m_issueSkewSum / m_stats.numFires;
+					pStats->meanCompletionSkewNs = m_completionSkewSum / m_stats.numFires;
+				}
+			}
+
+			/**
+			 * Reset the statistics.
+			 */
+			void ResetStats()
+			{
+				std::lock_guard<std::mutex> statsLock( m_statsMutex );
+				m_stats = MultiCameraTriggerStats();
+				m_issueSkewSum = 0.0;
+				m_completionSkewSum = 0.0;
+			}
+
+		private:
+
+			struct Slot
+			{
+				Clock::time_point issueTime;
+				Clock::time_point completionTime;
+				ErrorType error;
+
+				Slot() : error( PGRERROR_OK ) {}
+			};
+
+			static ErrorType GetErrorType( const Error& error ) { return error.GetType(); }
+			static ErrorType GetErrorType( ErrorType error ) { return error; }
+
+			void WorkerLoop( unsigned int index )
+			{
+				Detail::PrecisionSleeper sleeper;
+				unsigned long long seenGeneration = 0;
+				for (;;)
+				{
+					Clock::time_point targetTime;
+					std::chrono::nanoseconds spinThreshold;
+					{
+						std::unique_lock<std::mutex> lock( m_mutex );
+						m_startCondition.wait( lock, [&]{ return !m_running || m_generation != seenGeneration; } );
+						if ( !m_running )
+						{
+							return;
+						}
+						seenGeneration = m_generation;
+						targetTime = m_targetTime;
+						spinThreshold = m_spinThreshold;
+					}
+
+					sleeper.SleepUntil( targetTime, spinThreshold, m_running );
+
+					Slot& slot = m_slots[index];
+					slot.issueTime = Clock::now();
+					slot.error = GetErrorType( m_cameras[index]->FireSoftwareTrigger() );
+					slot.completionTime = Clock::now();
+
+					std::lock_guard<std::mutex> lock( m_mutex );
+					if ( --m_numPending == 0 )
+					{
+						m_doneCondition.notify_one();
+					}
+				}
+			}
+
+			void StopWorkers()
+			{
+				{
+					std::lock_guard<std::mutex> lock( m_mutex );
+					m_running = false;
+					m_startCondition.notify_all();
+				}
+				for ( size_t i = 0; i < m_workers.size(); i++ )
+				{
+					m_workers[i].join();
+				}
+				m_workers.clear();
+			}
+
+			MultiCameraTrigger( const MultiCameraTrigger& );
+			MultiCameraTrigger& operator=( const MultiCameraTrigger& );
+
+			std::vector<CameraT*>       m_cameras;
+			std::vector<Slot>           m_slots;
+			std::vector<std::thread>    m_workers;
+			std::chrono::nanoseconds    m_leadTime;
+			std::chrono::nanoseconds    m_spinThreshold;
+
+			std::mutex                  m_fireMutex;
+			std::mutex                  m_mutex;
+			std::condition_variable     m_startCondition;
+			std::condition_variable     m_doneCondition;
+			std::atomic<bool>           m_running;
+			unsigned long long          m_generation;
+			Clock::time_point           m_targetTime;
+			unsigned int                m_numPending;
+
+			mutable std::mutex          m_statsMutex;
+			MultiCameraTriggerStats     m_stats;
+			double                      m_issueSkewSum;
+			double                      m_completionSkewSum;
+	};
+}
+
+#endif // FLIR_FC2_MULTICAMERATRIGGER_H
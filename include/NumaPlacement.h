@@ -0,0 +1,363 @@
+//=============================================================================
+// Copyright (c) 2001-2018 FLIR Systems, Inc. All Rights Reserved.
+//
+// This software is the confidential and proprietary information of FLIR
+// Integrated Imaging Solutions, Inc. ("Confidential Information"). You
+// shall not disclose such Confidential Information and shall use it only in
+// accordance with the terms of the license agreement you entered into
+// with FLIR Integrated Imaging Solutions, Inc. (FLIR).
+//
+// FLIR MAKES NO REPRESENTATIONS OR WARRANTIES ABOUT THE SUITABILITY OF THE
+// SOFTWARE, EITHER EXPRESSED OR IMPLIED, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+// PURPOSE, OR NON-INFRINGEMENT. FLIR SHALL NOT BE LIABLE FOR ANY DAMAGES
+// SUFFERED BY LICENSEE AS A RESULT OF USING, MODIFYING OR DISTRIBUTING
+// THIS SOFTWARE OR ITS DERIVATIVES.
+//=============================================================================
+
+
+#ifndef FLIR_FC2_NUMAPLACEMENT_H
+#define FLIR_FC2_NUMAPLACEMENT_H
+
+#include "FlyCapture2Platform.h"
+#include "FlyCapture2Defs.h"
+#include "Error.h"
+#include "CameraBase.h"
+
+#if !defined(_MSC_VER) && __cplusplus < 201103L
+#error "NumaPlacement.h requires C++11"
+#endif
+
+#include <string>
+#include <vector>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__linux__)
+#include <limits.h>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace FlyCapture2
+{
+	namespace Detail
+	{
+		// Parse a sysfs CPU list such as "0-3,8,10-11".
+		inline std::vector<int> ParseCpuList( const char* pList )
+		{
+			std::vector<int> cpus;
+			const char* p = pList;
+			while ( *p != '\0' && *p != '\n' )
+			{
+				char* pEnd;
+				const long first = strtol( p, &pEnd, 10 );
+				if ( pEnd == p )
+				{
+					break;
+				}
+				long last = first;
+				p = pEnd;
+				if ( *p == '-' )
+				{
+					last = strtol( p + 1, &pEnd, 10 );
+					p = pEnd;
+				}
+				for ( long cpu = first; cpu <= last; cpu++ )
+				{
+					cpus.push_back( static_cast<int>( cpu ) );
+				}
+				if ( *p == ',' )
+				{
+					p++;
+				}
+			}
+			return cpus;
+		}
+
+		inline bool ReadSysfsLine( const std::string& path, char* pLine, size_t size )
+		{
+			FILE* pFile = fopen( path.c_str(), "r" );
+			if ( pFile == NULL )
+			{
+				return false;
+			}
+			const bool read = fgets( pLine, static_cast<int>( size ), pFile ) != NULL;
+			fclose( pFile );
+			return read;
+		}
+
+		inline ErrorType GetNumaErrorType( const Error& error ) { return error.GetType(); }
+		inline ErrorType GetNumaErrorType( ErrorType error ) { return error; }
+
+		inline int ReadSysfsInt( const std::string& path, int defaultValue )
+		{
+			char line[64];
+			return ReadSysfsLine( path, line, sizeof(line) ) ? atoi( line ) : defaultValue;
+		}
+	}
+
+	/**
+	 * Get the number of NUMA nodes.
+	 *
+	 * @return The number of nodes, 1 on hosts without NUMA support.
+	 */
+	inline int GetNumaNodeCount()
+	{
+#if defined(__linux__)
+		char line[256];
+		if ( Detail::ReadSysfsLine( "/sys/devices/system/node/possible", line, sizeof(line) ) )
+		{
+			const std::vector<int> nodes = Detail::ParseCpuList( line );
+			if ( !nodes.empty() )
+			{
+				return nodes.back() + 1;
+			}
+		}
+#endif
+		return 1;
+	}
+
+	/**
+	 * Get the CPUs of a NUMA node.
+	 *
+	 * @param node The node.
+	 *
+	 * @return The CPUs, empty if the node does not exist.
+	 */
+	inline std::vector<int> GetNumaNodeCpus( int node )
+	{
+#if defined(__linux__)
+		char line[1024];
+		char path[128];
+		snprintf( path, sizeof(path), "/sys/devices/system/node/node%d/cpulist", node );
+		if ( node >= 0 && Detail::ReadSysfsLine( path, line, sizeof(line) ) )
+		{
+			return Detail::ParseCpuList( line );
+		}
+#else
+		(void)node;
+#endif
+		return std::vector<int>();
+	}
+
+	/**
+	 * Get the CPUs sharing the last level cache with a CPU. On big.LITTLE
+	 * and other clustered hosts without NUMA nodes this is the cluster of
+	 * the CPU.
+	 *
+	 * @param cpu The CPU.
+	 *
+	 * @return The CPUs, including cpu, or empty if the topology is unknown.
+	 */
+	inline std::vector<int> GetCacheClusterCpus( int cpu )
+	{
+#if defined(__linux__)
+		char line[1024];
+		char path[128];
+		for ( int index = 7; index >= 0; index-- )
+		{
+			snprintf( path, sizeof(path), "/sys/devices/system/cpu/cpu%d/cache/index%d/shared_cpu_list", cpu, index );
+			if ( Detail::ReadSysfsLine( path, line, sizeof(line) ) )
+			{
+				return Detail::ParseCpuList( line );
+			}
+		}
+#else
+		(void)cpu;
+#endif
+		return std::vector<int>();
+	}
+
+	/**
+	 * Get the NUMA node of the PCI device behind a network interface, for
+	 * GigE cameras.
+	 *
+	 * @param pInterfaceName The interface, such as "eth0".
+	 *
+	 * @return The node, or -1 if unknown.
+	 */
+	inline int GetNetworkInterfaceNumaNode( const char* pInterfaceName )
+	{
+#if defined(__linux__)
+		return Detail::ReadSysfsInt( std::string( "/sys/class/net/" ) + pInterfaceName + "/device/numa_node", -1 );
+#else
+		(void)pInterfaceName;
+		return -1;
+#endif
+	}
+
+	/**
+	 * Get the NUMA node of the host controller of a USB bus, for USB
+	 * cameras.
+	 *
+	 * @param busNumber The USB bus number, as in /sys/bus/usb/devices/usbN.
+	 *
+	 * @return The node, or -1 if unknown.
+	 */
+	inline int GetUsbBusNumaNode( unsigned int busNumber )
+	{
+#if defined(__linux__)
+		char path[64];
+		snprintf( path, sizeof(path), "/sys/bus/usb/devices/usb%u", busNumber );
+		char resolved[PATH_MAX];
+		if ( realpath( path, resolved ) == NULL )
+		{
+			return -1;
+		}
+
+		// The root hub sits directly below its host controller.
+		std::string controller( resolved );
+		controller.erase( controller.rfind( '/' ) );
+		return Detail::ReadSysfsInt( controller + "/numa_node", -1 );
+#else
+		(void)busNumber;
+		return -1;
+#endif
+	}
+
+	/**
+	 * Restrict the calling thread to a set of CPUs.
+	 *
+	 * @param cpus The CPUs, for example from GetNumaNodeCpus().
+	 *
+	 * @return Whether the affinity was applied.
+	 */
+	inline bool PinCurrentThread( const std::vector<int>& cpus )
+	{
+#if defined(__linux__)
+		if ( cpus.empty() )
+		{
+			return false;
+		}
+
+		cpu_set_t set;
+		CPU_ZERO( &set );
+		for ( size_t i = 0; i < cpus.size(); i++ )
+		{
+			CPU_SET( cpus[i], &set );
+		}
+		return pthread_setaffinity_np( pthread_self(), sizeof(set), &set ) == 0;
+#else
+		(void)cpus;
+		return false;
+#endif
+	}
+
+	/**
+	 * Allocate memory placed on a NUMA node. The pages are bound to the
+	 * node with a preferred policy and touched, so they are resident
+	 * before capture starts. If the binding fails the memory is still
+	 * returned, placed wherever the kernel puts it, and the failure is
+	 * reported through pPlacement.
+	 *
+	 * @param size Size in bytes.
+	 * @param node The node, or -1 for no placement.
+	 * @param pPlacement Optional result of the placement: PGRERROR_OK if
+	 *                   the pages were bound or no node was requested;
+	 *                   PGRERROR_NOT_SUPPORTED if the platform or node
+	 *                   number does not support binding; or
+	 *                   PGRERROR_FAILED if the kernel refused it.
+	 *
+	 * @return Memory to be freed with FreeOnNode(), or NULL. On Linux the
+	 *         memory is page aligned; elsewhere it has the alignment of
+	 *         malloc().
+	 */
+	inline void* AllocateOnNode( size_t size, int node, ErrorType* pPlacement = NULL )
+	{
+		ErrorType placement = node < 0 ? PGRERROR_OK : PGRERROR_NOT_SUPPORTED;
+#if defined(__linux__)
+		void* pMem = mmap( NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0 );
+		if ( pMem == MAP_FAILED )
+		{
+			return NULL;
+		}
+
+#if defined(SYS_mbind)
+		if ( node >= 0 && node < static_cast<int>( sizeof(unsigned long) * 8 ) )
+		{
+			// MPOL_PREFERRED falls back to other nodes instead of failing
+			// when the node runs out of memory.
+			const int mpolPreferred = 1;
+			const unsigned long nodeMask = 1UL << node;
+			placement = syscall( SYS_mbind, pMem, size, mpolPreferred, &nodeMask, sizeof(nodeMask) * 8, 0 ) == 0 ?
+				PGRERROR_OK : PGRERROR_FAILED;
+		}
+#endif
+		memset( pMem, 0, size );
+#else
+		void* pMem = malloc( size );
+		if ( pMem == NULL )
+		{
+			return NULL;
+		}
+#endif
+		if ( pPlacement != NULL )
+		{
+			*pPlacement = placement;
+		}
+		return pMem;
+	}
+
+	/**
+	 * Free memory allocated with AllocateOnNode().
+	 *
+	 * @param pMem The memory.
+	 * @param size The size passed to AllocateOnNode().
+	 */
+	inline void FreeOnNode( void* pMem, size_t size )
+	{
+		if ( pMem == NULL )
+		{
+			return;
+		}
+#if defined(__linux__)
+		munmap( pMem, size );
+#else
+		(void)size;
+		free( pMem );
+#endif
+	}
+
+	/**
+	 * Start capture with the library threads created for it, such as the
+	 * receive and callback threads, restricted to a set of CPUs. New
+	 * threads inherit the affinity of their creator, so the calling thread
+	 * is pinned for the duration of StartCapture() and then restored.
+	 *
+	 * @param pCamera The camera, such as a Camera, GigECamera or
+	 *                VirtualCamera.
+	 * @param cpus The CPUs, for example from GetNumaNodeCpus().
+	 * @param callbackFn Optional image callback.
+	 * @param pCallbackData Data passed to the callback.
+	 *
+	 * @return The error of StartCapture().
+	 */
+	template <class CameraT>
+	ErrorType StartCaptureOnCpus(
+			CameraT*                pCamera,
+			const std::vector<int>& cpus,
+			ImageEventCallback      callbackFn = NULL,
+			const void*             pCallbackData = NULL )
+	{
+#if defined(__linux__)
+		cpu_set_t saved;
+		const bool haveSaved = pthread_getaffinity_np( pthread_self(), sizeof(saved), &saved ) == 0;
+		const bool pinned = haveSaved && PinCurrentThread( cpus );
+#endif
+		const ErrorType error = Detail::GetNumaErrorType( pCamera->StartCapture( callbackFn, pCallbackData ) );
+#if defined(__linux__)
+		if ( pinned )
+		{
+			pthread_setaffinity_np( pthread_self(), sizeof(saved), &saved );
+		}
+#endif
+		return error;
+	}
+}
+
+#endif // FLIR_FC2_NUMAPLACEMENT_H
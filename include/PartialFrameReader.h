@@ -0,0 +1,325 @@
+//=============================================================================
+// Copyright (c) 2001-2018 FLIR Systems, Inc. All Rights Reserved.
+//
+// This software is the confidential and proprietary information of FLIR
+// Integrated Imaging Solutions, Inc. ("Confidential Information"). You
+// shall not disclose such Confidential Information and shall use it only in
+// accordance with the terms of the license agreement you entered into
+// with FLIR Integrated Imaging Solutions, Inc. (FLIR).
+//
+// FLIR MAKES NO REPRESENTATIONS OR WARRANTIES ABOUT THE SUITABILITY OF THE
+// SOFTWARE, EITHER EXPRESSED OR IMPLIED, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+// PURPOSE, OR NON-INFRINGEMENT. FLIR SHALL NOT BE LIABLE FOR ANY DAMAGES
+// SUFFERED BY LICENSEE AS A RESULT OF USING, MODIFYING OR DISTRIBUTING
+// THIS SOFTWARE OR ITS DERIVATIVES.
+//=============================================================================
+
+
+#ifndef FLIR_FC2_PARTIALFRAMEREADER_H
+#define FLIR_FC2_PARTIALFRAMEREADER_H
+
+#include "FlyCapture2Platform.h"
+#include "FlyCapture2Defs.h"
+#include "Error.h"
+#include "Image.h"
+
+#if !defined(_MSC_VER) && __cplusplus < 201103L
+#error "PartialFrameReader.h requires C++11"
+#endif
+
+#include <chrono>
+
+namespace FlyCapture2
+{
+	/** A band of rows that has arrived since the previous notification. */
+	struct RowRange
+	{
+		/** First row of the band. */
+		unsigned int firstRow;
+		/** One past the last row of the band. */
+		unsigned int endRow;
+		/** Image notification that made the band available. */
+		unsigned int eventNumber;
+		/** Whether the band completes the frame. */
+		bool frameComplete;
+		/** Host time the notification was received. */
+		std::chrono::steady_clock::time_point time;
+
+		RowRange()
+		{
+			firstRow = 0;
+			endRow = 0;
+			eventNumber = 0;
+			frameComplete = false;
+		}
+	};
+
+	/** Statistics of a PartialFrameReader. */
+	struct PartialFrameReaderStats
+	{
+		/** Frames read to completion. */
+		unsigned long long numFrames;
+		/** Frames abandoned because a notification failed. */
+		unsigned long long numIncomplete;
+		/**
+		 * Mean time from the first rows becoming available to the end of
+		 * the frame, in nanoseconds. This is the head start processing gets
+		 * over waiting for the complete frame.
+		 */
+		double meanHeadStartNs;
+
+		PartialFrameReaderStats()
+		{
+			numFrames = 0;
+			numIncomplete = 0;
+			meanHeadStartNs = 0.0;
+		}
+	};
+
+	/**
+	 * The PartialFrameReader class hands out the rows of a frame as they
+	 * are received, so that demosaicing or analysis of the top of the frame
+	 * can run while the bottom is still being transferred.
+	 *
+	 * It is built on the image notifications of FC2Config: with x
+	 * notifications per image, WaitForBufferEvent() returns after the
+	 * first packet, at x - 2 evenly spaced points and at the end of the
+	 * image. Each notification is turned into a completion watermark, the
+	 * number of leading rows that are fully received, and WaitForRows()
+	 * returns the band between the previous watermark and the new one.
+	 * Watermarks are rounded down to whole rows, and the first packet
+	 * notification is not assumed to complete any row. Algorithms that
+	 * need neighbouring rows, such as demosaicing, must hold back the
+	 * last rows of each band until the next one arrives.
+	 *
+	 * Configure() must be called before StartCapture(). The class works
+	 * with any camera type providing GetConfiguration(), SetConfiguration()
+	 * and WaitForBufferEvent(), such as Camera or GigECamera. It is not
+	 * thread safe; use it from one thread.
+	 */
+	template <class CameraT>
+	class PartialFrameReader
+	{
+		public:
+
+			typedef std::chrono::steady_clock Clock;
+
+			/**
+			 * Construct a reader for a camera. The camera must outlive the
+			 * reader.
+			 *
+			 * @param pCamera The camera to read from.
+			 */
+			explicit PartialFrameReader( CameraT* pCamera )
+				: m_pCamera( pCamera ),
+				  m_numNotifications( 1 ),
+				  m_nextEvent( 0 ),
+				  m_rowsDelivered( 0 ),
+				  m_headStartSumNs( 0.0 )
+			{
+			}
+
+			/**
+			 * Set the number of image notifications. The camera may require
+			 * more than requested; the number actually used is returned by
+			 * GetNumNotifications().
+			 *
+			 * @param numNotifications Notifications per image. Each one
+			 *                         beyond the first and last adds a
+			 *                         band; 2 gives no early rows.
+			 *
+			 * @return PGRERROR_OK, PGRERROR_INVALID_PARAMETER, or the error
+			 *         of the configuration calls.
+			 */
+			ErrorType Configure( unsigned int numNotifications )
+			{
+				if ( numNotifications == 0 )
+				{
+					return PGRERROR_INVALID_PARAMETER;
+				}
+
+				FC2Config config;
+				ErrorType error = GetErrorType( m_pCamera->GetConfiguration( &config ) );
+				if ( error != PGRERROR_OK )
+				{
+					return error;
+				}
+
+				config.numImageNotifications = numNotifications > config.minNumImageNotifications ?
+					numNotifications : config.minNumImageNotifications;
+				error = GetErrorType( m_pCamera->SetConfiguration( &config ) );
+				if ( error != PGRERROR_OK )
+				{
+					return error;
+				}
+
+				error = GetErrorType( m_pCamera->GetConfiguration( &config ) );
+				if ( error != PGRERROR_OK )
+				{
+					return error;
+				}
+
+				m_numNotifications = config.numImageNotifications > 0 ? config.numImageNotifications : 1;
+				m_nextEvent = 0;
+				m_rowsDelivered = 0;
+				return PGRERROR_OK;
+			}
+
+			/**
+			 * Get the number of image notifications in use.
+			 *
+			 * @return The number of notifications per image.
+			 */
+			unsigned int GetNumNotifications() const
+			{
+				return m_numNotifications;
+			}
+
+			/**
+			 * Get the number of leading rows that are complete when a
+			 * notification arrives.
+			 *
+			 * @param eventNumber The notification, starting at 0.
+			 * @param numNotifications Notifications per image.
+			 * @param rows Rows in the image.
+			 *
+			 * @return The completion watermark, in rows.
+			 */
+			static unsigned int GetRowWatermark(
+					unsigned int eventNumber,
+					unsigned int numNotifications,
+					unsigned int rows )
+			{
+				if ( eventNumber + 1 >= numNotifications )
+				{
+					return rows;
+				}
+				if ( eventNumber == 0 )
+				{
+					return 0;
+				}
+				return static_cast<unsigned int>(
+					static_cast<unsigned long long>( rows ) * eventNumber / ( numNotifications - 1 ) );
+			}
+
+			/**
+			 * Wait for the next notification and return the rows it made
+			 * available. Between calls, rows before range.endRow of pImage
+			 * are valid. Bands may be empty.
+			 *
+			 * @param pImage Receives the frame being transferred.
+			 * @param pRange Receives the new band of rows.
+			 *
+			 * @return PGRERROR_OK, or the error of WaitForBufferEvent(), in
+			 *         which case the frame is abandoned and the next call
+			 *         starts a new one.
+			 */
+			ErrorType WaitForRows( Image* pImage, RowRange* pRange )
+			{
+				const unsigned int eventNumber = m_nextEvent;
+				const ErrorType error = GetErrorType( m_pCamera->WaitForBufferEvent( pImage, eventNumber ) );
+				const Clock::time_point now = Clock::now();
+				if ( error != PGRERROR_OK )
+				{
+					if ( eventNumber != 0 )
+					{
+						m_stats.numIncomplete++;
+					}
+					m_nextEvent = 0;
+					m_rowsDelivered = 0;
+					return error;
+				}
+
+				const unsigned int watermark = GetRowWatermark( eventNumber, m_numNotifications, pImage->GetRows() );
+				if ( m_rowsDelivered == 0 && watermark > 0 )
+				{
+					m_firstRowsTime = now;
+				}
+
+				pRange->firstRow = m_rowsDelivered;
+				pRange->endRow = watermark;
+				pRange->eventNumber = eventNumber;
+				pRange->frameComplete = eventNumber + 1 >= m_numNotifications;
+				pRange->time = now;
+
+				if ( pRange->frameComplete )
+				{
+					m_stats.numFrames++;
+					m_headStartSumNs += static_cast<double>(
+						std::chrono::duration_cast<std::chrono::nanoseconds>( now - m_firstRowsTime ).count() );
+					m_nextEvent = 0;
+					m_rowsDelivered = 0;
+				}
+				else
+				{
+					m_nextEvent = eventNumber + 1;
+					m_rowsDelivered = watermark;
+				}
+				return PGRERROR_OK;
+			}
+
+			/**
+			 * Read one frame, calling a handler for each band of rows as it
+			 * arrives.
+			 *
+			 * @param pImage Receives the frame.
+			 * @param handler Called as handler( const Image&, firstRow,
+			 *                endRow ) for every non-empty band.
+			 *
+			 * @return PGRERROR_OK once the frame is complete, or the error
+			 *         of WaitForRows().
+			 */
+			template <class Handler>
+			ErrorType ReadFrame( Image* pImage, Handler handler )
+			{
+				RowRange range;
+				do
+				{
+					const ErrorType error = WaitForRows( pImage, &range );
+					if ( error != PGRERROR_OK )
+					{
+						return error;
+					}
+					if ( range.endRow > range.firstRow )
+					{
+						handler( *static_cast<const Image*>( pImage ), range.firstRow, range.endRow );
+					}
+				}
+				while ( !range.frameComplete );
+				return PGRERROR_OK;
+			}
+
+			/**
+			 * Get the statistics of the reader.
+			 *
+			 * @param pStats Receives the statistics.
+			 */
+			void GetStats( PartialFrameReaderStats* pStats ) const
+			{
+				*pStats = m_stats;
+				if ( m_stats.numFrames != 0 )
+				{
+					pStats->meanHeadStartNs = m_headStartSumNs / m_stats.numFrames;
+				}
+			}
+
+		private:
+
+			static ErrorType GetErrorType( const Error& error ) { return error.GetType(); }
+			static ErrorType GetErrorType( ErrorType error ) { return error; }
+
+			PartialFrameReader( const PartialFrameReader& );
+			PartialFrameReader& operator=( const PartialFrameReader& );
+
+			CameraT*                m_pCamera;
+			unsigned int            m_numNotifications;
+			unsigned int            m_nextEvent;
+			unsigned int            m_rowsDelivered;
+			Clock::time_point       m_firstRowsTime;
+			PartialFrameReaderStats m_stats;
+			double                  m_headStartSumNs;
+	};
+}
+
+#endif // FLIR_FC2_PARTIALFRAMEREADER_H
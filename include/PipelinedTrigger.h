@@ -0,0 +1,391 @@
+//=============================================================================
+// Copyright (c) 2001-2018 FLIR Systems, Inc. All Rights Reserved.
+//
+// This software is the confidential and proprietary information of FLIR
+// Integrated Imaging Solutions, Inc. ("Confidential Information"). You
+// shall not disclose such Confidential Information and shall use it only in
+// accordance with the terms of the license agreement you entered into
+// with FLIR Integrated Imaging Solutions, Inc. (FLIR).
+//
+// FLIR MAKES NO REPRESENTATIONS OR WARRANTIES ABOUT THE SUITABILITY OF THE
+// SOFTWARE, EITHER EXPRESSED OR IMPLIED, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+// PURPOSE, OR NON-INFRINGEMENT. FLIR SHALL NOT BE LIABLE FOR ANY DAMAGES
+// SUFFERED BY LICENSEE AS A RESULT OF USING, MODIFYING OR DISTRIBUTING
+// THIS SOFTWARE OR ITS DERIVATIVES.
+//=============================================================================
+
+#ifndef FLIR_FC2_PIPELINEDTRIGGER_H
+#define FLIR_FC2_PIPELINEDTRIGGER_H
+
+#include "FlyCapture2Platform.h"
+#include "FlyCapture2Defs.h"
+#include "Error.h"
+#include "Image.h"
+
+#if !defined(_MSC_VER) && __cplusplus < 201103L
+#error "PipelinedTrigger.h requires C++11"
+#endif
+
+#include <algorithm>
+#include <chrono>
+#include <deque>
+
+namespace FlyCapture2
+{
+	/** Information about a frame retrieved by PipelinedTrigger. */
+	struct TriggeredFrameInfo
+	{
+		/** Index of the trigger that produced the frame. */
+		unsigned long long triggerIndex;
+		/** Host time the trigger was fired. */
+		std::chrono::steady_clock::time_point triggerTime;
+		/** Host time the frame was retrieved. */
+		std::chrono::steady_clock::time_point receivedTime;
+		/** Time from the trigger to the frame being retrieved. */
+		std::chrono::nanoseconds latency;
+		/** Triggers in flight after the replacement trigger was fired. */
+		unsigned int numInFlight;
+
+		TriggeredFrameInfo()
+		{
+			triggerIndex = 0;
+			latency = std::chrono::nanoseconds::zero();
+			numInFlight = 0;
+		}
+	};
+
+	/** Statistics of a PipelinedTrigger. */
+	struct PipelinedTriggerStats
+	{
+		/** Triggers accepted by the camera. */
+		unsigned long long numTriggers;
+		/** Triggers the camera failed to accept. */
+		unsigned long long numTriggerFailures;
+		/** Frames retrieved. */
+		unsigned long long numFrames;
+		/**
+		 * Triggers whose frame did not arrive within the grab timeout or
+		 * arrived damaged.
+		 */
+		unsigned long long numLost;
+		/** Frames discarded while resynchronizing after an error. */
+		unsigned long long numDiscarded;
+		/** Mean trigger-to-frame latency, in nanoseconds. */
+		double meanLatencyNs;
+		/** Smallest trigger-to-frame latency, in nanoseconds. */
+		long long minLatencyNs;
+		/** Largest trigger-to-frame latency, in nanoseconds. */
+		long long maxLatencyNs;
+
+		PipelinedTriggerStats()
+		{
+			numTriggers = 0;
+			numTriggerFailures = 0;
+			numFrames = 0;
+			numLost = 0;
+			numDiscarded = 0;
+			meanLatencyNs = 0.0;
+			minLatencyNs = 0;
+			maxLatencyNs = 0;
+		}
+	};
+
+	/**
+	 * The PipelinedTrigger class runs software triggered acquisition with
+	 * several triggers in flight, so that the exposure of the next frame
+	 * overlaps the readout, transfer and processing of the previous ones
+	 * instead of the usual FireSoftwareTrigger() then RetrieveBuffer()
+	 * sequence serializing all of them.
+	 *
+	 * Flow control is credit based: the pipeline is primed with a fixed
+	 * number of triggers, and each retrieved frame returns one credit,
+	 * which is spent immediately on a replacement trigger before the frame
+	 * is handed to the caller. The camera therefore never sees more
+	 * outstanding triggers than the depth, without polling the software
+	 * trigger register for readiness before every frame. Frames are matched
+	 * to triggers in order, which yields the trigger-to-frame latency of
+	 * every frame.
+	 *
+	 * The depth should not exceed what the camera can queue: 1 for standard
+	 * trigger mode 0, in which case the next exposure still overlaps the
+	 * caller's processing, and 2 or more for overlapped trigger modes such
+	 * as mode 14. A trigger the camera ignores is detected as a grab timeout
+	 * and its credit is reclaimed.
+	 *
+	 * A grab timeout cannot tell an ignored trigger from a late frame, and a
+	 * late frame would be matched to the next trigger, so after a timeout
+	 * the pipeline resynchronizes: no trigger is fired, every trigger in
+	 * flight is counted as lost, and frames are retrieved and discarded
+	 * until the camera is idle, that is until a grab times out with no
+	 * trigger outstanding. Triggering then resumes with a fresh window.
+	 * The same is done after any other retrieval error, which may or may
+	 * not have consumed a frame. A damaged frame, reported as an image
+	 * consistency error, still answers the oldest trigger, so that trigger
+	 * is counted as lost and its credit returned without resynchronizing.
+	 *
+	 * Trigger mode must be enabled with a software source and capture
+	 * started before Start(). The class works with any camera type
+	 * providing FireSoftwareTrigger() and RetrieveBuffer(), such as Camera
+	 * or VirtualCamera. It is not thread safe; use it from one thread.
+	 */
+	template <class CameraT>
+	class PipelinedTrigger
+	{
+		public:
+
+			typedef std::chrono::steady_clock Clock;
+
+			/**
+			 * Construct a pipeline for a camera. The camera must outlive the
+			 * pipeline.
+			 *
+			 * @param pCamera The camera to trigger.
+			 */
+			explicit PipelinedTrigger( CameraT* pCamera )
+				: m_pCamera( pCamera ),
+				  m_depth( 0 ),
+				  m_numTriggers( 0 ),
+				  m_nextTriggerIndex( 0 ),
+				  m_resyncing( false ),
+				  m_latencySumNs( 0.0 )
+			{
+			}
+
+			/**
+			 * Prime the pipeline with triggers.
+			 *
+			 * @param depth Number of triggers to keep in flight.
+			 * @param numTriggers Total number of triggers to fire, or 0 to
+			 *                    keep triggering until Stop().
+			 *
+			 * @return PGRERROR_OK, PGRERROR_INVALID_PARAMETER if the depth
+			 *         is 0, or the error of the first trigger.
+			 */
+			ErrorType Start( unsigned int depth, unsigned long long numTriggers = 0 )
+			{
+				if ( depth == 0 )
+				{
+					return PGRERROR_INVALID_PARAMETER;
+				}
+
+				m_depth = depth;
+				m_numTriggers = numTriggers;
+				m_nextTriggerIndex = 0;
+				m_resyncing = false;
+				m_inFlight.clear();
+				m_stats = PipelinedTriggerStats();
+				m_latencySumNs = 0.0;
+				return Refill();
+			}
+
+			/**
+			 * Stop firing triggers. Frames of triggers already in flight can
+			 * still be retrieved.
+			 */
+			void Stop()
+			{
+				m_depth = 0;
+			}
+
+			/**
+			 * Fire triggers until the configured depth is in flight again.
+			 * Use it to retry after a trigger failure. RetrieveBuffer()
+			 * also retries when nothing is in flight. Does nothing after
+			 * Stop(), once all triggers have been fired, or while the
+			 * pipeline is resynchronizing after a timeout.
+			 *
+			 * @return PGRERROR_OK, or the error of the trigger that failed.
+			 */
+			ErrorType Refill()
+			{
+				if ( m_resyncing )
+				{
+					return PGRERROR_OK;
+				}
+
+				ErrorType result = PGRERROR_OK;
+				while ( m_inFlight.size() < m_depth &&
+						( m_numTriggers == 0 || m_nextTriggerIndex < m_numTriggers ) )
+				{
+					// The index is only consumed by a trigger the camera
+					// accepted, so a retried trigger keeps it.
+					InFlightTrigger trigger;
+					trigger.index = m_nextTriggerIndex;
+					trigger.time = Clock::now();
+					result = GetErrorType( m_pCamera->FireSoftwareTrigger() );
+					if ( result != PGRERROR_OK )
+					{
+						m_stats.numTriggerFailures++;
+						break;
+					}
+
+					m_nextTriggerIndex++;
+					m_inFlight.push_back( trigger );
+					m_stats.numTriggers++;
+				}
+				return result;
+			}
+
+			/**
+			 * Get the number of triggers whose frames have not been retrieved.
+			 *
+			 * @return The number of triggers in flight.
+			 */
+			unsigned int GetNumInFlight() const
+			{
+				return static_cast<unsigned int>( m_inFlight.size() );
+			}
+
+			/**
+			 * Retrieve the frame of the oldest trigger in flight and fire a
+			 * replacement trigger.
+			 *
+			 * @param pImage Receives the frame.
+			 * @param pInfo Optional pointer to receive the trigger and
+			 *              latency of the frame.
+			 *
+			 * @return PGRERROR_OK; PGRERROR_ISOCH_NOT_STARTED if no trigger
+			 *         is in flight and none is left to fire; the error of
+			 *         the trigger if no trigger is in flight and firing one
+			 *         failed; PGRERROR_IMAGE_CONSISTENCY_ERROR if the frame
+			 *         of the oldest trigger arrived damaged; or
+			 *         PGRERROR_TIMEOUT or another error of RetrieveBuffer(),
+			 *         in which case the pipeline is resynchronized before
+			 *         returning, or on the next call if resynchronizing
+			 *         failed too.
+			 */
+			ErrorType RetrieveBuffer( Image* pImage, TriggeredFrameInfo* pInfo = NULL )
+			{
+				if ( m_resyncing )
+				{
+					const ErrorType resyncError = Resync( pImage );
+					if ( resyncError != PGRERROR_OK )
+					{
+						return resyncError;
+					}
+				}
+
+				if ( m_inFlight.empty() )
+				{
+					const ErrorType refillError = Refill();
+					if ( refillError != PGRERROR_OK )
+					{
+						return refillError;
+					}
+					if ( m_inFlight.empty() )
+					{
+						return PGRERROR_ISOCH_NOT_STARTED;
+					}
+				}
+
+				const ErrorType error = GetErrorType( m_pCamera->RetrieveBuffer( pImage ) );
+				const Clock::time_point receivedTime = Clock::now();
+				if ( error == PGRERROR_IMAGE_CONSISTENCY_ERROR )
+				{
+					// The damaged frame consumed the oldest trigger.
+					m_inFlight.pop_front();
+					m_stats.numLost++;
+					Refill();
+					return error;
+				}
+				if ( error != PGRERROR_OK )
+				{
+					m_resyncing = true;
+					const ErrorType resyncError = Resync( pImage );
+					return resyncError != PGRERROR_OK ? resyncError : error;
+				}
+
+				const InFlightTrigger trigger = m_inFlight.front();
+				m_inFlight.pop_front();
+
+				// Return the credit before handing the frame to the caller.
+				Refill();
+
+				const long long latencyNs = std::chrono::duration_cast<std::chrono::nanoseconds>(
+					receivedTime - trigger.time ).count();
+				m_stats.minLatencyNs = m_stats.numFrames == 0 ? latencyNs : std::min( m_stats.minLatencyNs, latencyNs );
+				m_stats.maxLatencyNs = std::max( m_stats.maxLatencyNs, latencyNs );
+				m_stats.numFrames++;
+				m_latencySumNs += static_cast<double>( latencyNs );
+
+				if ( pInfo != NULL )
+				{
+					pInfo->triggerIndex = trigger.index;
+					pInfo->triggerTime = trigger.time;
+					pInfo->receivedTime = receivedTime;
+					pInfo->latency = std::chrono::nanoseconds( latencyNs );
+					pInfo->numInFlight = GetNumInFlight();
+				}
+				return PGRERROR_OK;
+			}
+
+			/**
+			 * Get the statistics since Start().
+			 *
+			 * @param pStats Receives the statistics.
+			 */
+			void GetStats( PipelinedTriggerStats* pStats ) const
+			{
+				*pStats = m_stats;
+				if ( m_stats.numFrames != 0 )
+				{
+					pStats->meanLatencyNs = m_latencySumNs / m_stats.numFrames;
+				}
+			}
+
+		private:
+
+			struct InFlightTrigger
+			{
+				unsigned long long index;
+				Clock::time_point time;
+			};
+
+			static ErrorType GetErrorType( const Error& error ) { return error.GetType(); }
+			static ErrorType GetErrorType( ErrorType error ) { return error; }
+
+			// Discard frames, damaged or not, until a grab times out with
+			// no trigger fired since the error that started the resync,
+			// then start a new window. Returns PGRERROR_OK once
+			// resynchronized; any other error leaves the resync pending
+			// for the next call.
+			ErrorType Resync( Image* pImage )
+			{
+				m_stats.numLost += m_inFlight.size();
+				m_inFlight.clear();
+
+				for ( ;; )
+				{
+					const ErrorType error = GetErrorType( m_pCamera->RetrieveBuffer( pImage ) );
+					if ( error == PGRERROR_TIMEOUT )
+					{
+						break;
+					}
+					if ( error != PGRERROR_OK && error != PGRERROR_IMAGE_CONSISTENCY_ERROR )
+					{
+						return error;
+					}
+					m_stats.numDiscarded++;
+				}
+
+				m_resyncing = false;
+				Refill();
+				return PGRERROR_OK;
+			}
+
+			PipelinedTrigger( const PipelinedTrigger& );
+			PipelinedTrigger& operator=( const PipelinedTrigger& );
+
+			CameraT*                    m_pCamera;
+			unsigned int                m_depth;
+			unsigned long long          m_numTriggers;
+			unsigned long long          m_nextTriggerIndex;
+			bool                        m_resyncing;
+			std::deque<InFlightTrigger> m_inFlight;
+			PipelinedTriggerStats       m_stats;
+			double                      m_latencySumNs;
+	};
+}
+
+#endif // FLIR_FC2_PIPELINEDTRIGGER_H
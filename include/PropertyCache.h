@@ -0,0 +1,540 @@
+//=============================================================================
+// Copyright (c) 2001-2018 FLIR Systems, Inc. All Rights Reserved.
+//
+// This software is the confidential and proprietary information of FLIR
+// Integrated Imaging Solutions, Inc. ("Confidential Information"). You
+// shall not disclose such Confidential Information and shall use it only in
+// accordance with the terms of the license agreement you entered into
+// with FLIR Integrated Imaging Solutions, Inc. (FLIR).
+//
+// FLIR MAKES NO REPRESENTATIONS OR WARRANTIES ABOUT THE SUITABILITY OF THE
+// SOFTWARE, EITHER EXPRESSED OR IMPLIED, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+// PURPOSE, OR NON-INFRINGEMENT. FLIR SHALL NOT BE LIABLE FOR ANY DAMAGES
+// SUFFERED BY LICENSEE AS A RESULT OF USING, MODIFYING OR DISTRIBUTING
+// THIS SOFTWARE OR ITS DERIVATIVES.
+//=============================================================================
+
+#ifndef FLIR_FC2_PROPERTYCACHE_H
+#define FLIR_FC2_PROPERTYCACHE_H
+
+#include "FlyCapture2Platform.h"
+#include "FlyCapture2Defs.h"
+#include "Error.h"
+
+#if !defined(_MSC_VER) && __cplusplus < 201103L
+#error "PropertyCache.h requires C++11"
+#endif
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace FlyCapture2
+{
+	namespace Detail
+	{
+		// Control registers are addressed from the 48 bit base 0xFFFFF0F00000.
+		static const unsigned short sk_controlRegisterBaseHigh = 0xFFFF;
+		static const unsigned int sk_controlRegisterBaseLow = 0xF0F00000;
+
+		// The value registers of all properties but zoom, pan and tilt lie
+		// in one block at 0x800, so a single block read shows which of
+		// them changed.
+		static const unsigned int sk_propertyBlockOffset = 0x800;
+		static const unsigned int sk_propertyBlockQuadlets = 16;
+
+		/**
+		 * Get the index of a property's value register in the block at
+		 * sk_propertyBlockOffset.
+		 *
+		 * @return The quadlet index, or -1 if it is outside the block.
+		 */
+		inline int GetPropertyBlockIndex( PropertyType type )
+		{
+			static const int sk_indices[] =
+			{
+				0x00,   // BRIGHTNESS
+				0x01,   // AUTO_EXPOSURE
+				0x02,   // SHARPNESS
+				0x03,   // WHITE_BALANCE
+				0x04,   // HUE
+				0x05,   // SATURATION
+				0x06,   // GAMMA
+				0x09,   // IRIS
+				0x0A,   // FOCUS
+				-1,     // ZOOM
+				-1,     // PAN
+				-1,     // TILT
+				0x07,   // SHUTTER
+				0x08,   // GAIN
+				0x0C,   // TRIGGER_MODE
+				0x0D,   // TRIGGER_DELAY
+				0x0F,   // FRAME_RATE
+				0x0B    // TEMPERATURE
+			};
+
+			const unsigned int index = static_cast<unsigned int>( type );
+			return index < sizeof(sk_indices) / sizeof(sk_indices[0]) ? sk_indices[index] : -1;
+		}
+	}
+
+	/**
+	 * The PropertyCache class serves camera property reads from memory.
+	 * A background thread refreshes the cached properties from the camera at
+	 * a fixed period, so the number of register reads on the control channel
+	 * is bounded by the refresh rate regardless of how often the properties
+	 * are read. Reads are lock free and never wait for the camera or for
+	 * each other, which keeps high rate property polling from contending
+	 * with image retrieval on the same camera.
+	 *
+	 * The refreshed set can be changed while running with
+	 * SetActiveProperties(), so a control dialog can refresh only the
+	 * controls that are visible and load a page when it is first shown.
+	 * Properties that are not cached yet are read on the refresh thread.
+	 * Each pass starts with one block read of the property value
+	 * registers, and only properties whose register changed are read in
+	 * full. Cameras that do not support the block read fall back to
+	 * reading every active property. While SetCapturing( true ) is in
+	 * effect, the refresh period is lengthened to the capture period so
+	 * polling competes less with streaming.
+	 *
+	 * GetProperty() may be called from any number of threads. SetProperty(),
+	 * Start() and Stop() are serialized internally.
+	 *
+	 * The class works with any camera type providing Get/SetProperty() and
+	 * ReadRegisterBlock(), such as Camera, GigECamera or a VirtualCamera,
+	 * whose methods may return either an Error or an ErrorType.
+	 */
+	template <class CameraT>
+	class PropertyCache
+	{
+		public:
+
+			/**
+			 * Construct a property cache for a camera. The camera must be
+			 * connected before Start() is called and must outlive the cache.
+			 *
+			 * @param pCamera The camera to cache properties of.
+			 */
+			explicit PropertyCache( CameraT* pCamera )
+				: m_pCamera( pCamera ),
+				  m_refreshPeriodMs( 0 ),
+				  m_capturePeriodMs( 0 ),
+				  m_capturing( false ),
+				  m_running( false ),
+				  m_refreshRequested( false ),
+				  m_periodChanged( false ),
+				  m_refreshCount( 0 ),
+				  m_numPropertyReads( 0 ),
+				  m_numBlockReads( 0 )
+			{
+				for ( unsigned int i = 0; i < sk_numSlots; i++ )
+				{
+					m_slots[i].sequence.store( 0 );
+					m_slots[i].cached = false;
+					m_slots[i].property = Property( static_cast<PropertyType>( i ) );
+					m_registers[i] = 0;
+					m_registerValid[i] = false;
+				}
+			}
+
+			/**
+			 * Default destructor. Stops the refresh thread.
+			 */
+			~PropertyCache()
+			{
+				Stop();
+			}
+
+			/**
+			 * Read the specified properties from the camera and start
+			 * refreshing them in the background.
+			 *
+			 * @param pTypes The property types to cache.
+			 * @param numTypes Number of entries in pTypes.
+			 * @param refreshPeriodMs Time between refreshes, in milliseconds.
+			 *
+			 * @see Stop()
+			 *
+			 * @return PGRERROR_OK, PGRERROR_INVALID_PARAMETER if a property type
+			 *         is invalid, or the type of the error returned by the
+			 *         camera for the initial read.
+			 */
+			ErrorType Start(
+					const PropertyType* pTypes,
+					unsigned int        numTypes,
+					unsigned int        refreshPeriodMs )
+			{
+				Stop();
+
+				std::lock_guard<std::mutex> writeLock( m_writeMutex );
+
+				if ( !AssignTypes( pTypes, numTypes ) )
+				{
+					return PGRERROR_INVALID_PARAMETER;
+				}
+				for ( unsigned int i = 0; i < sk_numSlots; i++ )
+				{
+					m_registerValid[i] = false;
+				}
+
+				for ( size_t i = 0; i < m_types.size(); i++ )
+				{
+					Property prop( m_types[i] );
+					const ErrorType error = GetErrorType( m_pCamera->GetProperty( &prop ) );
+					if ( error != PGRERROR_OK )
+					{
+						return error;
+					}
+					Publish( prop );
+					m_numPropertyReads.fetch_add( 1, std::memory_order_relaxed );
+				}
+
+				m_refreshPeriodMs = refreshPeriodMs;
+				m_running = true;
+				m_thread = std::thread( &PropertyCache::RefreshLoop, this );
+				return PGRERROR_OK;
+			}
+
+			/**
+			 * Replace the set of refreshed properties, typically with the
+			 * controls currently visible. Properties not cached yet are
+			 * read on the refresh thread, which is woken immediately, so
+			 * this never waits for the camera. Properties dropped from the
+			 * set keep their last cached value.
+			 *
+			 * @param pTypes The property types to refresh.
+			 * @param numTypes Number of entries in pTypes.
+			 *
+			 * @return PGRERROR_OK, or PGRERROR_INVALID_PARAMETER if a property
+			 *         type is invalid.
+			 */
+			ErrorType SetActiveProperties( const PropertyType* pTypes, unsigned int numTypes )
+			{
+				{
+					std::lock_guard<std::mutex> writeLock( m_writeMutex );
+					if ( !AssignTypes( pTypes, numTypes ) )
+					{
+						return PGRERROR_INVALID_PARAMETER;
+					}
+				}
+
+				RequestRefresh();
+				return PGRERROR_OK;
+			}
+
+			/**
+			 * Set the refresh period used while capture is running. The
+			 * default, 0, keeps the normal period.
+			 *
+			 * @param capturePeriodMs Time between refreshes while capturing,
+			 *                        in milliseconds.
+			 */
+			void SetCaptureRefreshPeriod( unsigned int capturePeriodMs )
+			{
+				{
+					std::lock_guard<std::mutex> stopLock( m_stopMutex );
+					m_capturePeriodMs = capturePeriodMs;
+					m_periodChanged = true;
+				}
+				m_stopCondition.notify_all();
+			}
+
+			/**
+			 * Tell the cache whether capture is running, to select the
+			 * refresh period. A new period takes effect for the refresh
+			 * currently being waited for.
+			 *
+			 * @param capturing Whether the camera is streaming.
+			 */
+			void SetCapturing( bool capturing )
+			{
+				{
+					std::lock_guard<std::mutex> stopLock( m_stopMutex );
+					m_capturing = capturing;
+					m_periodChanged = true;
+				}
+				m_stopCondition.notify_all();
+			}
+
+			/**
+			 * Refresh the active properties now rather than at the end of
+			 * the period, for example after another application changed
+			 * them.
+			 */
+			void RequestRefresh()
+			{
+				{
+					std::lock_guard<std::mutex> stopLock( m_stopMutex );
+					m_refreshRequested = true;
+				}
+				m_stopCondition.notify_all();
+			}
+
+			/**
+			 * Stop refreshing. The last cached values remain readable.
+			 *
+			 * @see Start()
+			 */
+			void Stop()
+			{
+				{
+					std::lock_guard<std::mutex> stopLock( m_stopMutex );
+					m_running = false;
+				}
+				m_stopCondition.notify_all();
+
+				if ( m_thread.joinable() )
+				{
+					m_thread.join();
+				}
+			}
+
+			/**
+			 * Get the cached value of a property. The property type must be
+			 * specified in the Property structure passed in to the function.
+			 * This call does not communicate with the camera.
+			 *
+			 * @param pProp Pointer to the Property structure to be filled.
+			 *
+			 * @return true if the property is cached, false if it was not
+			 *         part of the set passed to Start().
+			 */
+			bool GetProperty( Property* pProp ) const
+			{
+				const unsigned int index = static_cast<unsigned int>( pProp->type );
+				if ( index >= sk_numSlots )
+				{
+					return false;
+				}
+
+				const Slot& slot = m_slots[index];
+				for ( ;; )
+				{
+					const unsigned int before = slot.sequence.load( std::memory_order_acquire );
+					if ( before & 1 )
+					{
+						std::this_thread::yield();
+						continue;
+					}
+
+					const bool cached = slot.cached;
+					const Property snapshot = slot.property;
+					std::atomic_thread_fence( std::memory_order_acquire );
+
+					if ( slot.sequence.load( std::memory_order_relaxed ) == before )
+					{
+						if ( cached )
+						{
+							*pProp = snapshot;
+						}
+						return cached;
+					}
+				}
+			}
+
+			/**
+			 * Write a property to the camera and update the cached value.
+			 *
+			 * @param prop The property to write.
+			 *
+			 * @return PGRERROR_OK, or the type of the error returned by the
+			 *         camera.
+			 */
+			ErrorType SetProperty( const Property& prop )
+			{
+				std::lock_guard<std::mutex> writeLock( m_writeMutex );
+
+				Property value = prop;
+				const ErrorType error = GetErrorType( m_pCamera->SetProperty( &value ) );
+				if ( error != PGRERROR_OK )
+				{
+					return error;
+				}
+
+				Publish( value );
+				m_registerValid[ static_cast<unsigned int>( value.type ) ] = false;
+				return PGRERROR_OK;
+			}
+
+			/**
+			 * Get the number of completed refresh passes.
+			 *
+			 * @return The number of refresh passes since Start().
+			 */
+			unsigned long long GetRefreshCount() const
+			{
+				return m_refreshCount.load( std::memory_order_relaxed );
+			}
+
+			/**
+			 * Get the number of full property reads from the camera.
+			 *
+			 * @return The number of GetProperty() calls made on the camera.
+			 */
+			unsigned long long GetNumPropertyReads() const
+			{
+				return m_numPropertyReads.load( std::memory_order_relaxed );
+			}
+
+			/**
+			 * Get the number of block reads of the property value registers.
+			 *
+			 * @return The number of successful block reads.
+			 */
+			unsigned long long GetNumBlockReads() const
+			{
+				return m_numBlockReads.load( std::memory_order_relaxed );
+			}
+
+		private:
+
+			static const unsigned int sk_numSlots = UNSPECIFIED_PROPERTY_TYPE;
+
+			struct Slot
+			{
+				std::atomic<unsigned int> sequence;
+				bool cached;
+				Property property;
+			};
+
+			// Callers hold m_writeMutex.
+			bool AssignTypes( const PropertyType* pTypes, unsigned int numTypes )
+			{
+				for ( unsigned int i = 0; i < numTypes; i++ )
+				{
+					if ( static_cast<unsigned int>( pTypes[i] ) >= sk_numSlots )
+					{
+						return false;
+					}
+				}
+
+				m_types.assign( pTypes, pTypes + numTypes );
+				return true;
+			}
+
+			// Callers hold m_writeMutex, so there is a single writer per slot.
+			void Publish( const Property& prop )
+			{
+				Slot& slot = m_slots[ static_cast<unsigned int>( prop.type ) ];
+				const unsigned int sequence = slot.sequence.load( std::memory_order_relaxed );
+
+				slot.sequence.store( sequence + 1, std::memory_order_relaxed );
+				std::atomic_thread_fence( std::memory_order_release );
+				slot.property = prop;
+				slot.cached = true;
+				slot.sequence.store( sequence + 2, std::memory_order_release );
+			}
+
+			void RefreshLoop()
+			{
+				std::unique_lock<std::mutex> stopLock( m_stopMutex );
+				std::chrono::steady_clock::time_point lastRefresh = std::chrono::steady_clock::now();
+				while ( m_running )
+				{
+					const unsigned int capturePeriodMs = m_capturePeriodMs;
+					const unsigned int periodMs = ( m_capturing && capturePeriodMs > m_refreshPeriodMs ) ?
+						capturePeriodMs : m_refreshPeriodMs;
+					m_periodChanged = false;
+					const bool woken = m_stopCondition.wait_until(
+							stopLock,
+							lastRefresh + std::chrono::milliseconds( periodMs ),
+							[this] { return !m_running || m_refreshRequested || m_periodChanged; } );
+					if ( !m_running )
+					{
+						break;
+					}
+					if ( woken && !m_refreshRequested )
+					{
+						// The period changed: wait again, from the last
+						// refresh, with the new one.
+						continue;
+					}
+					m_refreshRequested = false;
+
+					stopLock.unlock();
+					RefreshActive();
+					m_refreshCount.fetch_add( 1, std::memory_order_relaxed );
+					stopLock.lock();
+					lastRefresh = std::chrono::steady_clock::now();
+				}
+			}
+
+			void RefreshActive()
+			{
+				std::vector<PropertyType> types;
+				{
+					std::lock_guard<std::mutex> writeLock( m_writeMutex );
+					types = m_types;
+				}
+
+				// Read every value register in one transaction, then skip
+				// the properties whose register has not changed.
+				unsigned int block[Detail::sk_propertyBlockQuadlets];
+				const bool haveBlock = GetErrorType( m_pCamera->ReadRegisterBlock(
+					Detail::sk_controlRegisterBaseHigh,
+					Detail::sk_controlRegisterBaseLow + Detail::sk_propertyBlockOffset,
+					block,
+					Detail::sk_propertyBlockQuadlets ) ) == PGRERROR_OK;
+				if ( haveBlock )
+				{
+					m_numBlockReads.fetch_add( 1, std::memory_order_relaxed );
+				}
+
+				for ( size_t i = 0; i < types.size(); i++ )
+				{
+					std::lock_guard<std::mutex> writeLock( m_writeMutex );
+
+					const unsigned int slot = static_cast<unsigned int>( types[i] );
+					const int blockIndex = Detail::GetPropertyBlockIndex( types[i] );
+					const bool tracked = haveBlock && blockIndex >= 0;
+					if ( tracked && m_slots[slot].cached && m_registerValid[slot] &&
+						 m_registers[slot] == block[blockIndex] )
+					{
+						continue;
+					}
+
+					Property prop( types[i] );
+					if ( GetErrorType( m_pCamera->GetProperty( &prop ) ) == PGRERROR_OK )
+					{
+						Publish( prop );
+						m_registers[slot] = tracked ? block[blockIndex] : 0;
+						m_registerValid[slot] = tracked;
+					}
+					m_numPropertyReads.fetch_add( 1, std::memory_order_relaxed );
+				}
+			}
+
+			static ErrorType GetErrorType( const Error& error ) { return error.GetType(); }
+			static ErrorType GetErrorType( ErrorType error ) { return error; }
+
+			PropertyCache( const PropertyCache& );
+			PropertyCache& operator=( const PropertyCache& );
+
+			CameraT*                        m_pCamera;
+			Slot                            m_slots[sk_numSlots];
+			std::vector<PropertyType>       m_types;
+			unsigned int                    m_registers[sk_numSlots];
+			bool                            m_registerValid[sk_numSlots];
+			unsigned int                    m_refreshPeriodMs;
+			std::atomic<unsigned int>       m_capturePeriodMs;
+			std::atomic<bool>               m_capturing;
+
+			std::mutex                      m_writeMutex;
+			std::mutex                      m_stopMutex;
+			std::condition_variable         m_stopCondition;
+			bool                            m_running;
+			bool                            m_refreshRequested;
+			bool                            m_periodChanged;
+			std::thread                     m_thread;
+			std::atomic<unsigned long long> m_refreshCount;
+			std::atomic<unsigned long long> m_numPropertyReads;
+			std::atomic<unsigned long long> m_numBlockReads;
+	};
+}
+
+#endif // FLIR_FC2_PROPERTYCACHE_H
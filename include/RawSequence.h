@@ -0,0 +1,742 @@
+//=============================================================================
+// Copyright (c) 2001-2018 FLIR Systems, Inc. All Rights Reserved.
+//
+// This software is the confidential and proprietary information of FLIR
+// Integrated Imaging Solutions, Inc. ("Confidential Information"). You
+// shall not disclose such Confidential Information and shall use it only in
+// accordance with the terms of the license agreement you entered into
+// with FLIR Integrated Imaging Solutions, Inc. (FLIR).
+//
+// FLIR MAKES NO REPRESENTATIONS OR WARRANTIES ABOUT THE SUITABILITY OF THE
+// SOFTWARE, EITHER EXPRESSED OR IMPLIED, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+// PURPOSE, OR NON-INFRINGEMENT. FLIR SHALL NOT BE LIABLE FOR ANY DAMAGES
+// SUFFERED BY LICENSEE AS A RESULT OF USING, MODIFYING OR DISTRIBUTING
+// THIS SOFTWARE OR ITS DERIVATIVES.
+//=============================================================================
+
+#ifndef FLIR_FC2_RAWSEQUENCE_H
+#define FLIR_FC2_RAWSEQUENCE_H
+
+#include "FlyCapture2Platform.h"
+#include "FlyCapture2Defs.h"
+#include "Image.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#if defined(_WIN32)
+#include <stdlib.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+/**
+ * A raw sequence file stores frames of a single geometry uncompressed, so
+ * that recording costs one write per frame and playback can map the file
+ * and address any frame directly.
+ *
+ * Layout, all header fields little endian regardless of the host byte
+ * order. Frame data is stored as delivered by the camera.
+ *
+ *   File header (64 bytes)
+ *     char   magic[8]        "FC2RSEQ" followed by a NUL
+ *     uint32 version         1
+ *     uint32 headerSize      64
+ *     uint32 rows, cols, stride
+ *     uint32 pixelFormat     PixelFormat value
+ *     uint32 bayerFormat     BayerTileFormat value
+ *     uint32 recordSize      Bytes per frame record, a multiple of 64
+ *     uint32 reserved[6]
+ *
+ *   Frame records, recordSize bytes each, starting at headerSize
+ *     int64  seconds         TimeStamp of the frame
+ *     uint32 microSeconds
+ *     uint32 cycleSeconds, cycleCount, cycleOffset
+ *     uint32 metadata[10]    ImageMetadata, embeddedTimeStamp through
+ *                            embeddedROIPosition
+ *     uint8  data[rows * stride], starting at offset 64
+ *
+ * The number of frames is derived from the file size, so a recording that
+ * was interrupted remains readable up to its last complete frame.
+ */
+
+namespace FlyCapture2
+{
+	/** Geometry and record layout of a raw sequence file. */
+	struct RawSequenceHeader
+	{
+		/** Rows in each frame. */
+		unsigned int rows;
+		/** Columns in each frame. */
+		unsigned int cols;
+		/** Number of bytes between rows. */
+		unsigned int stride;
+		/** Pixel format of each frame. */
+		PixelFormat pixelFormat;
+		/** Bayer tile format of each frame. */
+		BayerTileFormat bayerFormat;
+		/** Bytes per frame record. */
+		unsigned int recordSize;
+
+		RawSequenceHeader()
+		{
+			rows = 0;
+			cols = 0;
+			stride = 0;
+			pixelFormat = UNSPECIFIED_PIXEL_FORMAT;
+			bayerFormat = NONE;
+			recordSize = 0;
+		}
+	};
+
+	namespace Detail
+	{
+		static const char sk_rawSequenceMagic[8] = { 'F', 'C', '2', 'R', 'S', 'E', 'Q', '\0' };
+		static const unsigned int sk_rawSequenceVersion = 1;
+		static const unsigned int sk_rawSequenceHeaderSize = 64;
+		static const unsigned int sk_rawSequenceRecordHeaderSize = 64;
+
+		inline void StoreLittleEndian( unsigned char* pOut, const unsigned int* pValues, size_t count )
+		{
+			for ( size_t i = 0; i < count; i++ )
+			{
+				pOut[i * 4] = static_cast<unsigned char>( pValues[i] );
+				pOut[i * 4 + 1] = static_cast<unsigned char>( pValues[i] >> 8 );
+				pOut[i * 4 + 2] = static_cast<unsigned char>( pValues[i] >> 16 );
+				pOut[i * 4 + 3] = static_cast<unsigned char>( pValues[i] >> 24 );
+			}
+		}
+
+		inline void LoadLittleEndian( const unsigned char* pIn, unsigned int* pValues, size_t count )
+		{
+			for ( size_t i = 0; i < count; i++ )
+			{
+				pValues[i] = static_cast<unsigned int>( pIn[i * 4] ) |
+					( static_cast<unsigned int>( pIn[i * 4 + 1] ) << 8 ) |
+					( static_cast<unsigned int>( pIn[i * 4 + 2] ) << 16 ) |
+					( static_cast<unsigned int>( pIn[i * 4 + 3] ) << 24 );
+			}
+		}
+
+		inline void EncodeRawSequenceHeader( const RawSequenceHeader& header, unsigned char* pOut )
+		{
+			const unsigned int fields[8] =
+			{
+				sk_rawSequenceVersion,
+				sk_rawSequenceHeaderSize,
+				header.rows,
+				header.cols,
+				header.stride,
+				static_cast<unsigned int>( header.pixelFormat ),
+				static_cast<unsigned int>( header.bayerFormat ),
+				header.recordSize
+			};
+
+			memset( pOut, 0, sk_rawSequenceHeaderSize );
+			memcpy( pOut, sk_rawSequenceMagic, sizeof(sk_rawSequenceMagic) );
+			StoreLittleEndian( pOut + 8, fields, 8 );
+		}
+
+		inline bool DecodeRawSequenceHeader( const unsigned char* pIn, RawSequenceHeader* pHeader )
+		{
+			unsigned int fields[8];
+			LoadLittleEndian( pIn + 8, fields, 8 );
+			if ( memcmp( pIn, sk_rawSequenceMagic, sizeof(sk_rawSequenceMagic) ) != 0 ||
+				 fields[0] != sk_rawSequenceVersion ||
+				 fields[1] != sk_rawSequenceHeaderSize )
+			{
+				return false;
+			}
+
+			pHeader->rows = fields[2];
+			pHeader->cols = fields[3];
+			pHeader->stride = fields[4];
+			pHeader->pixelFormat = static_cast<PixelFormat>( fields[5] );
+			pHeader->bayerFormat = static_cast<BayerTileFormat>( fields[6] );
+			pHeader->recordSize = fields[7];
+			return pHeader->recordSize >= sk_rawSequenceRecordHeaderSize +
+				static_cast<unsigned long long>( pHeader->rows ) * pHeader->stride;
+		}
+
+		inline void EncodeRawSequenceRecord(
+				const TimeStamp&     timeStamp,
+				const ImageMetadata& metadata,
+				unsigned char*       pOut )
+		{
+			const unsigned int fields[14] =
+			{
+				timeStamp.microSeconds,
+				timeStamp.cycleSeconds,
+				timeStamp.cycleCount,
+				timeStamp.cycleOffset,
+				metadata.embeddedTimeStamp,
+				metadata.embeddedGain,
+				metadata.embeddedShutter,
+				metadata.embeddedBrightness,
+				metadata.embeddedExposure,
+				metadata.embeddedWhiteBalance,
+				metadata.embeddedFrameCounter,
+				metadata.embeddedStrobePattern,
+				metadata.embeddedGPIOPinState,
+				metadata.embeddedROIPosition
+			};
+
+			const unsigned long long seconds = static_cast<unsigned long long>( timeStamp.seconds );
+			const unsigned int secondsWords[2] =
+			{
+				static_cast<unsigned int>( seconds ),
+				static_cast<unsigned int>( seconds >> 32 )
+			};
+			StoreLittleEndian( pOut, secondsWords, 2 );
+			StoreLittleEndian( pOut + 8, fields, 14 );
+		}
+
+		inline void DecodeRawSequenceRecord(
+				const unsigned char* pIn,
+				TimeStamp*           pTimeStamp,
+				ImageMetadata*       pMetadata )
+		{
+			unsigned int secondsWords[2];
+			unsigned int fields[14];
+			LoadLittleEndian( pIn, secondsWords, 2 );
+			LoadLittleEndian( pIn + 8, fields, 14 );
+
+			pTimeStamp->seconds = static_cast<long long>(
+				( static_cast<unsigned long long>( secondsWords[1] ) << 32 ) | secondsWords[0] );
+
+			pTimeStamp->microSeconds = fields[0];
+			pTimeStamp->cycleSeconds = fields[1];
+			pTimeStamp->cycleCount = fields[2];
+			pTimeStamp->cycleOffset = fields[3];
+			pMetadata->embeddedTimeStamp = fields[4];
+			pMetadata->embeddedGain = fields[5];
+			pMetadata->embeddedShutter = fields[6];
+			pMetadata->embeddedBrightness = fields[7];
+			pMetadata->embeddedExposure = fields[8];
+			pMetadata->embeddedWhiteBalance = fields[9];
+			pMetadata->embeddedFrameCounter = fields[10];
+			pMetadata->embeddedStrobePattern = fields[11];
+			pMetadata->embeddedGPIOPinState = fields[12];
+			pMetadata->embeddedROIPosition = fields[13];
+		}
+	}
+
+	/**
+	 * The RawSequenceWriter class records frames to a raw sequence file.
+	 * All frames must have the geometry of the first.
+	 */
+	class RawSequenceWriter
+	{
+		public:
+
+			RawSequenceWriter()
+				: m_pFile( NULL ),
+				  m_numFrames( 0 ),
+				  m_failed( false )
+			{
+			}
+
+			~RawSequenceWriter()
+			{
+				Close();
+			}
+
+			/**
+			 * Create a sequence file, replacing any existing file.
+			 *
+			 * @param pFilename Name of the file to create.
+			 * @param rows Rows in each frame.
+			 * @param cols Columns in each frame.
+			 * @param stride Number of bytes between rows.
+			 * @param pixelFormat Pixel format of each frame.
+			 * @param bayerFormat Bayer tile format of each frame.
+			 *
+			 * @return PGRERROR_OK, PGRERROR_INVALID_PARAMETER, or
+			 *         PGRERROR_FAILED if the file cannot be written.
+			 */
+			ErrorType Open(
+					const char*     pFilename,
+					unsigned int    rows,
+					unsigned int    cols,
+					unsigned int    stride,
+					PixelFormat     pixelFormat,
+					BayerTileFormat bayerFormat = NONE )
+			{
+				Close();
+
+				const unsigned long long frameSize = static_cast<unsigned long long>( rows ) * stride;
+				const unsigned long long recordSize =
+					( Detail::sk_rawSequenceRecordHeaderSize + frameSize + 63 ) & ~63ull;
+				if ( pFilename == NULL || frameSize == 0 || recordSize > 0xFFFFFFFFull )
+				{
+					return PGRERROR_INVALID_PARAMETER;
+				}
+
+				m_header.rows = rows;
+				m_header.cols = cols;
+				m_header.stride = stride;
+				m_header.pixelFormat = pixelFormat;
+				m_header.bayerFormat = bayerFormat;
+				m_header.recordSize = static_cast<unsigned int>( recordSize );
+
+				m_pFile = fopen( pFilename, "wb" );
+				if ( m_pFile == NULL )
+				{
+					return PGRERROR_FAILED;
+				}
+
+				unsigned char header[Detail::sk_rawSequenceHeaderSize];
+				Detail::EncodeRawSequenceHeader( m_header, header );
+				if ( fwrite( header, sizeof(header), 1, m_pFile ) != 1 )
+				{
+					Close();
+					return PGRERROR_FAILED;
+				}
+
+				m_numFrames = 0;
+				m_failed = false;
+				return PGRERROR_OK;
+			}
+
+			/**
+			 * Create a sequence file with the geometry of an image.
+			 *
+			 * @param pFilename Name of the file to create.
+			 * @param image Image that provides the geometry.
+			 *
+			 * @return PGRERROR_OK, PGRERROR_INVALID_PARAMETER, or
+			 *         PGRERROR_FAILED if the file cannot be written.
+			 */
+			ErrorType Open( const char* pFilename, const Image& image )
+			{
+				unsigned int rows;
+				unsigned int cols;
+				unsigned int stride;
+				PixelFormat pixelFormat;
+				BayerTileFormat bayerFormat;
+				image.GetDimensions( &rows, &cols, &stride, &pixelFormat, &bayerFormat );
+				return Open( pFilename, rows, cols, stride, pixelFormat, bayerFormat );
+			}
+
+			/**
+			 * Append a frame.
+			 *
+			 * @param pData Frame data of rows * stride bytes.
+			 * @param timeStamp Time stamp of the frame.
+			 * @param metadata Metadata of the frame.
+			 *
+			 * @return PGRERROR_OK, PGRERROR_NOT_INTITIALIZED, or
+			 *         PGRERROR_FAILED if the file cannot be written. A
+			 *         failed write leaves at most a partial record, which
+			 *         the next frame overwrites and readers ignore; if the
+			 *         file position cannot be restored, every later call
+			 *         fails until the file is opened again.
+			 */
+			ErrorType Append(
+					const unsigned char* pData,
+					const TimeStamp&     timeStamp,
+					const ImageMetadata& metadata )
+			{
+				if ( m_pFile == NULL )
+				{
+					return PGRERROR_NOT_INTITIALIZED;
+				}
+				if ( m_failed )
+				{
+					return PGRERROR_FAILED;
+				}
+
+				unsigned char record[Detail::sk_rawSequenceRecordHeaderSize];
+				memset( record, 0, sizeof(record) );
+				Detail::EncodeRawSequenceRecord( timeStamp, metadata, record );
+
+				static const unsigned char sk_padding[64] = { 0 };
+				const size_t frameSize = static_cast<size_t>( m_header.rows ) * m_header.stride;
+				const size_t paddingSize = m_header.recordSize - sizeof(record) - frameSize;
+				if ( fwrite( record, sizeof(record), 1, m_pFile ) != 1 ||
+					 fwrite( pData, frameSize, 1, m_pFile ) != 1 ||
+					 ( paddingSize != 0 && fwrite( sk_padding, paddingSize, 1, m_pFile ) != 1 ) )
+				{
+					// Step back over the partial record so the next one
+					// starts on the record grid. Readers ignore a partial
+					// record at the end of the file.
+					const unsigned long long offset =
+						Detail::sk_rawSequenceHeaderSize + m_numFrames * m_header.recordSize;
+#if defined(_WIN32)
+					m_failed = _fseeki64( m_pFile, static_cast<long long>( offset ), SEEK_SET ) != 0;
+#else
+					m_failed = fseeko( m_pFile, static_cast<off_t>( offset ), SEEK_SET ) != 0;
+#endif
+					return PGRERROR_FAILED;
+				}
+
+				m_numFrames++;
+				return PGRERROR_OK;
+			}
+
+			/**
+			 * Append an image with its own time stamp and metadata. The
+			 * image must have the geometry the file was opened with.
+			 *
+			 * @param image The image to append.
+			 *
+			 * @return PGRERROR_OK, PGRERROR_NOT_INTITIALIZED,
+			 *         PGRERROR_INVALID_PARAMETER if the geometry differs, or
+			 *         PGRERROR_FAILED if the file cannot be written.
+			 */
+			ErrorType Append( const Image& image )
+			{
+				return Append( image, image.GetTimeStamp(), image.GetMetadata() );
+			}
+
+			/**
+			 * Append an image with a time stamp and metadata delivered out
+			 * of band, such as in the VirtualFrameInfo of a virtual camera.
+			 * The image must have the geometry the file was opened with.
+			 *
+			 * @param image The image to append.
+			 * @param timeStamp Time stamp of the frame.
+			 * @param metadata Metadata of the frame.
+			 *
+			 * @return PGRERROR_OK, PGRERROR_NOT_INTITIALIZED,
+			 *         PGRERROR_INVALID_PARAMETER if the geometry differs, or
+			 *         PGRERROR_FAILED if the file cannot be written.
+			 */
+			ErrorType Append( const Image& image, const TimeStamp& timeStamp, const ImageMetadata& metadata )
+			{
+				unsigned int rows;
+				unsigned int cols;
+				unsigned int stride;
+				PixelFormat pixelFormat;
+				BayerTileFormat bayerFormat;
+				image.GetDimensions( &rows, &cols, &stride, &pixelFormat, &bayerFormat );
+				if ( m_pFile != NULL &&
+					 ( rows != m_header.rows || cols != m_header.cols || stride != m_header.stride ||
+					   pixelFormat != m_header.pixelFormat ) )
+				{
+					return PGRERROR_INVALID_PARAMETER;
+				}
+
+				return Append( image.GetData(), timeStamp, metadata );
+			}
+
+			/**
+			 * Flush buffered frames to the file.
+			 *
+			 * @return PGRERROR_OK, or PGRERROR_FAILED if the file cannot be
+			 *         written.
+			 */
+			ErrorType Flush()
+			{
+				return ( m_pFile != NULL && fflush( m_pFile ) != 0 ) ? PGRERROR_FAILED : PGRERROR_OK;
+			}
+
+			/**
+			 * Close the file.
+			 *
+			 * @return PGRERROR_OK, or PGRERROR_FAILED if buffered frames
+			 *         could not be written.
+			 */
+			ErrorType Close()
+			{
+				if ( m_pFile == NULL )
+				{
+					return PGRERROR_OK;
+				}
+
+				const int result = fclose( m_pFile );
+				m_pFile = NULL;
+				return result == 0 ? PGRERROR_OK : PGRERROR_FAILED;
+			}
+
+			/**
+			 * Get the number of frames appended since the file was opened.
+			 *
+			 * @return The number of frames.
+			 */
+			unsigned long long GetNumFrames() const { return m_numFrames; }
+
+		private:
+
+			RawSequenceWriter( const RawSequenceWriter& );
+			RawSequenceWriter& operator=( const RawSequenceWriter& );
+
+			FILE*              m_pFile;
+			RawSequenceHeader  m_header;
+			unsigned long long m_numFrames;
+			bool               m_failed;
+	};
+
+	/**
+	 * The RawSequenceReader class provides random access to the frames of a
+	 * raw sequence file. On POSIX systems the file is memory mapped and
+	 * Prefetch() asks the kernel to read frames ahead asynchronously.
+	 */
+	class RawSequenceReader
+	{
+		public:
+
+			RawSequenceReader()
+				: m_numFrames( 0 ),
+#if defined(_WIN32)
+				  m_pFile( NULL )
+#else
+				  m_pMapping( NULL ),
+				  m_mappingSize( 0 )
+#endif
+			{
+			}
+
+			~RawSequenceReader()
+			{
+				Close();
+			}
+
+			/**
+			 * Open a sequence file.
+			 *
+			 * @param pFilename Name of the file to open.
+			 *
+			 * @return PGRERROR_OK, PGRERROR_NOT_FOUND if the file cannot be
+			 *         opened, or PGRERROR_IMAGE_CONSISTENCY_ERROR if it is
+			 *         not a raw sequence file.
+			 */
+			ErrorType Open( const char* pFilename )
+			{
+				Close();
+
+				unsigned char header[Detail::sk_rawSequenceHeaderSize];
+				unsigned long long fileSize = 0;
+#if defined(_WIN32)
+				m_pFile = fopen( pFilename, "rb" );
+				if ( m_pFile == NULL )
+				{
+					return PGRERROR_NOT_FOUND;
+				}
+
+				_fseeki64( m_pFile, 0, SEEK_END );
+				fileSize = static_cast<unsigned long long>( _ftelli64( m_pFile ) );
+				_fseeki64( m_pFile, 0, SEEK_SET );
+				if ( fread( header, sizeof(header), 1, m_pFile ) != 1 )
+				{
+					Close();
+					return PGRERROR_IMAGE_CONSISTENCY_ERROR;
+				}
+#else
+				const int fd = open( pFilename, O_RDONLY );
+				if ( fd < 0 )
+				{
+					return PGRERROR_NOT_FOUND;
+				}
+
+				struct stat status;
+				if ( fstat( fd, &status ) != 0 || status.st_size < static_cast<off_t>( sizeof(header) ) )
+				{
+					close( fd );
+					return PGRERROR_IMAGE_CONSISTENCY_ERROR;
+				}
+
+				fileSize = static_cast<unsigned long long>( status.st_size );
+				void* pMapping = mmap( NULL, static_cast<size_t>( fileSize ), PROT_READ, MAP_SHARED, fd, 0 );
+				close( fd );
+				if ( pMapping == MAP_FAILED )
+				{
+					return PGRERROR_MEMORY_ALLOCATION_FAILED;
+				}
+
+				m_pMapping = static_cast<unsigned char*>( pMapping );
+				m_mappingSize = static_cast<size_t>( fileSize );
+				madvise( m_pMapping, m_mappingSize, MADV_SEQUENTIAL );
+				memcpy( header, m_pMapping, sizeof(header) );
+#endif
+
+				if ( !Detail::DecodeRawSequenceHeader( header, &m_header ) )
+				{
+					Close();
+					return PGRERROR_IMAGE_CONSISTENCY_ERROR;
+				}
+
+				m_numFrames = ( fileSize - Detail::sk_rawSequenceHeaderSize ) / m_header.recordSize;
+				return PGRERROR_OK;
+			}
+
+			/**
+			 * Close the file.
+			 */
+			void Close()
+			{
+#if defined(_WIN32)
+				if ( m_pFile != NULL )
+				{
+					fclose( m_pFile );
+					m_pFile = NULL;
+				}
+#else
+				if ( m_pMapping != NULL )
+				{
+					munmap( m_pMapping, m_mappingSize );
+					m_pMapping = NULL;
+					m_mappingSize = 0;
+				}
+#endif
+				m_numFrames = 0;
+				m_header = RawSequenceHeader();
+			}
+
+			/**
+			 * Check if a file is open.
+			 *
+			 * @return true if a file is open.
+			 */
+			bool IsOpen() const
+			{
+#if defined(_WIN32)
+				return m_pFile != NULL;
+#else
+				return m_pMapping != NULL;
+#endif
+			}
+
+			/**
+			 * Get the geometry of the frames in the file.
+			 *
+			 * @return The file header.
+			 */
+			const RawSequenceHeader& GetHeader() const { return m_header; }
+
+			/**
+			 * Get the number of complete frames in the file.
+			 *
+			 * @return The number of frames.
+			 */
+			unsigned long long GetNumFrames() const { return m_numFrames; }
+
+			/**
+			 * Read the time stamp and metadata of a frame without its data.
+			 *
+			 * @param index Index of the frame.
+			 * @param pTimeStamp Receives the time stamp of the frame.
+			 * @param pMetadata Receives the metadata of the frame.
+			 *
+			 * @return PGRERROR_OK, PGRERROR_INVALID_PARAMETER if the index
+			 *         is out of range, or PGRERROR_FAILED on a read error.
+			 */
+			ErrorType ReadFrameInfo(
+					unsigned long long index,
+					TimeStamp*         pTimeStamp,
+					ImageMetadata*     pMetadata )
+			{
+				return ReadFrame( index, NULL, pTimeStamp, pMetadata );
+			}
+
+			/**
+			 * Read a frame.
+			 *
+			 * @param index Index of the frame.
+			 * @param pData Buffer of rows * stride bytes to receive the frame
+			 *              data, or NULL to skip the data.
+			 * @param pTimeStamp Receives the time stamp of the frame, may be
+			 *                   NULL.
+			 * @param pMetadata Receives the metadata of the frame, may be
+			 *                  NULL.
+			 *
+			 * @return PGRERROR_OK, PGRERROR_INVALID_PARAMETER if the index
+			 *         is out of range, or PGRERROR_FAILED on a read error.
+			 */
+			ErrorType ReadFrame(
+					unsigned long long index,
+					unsigned char*     pData,
+					TimeStamp*         pTimeStamp,
+					ImageMetadata*     pMetadata )
+			{
+				if ( index >= m_numFrames )
+				{
+					return PGRERROR_INVALID_PARAMETER;
+				}
+
+				const unsigned long long offset = Detail::sk_rawSequenceHeaderSize + index * m_header.recordSize;
+				const size_t frameSize = static_cast<size_t>( m_header.rows ) * m_header.stride;
+				unsigned char record[Detail::sk_rawSequenceRecordHeaderSize];
+#if defined(_WIN32)
+				if ( _fseeki64( m_pFile, static_cast<long long>( offset ), SEEK_SET ) != 0 ||
+					 fread( record, sizeof(record), 1, m_pFile ) != 1 ||
+					 ( pData != NULL && fread( pData, frameSize, 1, m_pFile ) != 1 ) )
+				{
+					return PGRERROR_FAILED;
+				}
+#else
+				const unsigned char* pRecord = m_pMapping + offset;
+				memcpy( record, pRecord, sizeof(record) );
+				if ( pData != NULL )
+				{
+					memcpy( pData, pRecord + sizeof(record), frameSize );
+				}
+#endif
+
+				TimeStamp timeStamp;
+				ImageMetadata metadata;
+				Detail::DecodeRawSequenceRecord( record, &timeStamp, &metadata );
+				if ( pTimeStamp != NULL )
+				{
+					*pTimeStamp = timeStamp;
+				}
+				if ( pMetadata != NULL )
+				{
+					*pMetadata = metadata;
+				}
+				return PGRERROR_OK;
+			}
+
+			/**
+			 * Ask for frames to be read into memory ahead of use. The read
+			 * happens asynchronously. This is a no-op where the file is not
+			 * memory mapped.
+			 *
+			 * @param first Index of the first frame.
+			 * @param count Number of frames.
+			 */
+			void Prefetch( unsigned long long first, unsigned long long count )
+			{
+#if !defined(_WIN32)
+				if ( first >= m_numFrames || count == 0 )
+				{
+					return;
+				}
+				if ( count > m_numFrames - first )
+				{
+					count = m_numFrames - first;
+				}
+
+				// madvise() needs a page aligned start address.
+				const size_t pageSize = static_cast<size_t>( sysconf( _SC_PAGESIZE ) );
+				const size_t begin = static_cast<size_t>( Detail::sk_rawSequenceHeaderSize + first * m_header.recordSize );
+				const size_t alignedBegin = begin & ~( pageSize - 1 );
+				const size_t end = static_cast<size_t>( begin + count * m_header.recordSize );
+				madvise( m_pMapping + alignedBegin, end - alignedBegin, MADV_WILLNEED );
+#else
+				(void)first;
+				(void)count;
+#endif
+			}
+
+		private:
+
+			RawSequenceReader( const RawSequenceReader& );
+			RawSequenceReader& operator=( const RawSequenceReader& );
+
+			RawSequenceHeader  m_header;
+			unsigned long long m_numFrames;
+#if defined(_WIN32)
+			FILE*              m_pFile;
+#else
+			unsigned char*     m_pMapping;
+			size_t             m_mappingSize;
+#endif
+	};
+}
+
+#endif // FLIR_FC2_RAWSEQUENCE_H
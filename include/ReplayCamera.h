@@ -0,0 +1,444 @@
+//=============================================================================
+// Copyright (c) 2001-2018 FLIR Systems, Inc. All Rights Reserved.
+//
+// This software is the confidential and proprietary information of FLIR
+// Integrated Imaging Solutions, Inc. ("Confidential Information"). You
+// shall not disclose such Confidential Information and shall use it only in
+// accordance with the terms of the license agreement you entered into
+// with FLIR Integrated Imaging Solutions, Inc. (FLIR).
+//
+// FLIR MAKES NO REPRESENTATIONS OR WARRANTIES ABOUT THE SUITABILITY OF THE
+// SOFTWARE, EITHER EXPRESSED OR IMPLIED, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+// PURPOSE, OR NON-INFRINGEMENT. FLIR SHALL NOT BE LIABLE FOR ANY DAMAGES
+// SUFFERED BY LICENSEE AS A RESULT OF USING, MODIFYING OR DISTRIBUTING
+// THIS SOFTWARE OR ITS DERIVATIVES.
+//=============================================================================
+
+#ifndef FLIR_FC2_REPLAYCAMERA_H
+#define FLIR_FC2_REPLAYCAMERA_H
+
+#include "VirtualCamera.h"
+#include "RawSequence.h"
+
+#include <ctype.h>
+#include <stdlib.h>
+
+namespace FlyCapture2
+{
+	/** Pacing of frames replayed by ReplayCamera. */
+	enum ReplaySpeed
+	{
+		/** Frame intervals taken from the recorded time stamps. */
+		REPLAY_SPEED_ORIGINAL,
+		/** Frames delivered as fast as they are consumed. */
+		REPLAY_SPEED_MAXIMUM,
+		/** Frame intervals taken from the FRAME_RATE property. */
+		REPLAY_SPEED_FIXED_RATE
+	};
+
+	namespace Detail
+	{
+		inline bool ReadPnmField( FILE* pFile, unsigned int* pValue )
+		{
+			int c = fgetc( pFile );
+			while ( c != EOF && ( isspace( c ) || c == '#' ) )
+			{
+				if ( c == '#' )
+				{
+					while ( c != EOF && c != '\n' )
+					{
+						c = fgetc( pFile );
+					}
+				}
+				c = fgetc( pFile );
+			}
+
+			unsigned int value = 0;
+			bool found = false;
+			while ( c != EOF && isdigit( c ) )
+			{
+				value = value * 10 + static_cast<unsigned int>( c - '0' );
+				found = true;
+				c = fgetc( pFile );
+			}
+
+			// The single whitespace character after the last field is
+			// consumed here.
+			*pValue = value;
+			return found && c != EOF && isspace( c );
+		}
+
+		// Load a binary PGM or PPM file, as written by Image::Save(), into
+		// a MONO8, MONO16, RGB8 or RGB16 frame.
+		inline ErrorType LoadPnm(
+				const char*                 pFilename,
+				VirtualFrameFormat*         pFormat,
+				std::vector<unsigned char>* pData )
+		{
+			FILE* pFile = fopen( pFilename, "rb" );
+			if ( pFile == NULL )
+			{
+				return PGRERROR_NOT_FOUND;
+			}
+
+			char magic[2];
+			unsigned int cols;
+			unsigned int rows;
+			unsigned int maxValue;
+			if ( fread( magic, sizeof(magic), 1, pFile ) != 1 ||
+				 magic[0] != 'P' || ( magic[1] != '5' && magic[1] != '6' ) ||
+				 !ReadPnmField( pFile, &cols ) ||
+				 !ReadPnmField( pFile, &rows ) ||
+				 !ReadPnmField( pFile, &maxValue ) ||
+				 cols == 0 || rows == 0 || maxValue == 0 || maxValue > 65535 )
+			{
+				fclose( pFile );
+				return PGRERROR_IMAGE_CONSISTENCY_ERROR;
+			}
+
+			const bool isColor = magic[1] == '6';
+			const bool isWide = maxValue > 255;
+			const unsigned long long stride =
+				static_cast<unsigned long long>( cols ) * ( isColor ? 3 : 1 ) * ( isWide ? 2 : 1 );
+			if ( stride * rows > 0xFFFFFFFFull )
+			{
+				fclose( pFile );
+				return PGRERROR_IMAGE_CONSISTENCY_ERROR;
+			}
+
+			pData->resize( static_cast<size_t>( stride * rows ) );
+			const bool complete = fread( &(*pData)[0], pData->size(), 1, pFile ) == 1;
+			fclose( pFile );
+			if ( !complete )
+			{
+				return PGRERROR_IMAGE_CONSISTENCY_ERROR;
+			}
+
+			if ( isWide )
+			{
+				// PNM samples are big endian.
+				for ( size_t i = 0; i + 1 < pData->size(); i += 2 )
+				{
+					const unsigned short value = static_cast<unsigned short>(
+						( (*pData)[i] << 8 ) | (*pData)[i + 1] );
+					memcpy( &(*pData)[i], &value, sizeof(value) );
+				}
+			}
+
+			pFormat->rows = rows;
+			pFormat->cols = cols;
+			pFormat->stride = static_cast<unsigned int>( stride );
+			pFormat->pixelFormat = isColor ?
+				( isWide ? PIXEL_FORMAT_RGB16 : PIXEL_FORMAT_RGB8 ) :
+				( isWide ? PIXEL_FORMAT_MONO16 : PIXEL_FORMAT_MONO8 );
+			pFormat->bayerFormat = NONE;
+			return PGRERROR_OK;
+		}
+	}
+
+	/**
+	 * The ReplayCamera class is a virtual camera that plays back recorded
+	 * frames, for regression testing of acquisition pipelines at production
+	 * rates. Frames come from a raw sequence file written by
+	 * RawSequenceWriter, or from a set of PGM and PPM files such as those
+	 * written by Image::Save().
+	 *
+	 * Raw sequences are memory mapped and read ahead asynchronously, and
+	 * the recorded time stamp and metadata of each frame are reported in
+	 * its VirtualFrameInfo; the delivered Image itself carries neither, as
+	 * described for VirtualCamera. Images are
+	 * loaded into memory when opened and are paced by the FRAME_RATE
+	 * property. Buffering, grab modes, callbacks and triggering are
+	 * provided by VirtualCamera.
+	 *
+	 * @see VirtualCamera
+	 * @see RawSequenceWriter
+	 */
+	class ReplayCamera : public VirtualCamera
+	{
+		public:
+
+			/**
+			 * Constructor.
+			 *
+			 * @param serialNumber Serial number reported in CameraInfo.
+			 */
+			explicit ReplayCamera( unsigned int serialNumber = 1 )
+				: VirtualCamera( serialNumber, "Replay Camera" ),
+				  m_speed( REPLAY_SPEED_ORIGINAL ),
+				  m_speedFactor( 1.0 ),
+				  m_loop( false ),
+				  m_readAheadFrames( 16 ),
+				  m_activeLoop( false ),
+				  m_activeReadAheadFrames( 16 ),
+				  m_numFrames( 0 )
+			{
+			}
+
+			virtual ~ReplayCamera()
+			{
+				StopCapture();
+			}
+
+			/**
+			 * Open a raw sequence file for playback.
+			 *
+			 * @param pFilename Name of the file.
+			 *
+			 * @return PGRERROR_OK, PGRERROR_ISOCH_ALREADY_STARTED, or the
+			 *         error returned by RawSequenceReader::Open().
+			 */
+			ErrorType OpenSequence( const char* pFilename )
+			{
+				std::lock_guard<std::mutex> lock( m_mutex );
+				if ( IsCapturing() )
+				{
+					return PGRERROR_ISOCH_ALREADY_STARTED;
+				}
+
+				m_images.clear();
+				const ErrorType result = m_reader.Open( pFilename );
+				if ( result != PGRERROR_OK )
+				{
+					m_numFrames = 0;
+					return result;
+				}
+
+				const RawSequenceHeader& header = m_reader.GetHeader();
+				m_format.rows = header.rows;
+				m_format.cols = header.cols;
+				m_format.stride = header.stride;
+				m_format.pixelFormat = header.pixelFormat;
+				m_format.bayerFormat = header.bayerFormat;
+				m_numFrames = m_reader.GetNumFrames();
+				return PGRERROR_OK;
+			}
+
+			/**
+			 * Open a set of PGM or PPM files for playback, in the specified
+			 * order. All images must have the same dimensions and format.
+			 *
+			 * @param pFilenames Names of the files.
+			 * @param numFilenames Number of files.
+			 *
+			 * @return PGRERROR_OK, PGRERROR_ISOCH_ALREADY_STARTED,
+			 *         PGRERROR_NOT_FOUND if a file cannot be opened, or
+			 *         PGRERROR_IMAGE_CONSISTENCY_ERROR if a file cannot be
+			 *         read or does not match the first.
+			 */
+			ErrorType OpenImages( const char* const* pFilenames, unsigned int numFilenames )
+			{
+				std::lock_guard<std::mutex> lock( m_mutex );
+				if ( IsCapturing() )
+				{
+					return PGRERROR_ISOCH_ALREADY_STARTED;
+				}
+
+				m_reader.Close();
+				m_images.clear();
+				m_numFrames = 0;
+				m_images.resize( numFilenames );
+				for ( unsigned int i = 0; i < numFilenames; i++ )
+				{
+					VirtualFrameFormat format;
+					const ErrorType result = Detail::LoadPnm( pFilenames[i], &format, &m_images[i] );
+					if ( result == PGRERROR_OK && i != 0 &&
+						 ( format.rows != m_format.rows || format.cols != m_format.cols ||
+						   format.pixelFormat != m_format.pixelFormat ) )
+					{
+						m_images.clear();
+						return PGRERROR_IMAGE_CONSISTENCY_ERROR;
+					}
+					if ( result != PGRERROR_OK )
+					{
+						m_images.clear();
+						return result;
+					}
+
+					m_format = format;
+				}
+
+				m_numFrames = numFilenames;
+				return PGRERROR_OK;
+			}
+
+			/**
+			 * Get the number of frames available for playback.
+			 *
+			 * @return The number of frames.
+			 */
+			unsigned long long GetNumFrames()
+			{
+				std::lock_guard<std::mutex> lock( m_mutex );
+				return m_numFrames;
+			}
+
+			/**
+			 * Set the playback pacing. Takes effect on the next frame. At
+			 * REPLAY_SPEED_MAXIMUM in BUFFER_FRAMES mode, playback waits for
+			 * the consumer so that no frame is dropped.
+			 *
+			 * @param speed The pacing mode.
+			 * @param factor Speed multiplier for REPLAY_SPEED_ORIGINAL; 2.0
+			 *               plays back twice as fast as recorded.
+			 *
+			 * @return PGRERROR_OK, or PGRERROR_INVALID_PARAMETER if the
+			 *         factor is not positive.
+			 */
+			ErrorType SetSpeed( ReplaySpeed speed, double factor = 1.0 )
+			{
+				if ( !( factor > 0.0 ) )
+				{
+					return PGRERROR_INVALID_PARAMETER;
+				}
+
+				std::lock_guard<std::mutex> lock( m_mutex );
+				m_speed = speed;
+				m_speedFactor = factor;
+				return PGRERROR_OK;
+			}
+
+			/**
+			 * Set whether playback restarts from the first frame at the end.
+			 * Without looping, RetrieveBuffer() times out once every frame
+			 * has been delivered. Takes effect at the next StartCapture().
+			 *
+			 * @param loop Whether to loop.
+			 */
+			void SetLoop( bool loop )
+			{
+				std::lock_guard<std::mutex> lock( m_mutex );
+				m_loop = loop;
+			}
+
+			/**
+			 * Set how many frames of a raw sequence are read ahead of the
+			 * frame being delivered. Takes effect at the next StartCapture().
+			 *
+			 * @param numFrames Number of frames, at least 1.
+			 */
+			void SetReadAhead( unsigned int numFrames )
+			{
+				std::lock_guard<std::mutex> lock( m_mutex );
+				m_readAheadFrames = numFrames > 0 ? numFrames : 1;
+			}
+
+		protected:
+
+			virtual ErrorType GetFrameFormat( VirtualFrameFormat* pFormat )
+			{
+				if ( m_numFrames == 0 )
+				{
+					return PGRERROR_NOT_INTITIALIZED;
+				}
+
+				*pFormat = m_format;
+				return PGRERROR_OK;
+			}
+
+			virtual ErrorType OnStartCapture( const VirtualFrameFormat& /*format*/ )
+			{
+				m_activeLoop = m_loop;
+				m_activeReadAheadFrames = m_readAheadFrames;
+				if ( m_reader.IsOpen() )
+				{
+					m_reader.Prefetch( 0, 2ull * m_activeReadAheadFrames );
+				}
+				return PGRERROR_OK;
+			}
+
+			virtual Clock::duration GetFrameInterval( unsigned long long frameIndex )
+			{
+				switch ( m_speed )
+				{
+					case REPLAY_SPEED_MAXIMUM:
+						return Clock::duration::zero();
+					case REPLAY_SPEED_FIXED_RATE:
+						return VirtualCamera::GetFrameInterval( frameIndex );
+					default:
+						break;
+				}
+
+				if ( !m_reader.IsOpen() )
+				{
+					return VirtualCamera::GetFrameInterval( frameIndex );
+				}
+
+				const unsigned long long position = frameIndex % m_numFrames;
+				TimeStamp previous;
+				TimeStamp current;
+				if ( position == 0 ||
+					 m_reader.ReadFrameInfo( position - 1, &previous, NULL ) != PGRERROR_OK ||
+					 m_reader.ReadFrameInfo( position, &current, NULL ) != PGRERROR_OK )
+				{
+					return Clock::duration::zero();
+				}
+
+				const long long elapsed =
+					( current.seconds - previous.seconds ) * 1000000 +
+					( static_cast<long long>( current.microSeconds ) - previous.microSeconds );
+				if ( elapsed <= 0 )
+				{
+					return Clock::duration::zero();
+				}
+
+				return std::chrono::duration_cast<Clock::duration>(
+					std::chrono::duration<double, std::micro>( elapsed / m_speedFactor ) );
+			}
+
+			virtual bool IsLossless() const
+			{
+				return m_speed == REPLAY_SPEED_MAXIMUM;
+			}
+
+			virtual bool ProduceFrame(
+					unsigned long long frameIndex,
+					unsigned char*     pData,
+					VirtualFrameInfo*  pInfo )
+			{
+				if ( !m_activeLoop && frameIndex >= m_numFrames )
+				{
+					return false;
+				}
+
+				const unsigned long long position = frameIndex % m_numFrames;
+				if ( !m_images.empty() )
+				{
+					memcpy( pData, &m_images[ static_cast<size_t>( position ) ][0], m_images[0].size() );
+					return true;
+				}
+
+				// Keep between one and two read ahead windows in flight.
+				const unsigned long long window = m_activeReadAheadFrames;
+				if ( position % window == 0 )
+				{
+					m_reader.Prefetch( position + window, window );
+					if ( m_activeLoop && position + 2 * window >= m_numFrames )
+					{
+						m_reader.Prefetch( 0, window );
+					}
+				}
+
+				return m_reader.ReadFrame( position, pData, &pInfo->timeStamp, &pInfo->metadata ) == PGRERROR_OK;
+			}
+
+		private:
+
+			RawSequenceReader                       m_reader;
+			std::vector< std::vector<unsigned char> > m_images;
+			VirtualFrameFormat                      m_format;
+
+			ReplaySpeed                             m_speed;
+			double                                  m_speedFactor;
+			bool                                    m_loop;
+			unsigned int                            m_readAheadFrames;
+
+			// Capture state, owned by the producer thread while capturing.
+			bool                                    m_activeLoop;
+			unsigned int                            m_activeReadAheadFrames;
+			unsigned long long                      m_numFrames;
+	};
+}
+
+#endif // FLIR_FC2_REPLAYCAMERA_H
@@ -0,0 +1,484 @@
+//=============================================================================
+// Copyright (c) 2001-2018 FLIR Systems, Inc. All Rights Reserved.
+//
+// This software is the confidential and proprietary information of FLIR
+// Integrated Imaging Solutions, Inc. ("Confidential Information"). You
+// shall not disclose such Confidential Information and shall use it only in
+// accordance with the terms of the license agreement you entered into
+// with FLIR Integrated Imaging Solutions, Inc. (FLIR).
+//
+// FLIR MAKES NO REPRESENTATIONS OR WARRANTIES ABOUT THE SUITABILITY OF THE
+// SOFTWARE, EITHER EXPRESSED OR IMPLIED, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+// PURPOSE, OR NON-INFRINGEMENT. FLIR SHALL NOT BE LIABLE FOR ANY DAMAGES
+// SUFFERED BY LICENSEE AS A RESULT OF USING, MODIFYING OR DISTRIBUTING
+// THIS SOFTWARE OR ITS DERIVATIVES.
+//=============================================================================
+
+#ifndef FLIR_FC2_SIMULATEDCAMERA_H
+#define FLIR_FC2_SIMULATEDCAMERA_H
+
+#include "VirtualCamera.h"
+#include "ImageView.h"
+
+#include <algorithm>
+
+namespace FlyCapture2
+{
+	/** Test patterns rendered by SimulatedCamera. */
+	enum SimulatedPattern
+	{
+		/** Horizontal grey ramp. */
+		SIMULATED_PATTERN_RAMP,
+		/** Eight vertical colour bars. */
+		SIMULATED_PATTERN_COLOR_BARS,
+		/** Black and white squares of 32 pixels. */
+		SIMULATED_PATTERN_CHECKERBOARD,
+		/** Uniform random data, regenerated for every frame. */
+		SIMULATED_PATTERN_NOISE
+	};
+
+	/** Settings of a SimulatedCamera. */
+	struct SimulatedCameraSettings
+	{
+		/** Rows in each frame. */
+		unsigned int rows;
+		/** Columns in each frame. */
+		unsigned int cols;
+		/** Pixel format of each frame. */
+		PixelFormat pixelFormat;
+		/** Bayer tile format of RAW frames, or NONE for a mono sensor. */
+		BayerTileFormat bayerFormat;
+		/** Test pattern. */
+		SimulatedPattern pattern;
+		/** Whether the pattern scrolls by two columns every frame. */
+		bool animate;
+		/**
+		 * Initial FRAME_RATE value, in frames per second. Values are
+		 * clamped to the range of the property, 0.1 to 100000. 0 or less
+		 * turns FRAME_RATE off, so frames are produced as fast as
+		 * possible.
+		 */
+		float frameRate;
+		/** Serial number reported in CameraInfo. */
+		unsigned int serialNumber;
+
+		SimulatedCameraSettings()
+		{
+			rows = 1024;
+			cols = 1280;
+			pixelFormat = PIXEL_FORMAT_MONO8;
+			bayerFormat = NONE;
+			pattern = SIMULATED_PATTERN_RAMP;
+			animate = true;
+			frameRate = 30.0f;
+			serialNumber = 1;
+		}
+	};
+
+	/**
+	 * The SimulatedCamera class is a virtual camera that renders a test
+	 * pattern at the configured frame rate. It allows acquisition pipelines,
+	 * benchmarks and tools to be exercised deterministically without
+	 * hardware. Frame pacing, buffering, triggering and drop injection are
+	 * provided by VirtualCamera.
+	 *
+	 * The pattern is rendered once when capture starts and each frame is a
+	 * scrolled copy of it, so the cost of producing a frame is close to a
+	 * memcpy. The timestamp and frame counter can be embedded in the first
+	 * pixels of each frame, in the same layout as a camera.
+	 *
+	 * @see VirtualCamera
+	 */
+	class SimulatedCamera : public VirtualCamera
+	{
+		public:
+
+			/**
+			 * Constructor.
+			 *
+			 * @param settings The settings of the camera.
+			 */
+			explicit SimulatedCamera( const SimulatedCameraSettings& settings = SimulatedCameraSettings() )
+				: VirtualCamera( settings.serialNumber, "Simulated Camera" ),
+				  m_settings( settings ),
+				  m_bytesPerPixel( 0 ),
+				  m_scroll( 0 ),
+				  m_noiseState( settings.serialNumber | 1 )
+			{
+				PropertyInfo frameRateInfo( FRAME_RATE );
+				GetPropertyInfo( &frameRateInfo );
+
+				Property frameRate( FRAME_RATE );
+				GetProperty( &frameRate );
+				frameRate.absControl = true;
+				frameRate.onOff = settings.frameRate > 0.0f;
+				if ( frameRate.onOff )
+				{
+					frameRate.absValue = std::min( std::max( settings.frameRate, frameRateInfo.absMin ), frameRateInfo.absMax );
+				}
+				SetProperty( &frameRate );
+			}
+
+			virtual ~SimulatedCamera()
+			{
+				StopCapture();
+			}
+
+			/**
+			 * Get the settings of the camera.
+			 *
+			 * @param pSettings Structure to receive the settings.
+			 */
+			void GetSettings( SimulatedCameraSettings* pSettings )
+			{
+				std::lock_guard<std::mutex> lock( m_mutex );
+				*pSettings = m_settings;
+			}
+
+			/**
+			 * Change the settings of the camera. The frame rate is not
+			 * changed; use the FRAME_RATE property instead.
+			 *
+			 * @param settings The new settings.
+			 *
+			 * @return PGRERROR_OK, or PGRERROR_ISOCH_ALREADY_STARTED if
+			 *         capture is running.
+			 */
+			ErrorType SetSettings( const SimulatedCameraSettings& settings )
+			{
+				std::lock_guard<std::mutex> lock( m_mutex );
+				if ( IsCapturing() )
+				{
+					return PGRERROR_ISOCH_ALREADY_STARTED;
+				}
+
+				m_settings = settings;
+				return PGRERROR_OK;
+			}
+
+		protected:
+
+			virtual ErrorType GetFrameFormat( VirtualFrameFormat* pFormat )
+			{
+				const unsigned int bitsPerPixel = GetBitsPerPixel( m_settings.pixelFormat );
+				if ( bitsPerPixel == 0 || m_settings.rows == 0 || m_settings.cols == 0 )
+				{
+					return PGRERROR_INVALID_SETTINGS;
+				}
+
+				const unsigned long long stride =
+					( static_cast<unsigned long long>( m_settings.cols ) * bitsPerPixel + 7 ) / 8;
+				if ( stride * m_settings.rows > 0xFFFFFFFFull )
+				{
+					return PGRERROR_INVALID_SETTINGS;
+				}
+
+				pFormat->rows = m_settings.rows;
+				pFormat->cols = m_settings.cols;
+				pFormat->stride = static_cast<unsigned int>( stride );
+				pFormat->pixelFormat = m_settings.pixelFormat;
+				pFormat->bayerFormat = IsRawFormat( m_settings.pixelFormat ) ? m_settings.bayerFormat : NONE;
+				return PGRERROR_OK;
+			}
+
+			virtual ErrorType OnStartCapture( const VirtualFrameFormat& format )
+			{
+				m_format = format;
+				m_pattern = m_settings.pattern;
+				m_animate = m_settings.animate;
+				m_scroll = 0;
+
+				// Render the pattern twice side by side so that a scrolled
+				// row is a single contiguous copy.
+				// Packed formats such as MONO12, RAW12 and 411YUV8 have no
+				// whole number of bytes per pixel and are not scrolled.
+				const size_t rowBytes = format.stride;
+				const unsigned int bitsPerPixel = GetBitsPerPixel( format.pixelFormat );
+				m_bytesPerPixel = bitsPerPixel % 8 == 0 ? bitsPerPixel / 8 : 0;
+				m_rendered.assign( static_cast<size_t>( format.rows ) * rowBytes * 2, 0 );
+				if ( m_pattern != SIMULATED_PATTERN_NOISE )
+				{
+					for ( unsigned int row = 0; row < format.rows; row++ )
+					{
+						unsigned char* pRow = &m_rendered[ row * rowBytes * 2 ];
+						RenderRow( row, pRow );
+						memcpy( pRow + rowBytes, pRow, rowBytes );
+					}
+				}
+				return PGRERROR_OK;
+			}
+
+			virtual bool ProduceFrame(
+					unsigned long long frameIndex,
+					unsigned char*     pData,
+					VirtualFrameInfo*  pInfo )
+			{
+				const size_t rowBytes = m_format.stride;
+				if ( m_pattern == SIMULATED_PATTERN_NOISE )
+				{
+					FillNoise( pData, rowBytes * m_format.rows );
+				}
+				else
+				{
+					// Scroll by whole pixels, and by an even number of
+					// columns so that the Bayer tiling is preserved. Packed
+					// formats are not scrolled.
+					size_t offset = 0;
+					if ( m_animate && m_bytesPerPixel != 0 )
+					{
+						offset = m_scroll * m_bytesPerPixel;
+						m_scroll = ( m_scroll + m_format.cols - 2 ) % m_format.cols;
+						m_scroll &= ~1u;
+					}
+
+					for ( unsigned int row = 0; row < m_format.rows; row++ )
+					{
+						memcpy( pData + row * rowBytes, &m_rendered[ row * rowBytes * 2 ] + offset, rowBytes );
+					}
+				}
+
+				EmbedImageInfo( frameIndex, pData, pInfo );
+				return true;
+			}
+
+		private:
+
+			static bool IsRawFormat( PixelFormat format )
+			{
+				return format == PIXEL_FORMAT_RAW8 ||
+					format == PIXEL_FORMAT_RAW12 ||
+					format == PIXEL_FORMAT_RAW16;
+			}
+
+			static unsigned int GetBitsPerPixel( PixelFormat format )
+			{
+				unsigned int bitsPerChannel;
+				unsigned int numChannels;
+				bool isSigned;
+				if ( GetChannelLayout( format, &bitsPerChannel, &numChannels, &isSigned ) )
+				{
+					return bitsPerChannel * numChannels;
+				}
+
+				switch ( format )
+				{
+					case PIXEL_FORMAT_MONO12:
+					case PIXEL_FORMAT_RAW12:
+					case PIXEL_FORMAT_411YUV8:
+						return 12;
+					case PIXEL_FORMAT_422YUV8:
+					case PIXEL_FORMAT_422YUV8_JPEG:
+						return 16;
+					default:
+						return 0;
+				}
+			}
+
+			// Pattern colour at a pixel, as 8 bit RGB.
+			void GetPatternColor( unsigned int row, unsigned int col, unsigned char rgb[3] ) const
+			{
+				static const unsigned char sk_bars[8][3] =
+				{
+					{ 255, 255, 255 }, { 255, 255, 0 }, { 0, 255, 255 }, { 0, 255, 0 },
+					{ 255, 0, 255 }, { 255, 0, 0 }, { 0, 0, 255 }, { 0, 0, 0 }
+				};
+
+				switch ( m_pattern )
+				{
+					case SIMULATED_PATTERN_COLOR_BARS:
+						{
+							const unsigned int bar = static_cast<unsigned int>(
+								static_cast<unsigned long long>( col ) * 8 / m_format.cols );
+							memcpy( rgb, sk_bars[bar], 3 );
+						}
+						break;
+					case SIMULATED_PATTERN_CHECKERBOARD:
+						rgb[0] = rgb[1] = rgb[2] = ( ( ( row / 32 ) ^ ( col / 32 ) ) & 1 ) ? 255 : 0;
+						break;
+					default:
+						rgb[0] = rgb[1] = rgb[2] = static_cast<unsigned char>(
+							static_cast<unsigned long long>( col ) * 256 / m_format.cols );
+						break;
+				}
+			}
+
+			// Colour channel (0 = R, 1 = G, 2 = B) sampled at a Bayer site.
+			unsigned int GetBayerChannel( unsigned int row, unsigned int col ) const
+			{
+				// Channels of the 2x2 tile in row major order.
+				static const unsigned char sk_tiles[4][4] =
+				{
+					{ 0, 1, 1, 2 }, // RGGB
+					{ 1, 0, 2, 1 }, // GRBG
+					{ 1, 2, 0, 1 }, // GBRG
+					{ 2, 1, 1, 0 }  // BGGR
+				};
+
+				int tile;
+				switch ( m_format.bayerFormat )
+				{
+					case RGGB: tile = 0; break;
+					case GRBG: tile = 1; break;
+					case GBRG: tile = 2; break;
+					case BGGR: tile = 3; break;
+					default: return 3;
+				}
+				return sk_tiles[tile][ ( row & 1 ) * 2 + ( col & 1 ) ];
+			}
+
+			void RenderRow( unsigned int row, unsigned char* pRow ) const
+			{
+				unsigned int bitsPerChannel;
+				unsigned int numChannels;
+				bool isSigned;
+				if ( !GetChannelLayout( m_format.pixelFormat, &bitsPerChannel, &numChannels, &isSigned ) )
+				{
+					// Packed and subsampled formats: render the luminance of
+					// each byte position.
+					for ( unsigned int i = 0; i < m_format.stride; i++ )
+					{
+						unsigned char rgb[3];
+						GetPatternColor( row, static_cast<unsigned int>(
+							static_cast<unsigned long long>( i ) * m_format.cols / m_format.stride ), rgb );
+						pRow[i] = rgb[1];
+					}
+					return;
+				}
+
+				for ( unsigned int col = 0; col < m_format.cols; col++ )
+				{
+					unsigned char rgb[3];
+					GetPatternColor( row, col, rgb );
+
+					unsigned char channels[4];
+					switch ( m_format.pixelFormat )
+					{
+						case PIXEL_FORMAT_RGB8:
+						case PIXEL_FORMAT_RGB16:
+						case PIXEL_FORMAT_S_RGB16:
+						case PIXEL_FORMAT_RGBU:
+							channels[0] = rgb[0];
+							channels[1] = rgb[1];
+							channels[2] = rgb[2];
+							channels[3] = 255;
+							break;
+						case PIXEL_FORMAT_BGR:
+						case PIXEL_FORMAT_BGR16:
+						case PIXEL_FORMAT_BGRU:
+						case PIXEL_FORMAT_BGRU16:
+							channels[0] = rgb[2];
+							channels[1] = rgb[1];
+							channels[2] = rgb[0];
+							channels[3] = 255;
+							break;
+						case PIXEL_FORMAT_444YUV8:
+							{
+								const int y = ( 77 * rgb[0] + 150 * rgb[1] + 29 * rgb[2] ) >> 8;
+								const int u = ( ( ( rgb[2] - y ) * 144 ) >> 8 ) + 128;
+								const int v = ( ( ( rgb[0] - y ) * 183 ) >> 8 ) + 128;
+								channels[0] = static_cast<unsigned char>( u < 0 ? 0 : ( u > 255 ? 255 : u ) );
+								channels[1] = static_cast<unsigned char>( y );
+								channels[2] = static_cast<unsigned char>( v < 0 ? 0 : ( v > 255 ? 255 : v ) );
+							}
+							break;
+						default:
+							{
+								const unsigned int channel = GetBayerChannel( row, col );
+								channels[0] = channel < 3 ? rgb[channel] :
+									static_cast<unsigned char>( ( 77 * rgb[0] + 150 * rgb[1] + 29 * rgb[2] ) >> 8 );
+							}
+							break;
+					}
+
+					for ( unsigned int c = 0; c < numChannels; c++ )
+					{
+						if ( bitsPerChannel == 16 )
+						{
+							// Scale to the full range, or to the positive
+							// range for signed formats.
+							const unsigned short value = static_cast<unsigned short>(
+								isSigned ? channels[c] * 128 : channels[c] * 257 );
+							memcpy( pRow, &value, sizeof(value) );
+							pRow += sizeof(value);
+						}
+						else
+						{
+							*pRow++ = channels[c];
+						}
+					}
+				}
+			}
+
+			void FillNoise( unsigned char* pData, size_t size )
+			{
+				unsigned int state = m_noiseState;
+				size_t i = 0;
+				for ( ; i + sizeof(state) <= size; i += sizeof(state) )
+				{
+					state ^= state << 13;
+					state ^= state >> 17;
+					state ^= state << 5;
+					memcpy( pData + i, &state, sizeof(state) );
+				}
+				for ( ; i < size; i++ )
+				{
+					state ^= state << 13;
+					state ^= state >> 17;
+					state ^= state << 5;
+					pData[i] = static_cast<unsigned char>( state );
+				}
+				m_noiseState = state;
+			}
+
+			// Write the enabled embedded image information big endian into
+			// the first pixels of the frame, in camera order, and mirror it
+			// in the frame metadata.
+			void EmbedImageInfo( unsigned long long frameIndex, unsigned char* pData, VirtualFrameInfo* pInfo )
+			{
+				const EmbeddedImageInfo& embedded = GetFrameEmbeddedInfo();
+				const size_t frameSize = static_cast<size_t>( m_format.rows ) * m_format.stride;
+				size_t offset = 0;
+
+				const long long micro = std::chrono::duration_cast<std::chrono::microseconds>(
+					std::chrono::system_clock::now().time_since_epoch() ).count();
+				const unsigned int cycleSeconds = static_cast<unsigned int>( ( micro / 1000000 ) % 128 );
+				const unsigned int cycleCount = static_cast<unsigned int>( ( micro % 1000000 ) / 125 );
+				const unsigned int cycleOffset = static_cast<unsigned int>( ( micro % 125 ) * 3072 / 125 );
+				pInfo->metadata.embeddedTimeStamp = ( cycleSeconds << 25 ) | ( cycleCount << 12 ) | cycleOffset;
+				pInfo->metadata.embeddedFrameCounter = static_cast<unsigned int>( frameIndex );
+
+				if ( embedded.timestamp.onOff && offset + 4 <= frameSize )
+				{
+					WriteBigEndian( pData + offset, pInfo->metadata.embeddedTimeStamp );
+					offset += 4;
+				}
+				if ( embedded.frameCounter.onOff && offset + 4 <= frameSize )
+				{
+					WriteBigEndian( pData + offset, pInfo->metadata.embeddedFrameCounter );
+					offset += 4;
+				}
+			}
+
+			static void WriteBigEndian( unsigned char* pData, unsigned int value )
+			{
+				pData[0] = static_cast<unsigned char>( value >> 24 );
+				pData[1] = static_cast<unsigned char>( value >> 16 );
+				pData[2] = static_cast<unsigned char>( value >> 8 );
+				pData[3] = static_cast<unsigned char>( value );
+			}
+
+			SimulatedCameraSettings    m_settings;
+
+			// Capture state, owned by the producer thread while capturing.
+			VirtualFrameFormat         m_format;
+			SimulatedPattern           m_pattern;
+			bool                       m_animate;
+			std::vector<unsigned char> m_rendered;
+			unsigned int               m_bytesPerPixel;
+			unsigned int               m_scroll;
+			unsigned int               m_noiseState;
+	};
+}
+
+#endif // FLIR_FC2_SIMULATEDCAMERA_H
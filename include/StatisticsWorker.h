@@ -0,0 +1,641 @@
+//=============================================================================
+// Copyright (c) 2001-2018 FLIR Systems, Inc. All Rights Reserved.
+//
+// This software is the confidential and proprietary information of FLIR
+// Integrated Imaging Solutions, Inc. ("Confidential Information"). You
+// shall not disclose such Confidential Information and shall use it only in
+// accordance with the terms of the license agreement you entered into
+// with FLIR Integrated Imaging Solutions, Inc. (FLIR).
+//
+// FLIR MAKES NO REPRESENTATIONS OR WARRANTIES ABOUT THE SUITABILITY OF THE
+// SOFTWARE, EITHER EXPRESSED OR IMPLIED, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+// PURPOSE, OR NON-INFRINGEMENT. FLIR SHALL NOT BE LIABLE FOR ANY DAMAGES
+// SUFFERED BY LICENSEE AS A RESULT OF USING, MODIFYING OR DISTRIBUTING
+// THIS SOFTWARE OR ITS DERIVATIVES.
+//=============================================================================
+
+
+#ifndef FLIR_FC2_STATISTICSWORKER_H
+#define FLIR_FC2_STATISTICSWORKER_H
+
+#include "FlyCapture2Platform.h"
+#include "FlyCapture2Defs.h"
+#include "Error.h"
+#include "Image.h"
+#include "ImageStatistics.h"
+#include "ViewerPipeline.h"
+#include "MemoryBudget.h"
+
+#if !defined(_MSC_VER) && __cplusplus < 201103L
+#error "StatisticsWorker.h requires C++11"
+#endif
+
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace FlyCapture2
+{
+	/** Statistics of one channel of a frame, on an 8 bit scale. */
+	struct ChannelStatistics
+	{
+		/** Whether the channel was computed. */
+		bool enabled;
+		/** Smallest sampled value. */
+		unsigned int minimum;
+		/** Largest sampled value. */
+		unsigned int maximum;
+		/** Mean sampled value. */
+		float mean;
+		/** Number of samples with each value. */
+		unsigned int histogram[256];
+
+		ChannelStatistics()
+		{
+			enabled = false;
+			minimum = 0;
+			maximum = 0;
+			mean = 0.0f;
+			memset( histogram, 0, sizeof(histogram) );
+		}
+	};
+
+	/**
+	 * Statistics of a sampled frame. 16 bit data is reduced to its high
+	 * byte.
+	 */
+	struct FrameStatistics
+	{
+		/** Tag of the frame, as passed to StatisticsWorker::Submit(). */
+		FrameTag tag;
+		/** Size of the frame. */
+		unsigned int rows;
+		unsigned int cols;
+		/** Distance between sampled rows and columns. */
+		unsigned int subsample;
+		/** Number of pixels sampled. */
+		unsigned long long numSamples;
+		/**
+		 * Per channel statistics, indexed by ImageStatistics::GREY, RED,
+		 * GREEN and BLUE. Colour channels are only enabled for colour
+		 * frames.
+		 */
+		ChannelStatistics channels[4];
+		/** Mean grey value of each sampled row, if enabled. */
+		std::vector<float> rowMeans;
+		/** Mean grey value of each sampled column, if enabled. */
+		std::vector<float> columnMeans;
+		/** Time spent computing the statistics. */
+		std::chrono::nanoseconds computeTime;
+
+		FrameStatistics()
+		{
+			rows = 0;
+			cols = 0;
+			subsample = 1;
+			numSamples = 0;
+			computeTime = std::chrono::nanoseconds::zero();
+		}
+	};
+
+	/** Counters of a StatisticsWorker. */
+	struct StatisticsWorkerStats
+	{
+		/** Calls to Submit(). */
+		unsigned long long numSubmitted;
+		/** Submitted frames skipped because they came sooner than the rate allows. */
+		unsigned long long numSkipped;
+		/** Accepted frames replaced before the worker got to them. */
+		unsigned long long numOverwritten;
+		/** Frames whose statistics were published. */
+		unsigned long long numComputed;
+		/** Frames in a format that could not be read or converted. */
+		unsigned long long numErrors;
+
+		StatisticsWorkerStats()
+		{
+			numSubmitted = 0;
+			numSkipped = 0;
+			numOverwritten = 0;
+			numComputed = 0;
+			numErrors = 0;
+		}
+	};
+
+	namespace Detail
+	{
+		// Histogram, row and column kernel over every step-th pixel of one
+		// row of an interleaved image. Grey is (R + 2G + B) / 4 for colour
+		// data. Mono rows alternate between two histograms so consecutive
+		// increments of the same bin do not stall on each other.
+		template <typename SampleT, unsigned int Channels>
+		inline unsigned int AccumulateStatisticsRow(
+				const SampleT* pRow,
+				unsigned int   cols,
+				unsigned int   step,
+				unsigned int   rIndex,
+				unsigned int   bIndex,
+				unsigned int   shift,
+				unsigned int   (*pHistograms)[256],
+				unsigned int*  pColumnSums )
+		{
+			unsigned int rowSum = 0;
+			if ( Channels == 1 )
+			{
+				unsigned int* pEven = pHistograms[0];
+				unsigned int* pOdd = pHistograms[4];
+				unsigned int i = 0;
+				unsigned int x = 0;
+				for ( ; x + step < cols; x += 2 * step, i += 2 )
+				{
+					const unsigned int v0 = pRow[x] >> shift;
+					const unsigned int v1 = pRow[x + step] >> shift;
+					pEven[v0]++;
+					pOdd[v1]++;
+					pColumnSums[i] += v0;
+					pColumnSums[i + 1] += v1;
+					rowSum += v0 + v1;
+				}
+				if ( x < cols )
+				{
+					const unsigned int v = pRow[x] >> shift;
+					pEven[v]++;
+					pColumnSums[i] += v;
+					rowSum += v;
+				}
+				return rowSum;
+			}
+
+			for ( unsigned int x = 0, i = 0; x < cols; x += step, i++ )
+			{
+				const SampleT* pPixel = pRow + x * Channels;
+				const unsigned int r = pPixel[rIndex] >> shift;
+				const unsigned int g = pPixel[1] >> shift;
+				const unsigned int b = pPixel[bIndex] >> shift;
+				const unsigned int grey = ( r + 2 * g + b ) >> 2;
+				pHistograms[ImageStatistics::GREY][grey]++;
+				pHistograms[ImageStatistics::RED][r]++;
+				pHistograms[ImageStatistics::GREEN][g]++;
+				pHistograms[ImageStatistics::BLUE][b]++;
+				pColumnSums[i] += grey;
+				rowSum += grey;
+			}
+			return rowSum;
+		}
+
+		template <typename SampleT, unsigned int Channels>
+		void AccumulateStatistics(
+				const Image&   image,
+				unsigned int   step,
+				unsigned int   rIndex,
+				unsigned int   bIndex,
+				unsigned int   (*pHistograms)[256],
+				unsigned int*  pColumnSums,
+				float*         pRowMeans,
+				unsigned int   numSampledCols )
+		{
+			const unsigned int shift = sizeof(SampleT) == 1 ? 0 : 8;
+			const unsigned char* pData = image.GetData();
+			for ( unsigned int y = 0, j = 0; y < image.GetRows(); y += step, j++ )
+			{
+				const SampleT* pRow = reinterpret_cast<const SampleT*>( pData + static_cast<size_t>( y ) * image.GetStride() );
+				const unsigned int rowSum = AccumulateStatisticsRow<SampleT, Channels>(
+					pRow, image.GetCols(), step, rIndex, bIndex, shift, pHistograms, pColumnSums );
+				if ( pRowMeans != NULL )
+				{
+					pRowMeans[j] = static_cast<float>( rowSum ) / numSampledCols;
+				}
+			}
+		}
+
+		inline void FinishChannelStatistics( ChannelStatistics* pChannel, unsigned long long numSamples )
+		{
+			// Range and mean come from the histogram, which keeps compares
+			// out of the per-pixel loop.
+			unsigned long long sum = 0;
+			bool found = false;
+			for ( unsigned int v = 0; v < 256; v++ )
+			{
+				if ( pChannel->histogram[v] == 0 )
+				{
+					continue;
+				}
+				if ( !found )
+				{
+					pChannel->minimum = v;
+					found = true;
+				}
+				pChannel->maximum = v;
+				sum += static_cast<unsigned long long>( v ) * pChannel->histogram[v];
+			}
+			pChannel->enabled = true;
+			pChannel->mean = numSamples > 0 ? static_cast<float>( static_cast<double>( sum ) / numSamples ) : 0.0f;
+		}
+
+		/**
+		 * Compute the statistics of every step-th row and column of an
+		 * image in MONO8, MONO16, RAW8, RAW16, RGB8, BGR, RGBU or BGRU.
+		 * Raw data is treated as mono.
+		 */
+		inline ErrorType ComputeFrameStatistics(
+				const Image&     image,
+				unsigned int     step,
+				bool             rowColumnStatistics,
+				FrameStatistics* pStats )
+		{
+			if ( image.GetData() == NULL || image.GetRows() == 0 || image.GetCols() == 0 || step == 0 )
+			{
+				return PGRERROR_INVALID_PARAMETER;
+			}
+
+			unsigned int rIndex = 0;
+			unsigned int bIndex = 2;
+			unsigned int channels = 1;
+			bool isWide = false;
+			switch ( image.GetPixelFormat() )
+			{
+				case PIXEL_FORMAT_MONO8:
+				case PIXEL_FORMAT_RAW8:
+					break;
+				case PIXEL_FORMAT_MONO16:
+				case PIXEL_FORMAT_RAW16:
+					isWide = true;
+					break;
+				case PIXEL_FORMAT_RGB8:
+					channels = 3;
+					break;
+				case PIXEL_FORMAT_RGBU:
+					channels = 4;
+					break;
+				case PIXEL_FORMAT_BGR:
+					channels = 3;
+					rIndex = 2;
+					bIndex = 0;
+					break;
+				case PIXEL_FORMAT_BGRU:
+					channels = 4;
+					rIndex = 2;
+					bIndex = 0;
+					break;
+				default:
+					return PGRERROR_IMAGE_CONVERSION_FAILED;
+			}
+
+			const unsigned int numSampledRows = ( image.GetRows() + step - 1 ) / step;
+			const unsigned int numSampledCols = ( image.GetCols() + step - 1 ) / step;
+			pStats->rows = image.GetRows();
+			pStats->cols = image.GetCols();
+			pStats->subsample = step;
+			pStats->numSamples = static_cast<unsigned long long>( numSampledRows ) * numSampledCols;
+
+			// Slots 0-3 are the channels; slot 4 is the second mono histogram.
+			std::vector<unsigned int> histograms( 5 * 256 );
+			unsigned int (*pHistograms)[256] = reinterpret_cast<unsigned int (*)[256]>( &histograms[0] );
+			std::vector<unsigned int> columnSums( numSampledCols );
+			pStats->rowMeans.assign( rowColumnStatistics ? numSampledRows : 0, 0.0f );
+			float* pRowMeans = rowColumnStatistics ? &pStats->rowMeans[0] : NULL;
+
+			if ( channels == 1 && !isWide )
+			{
+				AccumulateStatistics<unsigned char, 1>( image, step, 0, 0, pHistograms, &columnSums[0], pRowMeans, numSampledCols );
+			}
+			else if ( channels == 1 )
+			{
+				AccumulateStatistics<unsigned short, 1>( image, step, 0, 0, pHistograms, &columnSums[0], pRowMeans, numSampledCols );
+			}
+			else if ( channels == 3 )
+			{
+				AccumulateStatistics<unsigned char, 3>( image, step, rIndex, bIndex, pHistograms, &columnSums[0], pRowMeans, numSampledCols );
+			}
+			else
+			{
+				AccumulateStatistics<unsigned char, 4>( image, step, rIndex, bIndex, pHistograms, &columnSums[0], pRowMeans, numSampledCols );
+			}
+
+			for ( unsigned int v = 0; v < 256; v++ )
+			{
+				pHistograms[ImageStatistics::GREY][v] += pHistograms[4][v];
+			}
+			const unsigned int numChannels = channels == 1 ? 1 : 4;
+			for ( unsigned int c = 0; c < 4; c++ )
+			{
+				pStats->channels[c] = ChannelStatistics();
+				if ( c < numChannels )
+				{
+					memcpy( pStats->channels[c].histogram, pHistograms[c], sizeof(pStats->channels[c].histogram) );
+					FinishChannelStatistics( &pStats->channels[c], pStats->numSamples );
+				}
+			}
+
+			pStats->columnMeans.assign( rowColumnStatistics ? numSampledCols : 0, 0.0f );
+			for ( unsigned int i = 0; i < pStats->columnMeans.size(); i++ )
+			{
+				pStats->columnMeans[i] = static_cast<float>( columnSums[i] ) / numSampledRows;
+			}
+			return PGRERROR_OK;
+		}
+	}
+
+	/**
+	 * The StatisticsWorker class computes histograms and row and column
+	 * means of live frames on a background thread, at a bounded rate, so
+	 * a statistics window does not slow down the thread that displays
+	 * frames.
+	 *
+	 * The display thread passes each frame to Submit(). Frames arriving
+	 * sooner than the rate allows are skipped without being touched; the
+	 * others are copied into a LatestFrameSlot, which the worker drains.
+	 * The worker samples every n-th row and column and publishes each
+	 * result as an immutable FrameStatistics, which any thread can get
+	 * with GetLatest() without waiting for the worker.
+	 *
+	 * Frames in MONO8, MONO16, RAW8, RAW16, RGB8, BGR, RGBU and BGRU are
+	 * read directly. Other formats are converted to BGRU on the worker
+	 * thread.
+	 *
+	 * With a MemoryBudget, the three frame copies the worker keeps, staged,
+	 * published and being computed, are reserved as cache memory owned by
+	 * the worker at the largest frame size seen. A frame that would exceed
+	 * the limit is refused and counted as an error.
+	 */
+	class StatisticsWorker
+	{
+		public:
+
+			typedef std::chrono::steady_clock Clock;
+
+			/**
+			 * @param pBudget Optional budget to account the frame copies
+			 *                in. It must outlive the worker.
+			 */
+			explicit StatisticsWorker( MemoryBudget* pBudget = NULL )
+				: m_pBudget( pBudget ),
+				  m_running( false ),
+				  m_pStaging( new Image() ),
+				  m_period( std::chrono::milliseconds( 100 ) ),
+				  m_numAccepted( 0 ),
+				  m_reservedBytes( 0 ),
+				  m_subsample( 4 ),
+				  m_rowColumnStatistics( true ),
+				  m_generation( 0 ),
+				  m_numComputeErrors( 0 )
+			{
+			}
+
+			/**
+			 * Default destructor. Stops the worker.
+			 */
+			~StatisticsWorker()
+			{
+				Stop();
+				delete m_pStaging;
+				if ( m_pBudget != NULL )
+				{
+					m_pBudget->Release( this, MEMORY_CACHE );
+				}
+			}
+
+			/**
+			 * Start the worker thread.
+			 *
+			 * @return PGRERROR_OK, or PGRERROR_ISOCH_ALREADY_STARTED.
+			 */
+			ErrorType Start()
+			{
+				std::lock_guard<std::mutex> lock( m_controlMutex );
+				if ( m_running )
+				{
+					return PGRERROR_ISOCH_ALREADY_STARTED;
+				}
+
+				m_running = true;
+				m_thread = std::thread( &StatisticsWorker::WorkerLoop, this );
+				return PGRERROR_OK;
+			}
+
+			/**
+			 * Stop the worker thread. The latest statistics stay available.
+			 */
+			void Stop()
+			{
+				std::lock_guard<std::mutex> lock( m_controlMutex );
+				if ( !m_running )
+				{
+					return;
+				}
+
+				m_running = false;
+				m_thread.join();
+			}
+
+			/**
+			 * Set how often statistics are computed. The default is 10 Hz.
+			 *
+			 * @param rateHz Largest rate, or 0 to compute every frame the
+			 *               worker keeps up with.
+			 */
+			void SetMaxRate( double rateHz )
+			{
+				std::lock_guard<std::mutex> lock( m_submitMutex );
+				m_period = rateHz > 0.0 ?
+					std::chrono::duration_cast<Clock::duration>( std::chrono::duration<double>( 1.0 / rateHz ) ) :
+					Clock::duration::zero();
+			}
+
+			/**
+			 * Set the distance between sampled rows and columns. The
+			 * default is 4, which reads one pixel in 16.
+			 *
+			 * @param step The step, 1 for every pixel.
+			 *
+			 * @return PGRERROR_OK, or PGRERROR_INVALID_PARAMETER if step is 0.
+			 */
+			ErrorType SetSubsample( unsigned int step )
+			{
+				if ( step == 0 )
+				{
+					return PGRERROR_INVALID_PARAMETER;
+				}
+
+				m_subsample = step;
+				return PGRERROR_OK;
+			}
+
+			/**
+			 * Set whether row and column means are computed. The default
+			 * is true.
+			 *
+			 * @param enable Whether to compute them.
+			 */
+			void SetRowColumnStatistics( bool enable )
+			{
+				m_rowColumnStatistics = enable;
+			}
+
+			/**
+			 * Offer a frame. The frame is copied only if it is due
+			 * according to the rate, so this is cheap to call for every
+			 * displayed frame.
+			 *
+			 * @param image The frame.
+			 * @param tag The tag of the frame, returned with its
+			 *            statistics. Frames are taken in the order of the
+			 *            calls, whatever their sequence, so the sequence
+			 *            may restart with the pipeline.
+			 *
+			 * @return Whether the frame was taken; false if it was not due,
+			 *         could not be copied or does not fit in the memory
+			 *         budget.
+			 */
+			bool Submit( const Image& image, const FrameTag& tag )
+			{
+				std::lock_guard<std::mutex> lock( m_submitMutex );
+				m_stats.numSubmitted++;
+				const Clock::time_point now = Clock::now();
+				if ( now < m_nextAccept )
+				{
+					m_stats.numSkipped++;
+					return false;
+				}
+
+				if ( !ReserveCopies( image.GetDataSize() ) ||
+					 m_pStaging->DeepCopy( &image ) != PGRERROR_OK ||
+					 !m_slot.Publish( &m_pStaging, tag, m_numAccepted + 1 ) )
+				{
+					m_stats.numErrors++;
+					return false;
+				}
+				m_numAccepted++;
+				m_nextAccept = now + m_period;
+				return true;
+			}
+
+			/**
+			 * Get the most recent statistics. The object is not modified
+			 * after it is returned.
+			 *
+			 * @return The statistics, or an empty pointer if none have been
+			 *         computed.
+			 */
+			std::shared_ptr<const FrameStatistics> GetLatest() const
+			{
+				return std::atomic_load( &m_latest );
+			}
+
+			/**
+			 * Get the number of results published, to tell whether
+			 * GetLatest() has changed.
+			 *
+			 * @return The number of results.
+			 */
+			unsigned long long GetGeneration() const
+			{
+				return m_generation.load( std::memory_order_acquire );
+			}
+
+			/**
+			 * Get the worker counters.
+			 *
+			 * @param pStats Receives the counters.
+			 */
+			void GetStats( StatisticsWorkerStats* pStats ) const
+			{
+				{
+					std::lock_guard<std::mutex> lock( m_submitMutex );
+					*pStats = m_stats;
+				}
+				pStats->numOverwritten = m_slot.GetNumOverwritten();
+				pStats->numComputed = m_generation.load();
+				pStats->numErrors += m_numComputeErrors.load();
+			}
+
+		private:
+
+			// Number of frame copies held: staged, published and computed.
+			static const unsigned int sk_numCopies = 3;
+
+			// Grow the budget reservation to cover the frame copies at the
+			// largest size seen. Called with the submit mutex held.
+			bool ReserveCopies( unsigned long long frameBytes )
+			{
+				const unsigned long long bytes = sk_numCopies * frameBytes;
+				if ( m_pBudget == NULL || bytes <= m_reservedBytes )
+				{
+					return true;
+				}
+				if ( m_pBudget->Reserve( this, MEMORY_CACHE, bytes ) != PGRERROR_OK )
+				{
+					return false;
+				}
+				m_reservedBytes = bytes;
+				return true;
+			}
+
+			void WorkerLoop()
+			{
+				Image* pWork = new Image();
+				Image converted;
+				while ( m_running )
+				{
+					FrameTag tag;
+					if ( !m_slot.Acquire( &pWork, &tag, std::chrono::milliseconds( 100 ) ) )
+					{
+						continue;
+					}
+
+					const Clock::time_point start = Clock::now();
+					std::shared_ptr<FrameStatistics> pStats = std::make_shared<FrameStatistics>();
+					pStats->tag = tag;
+					const unsigned int step = m_subsample;
+					const bool rowColumnStatistics = m_rowColumnStatistics;
+					ErrorType error = Detail::ComputeFrameStatistics( *pWork, step, rowColumnStatistics, pStats.get() );
+					if ( error == PGRERROR_IMAGE_CONVERSION_FAILED &&
+						 pWork->Convert( PIXEL_FORMAT_BGRU, &converted ) == PGRERROR_OK )
+					{
+						error = Detail::ComputeFrameStatistics( converted, step, rowColumnStatistics, pStats.get() );
+					}
+					if ( error != PGRERROR_OK )
+					{
+						m_numComputeErrors++;
+						continue;
+					}
+
+					pStats->computeTime = std::chrono::duration_cast<std::chrono::nanoseconds>( Clock::now() - start );
+					std::atomic_store( &m_latest, std::shared_ptr<const FrameStatistics>( pStats ) );
+					m_generation.fetch_add( 1, std::memory_order_release );
+				}
+				delete pWork;
+			}
+
+			StatisticsWorker( const StatisticsWorker& );
+			StatisticsWorker& operator=( const StatisticsWorker& );
+
+			MemoryBudget* const         m_pBudget;
+			std::mutex                  m_controlMutex;
+			std::thread                 m_thread;
+			std::atomic<bool>           m_running;
+
+			mutable std::mutex          m_submitMutex;
+			Image*                      m_pStaging;
+			Clock::duration             m_period;
+			Clock::time_point           m_nextAccept;
+			// Frames taken by Submit(), which orders them in the slot.
+			unsigned long long          m_numAccepted;
+			unsigned long long          m_reservedBytes;
+			StatisticsWorkerStats       m_stats;
+
+			LatestFrameSlot             m_slot;
+			std::atomic<unsigned int>   m_subsample;
+			std::atomic<bool>           m_rowColumnStatistics;
+			std::shared_ptr<const FrameStatistics> m_latest;
+			std::atomic<unsigned long long> m_generation;
+			std::atomic<unsigned long long> m_numComputeErrors;
+	};
+}
+
+#endif // FLIR_FC2_STATISTICSWORKER_H
@@ -0,0 +1,684 @@
+//=============================================================================
+// Copyright (c) 2001-2018 FLIR Systems, Inc. All Rights Reserved.
+//
+// This software is the confidential and proprietary information of FLIR
+// Integrated Imaging Solutions, Inc. ("Confidential Information"). You
+// shall not disclose such Confidential Information and shall use it only in
+// accordance with the terms of the license agreement you entered into
+// with FLIR Integrated Imaging Solutions, Inc. (FLIR).
+//
+// FLIR MAKES NO REPRESENTATIONS OR WARRANTIES ABOUT THE SUITABILITY OF THE
+// SOFTWARE, EITHER EXPRESSED OR IMPLIED, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+// PURPOSE, OR NON-INFRINGEMENT. FLIR SHALL NOT BE LIABLE FOR ANY DAMAGES
+// SUFFERED BY LICENSEE AS A RESULT OF USING, MODIFYING OR DISTRIBUTING
+// THIS SOFTWARE OR ITS DERIVATIVES.
+//=============================================================================
+
+#ifndef FLIR_FC2_TRIGGERSCHEDULER_H
+#define FLIR_FC2_TRIGGERSCHEDULER_H
+
+#include "FlyCapture2Platform.h"
+#include "FlyCapture2Defs.h"
+#include "Error.h"
+
+#if !defined(_MSC_VER) && __cplusplus < 201103L
+#error "TriggerScheduler.h requires C++11"
+#endif
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <math.h>
+
+#if defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#include <sys/timerfd.h>
+#include <time.h>
+#include <unistd.h>
+#endif
+
+namespace FlyCapture2
+{
+	/** Timing of one software trigger fired by a TriggerScheduler. */
+	struct TriggerRecord
+	{
+		/** Index of the trigger since the schedule started. */
+		unsigned long long index;
+		/** Time the trigger was scheduled for. */
+		std::chrono::steady_clock::time_point scheduledTime;
+		/** Time the trigger was issued to the first camera. */
+		std::chrono::steady_clock::time_point firedTime;
+		/** Time the trigger had been issued to every camera. */
+		std::chrono::steady_clock::time_point completedTime;
+		/** Number of cameras that failed to accept the trigger. */
+		unsigned int numFailures;
+
+		TriggerRecord()
+		{
+			index = 0;
+			numFailures = 0;
+		}
+	};
+
+	/** Statistics of a TriggerScheduler. */
+	struct TriggerSchedulerStats
+	{
+		/** Triggers fired. */
+		unsigned long long numFired;
+		/** Triggers skipped because they were due more than a period ago. */
+		unsigned long long numMissed;
+		/** Camera trigger writes that failed. */
+		unsigned long long numFailures;
+		/** Mean of firedTime - scheduledTime, in nanoseconds. */
+		double meanLatenessNs;
+		/** Standard deviation of firedTime - scheduledTime, in nanoseconds. */
+		double stdDevLatenessNs;
+		/** Largest firedTime - scheduledTime, in nanoseconds. */
+		long long maxLatenessNs;
+		/** Largest completedTime - firedTime, in nanoseconds. */
+		long long maxFireDurationNs;
+		/** Whether the requested real time priority and affinity were applied. */
+		bool realtimeApplied;
+
+		TriggerSchedulerStats()
+		{
+			numFired = 0;
+			numMissed = 0;
+			numFailures = 0;
+			meanLatenessNs = 0.0;
+			stdDevLatenessNs = 0.0;
+			maxLatenessNs = 0;
+			maxFireDurationNs = 0;
+			realtimeApplied = false;
+		}
+	};
+
+	namespace Detail
+	{
+		// Sleep until a deadline with sub-microsecond precision: block on
+		// an absolute CLOCK_MONOTONIC timer until shortly before the
+		// deadline, then spin for the remainder. steady_clock is
+		// CLOCK_MONOTONIC on Linux.
+		class PrecisionSleeper
+		{
+			public:
+
+				PrecisionSleeper()
+#if defined(__linux__)
+					: m_timerFd( timerfd_create( CLOCK_MONOTONIC, TFD_CLOEXEC ) )
+#endif
+				{
+				}
+
+				~PrecisionSleeper()
+				{
+#if defined(__linux__)
+					if ( m_timerFd >= 0 )
+					{
+						close( m_timerFd );
+					}
+#endif
+				}
+
+				// Returns early, without spinning, once running is cleared.
+				void SleepUntil(
+						std::chrono::steady_clock::time_point deadline,
+						std::chrono::nanoseconds              spinThreshold,
+						const std::atomic<bool>&              running )
+				{
+					typedef std::chrono::steady_clock Clock;
+					const Clock::time_point wakeTime = deadline - spinThreshold;
+
+					// Block in bounded steps so that a stop request is seen
+					// promptly even for long trigger periods.
+					Clock::time_point now = Clock::now();
+					while ( now < wakeTime && running.load( std::memory_order_relaxed ) )
+					{
+						BlockUntil( std::min( wakeTime, now + std::chrono::milliseconds( 50 ) ) );
+						now = Clock::now();
+					}
+
+					while ( Clock::now() < deadline && running.load( std::memory_order_relaxed ) )
+					{
+					}
+				}
+
+			private:
+
+				void BlockUntil( std::chrono::steady_clock::time_point wakeTime )
+				{
+#if defined(__linux__)
+					if ( m_timerFd >= 0 )
+					{
+						const long long ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+							wakeTime.time_since_epoch() ).count();
+						struct itimerspec spec;
+						spec.it_interval.tv_sec = 0;
+						spec.it_interval.tv_nsec = 0;
+						spec.it_value.tv_sec = static_cast<time_t>( ns / 1000000000 );
+						spec.it_value.tv_nsec = static_cast<long>( ns % 1000000000 );
+
+						unsigned long long expirations;
+						if ( timerfd_settime( m_timerFd, TFD_TIMER_ABSTIME, &spec, NULL ) == 0 &&
+							 read( m_timerFd, &expirations, sizeof(expirations) ) == sizeof(expirations) )
+						{
+							return;
+						}
+					}
+#endif
+					std::this_thread::sleep_until( wakeTime );
+				}
+
+				PrecisionSleeper( const PrecisionSleeper& );
+				PrecisionSleeper& operator=( const PrecisionSleeper& );
+
+#if defined(__linux__)
+				int m_timerFd;
+#endif
+		};
+
+		// Move the calling thread to SCHED_FIFO at the specified priority
+		// and pin it to a CPU, ideally one isolated with isolcpus. Needs
+		// CAP_SYS_NICE or a suitable RLIMIT_RTPRIO.
+		inline bool MakeRealtime( int priority, int cpu )
+		{
+#if defined(__linux__)
+			bool applied = true;
+			if ( priority > 0 )
+			{
+				struct sched_param param;
+				param.sched_priority = priority;
+				applied = pthread_setschedparam( pthread_self(), SCHED_FIFO, &param ) == 0;
+			}
+			if ( cpu >= 0 )
+			{
+				cpu_set_t cpus;
+				CPU_ZERO( &cpus );
+				CPU_SET( cpu, &cpus );
+				applied = pthread_setaffinity_np( pthread_self(), sizeof(cpus), &cpus ) == 0 && applied;
+			}
+			return applied;
+#else
+			return priority <= 0 && cpu < 0;
+#endif
+		}
+	}
+
+	/**
+	 * The TriggerScheduler class fires software triggers on one or more
+	 * cameras at a fixed rate or on an arbitrary schedule, with timing
+	 * precise to a few microseconds rather than the milliseconds of a sleep
+	 * based loop.
+	 *
+	 * Triggers are fired from a dedicated thread which blocks on a
+	 * CLOCK_MONOTONIC timerfd until shortly before each deadline and spins
+	 * for the rest. The thread can be given real time priority and pinned
+	 * to an isolated CPU. The timing of every trigger is recorded, and
+	 * TriggerLatencyEstimator relates it to the embedded time stamps of the
+	 * resulting images.
+	 *
+	 * Cameras are triggered in order with FireSoftwareTrigger(). Trigger
+	 * mode must already be enabled with a software source. The scheduler
+	 * works with any camera type providing FireSoftwareTrigger(), such as
+	 * Camera, GigECamera or VirtualCamera.
+	 */
+	template <class CameraT>
+	class TriggerScheduler
+	{
+		public:
+
+			typedef std::chrono::steady_clock Clock;
+
+			/** Number of recent triggers whose records are kept. */
+			static const unsigned int sk_historySize = 4096;
+
+			TriggerScheduler()
+				: m_spinThreshold( std::chrono::microseconds( 200 ) ),
+				  m_priority( 0 ),
+				  m_cpu( -1 ),
+				  m_running( false ),
+				  m_history( sk_historySize ),
+				  m_latenessSum( 0.0 ),
+				  m_latenessSquareSum( 0.0 )
+			{
+			}
+
+			/**
+			 * Default destructor. Stops the schedule.
+			 */
+			~TriggerScheduler()
+			{
+				Stop();
+			}
+
+			/**
+			 * Set the cameras to trigger. The cameras must outlive the
+			 * schedule.
+			 *
+			 * @param ppCameras Array of cameras.
+			 * @param numCameras Number of cameras.
+			 *
+			 * @return PGRERROR_OK, or PGRERROR_ISOCH_ALREADY_STARTED if a
+			 *         schedule is running.
+			 */
+			ErrorType SetCameras( CameraT** ppCameras, unsigned int numCameras )
+			{
+				if ( m_running )
+				{
+					return PGRERROR_ISOCH_ALREADY_STARTED;
+				}
+
+				m_cameras.assign( ppCameras, ppCameras + numCameras );
+				return PGRERROR_OK;
+			}
+
+			/**
+			 * Set how long before each deadline the scheduler stops blocking
+			 * and starts spinning. Larger values trade CPU time for
+			 * precision on loaded systems. The default is 200 us. Call while
+			 * no schedule is running.
+			 *
+			 * @param threshold The spin threshold.
+			 */
+			void SetSpinThreshold( std::chrono::nanoseconds threshold )
+			{
+				m_spinThreshold = threshold;
+			}
+
+			/**
+			 * Request real time scheduling of the trigger thread. Takes
+			 * effect at the next start. Whether it could be applied is
+			 * reported in the statistics.
+			 *
+			 * @param priority SCHED_FIFO priority, or 0 to keep the default
+			 *                 policy.
+			 * @param cpu CPU to pin the thread to, or -1 for no affinity.
+			 */
+			void SetRealtime( int priority, int cpu = -1 )
+			{
+				m_priority = priority;
+				m_cpu = cpu;
+			}
+
+			/**
+			 * Fire triggers at a fixed rate, starting one period from now.
+			 *
+			 * @param rateHz Trigger rate in Hz.
+			 * @param numTriggers Number of triggers, or 0 to run until
+			 *                    Stop() is called.
+			 *
+			 * @return PGRERROR_OK, PGRERROR_INVALID_PARAMETER, or
+			 *         PGRERROR_ISOCH_ALREADY_STARTED.
+			 */
+			ErrorType StartPeriodic( double rateHz, unsigned long long numTriggers = 0 )
+			{
+				if ( !( rateHz > 0.0 ) )
+				{
+					return PGRERROR_INVALID_PARAMETER;
+				}
+
+				m_period = std::chrono::duration_cast<Clock::duration>( std::chrono::duration<double>( 1.0 / rateHz ) );
+				m_offsets.clear();
+				m_numTriggers = numTriggers;
+				return Start();
+			}
+
+			/**
+			 * Fire triggers on an arbitrary schedule.
+			 *
+			 * @param offsets Trigger times relative to the start, in
+			 *                increasing order. Must not be empty.
+			 *
+			 * @return PGRERROR_OK, PGRERROR_INVALID_PARAMETER if offsets is
+			 *         empty or out of order, or
+			 *         PGRERROR_ISOCH_ALREADY_STARTED.
+			 */
+			ErrorType StartSchedule( const std::vector<std::chrono::nanoseconds>& offsets )
+			{
+				// An empty schedule would leave m_numTriggers at 0, which
+				// means fire unpaced until Stop().
+				if ( offsets.empty() )
+				{
+					return PGRERROR_INVALID_PARAMETER;
+				}
+
+				for ( size_t i = 1; i < offsets.size(); i++ )
+				{
+					if ( offsets[i] < offsets[i - 1] )
+					{
+						return PGRERROR_INVALID_PARAMETER;
+					}
+				}
+
+				m_period = Clock::duration::zero();
+				m_offsets = offsets;
+				m_numTriggers = offsets.size();
+				return Start();
+			}
+
+			/**
+			 * Stop firing triggers. Returns once the trigger thread has
+			 * exited.
+			 */
+			void Stop()
+			{
+				m_running = false;
+				if ( m_thread.joinable() )
+				{
+					m_thread.join();
+				}
+			}
+
+			/**
+			 * Check if the schedule is still running.
+			 *
+			 * @return false once every trigger has been fired or Stop() has
+			 *         been called.
+			 */
+			bool IsRunning() const
+			{
+				return m_running;
+			}
+
+			/**
+			 * Get the record of a recent trigger.
+			 *
+			 * @param index Index of the trigger since the start.
+			 * @param pRecord Receives the record.
+			 *
+			 * @return false if the trigger has not been fired yet or is no
+			 *         longer in the history.
+			 */
+			bool GetTriggerRecord( unsigned long long index, TriggerRecord* pRecord )
+			{
+				std::lock_guard<std::mutex> lock( m_mutex );
+				const TriggerRecord& record = m_history[ index % sk_historySize ];
+				if ( m_stats.numFired == 0 || record.index != index || record.firedTime == Clock::time_point() )
+				{
+					return false;
+				}
+
+				*pRecord = record;
+				return true;
+			}
+
+			/**
+			 * Get the statistics of the current or last schedule.
+			 *
+			 * @param pStats Receives the statistics.
+			 */
+			void GetStats( TriggerSchedulerStats* pStats )
+			{
+				std::lock_guard<std::mutex> lock( m_mutex );
+				*pStats = m_stats;
+				if ( m_stats.numFired != 0 )
+				{
+					const double n = static_cast<double>( m_stats.numFired );
+					pStats->meanLatenessNs = m_latenessSum / n;
+					pStats->stdDevLatenessNs = sqrt( std::max( 0.0,
+						m_latenessSquareSum / n - pStats->meanLatenessNs * pStats->meanLatenessNs ) );
+				}
+			}
+
+		private:
+
+			ErrorType Start()
+			{
+				if ( m_running )
+				{
+					return PGRERROR_ISOCH_ALREADY_STARTED;
+				}
+				Stop();
+
+				{
+					std::lock_guard<std::mutex> lock( m_mutex );
+					m_stats = TriggerSchedulerStats();
+					m_history.assign( sk_historySize, TriggerRecord() );
+					m_latenessSum = 0.0;
+					m_latenessSquareSum = 0.0;
+				}
+
+				m_running = true;
+				m_thread = std::thread( &TriggerScheduler::Run, this );
+				return PGRERROR_OK;
+			}
+
+			void Run()
+			{
+				const bool realtimeApplied = Detail::MakeRealtime( m_priority, m_cpu );
+				{
+					std::lock_guard<std::mutex> lock( m_mutex );
+					m_stats.realtimeApplied = realtimeApplied;
+				}
+
+				Detail::PrecisionSleeper sleeper;
+				const Clock::time_point start = Clock::now() + ( m_offsets.empty() ? m_period : Clock::duration::zero() );
+
+				for ( unsigned long long index = 0; m_running && ( m_numTriggers == 0 || index < m_numTriggers ); index++ )
+				{
+					const Clock::time_point scheduled = m_offsets.empty() ?
+						start + m_period * static_cast<Clock::rep>( index ) :
+						start + std::chrono::duration_cast<Clock::duration>( m_offsets[ static_cast<size_t>( index ) ] );
+
+					// Skip triggers that are more than a period late rather
+					// than firing them in a burst.
+					if ( m_period != Clock::duration::zero() && Clock::now() > scheduled + m_period )
+					{
+						std::lock_guard<std::mutex> lock( m_mutex );
+						m_stats.numMissed++;
+						continue;
+					}
+
+					sleeper.SleepUntil( scheduled, m_spinThreshold, m_running );
+					if ( !m_running )
+					{
+						break;
+					}
+
+					TriggerRecord record;
+					record.index = index;
+					record.scheduledTime = scheduled;
+					record.firedTime = Clock::now();
+					for ( size_t i = 0; i < m_cameras.size(); i++ )
+					{
+						if ( m_cameras[i]->FireSoftwareTrigger() != PGRERROR_OK )
+						{
+							record.numFailures++;
+						}
+					}
+					record.completedTime = Clock::now();
+
+					const long long lateness = std::chrono::duration_cast<std::chrono::nanoseconds>(
+						record.firedTime - scheduled ).count();
+					const long long duration = std::chrono::duration_cast<std::chrono::nanoseconds>(
+						record.completedTime - record.firedTime ).count();
+
+					std::lock_guard<std::mutex> lock( m_mutex );
+					m_history[ index % sk_historySize ] = record;
+					m_stats.numFired++;
+					m_stats.numFailures += record.numFailures;
+					m_stats.maxLatenessNs = std::max( m_stats.maxLatenessNs, lateness );
+					m_stats.maxFireDurationNs = std::max( m_stats.maxFireDurationNs, duration );
+					m_latenessSum += static_cast<double>( lateness );
+					m_latenessSquareSum += static_cast<double>( lateness ) * lateness;
+				}
+
+				m_running = false;
+			}
+
+			TriggerScheduler( const TriggerScheduler& );
+			TriggerScheduler& operator=( const TriggerScheduler& );
+
+			std::vector<CameraT*>                  m_cameras;
+			std::chrono::nanoseconds               m_spinThreshold;
+			int                                    m_priority;
+			int                                    m_cpu;
+
+			Clock::duration                        m_period;
+			std::vector<std::chrono::nanoseconds>  m_offsets;
+			unsigned long long                     m_numTriggers;
+
+			std::atomic<bool>                      m_running;
+			std::thread                            m_thread;
+
+			std::mutex                             m_mutex;
+			std::vector<TriggerRecord>             m_history;
+			TriggerSchedulerStats                  m_stats;
+			double                                 m_latenessSum;
+			double                                 m_latenessSquareSum;
+	};
+
+	/**
+	 * The TriggerLatencyEstimator class measures trigger-to-exposure latency
+	 * from the embedded time stamps of triggered images.
+	 *
+	 * The embedded time stamp counts camera time, which is not synchronized
+	 * with the host clock, so the absolute latency cannot be observed. The
+	 * estimator instead tracks the difference between camera time and host
+	 * trigger time for every frame. Its minimum is the fixed clock offset
+	 * plus the smallest latency, and the excess over the minimum is the
+	 * variable part of the latency: trigger jitter, USB or GigE command
+	 * latency, and exposure start uncertainty. Delivery latency, from the
+	 * trigger to the image reaching the host, is measured absolutely.
+	 */
+	class TriggerLatencyEstimator
+	{
+		public:
+
+			TriggerLatencyEstimator()
+			{
+				Reset();
+			}
+
+			/**
+			 * Discard all samples.
+			 */
+			void Reset()
+			{
+				m_haveOffset = false;
+				m_minOffsetUs = 0;
+				m_numSamples = 0;
+				m_excessSumUs = 0.0;
+				m_maxExcessUs = 0;
+				m_numDeliverySamples = 0;
+				m_deliverySumUs = 0.0;
+				m_maxDeliveryUs = 0;
+			}
+
+			/**
+			 * Add a sample relating a trigger to the embedded time stamp of
+			 * the image it produced.
+			 *
+			 * @param triggerTime Host time the trigger was fired.
+			 * @param embeddedTimeStamp The embedded time stamp of the image,
+			 *        as reported in ImageMetadata::embeddedTimeStamp.
+			 */
+			void AddExposureSample(
+					std::chrono::steady_clock::time_point triggerTime,
+					unsigned int                          embeddedTimeStamp )
+			{
+				// The embedded time stamp holds 7 bits of seconds, 13 bits
+				// of 125 us cycles and 12 bits of cycle offset, wrapping
+				// every 128 seconds.
+				static const long long sk_wrapUs = 128LL * 1000000;
+				const long long cameraUs =
+					( embeddedTimeStamp >> 25 ) * 1000000LL +
+					( ( embeddedTimeStamp >> 12 ) & 0x1FFF ) * 125LL +
+					( embeddedTimeStamp & 0xFFF ) * 125LL / 3072;
+				const long long hostUs = std::chrono::duration_cast<std::chrono::microseconds>(
+					triggerTime.time_since_epoch() ).count() % sk_wrapUs;
+				const long long offsetUs = ( ( cameraUs - hostUs ) % sk_wrapUs + sk_wrapUs ) % sk_wrapUs;
+
+				if ( !m_haveOffset || Wrapped( offsetUs - m_minOffsetUs ) < 0 )
+				{
+					// A new minimum shifts the excess of every earlier sample.
+					const long long shift = m_haveOffset ? -Wrapped( offsetUs - m_minOffsetUs ) : 0;
+					m_excessSumUs += static_cast<double>( shift ) * m_numSamples;
+					m_maxExcessUs += shift;
+					m_minOffsetUs = offsetUs;
+					m_haveOffset = true;
+				}
+
+				const long long excess = Wrapped( offsetUs - m_minOffsetUs );
+				m_numSamples++;
+				m_excessSumUs += static_cast<double>( excess );
+				m_maxExcessUs = std::max( m_maxExcessUs, excess );
+			}
+
+			/**
+			 * Add a sample of the time from a trigger to the image reaching
+			 * the host.
+			 *
+			 * @param triggerTime Host time the trigger was fired.
+			 * @param receivedTime Host time the image was received.
+			 */
+			void AddDeliverySample(
+					std::chrono::steady_clock::time_point triggerTime,
+					std::chrono::steady_clock::time_point receivedTime )
+			{
+				const long long us = std::chrono::duration_cast<std::chrono::microseconds>(
+					receivedTime - triggerTime ).count();
+				m_numDeliverySamples++;
+				m_deliverySumUs += static_cast<double>( us );
+				m_maxDeliveryUs = std::max( m_maxDeliveryUs, us );
+			}
+
+			/** Number of exposure samples. */
+			unsigned long long GetNumExposureSamples() const { return m_numSamples; }
+
+			/** Mean variable trigger-to-exposure latency, in microseconds. */
+			double GetMeanExposureJitterUs() const
+			{
+				return m_numSamples != 0 ? m_excessSumUs / m_numSamples : 0.0;
+			}
+
+			/** Largest variable trigger-to-exposure latency, in microseconds. */
+			long long GetMaxExposureJitterUs() const { return m_maxExcessUs; }
+
+			/** Number of delivery samples. */
+			unsigned long long GetNumDeliverySamples() const { return m_numDeliverySamples; }
+
+			/** Mean trigger-to-delivery latency, in microseconds. */
+			double GetMeanDeliveryLatencyUs() const
+			{
+				return m_numDeliverySamples != 0 ? m_deliverySumUs / m_numDeliverySamples : 0.0;
+			}
+
+			/** Largest trigger-to-delivery latency, in microseconds. */
+			long long GetMaxDeliveryLatencyUs() const { return m_maxDeliveryUs; }
+
+		private:
+
+			// Map a difference of wrapped times into [-64 s, 64 s).
+			static long long Wrapped( long long us )
+			{
+				static const long long sk_wrapUs = 128LL * 1000000;
+				us %= sk_wrapUs;
+				if ( us >= sk_wrapUs / 2 )
+				{
+					us -= sk_wrapUs;
+				}
+				else if ( us < -sk_wrapUs / 2 )
+				{
+					us += sk_wrapUs;
+				}
+				return us;
+			}
+
+			bool               m_haveOffset;
+			long long          m_minOffsetUs;
+			unsigned long long m_numSamples;
+			double             m_excessSumUs;
+			long long          m_maxExcessUs;
+			unsigned long long m_numDeliverySamples;
+			double             m_deliverySumUs;
+			long long          m_maxDeliveryUs;
+	};
+}
+
+#endif // FLIR_FC2_TRIGGERSCHEDULER_H
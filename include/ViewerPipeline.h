@@ -0,0 +1,645 @@
+//=============================================================================
+// Copyright (c) 2001-2018 FLIR Systems, Inc. All Rights Reserved.
+//
+// This software is the confidential and proprietary information of FLIR
+// Integrated Imaging Solutions, Inc. ("Confidential Information"). You
+// shall not disclose such Confidential Information and shall use it only in
+// accordance with the terms of the license agreement you entered into
+// with FLIR Integrated Imaging Solutions, Inc. (FLIR).
+//
+// FLIR MAKES NO REPRESENTATIONS OR WARRANTIES ABOUT THE SUITABILITY OF THE
+// SOFTWARE, EITHER EXPRESSED OR IMPLIED, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+// PURPOSE, OR NON-INFRINGEMENT. FLIR SHALL NOT BE LIABLE FOR ANY DAMAGES
+// SUFFERED BY LICENSEE AS A RESULT OF USING, MODIFYING OR DISTRIBUTING
+// THIS SOFTWARE OR ITS DERIVATIVES.
+//=============================================================================
+
+
+#ifndef FLIR_FC2_VIEWERPIPELINE_H
+#define FLIR_FC2_VIEWERPIPELINE_H
+
+#include "FlyCapture2Platform.h"
+#include "FlyCapture2Defs.h"
+#include "Error.h"
+#include "Image.h"
+#include "VirtualCamera.h"
+#include "MemoryBudget.h"
+
+#if !defined(_MSC_VER) && __cplusplus < 201103L
+#error "ViewerPipeline.h requires C++11"
+#endif
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace FlyCapture2
+{
+	/** Identity and timing of a frame passed between pipeline stages. */
+	struct FrameTag
+	{
+		/** Index of the frame since the pipeline started. */
+		unsigned long long sequence;
+		/** Host time the frame was retrieved from the camera. */
+		std::chrono::steady_clock::time_point grabTime;
+		/** Host time the frame was published to the slot. */
+		std::chrono::steady_clock::time_point publishTime;
+		/**
+		 * Time stamp of the frame, from the Image for real cameras and from
+		 * the VirtualFrameInfo for virtual cameras.
+		 */
+		TimeStamp timeStamp;
+		/** Metadata of the frame, from the same source as timeStamp. */
+		ImageMetadata metadata;
+
+		FrameTag()
+		{
+			sequence = 0;
+		}
+	};
+
+	/**
+	 * The LatestFrameSlot class hands frames from any number of producer
+	 * threads to one consumer, keeping only the newest. Producers never
+	 * wait for the consumer: publishing replaces a frame that has not been
+	 * taken yet, and the consumer always gets the newest frame available.
+	 *
+	 * Frames are exchanged, not copied. Publish() and Acquire() swap the
+	 * caller's Image pointer with the one held by the slot, so each party
+	 * always owns a buffer it can reuse. A frame that finishes after a
+	 * newer one has been published, as happens with several conversion
+	 * threads, is refused rather than shown out of order.
+	 */
+	class LatestFrameSlot
+	{
+		public:
+
+			typedef std::chrono::steady_clock Clock;
+
+			LatestFrameSlot()
+				: m_pReady( new Image() ),
+				  m_readyOrder( 0 ),
+				  m_hasNew( false ),
+				  m_hasPublished( false ),
+				  m_numOverwritten( 0 ),
+				  m_numStale( 0 )
+			{
+			}
+
+			~LatestFrameSlot()
+			{
+				delete m_pReady;
+			}
+
+			/**
+			 * Publish a frame. On success *ppImage receives a buffer to
+			 * reuse for the next frame.
+			 *
+			 * @param ppImage The frame to publish.
+			 * @param tag The tag of the frame.
+			 *
+			 * @return Whether the frame was published; false if a newer
+			 *         frame was already published, in which case *ppImage
+			 *         is left untouched.
+			 */
+			bool Publish( Image** ppImage, const FrameTag& tag )
+			{
+				return Publish( ppImage, tag, tag.sequence );
+			}
+
+			/**
+			 * Publish a frame, ordered by a key other than the sequence of
+			 * its tag, such as a count kept by the producer.
+			 *
+			 * @param ppImage The frame to publish.
+			 * @param tag The tag of the frame.
+			 * @param order Increasing key frames are ordered by.
+			 *
+			 * @return Whether the frame was published; false if a frame
+			 *         with a later key was already published.
+			 */
+			bool Publish( Image** ppImage, const FrameTag& tag, unsigned long long order )
+			{
+				std::lock_guard<std::mutex> lock( m_mutex );
+				if ( m_hasPublished && order <= m_readyOrder )
+				{
+					m_numStale++;
+					return false;
+				}
+				if ( m_hasNew )
+				{
+					m_numOverwritten++;
+				}
+
+				std::swap( *ppImage, m_pReady );
+				m_readyTag = tag;
+				m_readyTag.publishTime = Clock::now();
+				m_readyOrder = order;
+				m_hasNew = true;
+				m_hasPublished = true;
+				m_condition.notify_one();
+				return true;
+			}
+
+			/**
+			 * Take the newest frame if one has been published since the
+			 * last call. On success *ppImage receives the frame and the
+			 * slot keeps the buffer passed in.
+			 *
+			 * @param ppImage The buffer to give up; receives the frame.
+			 * @param pTag Receives the tag of the frame.
+			 * @param timeout Longest time to wait for a new frame.
+			 *
+			 * @return Whether a new frame was taken.
+			 */
+			bool Acquire( Image** ppImage, FrameTag* pTag, std::chrono::nanoseconds timeout )
+			{
+				std::unique_lock<std::mutex> lock( m_mutex );
+				if ( !m_condition.wait_for( lock, timeout, [this] { return m_hasNew; } ) )
+				{
+					return false;
+				}
+
+				std::swap( *ppImage, m_pReady );
+				*pTag = m_readyTag;
+				m_hasNew = false;
+				return true;
+			}
+
+			/**
+			 * Forget the published frames and clear the counters, so that
+			 * sequence numbers can start again.
+			 */
+			void Reset()
+			{
+				std::lock_guard<std::mutex> lock( m_mutex );
+				m_hasNew = false;
+				m_hasPublished = false;
+				m_numOverwritten = 0;
+				m_numStale = 0;
+			}
+
+			/**
+			 * Get the number of frames replaced before they were taken.
+			 *
+			 * @return The number of overwritten frames.
+			 */
+			unsigned long long GetNumOverwritten() const
+			{
+				std::lock_guard<std::mutex> lock( m_mutex );
+				return m_numOverwritten;
+			}
+
+			/**
+			 * Get the number of frames refused because a newer frame was
+			 * published first.
+			 *
+			 * @return The number of stale frames.
+			 */
+			unsigned long long GetNumStale() const
+			{
+				std::lock_guard<std::mutex> lock( m_mutex );
+				return m_numStale;
+			}
+
+		private:
+
+			LatestFrameSlot( const LatestFrameSlot& );
+			LatestFrameSlot& operator=( const LatestFrameSlot& );
+
+			mutable std::mutex      m_mutex;
+			std::condition_variable m_condition;
+			Image*                  m_pReady;
+			FrameTag                m_readyTag;
+			unsigned long long      m_readyOrder;
+			bool                    m_hasNew;
+			bool                    m_hasPublished;
+			unsigned long long      m_numOverwritten;
+			unsigned long long      m_numStale;
+	};
+
+	/** Statistics of a ViewerPipeline. */
+	struct ViewerPipelineStats
+	{
+		/** Frames retrieved from the camera. */
+		unsigned long long numGrabbed;
+		/** RetrieveBuffer() calls that failed for a reason other than a timeout. */
+		unsigned long long numGrabErrors;
+		/** Frames replaced before a conversion thread picked them up. */
+		unsigned long long numDroppedBeforeConvert;
+		/** Frames converted. */
+		unsigned long long numConverted;
+		/** Conversions that failed or did not fit in the memory budget. */
+		unsigned long long numConvertErrors;
+		/** Converted frames replaced before they were displayed. */
+		unsigned long long numDroppedBeforeDisplay;
+		/** Converted frames discarded because a newer one was already published. */
+		unsigned long long numStale;
+		/** Frames handed to the display. */
+		unsigned long long numDisplayed;
+
+		ViewerPipelineStats()
+		{
+			numGrabbed = 0;
+			numGrabErrors = 0;
+			numDroppedBeforeConvert = 0;
+			numConverted = 0;
+			numConvertErrors = 0;
+			numDroppedBeforeDisplay = 0;
+			numStale = 0;
+			numDisplayed = 0;
+		}
+	};
+
+	/**
+	 * The ViewerPipeline class runs the grab, convert and display stages of
+	 * a live viewer independently, so a slow conversion or display never
+	 * slows down capture.
+	 *
+	 * A grab thread retrieves frames as fast as the camera delivers them
+	 * and leaves the newest in a pending slot. A pool of conversion threads
+	 * takes pending frames, converts them to the display format and
+	 * publishes them to a LatestFrameSlot. The display calls
+	 * AcquireDisplayFrame() once per refresh and always gets the newest
+	 * converted frame. Every stage drops frames it cannot keep up with
+	 * rather than queueing them, and the statistics say where.
+	 *
+	 * Frames are passed between stages by exchanging Image pointers. With
+	 * a Camera, each stage therefore holds a reference to a library
+	 * buffer, so numBuffers must exceed the number of conversion threads
+	 * plus three. The grab timeout of the camera bounds how long Stop()
+	 * waits.
+	 *
+	 * With a MemoryBudget, the converted frames, one per conversion thread
+	 * plus the published and displayed ones, are reserved as conversion
+	 * memory owned by the pipeline at the largest converted size seen. A
+	 * conversion that would exceed the limit is counted as an error and
+	 * its buffer freed.
+	 *
+	 * The class works with any camera type providing RetrieveBuffer(), such
+	 * as Camera, GigECamera or VirtualCamera. Capture must be started
+	 * before Start().
+	 */
+	template <class CameraT>
+	class ViewerPipeline
+	{
+		public:
+
+			typedef std::chrono::steady_clock Clock;
+
+			/** Conversion applied by the conversion threads. */
+			typedef std::function<ErrorType( const Image& source, Image* pDest )> ConvertFunction;
+
+			/** Function called on the grab thread for every frame retrieved. */
+			typedef std::function<void( const Image& image, const FrameTag& tag )> FrameObserver;
+
+			/**
+			 * @param pBudget Optional budget to account the converted frames
+			 *                in. It must outlive the pipeline.
+			 */
+			explicit ViewerPipeline( MemoryBudget* pBudget = NULL )
+				: m_pCamera( NULL ),
+				  m_pBudget( pBudget ),
+				  m_numConverters( 0 ),
+				  m_running( false ),
+				  m_pPendingRaw( NULL ),
+				  m_hasPending( false ),
+				  m_largestFrameBytes( 0 ),
+				  m_reservedBytes( 0 ),
+				  m_pFront( new Image() ),
+				  m_displayPeriod( Clock::duration::zero() ),
+				  m_numDisplayed( 0 )
+			{
+			}
+
+			/**
+			 * Default destructor. Stops the pipeline.
+			 */
+			~ViewerPipeline()
+			{
+				Stop();
+				delete m_pFront;
+				if ( m_pBudget != NULL )
+				{
+					m_pBudget->Release( this, MEMORY_CONVERSION );
+				}
+			}
+
+			/**
+			 * Start the grab and conversion threads.
+			 *
+			 * @param pCamera The camera, capturing.
+			 * @param convert The conversion to the display format.
+			 * @param numConverters Number of conversion threads.
+			 *
+			 * @return PGRERROR_OK, PGRERROR_INVALID_PARAMETER, or
+			 *         PGRERROR_ISOCH_ALREADY_STARTED.
+			 */
+			ErrorType Start( CameraT* pCamera, ConvertFunction convert, unsigned int numConverters = 2 )
+			{
+				if ( pCamera == NULL || !convert || numConverters == 0 )
+				{
+					return PGRERROR_INVALID_PARAMETER;
+				}
+				if ( m_running )
+				{
+					return PGRERROR_ISOCH_ALREADY_STARTED;
+				}
+
+				m_pCamera = pCamera;
+				m_convert = convert;
+				m_numConverters = numConverters;
+				m_stats = ViewerPipelineStats();
+				m_numDisplayed = 0;
+				m_display.Reset();
+				m_hasPending = false;
+				m_pPendingRaw = new Image();
+				m_nextDisplayTime = Clock::now();
+				m_running = true;
+
+				m_threads.push_back( std::thread( &ViewerPipeline::GrabLoop, this ) );
+				for ( unsigned int i = 0; i < numConverters; i++ )
+				{
+					m_threads.push_back( std::thread( &ViewerPipeline::ConvertLoop, this ) );
+				}
+				return PGRERROR_OK;
+			}
+
+			/**
+			 * Start the pipeline with Image::Convert() to a pixel format as
+			 * the conversion.
+			 *
+			 * @param pCamera The camera, capturing.
+			 * @param displayFormat The pixel format of displayed frames.
+			 * @param numConverters Number of conversion threads.
+			 *
+			 * @return As the other overload.
+			 */
+			ErrorType Start( CameraT* pCamera, PixelFormat displayFormat, unsigned int numConverters = 2 )
+			{
+				return Start( pCamera, [displayFormat]( const Image& source, Image* pDest ) {
+					return source.Convert( displayFormat, pDest ).GetType(); }, numConverters );
+			}
+
+			/**
+			 * Set a function to see every retrieved frame at camera rate,
+			 * before frames are dropped for display, such as
+			 * BackgroundRecorder::Record() given the time stamp and metadata
+			 * of the tag. It runs on the grab thread and must return
+			 * quickly.
+			 *
+			 * @param observer The function, or an empty function for none.
+			 *
+			 * @return PGRERROR_OK, or PGRERROR_ISOCH_ALREADY_STARTED if the
+			 *         pipeline is running.
+			 */
+			ErrorType SetFrameObserver( FrameObserver observer )
+			{
+				if ( m_running )
+				{
+					return PGRERROR_ISOCH_ALREADY_STARTED;
+				}
+
+				m_observer = observer;
+				return PGRERROR_OK;
+			}
+
+			/**
+			 * Stop the pipeline and wait for its threads. Capture is left
+			 * running.
+			 */
+			void Stop()
+			{
+				{
+					std::lock_guard<std::mutex> lock( m_pendingMutex );
+					if ( !m_running )
+					{
+						return;
+					}
+					m_running = false;
+					m_pendingCondition.notify_all();
+				}
+
+				for ( size_t i = 0; i < m_threads.size(); i++ )
+				{
+					m_threads[i].join();
+				}
+				m_threads.clear();
+				delete m_pPendingRaw;
+				m_pPendingRaw = NULL;
+			}
+
+			/**
+			 * Limit how often AcquireDisplayFrame() returns a frame, usually
+			 * to the monitor refresh rate. Waiting for the refresh instead
+			 * of for a frame means each refresh shows the newest frame.
+			 *
+			 * @param rateHz Largest display rate, or 0 for no limit.
+			 */
+			void SetMaxDisplayRate( double rateHz )
+			{
+				std::lock_guard<std::mutex> lock( m_displayMutex );
+				m_displayPeriod = rateHz > 0.0 ?
+					std::chrono::duration_cast<Clock::duration>( std::chrono::duration<double>( 1.0 / rateHz ) ) :
+					Clock::duration::zero();
+			}
+
+			/**
+			 * Get the newest converted frame for display. Call from a single
+			 * display thread.
+			 *
+			 * @param pTag Optional pointer to receive the tag of the frame.
+			 * @param timeout Longest time to wait for a new frame, after
+			 *                waiting for the next display period.
+			 *
+			 * @return The frame, valid until the next call, or NULL if no
+			 *         new frame arrived in time.
+			 */
+			const Image* AcquireDisplayFrame( FrameTag* pTag, std::chrono::milliseconds timeout )
+			{
+				std::lock_guard<std::mutex> lock( m_displayMutex );
+				if ( m_displayPeriod != Clock::duration::zero() )
+				{
+					std::this_thread::sleep_until( m_nextDisplayTime );
+					m_nextDisplayTime = std::max( m_nextDisplayTime + m_displayPeriod, Clock::now() );
+				}
+
+				FrameTag tag;
+				if ( !m_display.Acquire( &m_pFront, &tag, timeout ) )
+				{
+					return NULL;
+				}
+
+				m_numDisplayed++;
+				if ( pTag != NULL )
+				{
+					*pTag = tag;
+				}
+				return m_pFront;
+			}
+
+			/**
+			 * Get the statistics since Start().
+			 *
+			 * @param pStats Receives the statistics.
+			 */
+			void GetStats( ViewerPipelineStats* pStats ) const
+			{
+				{
+					std::lock_guard<std::mutex> lock( m_pendingMutex );
+					*pStats = m_stats;
+				}
+				pStats->numDroppedBeforeDisplay = m_display.GetNumOverwritten();
+				pStats->numStale = m_display.GetNumStale();
+				pStats->numDisplayed = m_numDisplayed;
+			}
+
+		private:
+
+			void GrabLoop()
+			{
+				Image* pImage = new Image();
+				unsigned long long sequence = 0;
+				while ( m_running )
+				{
+					TimeStamp timeStamp;
+					ImageMetadata metadata;
+					const ErrorType error = Detail::RetrieveBufferWithInfo( m_pCamera, pImage, &timeStamp, &metadata );
+					const Clock::time_point grabTime = Clock::now();
+					if ( error != PGRERROR_OK )
+					{
+						if ( error != PGRERROR_TIMEOUT )
+						{
+							{
+								std::lock_guard<std::mutex> lock( m_pendingMutex );
+								m_stats.numGrabErrors++;
+							}
+							std::this_thread::sleep_for( std::chrono::milliseconds( 10 ) );
+						}
+						continue;
+					}
+
+					FrameTag tag;
+					tag.sequence = sequence++;
+					tag.grabTime = grabTime;
+					tag.timeStamp = timeStamp;
+					tag.metadata = metadata;
+					if ( m_observer )
+					{
+						m_observer( *pImage, tag );
+					}
+
+					std::lock_guard<std::mutex> lock( m_pendingMutex );
+					m_stats.numGrabbed++;
+					if ( m_hasPending )
+					{
+						m_stats.numDroppedBeforeConvert++;
+					}
+					std::swap( pImage, m_pPendingRaw );
+					m_pendingTag = tag;
+					m_hasPending = true;
+					m_pendingCondition.notify_one();
+				}
+				delete pImage;
+			}
+
+			void ConvertLoop()
+			{
+				Image* pRaw = new Image();
+				Image* pConverted = new Image();
+				for (;;)
+				{
+					FrameTag tag;
+					{
+						std::unique_lock<std::mutex> lock( m_pendingMutex );
+						m_pendingCondition.wait( lock, [this] { return m_hasPending || !m_running; } );
+						if ( !m_running )
+						{
+							break;
+						}
+						std::swap( pRaw, m_pPendingRaw );
+						tag = m_pendingTag;
+						m_hasPending = false;
+					}
+
+					const ErrorType error = m_convert( *pRaw, pConverted );
+					{
+						std::lock_guard<std::mutex> lock( m_pendingMutex );
+						if ( error != PGRERROR_OK )
+						{
+							m_stats.numConvertErrors++;
+							continue;
+						}
+						if ( !ReserveConverted( pConverted->GetDataSize() ) )
+						{
+							m_stats.numConvertErrors++;
+							pConverted->ReleaseBuffer();
+							continue;
+						}
+						m_stats.numConverted++;
+					}
+					m_display.Publish( &pConverted, tag );
+				}
+				delete pRaw;
+				delete pConverted;
+			}
+
+			// Grow the budget reservation to cover every converted frame at
+			// the largest size seen. Called with the pending mutex held.
+			bool ReserveConverted( unsigned long long frameBytes )
+			{
+				if ( m_pBudget == NULL )
+				{
+					return true;
+				}
+
+				const unsigned long long largestFrameBytes = std::max( m_largestFrameBytes, frameBytes );
+				const unsigned long long bytes = ( m_numConverters + 2ULL ) * largestFrameBytes;
+				if ( bytes > m_reservedBytes )
+				{
+					if ( m_pBudget->Reserve( this, MEMORY_CONVERSION, bytes ) != PGRERROR_OK )
+					{
+						return false;
+					}
+					m_reservedBytes = bytes;
+				}
+				m_largestFrameBytes = largestFrameBytes;
+				return true;
+			}
+
+			ViewerPipeline( const ViewerPipeline& );
+			ViewerPipeline& operator=( const ViewerPipeline& );
+
+			CameraT*                    m_pCamera;
+			MemoryBudget* const         m_pBudget;
+			unsigned int                m_numConverters;
+			ConvertFunction             m_convert;
+			FrameObserver               m_observer;
+			std::vector<std::thread>    m_threads;
+			std::atomic<bool>           m_running;
+
+			mutable std::mutex          m_pendingMutex;
+			std::condition_variable     m_pendingCondition;
+			Image*                      m_pPendingRaw;
+			FrameTag                    m_pendingTag;
+			bool                        m_hasPending;
+			unsigned long long          m_largestFrameBytes;
+			unsigned long long          m_reservedBytes;
+			ViewerPipelineStats         m_stats;
+
+			LatestFrameSlot             m_display;
+			std::mutex                  m_displayMutex;
+			Image*                      m_pFront;
+			Clock::duration             m_displayPeriod;
+			Clock::time_point           m_nextDisplayTime;
+			std::atomic<unsigned long long> m_numDisplayed;
+	};
+}
+
+#endif // FLIR_FC2_VIEWERPIPELINE_H
@@ -0,0 +1,1404 @@
+//=============================================================================
+// Copyright (c) 2001-2018 FLIR Systems, Inc. All Rights Reserved.
+//
+// This software is the confidential and proprietary information of FLIR
+// Integrated Imaging Solutions, Inc. ("Confidential Information"). You
+// shall not disclose such Confidential Information and shall use it only in
+// accordance with the terms of the license agreement you entered into
+// with FLIR Integrated Imaging Solutions, Inc. (FLIR).
+//
+// FLIR MAKES NO REPRESENTATIONS OR WARRANTIES ABOUT THE SUITABILITY OF THE
+// SOFTWARE, EITHER EXPRESSED OR IMPLIED, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+// PURPOSE, OR NON-INFRINGEMENT. FLIR SHALL NOT BE LIABLE FOR ANY DAMAGES
+// SUFFERED BY LICENSEE AS A RESULT OF USING, MODIFYING OR DISTRIBUTING
+// THIS SOFTWARE OR ITS DERIVATIVES.
+//=============================================================================
+
+#ifndef FLIR_FC2_VIRTUALCAMERA_H
+#define FLIR_FC2_VIRTUALCAMERA_H
+
+#include "FlyCapture2Platform.h"
+#include "FlyCapture2Defs.h"
+#include "Error.h"
+#include "Image.h"
+#include "CameraBase.h"
+
+#if !defined(_MSC_VER) && __cplusplus < 201103L
+#error "VirtualCamera.h requires C++11"
+#endif
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+#include <stdio.h>
+#include <string.h>
+
+namespace FlyCapture2
+{
+	/** Per-frame information delivered alongside a virtual camera image. */
+	struct VirtualFrameInfo
+	{
+		/** Index of the frame since StartCapture(), including dropped frames. */
+		unsigned long long frameId;
+		/** Host time at which the frame was produced. */
+		TimeStamp timeStamp;
+		/** Metadata of the frame, as it would be embedded by a camera. */
+		ImageMetadata metadata;
+		/** Host monotonic time at which the frame was completed. */
+		std::chrono::steady_clock::time_point completionTime;
+		/**
+		 * Host monotonic time of the software trigger that produced the
+		 * frame. Equal to completionTime for free running frames.
+		 */
+		std::chrono::steady_clock::time_point triggerTime;
+
+		VirtualFrameInfo()
+		{
+			frameId = 0;
+		}
+	};
+
+	/**
+	 * Function called for each frame produced by a virtual camera started
+	 * with VirtualCamera::StartCaptureWithFrameInfo().
+	 *
+	 * @param pImage The frame, only valid for the duration of the call.
+	 * @param pInfo Time stamp, metadata and timing of the frame.
+	 * @param pCallbackData The pointer passed when capture was started.
+	 */
+	typedef void (*VirtualFrameCallback)( Image* pImage, const VirtualFrameInfo* pInfo, const void* pCallbackData );
+
+	/** Geometry of the frames produced by a virtual camera. */
+	struct VirtualFrameFormat
+	{
+		/** Rows in each frame. */
+		unsigned int rows;
+		/** Columns in each frame. */
+		unsigned int cols;
+		/** Number of bytes between rows. */
+		unsigned int stride;
+		/** Pixel format of each frame. */
+		PixelFormat pixelFormat;
+		/** Bayer tile format of each frame. */
+		BayerTileFormat bayerFormat;
+
+		VirtualFrameFormat()
+		{
+			rows = 0;
+			cols = 0;
+			stride = 0;
+			pixelFormat = UNSPECIFIED_PIXEL_FORMAT;
+			bayerFormat = NONE;
+		}
+	};
+
+	/**
+	 * The VirtualCamera class is the common base of cameras that produce
+	 * frames in software, such as SimulatedCamera and ReplayCamera. It
+	 * implements the acquisition side of the CameraBase interface: capture
+	 * start and stop, the DROP_FRAMES and BUFFER_FRAMES grab modes with
+	 * FC2Config buffering and timeouts, image event callbacks, software
+	 * triggering, the FRAME_RATE, SHUTTER and GAIN properties, and
+	 * CameraStats drop counters. Derived classes only provide frame data.
+	 *
+	 * Method names and semantics follow CameraBase so that templated
+	 * acquisition code can run against real and virtual cameras alike.
+	 * Methods return the ErrorType of the failure rather than an Error.
+	 *
+	 * Image provides no way to set a time stamp or metadata, so the
+	 * Images a virtual camera delivers report an empty TimeStamp and
+	 * ImageMetadata. The time stamp, metadata and timing of each frame
+	 * are delivered out of band in a VirtualFrameInfo, by RetrieveBuffer()
+	 * and by callbacks registered with StartCaptureWithFrameInfo(). Code
+	 * that needs them for any camera type can use
+	 * Detail::RetrieveBufferWithInfo().
+	 *
+	 * Derived classes must call StopCapture() from their destructor.
+	 */
+	class VirtualCamera
+	{
+		public:
+
+			typedef std::chrono::steady_clock Clock;
+
+			/** Trigger source that selects software triggering. */
+			static const unsigned int sk_softwareTriggerSource = 7;
+
+			/** Name of the exposure end event generated by the camera. */
+			static constexpr const char* sk_exposureEndEventName = "EventExposureEnd";
+
+			/** EventID reported with the exposure end event. */
+			static const unsigned long long sk_exposureEndEventId = 0x9040;
+
+			virtual ~VirtualCamera() {}
+
+			/**
+			 * Connect to the virtual device. The guid is ignored.
+			 *
+			 * @return PGRERROR_OK.
+			 */
+			ErrorType Connect( PGRGuid* /*pGuid*/ = NULL )
+			{
+				std::lock_guard<std::mutex> lock( m_mutex );
+				m_connected = true;
+				m_connectTime = Clock::now();
+				return PGRERROR_OK;
+			}
+
+			/**
+			 * Disconnect from the virtual device, stopping capture first.
+			 *
+			 * @return PGRERROR_OK.
+			 */
+			ErrorType Disconnect()
+			{
+				StopCapture();
+				std::lock_guard<std::mutex> lock( m_mutex );
+				m_connected = false;
+				return PGRERROR_OK;
+			}
+
+			/**
+			 * Check if the virtual device is connected.
+			 *
+			 * @return true if connected.
+			 */
+			bool IsConnected()
+			{
+				std::lock_guard<std::mutex> lock( m_mutex );
+				return m_connected;
+			}
+
+			/**
+			 * Start producing frames. If a callback is specified, every frame
+			 * is passed to it on the producer thread and RetrieveBuffer() is
+			 * not used. The Image passed to the callback is only valid for
+			 * the duration of the call, and carries no time stamp or
+			 * metadata; use StartCaptureWithFrameInfo() to receive them.
+			 *
+			 * @param callbackFn A function to be called when a new image is
+			 *                   produced.
+			 * @param pCallbackData A pointer to data passed to the callback.
+			 *
+			 * @return PGRERROR_OK, PGRERROR_NOT_CONNECTED,
+			 *         PGRERROR_ISOCH_ALREADY_STARTED or the error reported by
+			 *         the frame source.
+			 */
+			ErrorType StartCapture(
+					ImageEventCallback callbackFn = NULL,
+					const void*        pCallbackData = NULL )
+			{
+				return StartProducer( callbackFn, NULL, pCallbackData );
+			}
+
+			/**
+			 * Start producing frames, passing every frame and its
+			 * VirtualFrameInfo to a callback on the producer thread.
+			 * RetrieveBuffer() is not used. The Image and the information
+			 * are only valid for the duration of the call.
+			 *
+			 * @param callbackFn A function to be called when a new image is
+			 *                   produced.
+			 * @param pCallbackData A pointer to data passed to the callback.
+			 *
+			 * @return PGRERROR_OK, PGRERROR_INVALID_PARAMETER,
+			 *         PGRERROR_NOT_CONNECTED, PGRERROR_ISOCH_ALREADY_STARTED
+			 *         or the error reported by the frame source.
+			 */
+			ErrorType StartCaptureWithFrameInfo(
+					VirtualFrameCallback callbackFn,
+					const void*          pCallbackData = NULL )
+			{
+				if ( callbackFn == NULL )
+				{
+					return PGRERROR_INVALID_PARAMETER;
+				}
+				return StartProducer( NULL, callbackFn, pCallbackData );
+			}
+
+			/**
+			 * Stop producing frames. Frames that have not been retrieved are
+			 * discarded.
+			 *
+			 * @return PGRERROR_OK, or PGRERROR_ISOCH_NOT_STARTED if capture
+			 *         was not running.
+			 */
+			ErrorType StopCapture()
+			{
+				std::unique_lock<std::mutex> lock( m_mutex );
+				if ( !m_capturing )
+				{
+					return PGRERROR_ISOCH_NOT_STARTED;
+				}
+
+				m_stopRequested = true;
+				m_producerCondition.notify_all();
+				m_consumerCondition.notify_all();
+				lock.unlock();
+
+				if ( m_producer.joinable() )
+				{
+					m_producer.join();
+				}
+
+				lock.lock();
+				m_consumerCondition.wait( lock, [this] { return m_activeReaders == 0; } );
+				m_capturing = false;
+				m_ready.clear();
+				return PGRERROR_OK;
+			}
+
+			/**
+			 * Retrieve the next image, honouring the grab mode and grab
+			 * timeout of the configuration. The image data is copied into
+			 * pImage, so the frame buffer is returned to the virtual camera
+			 * immediately.
+			 *
+			 * @param pImage Pointer to the Image to store the data in.
+			 * @param pInfo Optional pointer to receive the frame information.
+			 *
+			 * @return PGRERROR_OK, PGRERROR_ISOCH_NOT_STARTED,
+			 *         PGRERROR_TIMEOUT, or the error returned by the copy.
+			 */
+			ErrorType RetrieveBuffer( Image* pImage, VirtualFrameInfo* pInfo = NULL )
+			{
+				if ( pImage == NULL )
+				{
+					return PGRERROR_INVALID_PARAMETER;
+				}
+
+				std::unique_lock<std::mutex> lock( m_mutex );
+				if ( !m_capturing || HasCallback() )
+				{
+					return PGRERROR_ISOCH_NOT_STARTED;
+				}
+
+				auto hasFrame = [this] { return !m_ready.empty() || m_stopRequested || m_endOfStream; };
+				if ( m_config.grabTimeout == TIMEOUT_INFINITE )
+				{
+					m_consumerCondition.wait( lock, hasFrame );
+				}
+				else if ( !m_consumerCondition.wait_for(
+							  lock,
+							  std::chrono::milliseconds( m_config.grabTimeout > 0 ? m_config.grabTimeout : 0 ),
+							  hasFrame ) )
+				{
+					return PGRERROR_TIMEOUT;
+				}
+
+				if ( m_ready.empty() )
+				{
+					return m_stopRequested ? PGRERROR_ISOCH_NOT_STARTED : PGRERROR_TIMEOUT;
+				}
+
+				size_t index;
+				if ( m_config.grabMode == BUFFER_FRAMES )
+				{
+					index = m_ready.front();
+					m_ready.pop_front();
+				}
+				else
+				{
+					index = m_ready.back();
+					m_ready.pop_back();
+					while ( !m_ready.empty() )
+					{
+						m_slots[ m_ready.front() ].state = SLOT_FREE;
+						m_ready.pop_front();
+						m_stats.imageDropped++;
+					}
+				}
+
+				Slot& slot = m_slots[index];
+				slot.state = SLOT_READING;
+				m_activeReaders++;
+				lock.unlock();
+
+				Image frame(
+						m_format.rows,
+						m_format.cols,
+						m_format.stride,
+						&slot.data[0],
+						static_cast<unsigned int>( slot.data.size() ),
+						m_format.pixelFormat,
+						m_format.bayerFormat );
+				Error error = pImage->DeepCopy( &frame );
+				if ( pInfo != NULL )
+				{
+					*pInfo = slot.info;
+				}
+
+				lock.lock();
+				slot.state = SLOT_FREE;
+				m_activeReaders--;
+				m_producerCondition.notify_all();
+				m_consumerCondition.notify_all();
+				return error.GetType();
+			}
+
+			/**
+			 * Get the current configuration.
+			 *
+			 * @param pConfig Pointer to the configuration structure to fill.
+			 *
+			 * @return PGRERROR_OK.
+			 */
+			ErrorType GetConfiguration( FC2Config* pConfig )
+			{
+				std::lock_guard<std::mutex> lock( m_mutex );
+				*pConfig = m_config;
+				return PGRERROR_OK;
+			}
+
+			/**
+			 * Set the configuration. Unspecified fields are left unchanged.
+			 * The number of buffers can only be changed while capture is
+			 * stopped.
+			 *
+			 * @param pConfig Pointer to the configuration structure to use.
+			 *
+			 * @return PGRERROR_OK, or PGRERROR_ISOCH_ALREADY_STARTED if the
+			 *         number of buffers is changed during capture.
+			 */
+			ErrorType SetConfiguration( const FC2Config* pConfig )
+			{
+				std::lock_guard<std::mutex> lock( m_mutex );
+				if ( m_capturing && pConfig->numBuffers != 0 && pConfig->numBuffers != m_config.numBuffers )
+				{
+					return PGRERROR_ISOCH_ALREADY_STARTED;
+				}
+
+				if ( pConfig->numBuffers != 0 )
+				{
+					m_config.numBuffers = pConfig->numBuffers;
+				}
+				if ( pConfig->numImageNotifications != 0 )
+				{
+					m_config.numImageNotifications = pConfig->numImageNotifications;
+				}
+				if ( pConfig->grabTimeout != TIMEOUT_UNSPECIFIED )
+				{
+					m_config.grabTimeout = pConfig->grabTimeout;
+				}
+				if ( pConfig->grabMode != UNSPECIFIED_GRAB_MODE )
+				{
+					m_config.grabMode = pConfig->grabMode;
+				}
+				m_config.highPerformanceRetrieveBuffer = pConfig->highPerformanceRetrieveBuffer;
+				return PGRERROR_OK;
+			}
+
+			/**
+			 * Get information about the virtual device.
+			 *
+			 * @param pCameraInfo Pointer to the camera information structure.
+			 *
+			 * @return PGRERROR_OK or PGRERROR_NOT_CONNECTED.
+			 */
+			ErrorType GetCameraInfo( CameraInfo* pCameraInfo )
+			{
+				std::lock_guard<std::mutex> lock( m_mutex );
+				if ( !m_connected )
+				{
+					return PGRERROR_NOT_CONNECTED;
+				}
+
+				*pCameraInfo = CameraInfo();
+				pCameraInfo->serialNumber = m_serialNumber;
+				pCameraInfo->interfaceType = INTERFACE_UNKNOWN;
+				pCameraInfo->driverType = DRIVER_UNKNOWN;
+				pCameraInfo->maximumBusSpeed = BUSSPEED_S_FASTEST;
+				snprintf( pCameraInfo->vendorName, sk_maxStringLength, "%s", "FLIR" );
+				snprintf( pCameraInfo->modelName, sk_maxStringLength, "%s", m_modelName );
+				snprintf( pCameraInfo->driverName, sk_maxStringLength, "%s", "none" );
+
+				VirtualFrameFormat format;
+				if ( GetFrameFormat( &format ) == PGRERROR_OK )
+				{
+					pCameraInfo->bayerTileFormat = format.bayerFormat;
+					pCameraInfo->isColorCamera = format.bayerFormat != NONE ||
+						( format.pixelFormat != PIXEL_FORMAT_MONO8 &&
+						  format.pixelFormat != PIXEL_FORMAT_MONO12 &&
+						  format.pixelFormat != PIXEL_FORMAT_MONO16 &&
+						  format.pixelFormat != PIXEL_FORMAT_S_MONO16 &&
+						  format.pixelFormat != PIXEL_FORMAT_RAW8 &&
+						  format.pixelFormat != PIXEL_FORMAT_RAW12 &&
+						  format.pixelFormat != PIXEL_FORMAT_RAW16 );
+					snprintf( pCameraInfo->sensorResolution, sk_maxStringLength, "%ux%u", format.cols, format.rows );
+				}
+				return PGRERROR_OK;
+			}
+
+			/**
+			 * Get information about a property. FRAME_RATE, SHUTTER and GAIN
+			 * are present and support absolute values; all other properties
+			 * are reported as not present.
+			 *
+			 * @param pPropInfo Pointer to the PropertyInfo structure to fill.
+			 *
+			 * @return PGRERROR_OK.
+			 */
+			ErrorType GetPropertyInfo( PropertyInfo* pPropInfo )
+			{
+				const PropertyType type = pPropInfo->type;
+				*pPropInfo = PropertyInfo( type );
+
+				const PropertyLimits* pLimits = FindLimits( type );
+				if ( pLimits != NULL )
+				{
+					pPropInfo->present = true;
+					pPropInfo->manualSupported = true;
+					pPropInfo->onOffSupported = type == FRAME_RATE;
+					pPropInfo->absValSupported = true;
+					pPropInfo->readOutSupported = true;
+					pPropInfo->absMin = pLimits->absMin;
+					pPropInfo->absMax = pLimits->absMax;
+					pPropInfo->min = 0;
+					pPropInfo->max = 4095;
+					snprintf( pPropInfo->pUnits, sk_maxStringLength, "%s", pLimits->pUnits );
+					snprintf( pPropInfo->pUnitAbbr, sk_maxStringLength, "%s", pLimits->pUnits );
+				}
+				return PGRERROR_OK;
+			}
+
+			/**
+			 * Read a property.
+			 *
+			 * @param pProp Pointer to the Property structure to fill.
+			 *
+			 * @return PGRERROR_OK or PGRERROR_PROPERTY_NOT_PRESENT.
+			 */
+			ErrorType GetProperty( Property* pProp )
+			{
+				SimulateControlLatency();
+				std::lock_guard<std::mutex> lock( m_mutex );
+				Property* pStored = FindProperty( pProp->type );
+				if ( pStored == NULL )
+				{
+					return PGRERROR_PROPERTY_NOT_PRESENT;
+				}
+
+				*pProp = *pStored;
+				return PGRERROR_OK;
+			}
+
+			/**
+			 * Write a property. Only the absolute value and the on/off flag
+			 * are used. Changes to FRAME_RATE take effect on the next frame.
+			 *
+			 * @param pProp Pointer to the Property structure to use.
+			 * @param broadcast Ignored.
+			 *
+			 * @return PGRERROR_OK, PGRERROR_PROPERTY_NOT_PRESENT or
+			 *         PGRERROR_INVALID_PARAMETER if the value is out of range.
+			 */
+			ErrorType SetProperty( const Property* pProp, bool /*broadcast*/ = false )
+			{
+				const PropertyLimits* pLimits = FindLimits( pProp->type );
+				if ( pLimits == NULL )
+				{
+					return PGRERROR_PROPERTY_NOT_PRESENT;
+				}
+				if ( pProp->absValue < pLimits->absMin || pProp->absValue > pLimits->absMax )
+				{
+					return PGRERROR_INVALID_PARAMETER;
+				}
+
+				SimulateControlLatency();
+				std::lock_guard<std::mutex> lock( m_mutex );
+				Property* pStored = FindProperty( pProp->type );
+				pStored->absValue = pProp->absValue;
+				pStored->onOff = pProp->onOff;
+				m_producerCondition.notify_all();
+				return PGRERROR_OK;
+			}
+
+			/**
+			 * Read from a register block. Virtual devices have no register
+			 * space, so callers fall back to the property interface.
+			 *
+			 * @return PGRERROR_NOT_SUPPORTED.
+			 */
+			ErrorType ReadRegisterBlock(
+					unsigned short /*addressHigh*/,
+					unsigned int   /*addressLow*/,
+					unsigned int*  /*pBuffer*/,
+					unsigned int   /*length*/ )
+			{
+				return PGRERROR_NOT_SUPPORTED;
+			}
+
+			/**
+			 * Get the trigger capabilities. Only software triggering is
+			 * supported.
+			 *
+			 * @param pTriggerModeInfo Structure to receive the trigger
+			 *                         capabilities.
+			 *
+			 * @return PGRERROR_OK.
+			 */
+			ErrorType GetTriggerModeInfo( TriggerModeInfo* pTriggerModeInfo )
+			{
+				*pTriggerModeInfo = TriggerModeInfo();
+				pTriggerModeInfo->present = true;
+				pTriggerModeInfo->readOutSupported = true;
+				pTriggerModeInfo->onOffSupported = true;
+				pTriggerModeInfo->valueReadable = true;
+				pTriggerModeInfo->sourceMask = 1u << ( 7 - sk_softwareTriggerSource );
+				pTriggerModeInfo->softwareTriggerSupported = true;
+				pTriggerModeInfo->modeMask = 1u << 15;
+				return PGRERROR_OK;
+			}
+
+			/**
+			 * Get the current trigger settings.
+			 *
+			 * @param pTriggerMode Structure to receive the trigger settings.
+			 *
+			 * @return PGRERROR_OK.
+			 */
+			ErrorType GetTriggerMode( TriggerMode* pTriggerMode )
+			{
+				std::lock_guard<std::mutex> lock( m_mutex );
+				*pTriggerMode = m_triggerMode;
+				return PGRERROR_OK;
+			}
+
+			/**
+			 * Set the trigger settings. When the trigger is on, a frame is
+			 * only produced for each call to FireSoftwareTrigger(), one
+			 * shutter period after the trigger.
+			 *
+			 * @param pTriggerMode Structure providing the trigger settings.
+			 * @param broadcast Ignored.
+			 *
+			 * @return PGRERROR_OK, or PGRERROR_TRIGGER_FAILED if the trigger
+			 *         is turned on with a source other than software.
+			 */
+			ErrorType SetTriggerMode( const TriggerMode* pTriggerMode, bool /*broadcast*/ = false )
+			{
+				if ( pTriggerMode->onOff && pTriggerMode->source != sk_softwareTriggerSource )
+				{
+					return PGRERROR_TRIGGER_FAILED;
+				}
+
+				std::lock_guard<std::mutex> lock( m_mutex );
+				m_triggerMode = *pTriggerMode;
+				m_pendingTriggers.clear();
+				m_producerCondition.notify_all();
+				return PGRERROR_OK;
+			}
+
+			/**
+			 * Fire a software trigger. Triggers are queued and serviced in
+			 * order, one exposure at a time.
+			 *
+			 * @param broadcast Ignored.
+			 *
+			 * @return PGRERROR_OK, or PGRERROR_TRIGGER_FAILED if the trigger
+			 *         is not on.
+			 */
+			ErrorType FireSoftwareTrigger( bool /*broadcast*/ = false )
+			{
+				SimulateControlLatency();
+				std::lock_guard<std::mutex> lock( m_mutex );
+				if ( !m_triggerMode.onOff )
+				{
+					return PGRERROR_TRIGGER_FAILED;
+				}
+
+				m_pendingTriggers.push_back( Clock::now() );
+				m_producerCondition.notify_all();
+				return PGRERROR_OK;
+			}
+
+			/**
+			 * Get the number of software triggers waiting to be serviced.
+			 *
+			 * @return The number of pending triggers.
+			 */
+			unsigned int GetPendingTriggerCount()
+			{
+				std::lock_guard<std::mutex> lock( m_mutex );
+				return static_cast<unsigned int>( m_pendingTriggers.size() );
+			}
+
+			/**
+			 * Get the embedded image information settings. The timestamp
+			 * and frame counter are available.
+			 *
+			 * @param pInfo Structure to receive the settings.
+			 *
+			 * @return PGRERROR_OK.
+			 */
+			ErrorType GetEmbeddedImageInfo( EmbeddedImageInfo* pInfo )
+			{
+				std::lock_guard<std::mutex> lock( m_mutex );
+				*pInfo = m_embeddedInfo;
+				return PGRERROR_OK;
+			}
+
+			/**
+			 * Set the embedded image information settings. Only the
+			 * timestamp and frame counter can be turned on.
+			 *
+			 * @param pInfo Structure providing the settings.
+			 *
+			 * @return PGRERROR_OK.
+			 */
+			ErrorType SetEmbeddedImageInfo( EmbeddedImageInfo* pInfo )
+			{
+				std::lock_guard<std::mutex> lock( m_mutex );
+				m_embeddedInfo.timestamp.onOff = pInfo->timestamp.onOff;
+				m_embeddedInfo.frameCounter.onOff = pInfo->frameCounter.onOff;
+				return PGRERROR_OK;
+			}
+
+			/**
+			 * Register a callback for a device event. Only the exposure end
+			 * event, named by sk_exposureEndEventName, is generated. Its
+			 * EventTimestamp is the device time in nanoseconds and its
+			 * EventData points to the frame index as an unsigned long long.
+			 * The callback is called from the acquisition thread and delays
+			 * the frame until it returns.
+			 *
+			 * @param pOpts The callback, event name and user data.
+			 *
+			 * @return PGRERROR_OK; PGRERROR_NOT_FOUND for an unknown event;
+			 *         or PGRERROR_FAILED if all events are registered.
+			 */
+			ErrorType RegisterEvent( EventOptions* pOpts )
+			{
+				if ( pOpts->EventName == NULL || strcmp( pOpts->EventName, sk_exposureEndEventName ) != 0 )
+				{
+					return PGRERROR_NOT_FOUND;
+				}
+
+				std::lock_guard<std::mutex> lock( m_mutex );
+				if ( m_allEventsRegistered )
+				{
+					return PGRERROR_FAILED;
+				}
+
+				m_exposureEndEvent = *pOpts;
+				m_exposureEndEvent.EventName = sk_exposureEndEventName;
+				return PGRERROR_OK;
+			}
+
+			/**
+			 * Deregister a device event.
+			 *
+			 * @param pOpts The name of the event.
+			 *
+			 * @return PGRERROR_OK, or PGRERROR_NOT_FOUND for an unknown event.
+			 */
+			ErrorType DeregisterEvent( EventOptions* pOpts )
+			{
+				if ( pOpts->EventName == NULL || strcmp( pOpts->EventName, sk_exposureEndEventName ) != 0 )
+				{
+					return PGRERROR_NOT_FOUND;
+				}
+
+				std::lock_guard<std::mutex> lock( m_mutex );
+				m_exposureEndEvent.EventCallbackFcn = NULL;
+				m_allEventsRegistered = false;
+				return PGRERROR_OK;
+			}
+
+			/**
+			 * Register a callback for every device event.
+			 *
+			 * @param pOpts The callback and user data.
+			 *
+			 * @return PGRERROR_OK, or PGRERROR_FAILED if an event is
+			 *         already registered individually.
+			 */
+			ErrorType RegisterAllEvents( EventOptions* pOpts )
+			{
+				std::lock_guard<std::mutex> lock( m_mutex );
+				if ( m_exposureEndEvent.EventCallbackFcn != NULL && !m_allEventsRegistered )
+				{
+					return PGRERROR_FAILED;
+				}
+
+				m_exposureEndEvent = *pOpts;
+				m_exposureEndEvent.EventName = sk_exposureEndEventName;
+				m_allEventsRegistered = true;
+				return PGRERROR_OK;
+			}
+
+			/**
+			 * Deregister every device event.
+			 *
+			 * @return PGRERROR_OK.
+			 */
+			ErrorType DeregisterAllEvents()
+			{
+				std::lock_guard<std::mutex> lock( m_mutex );
+				m_exposureEndEvent.EventCallbackFcn = NULL;
+				m_allEventsRegistered = false;
+				return PGRERROR_OK;
+			}
+
+			/**
+			 * Get the acquisition statistics. imageDropped counts frames
+			 * discarded by the grab mode, imageXmitFailed counts frames lost
+			 * to injected drops.
+			 *
+			 * @param pStats Structure to receive the statistics.
+			 *
+			 * @return PGRERROR_OK.
+			 */
+			ErrorType GetStats( CameraStats* pStats )
+			{
+				std::lock_guard<std::mutex> lock( m_mutex );
+				*pStats = m_stats;
+				pStats->cameraPowerUp = m_connected;
+				pStats->timeSinceInitialization = m_connected ? static_cast<unsigned int>(
+					std::chrono::duration_cast<std::chrono::seconds>( Clock::now() - m_connectTime ).count() ) : 0;
+				return PGRERROR_OK;
+			}
+
+			/**
+			 * Reset the acquisition statistics.
+			 *
+			 * @return PGRERROR_OK.
+			 */
+			ErrorType ResetStats()
+			{
+				std::lock_guard<std::mutex> lock( m_mutex );
+				m_stats = CameraStats();
+				return PGRERROR_OK;
+			}
+
+			/**
+			 * Inject frame drops. A frame is dropped when either condition
+			 * is met. Dropped frames still advance the frame counter.
+			 *
+			 * @param probability Probability in [0, 1] of dropping each frame.
+			 * @param interval Drop every interval-th frame, or 0 to disable.
+			 */
+			void SetDropInjection( double probability, unsigned int interval )
+			{
+				std::lock_guard<std::mutex> lock( m_mutex );
+				m_dropProbability = probability;
+				m_dropInterval = interval;
+			}
+
+			/**
+			 * Emulate the latency of register access on a real bus. Property
+			 * reads and writes and software triggers take the specified time
+			 * to complete, and a software trigger takes effect at the end of
+			 * it. Calls from different threads overlap, as they would on
+			 * separate cameras.
+			 *
+			 * @param latency The latency of each access.
+			 */
+			void SetControlLatency( std::chrono::microseconds latency )
+			{
+				m_controlLatencyUs = latency.count();
+			}
+
+		protected:
+
+			VirtualCamera( unsigned int serialNumber, const char* pModelName )
+				: m_connected( false ),
+				  m_capturing( false ),
+				  m_stopRequested( false ),
+				  m_endOfStream( false ),
+				  m_activeReaders( 0 ),
+				  m_callbackFn( NULL ),
+				  m_frameCallbackFn( NULL ),
+				  m_pCallbackData( NULL ),
+				  m_allEventsRegistered( false ),
+				  m_deviceEpoch( Clock::now() ),
+				  m_frameIndex( 0 ),
+				  m_serialNumber( serialNumber ),
+				  m_dropProbability( 0.0 ),
+				  m_dropInterval( 0 ),
+				  m_random( serialNumber * 2654435761u + 1 ),
+				  m_controlLatencyUs( 0 )
+			{
+				snprintf( m_modelName, sizeof(m_modelName), "%s", pModelName );
+
+				m_config.numBuffers = 10;
+				m_config.numImageNotifications = 1;
+				m_config.minNumImageNotifications = 1;
+				m_config.grabTimeout = TIMEOUT_INFINITE;
+				m_config.grabMode = DROP_FRAMES;
+
+				m_frameRate = Property( FRAME_RATE );
+				m_frameRate.present = true;
+				m_frameRate.absControl = true;
+				m_frameRate.onOff = true;
+				m_frameRate.absValue = 30.0f;
+
+				m_shutter = Property( SHUTTER );
+				m_shutter.present = true;
+				m_shutter.absControl = true;
+				m_shutter.onOff = true;
+				m_shutter.absValue = 1.0f;
+
+				m_gain = Property( GAIN );
+				m_gain.present = true;
+				m_gain.absControl = true;
+				m_gain.onOff = true;
+				m_gain.absValue = 0.0f;
+
+				m_embeddedInfo.timestamp.available = true;
+				m_embeddedInfo.frameCounter.available = true;
+
+				memset( &m_exposureEndEvent, 0, sizeof(m_exposureEndEvent) );
+			}
+
+			/**
+			 * Describe the frames the camera produces. Called when capture
+			 * starts and when camera information is queried. The mutex of
+			 * the camera is held during the call.
+			 *
+			 * @param pFormat Structure to receive the frame format.
+			 *
+			 * @return PGRERROR_OK, or an error that prevents capture.
+			 */
+			virtual ErrorType GetFrameFormat( VirtualFrameFormat* pFormat ) = 0;
+
+			/**
+			 * Prepare to produce frames of the specified format. Called when
+			 * capture starts, with the mutex held.
+			 *
+			 * @param format The format returned by GetFrameFormat().
+			 *
+			 * @return PGRERROR_OK, or an error that prevents capture.
+			 */
+			virtual ErrorType OnStartCapture( const VirtualFrameFormat& /*format*/ )
+			{
+				return PGRERROR_OK;
+			}
+
+			/**
+			 * Fill a frame. Called on the producer thread without the mutex
+			 * held. The frame information is pre-filled with host timing and
+			 * the frame ID and may be overwritten.
+			 *
+			 * @param frameIndex Index of the frame since capture started.
+			 * @param pData Buffer of rows * stride bytes to fill.
+			 * @param pInfo Frame information to complete.
+			 *
+			 * @return false when the source has no more frames.
+			 */
+			virtual bool ProduceFrame(
+					unsigned long long frameIndex,
+					unsigned char*     pData,
+					VirtualFrameInfo*  pInfo ) = 0;
+
+			/**
+			 * Get the time between the previous frame and the specified
+			 * free running frame. The default follows the FRAME_RATE
+			 * property, or runs as fast as possible when it is off. Called
+			 * with the mutex held.
+			 *
+			 * @param frameIndex Index of the frame since capture started.
+			 *
+			 * @return The frame interval.
+			 */
+			virtual Clock::duration GetFrameInterval( unsigned long long /*frameIndex*/ )
+			{
+				if ( !m_frameRate.onOff || m_frameRate.absValue <= 0.0f )
+				{
+					return Clock::duration::zero();
+				}
+				return std::chrono::duration_cast<Clock::duration>(
+						std::chrono::duration<double>( 1.0 / m_frameRate.absValue ) );
+			}
+
+			/**
+			 * Check if the producer should wait for a free buffer instead of
+			 * dropping frames in BUFFER_FRAMES mode, so that every frame is
+			 * delivered. Called with the mutex held.
+			 *
+			 * @return true to never drop frames for lack of buffers.
+			 */
+			virtual bool IsLossless() const
+			{
+				return false;
+			}
+
+			/**
+			 * Check if capture is running. Called with the mutex held.
+			 *
+			 * @return true if capture is running.
+			 */
+			bool IsCapturing() const { return m_capturing; }
+
+			/**
+			 * Get the current SHUTTER value. Called with the mutex held.
+			 *
+			 * @return The shutter time in milliseconds.
+			 */
+			float GetShutterMs() const { return m_shutter.absValue; }
+
+			/**
+			 * Get the current GAIN value. Called with the mutex held.
+			 *
+			 * @return The gain in dB.
+			 */
+			float GetGainDb() const { return m_gain.absValue; }
+
+			/**
+			 * Get the embedded image information settings as of the start of
+			 * the current frame.
+			 *
+			 * @return The embedded image information settings.
+			 */
+			const EmbeddedImageInfo& GetFrameEmbeddedInfo() const { return m_frameEmbeddedInfo; }
+
+			/** Mutex guarding the state of the camera. */
+			std::mutex m_mutex;
+
+		private:
+
+			enum SlotState
+			{
+				SLOT_FREE,
+				SLOT_WRITING,
+				SLOT_READY,
+				SLOT_READING
+			};
+
+			struct Slot
+			{
+				std::vector<unsigned char> data;
+				VirtualFrameInfo info;
+				SlotState state;
+			};
+
+			struct PropertyLimits
+			{
+				PropertyType type;
+				float absMin;
+				float absMax;
+				const char* pUnits;
+			};
+
+			static const PropertyLimits* FindLimits( PropertyType type )
+			{
+				static const PropertyLimits sk_limits[] =
+				{
+					{ FRAME_RATE, 0.1f, 100000.0f, "fps" },
+					{ SHUTTER, 0.001f, 10000.0f, "ms" },
+					{ GAIN, 0.0f, 48.0f, "dB" },
+				};
+
+				for ( size_t i = 0; i < sizeof(sk_limits) / sizeof(sk_limits[0]); i++ )
+				{
+					if ( sk_limits[i].type == type )
+					{
+						return &sk_limits[i];
+					}
+				}
+				return NULL;
+			}
+
+			Property* FindProperty( PropertyType type )
+			{
+				switch ( type )
+				{
+					case FRAME_RATE: return &m_frameRate;
+					case SHUTTER: return &m_shutter;
+					case GAIN: return &m_gain;
+					default: return NULL;
+				}
+			}
+
+			bool ShouldDrop( unsigned long long frameIndex )
+			{
+				if ( m_dropInterval != 0 && ( frameIndex + 1 ) % m_dropInterval == 0 )
+				{
+					return true;
+				}
+
+				// xorshift32
+				m_random ^= m_random << 13;
+				m_random ^= m_random >> 17;
+				m_random ^= m_random << 5;
+				return m_dropProbability > 0.0 &&
+					( m_random / 4294967296.0 ) < m_dropProbability;
+			}
+
+			void SimulateControlLatency() const
+			{
+				const long long latencyUs = m_controlLatencyUs;
+				if ( latencyUs > 0 )
+				{
+					std::this_thread::sleep_for( std::chrono::microseconds( latencyUs ) );
+				}
+			}
+
+			bool HasFreeSlot() const
+			{
+				for ( size_t i = 0; i < m_slots.size(); i++ )
+				{
+					if ( m_slots[i].state == SLOT_FREE )
+					{
+						return true;
+					}
+				}
+				return false;
+			}
+
+			// Find a buffer for a new frame. In BUFFER_FRAMES mode a full
+			// queue drops the new frame; in DROP_FRAMES mode it drops the
+			// oldest unretrieved frame.
+			Slot* AcquireSlot()
+			{
+				for ( size_t i = 0; i < m_slots.size(); i++ )
+				{
+					if ( m_slots[i].state == SLOT_FREE )
+					{
+						return &m_slots[i];
+					}
+				}
+
+				if ( m_config.grabMode != BUFFER_FRAMES && !m_ready.empty() )
+				{
+					Slot* pSlot = &m_slots[ m_ready.front() ];
+					m_ready.pop_front();
+					m_stats.imageDropped++;
+					return pSlot;
+				}
+
+				m_stats.imageDropped++;
+				return NULL;
+			}
+
+			static TimeStamp MakeTimeStamp()
+			{
+				const std::chrono::microseconds sinceEpoch =
+					std::chrono::duration_cast<std::chrono::microseconds>(
+						std::chrono::system_clock::now().time_since_epoch() );
+				const long long micro = sinceEpoch.count();
+
+				// 1394 style cycle time: 8000 cycles per second, 3072 ticks
+				// per cycle, seconds wrapping at 128.
+				TimeStamp timeStamp;
+				timeStamp.seconds = micro / 1000000;
+				timeStamp.microSeconds = static_cast<unsigned int>( micro % 1000000 );
+				timeStamp.cycleSeconds = static_cast<unsigned int>( timeStamp.seconds % 128 );
+				timeStamp.cycleCount = timeStamp.microSeconds / 125;
+				timeStamp.cycleOffset = ( timeStamp.microSeconds % 125 ) * 3072 / 125;
+				return timeStamp;
+			}
+
+			void FireEvent( const EventOptions& options, unsigned long long frameIndex )
+			{
+				unsigned long long eventData = frameIndex;
+				EventCallbackData data;
+				data.EventUserData = const_cast<void*>( options.EventUserData );
+				data.EventUserDataSize = options.EventUserDataSize;
+				data.EventName = options.EventName;
+				data.EventID = sk_exposureEndEventId;
+				data.EventTimestamp = static_cast<unsigned long long>(
+					std::chrono::duration_cast<std::chrono::nanoseconds>( Clock::now() - m_deviceEpoch ).count() );
+				data.EventData = &eventData;
+				data.EventDataSize = sizeof(eventData);
+				options.EventCallbackFcn( &data );
+			}
+
+			ErrorType StartProducer(
+					ImageEventCallback   callbackFn,
+					VirtualFrameCallback frameCallbackFn,
+					const void*          pCallbackData )
+			{
+				std::unique_lock<std::mutex> lock( m_mutex );
+				if ( !m_connected )
+				{
+					return PGRERROR_NOT_CONNECTED;
+				}
+				if ( m_capturing )
+				{
+					return PGRERROR_ISOCH_ALREADY_STARTED;
+				}
+
+				ErrorType result = GetFrameFormat( &m_format );
+				if ( result == PGRERROR_OK )
+				{
+					result = OnStartCapture( m_format );
+				}
+				if ( result != PGRERROR_OK )
+				{
+					return result;
+				}
+
+				const unsigned int numBuffers = m_config.numBuffers > 0 ? m_config.numBuffers : 1;
+				const size_t frameSize = static_cast<size_t>( m_format.rows ) * m_format.stride;
+				m_slots.resize( numBuffers );
+				for ( size_t i = 0; i < m_slots.size(); i++ )
+				{
+					m_slots[i].data.resize( frameSize );
+					m_slots[i].state = SLOT_FREE;
+				}
+				m_ready.clear();
+
+				m_callbackFn = callbackFn;
+				m_frameCallbackFn = frameCallbackFn;
+				m_pCallbackData = pCallbackData;
+				m_pendingTriggers.clear();
+				m_frameIndex = 0;
+				m_capturing = true;
+				m_stopRequested = false;
+				m_endOfStream = false;
+				m_producer = std::thread( &VirtualCamera::ProducerLoop, this );
+				return PGRERROR_OK;
+			}
+
+			// Callers hold m_mutex.
+			bool HasCallback() const
+			{
+				return m_callbackFn != NULL || m_frameCallbackFn != NULL;
+			}
+
+			void ProducerLoop()
+			{
+				std::unique_lock<std::mutex> lock( m_mutex );
+				Clock::time_point nextFrame = Clock::now();
+
+				while ( !m_stopRequested && !m_endOfStream )
+				{
+					Clock::time_point triggerTime;
+					if ( m_triggerMode.onOff )
+					{
+						m_producerCondition.wait( lock, [this] {
+							return m_stopRequested || !m_triggerMode.onOff || !m_pendingTriggers.empty(); } );
+						if ( m_stopRequested || !m_triggerMode.onOff )
+						{
+							nextFrame = Clock::now();
+							continue;
+						}
+
+						triggerTime = m_pendingTriggers.front();
+						m_pendingTriggers.pop_front();
+						const Clock::time_point exposureEnd = Clock::now() +
+							std::chrono::duration_cast<Clock::duration>(
+								std::chrono::duration<double, std::milli>( m_shutter.absValue ) );
+						m_producerCondition.wait_until( lock, exposureEnd, [this] { return m_stopRequested; } );
+						if ( m_stopRequested )
+						{
+							break;
+						}
+					}
+					else
+					{
+						nextFrame += GetFrameInterval( m_frameIndex );
+						if ( m_producerCondition.wait_until( lock, nextFrame, [this] {
+								return m_stopRequested || m_triggerMode.onOff; } ) )
+						{
+							continue;
+						}
+
+						// Do not try to catch up on frames missed while the
+						// consumer or the host was stalled.
+						const Clock::time_point now = Clock::now();
+						if ( now > nextFrame + std::chrono::milliseconds( 100 ) )
+						{
+							nextFrame = now;
+						}
+						triggerTime = now;
+					}
+
+					const unsigned long long frameIndex = m_frameIndex++;
+					if ( m_exposureEndEvent.EventCallbackFcn != NULL )
+					{
+						const EventOptions options = m_exposureEndEvent;
+						lock.unlock();
+						FireEvent( options, frameIndex );
+						lock.lock();
+						if ( m_stopRequested )
+						{
+							break;
+						}
+					}
+
+					if ( ShouldDrop( frameIndex ) )
+					{
+						m_stats.imageXmitFailed++;
+						continue;
+					}
+
+					if ( m_config.grabMode == BUFFER_FRAMES && IsLossless() )
+					{
+						m_producerCondition.wait( lock, [this] { return m_stopRequested || HasFreeSlot(); } );
+						if ( m_stopRequested )
+						{
+							break;
+						}
+					}
+
+					Slot* pSlot = AcquireSlot();
+					if ( pSlot == NULL )
+					{
+						continue;
+					}
+
+					pSlot->state = SLOT_WRITING;
+					m_frameEmbeddedInfo = m_embeddedInfo;
+					lock.unlock();
+
+					VirtualFrameInfo info;
+					info.frameId = frameIndex;
+					info.triggerTime = triggerTime;
+					info.timeStamp = MakeTimeStamp();
+					const bool produced = ProduceFrame( frameIndex, &pSlot->data[0], &info );
+					info.completionTime = Clock::now();
+					pSlot->info = info;
+
+					if ( produced && HasCallback() )
+					{
+						Image frame(
+								m_format.rows,
+								m_format.cols,
+								m_format.stride,
+								&pSlot->data[0],
+								static_cast<unsigned int>( pSlot->data.size() ),
+								m_format.pixelFormat,
+								m_format.bayerFormat );
+						if ( m_frameCallbackFn != NULL )
+						{
+							m_frameCallbackFn( &frame, &info, m_pCallbackData );
+						}
+						else
+						{
+							m_callbackFn( &frame, m_pCallbackData );
+						}
+					}
+
+					lock.lock();
+					if ( !produced )
+					{
+						pSlot->state = SLOT_FREE;
+						m_endOfStream = true;
+						m_consumerCondition.notify_all();
+						break;
+					}
+
+					if ( HasCallback() )
+					{
+						pSlot->state = SLOT_FREE;
+					}
+					else
+					{
+						pSlot->state = SLOT_READY;
+						m_ready.push_back( static_cast<size_t>( pSlot - &m_slots[0] ) );
+						m_consumerCondition.notify_all();
+					}
+				}
+			}
+
+			VirtualCamera( const VirtualCamera& );
+			VirtualCamera& operator=( const VirtualCamera& );
+
+			std::condition_variable m_producerCondition;
+			std::condition_variable m_consumerCondition;
+			std::thread             m_producer;
+
+			bool                    m_connected;
+			bool                    m_capturing;
+			bool                    m_stopRequested;
+			bool                    m_endOfStream;
+			unsigned int            m_activeReaders;
+			Clock::time_point       m_connectTime;
+
+			FC2Config               m_config;
+			VirtualFrameFormat      m_format;
+			std::vector<Slot>       m_slots;
+			std::deque<size_t>      m_ready;
+
+			ImageEventCallback      m_callbackFn;
+			VirtualFrameCallback    m_frameCallbackFn;
+			const void*             m_pCallbackData;
+			EventOptions            m_exposureEndEvent;
+			bool                    m_allEventsRegistered;
+			const Clock::time_point m_deviceEpoch;
+
+			TriggerMode             m_triggerMode;
+			std::deque<Clock::time_point> m_pendingTriggers;
+
+			Property                m_frameRate;
+			Property                m_shutter;
+			Property                m_gain;
+			EmbeddedImageInfo       m_embeddedInfo;
+			EmbeddedImageInfo       m_frameEmbeddedInfo;
+
+			CameraStats             m_stats;
+			unsigned long long      m_frameIndex;
+			unsigned int            m_serialNumber;
+			char                    m_modelName[sk_maxStringLength];
+			double                  m_dropProbability;
+			unsigned int            m_dropInterval;
+			unsigned int            m_random;
+			std::atomic<long long>  m_controlLatencyUs;
+	};
+
+	namespace Detail
+	{
+		template <class CameraT>
+		inline ErrorType RetrieveBufferWithInfo(
+				CameraT*       pCamera,
+				Image*         pImage,
+				TimeStamp*     pTimeStamp,
+				ImageMetadata* pMetadata,
+				std::false_type )
+		{
+			const Error error = pCamera->RetrieveBuffer( pImage );
+			*pTimeStamp = pImage->GetTimeStamp();
+			*pMetadata = pImage->GetMetadata();
+			return error.GetType();
+		}
+
+		template <class CameraT>
+		inline ErrorType RetrieveBufferWithInfo(
+				CameraT*       pCamera,
+				Image*         pImage,
+				TimeStamp*     pTimeStamp,
+				ImageMetadata* pMetadata,
+				std::true_type )
+		{
+			VirtualFrameInfo info;
+			const ErrorType error = pCamera->RetrieveBuffer( pImage, &info );
+			*pTimeStamp = info.timeStamp;
+			*pMetadata = info.metadata;
+			return error;
+		}
+
+		/**
+		 * Retrieve an image with its time stamp and metadata from a real
+		 * or virtual camera. Real cameras report them in the Image;
+		 * virtual cameras report them out of band.
+		 *
+		 * @param pCamera The camera.
+		 * @param pImage Receives the image.
+		 * @param pTimeStamp Receives the time stamp of the image.
+		 * @param pMetadata Receives the metadata of the image.
+		 *
+		 * @return The type of the error returned by RetrieveBuffer().
+		 */
+		template <class CameraT>
+		inline ErrorType RetrieveBufferWithInfo(
+				CameraT*       pCamera,
+				Image*         pImage,
+				TimeStamp*     pTimeStamp,
+				ImageMetadata* pMetadata )
+		{
+			return RetrieveBufferWithInfo(
+				pCamera, pImage, pTimeStamp, pMetadata,
+				typename std::is_base_of<VirtualCamera, CameraT>::type() );
+		}
+	}
+}
+
+#endif // FLIR_FC2_VIRTUALCAMERA_H
@@ -0,0 +1,499 @@
+//=============================================================================
+// Copyright (c) 2001-2018 FLIR Systems, Inc. All Rights Reserved.
+//
+// This software is the confidential and proprietary information of FLIR
+// Integrated Imaging Solutions, Inc. ("Confidential Information"). You
+// shall not disclose such Confidential Information and shall use it only in
+// accordance with the terms of the license agreement you entered into
+// with FLIR Integrated Imaging Solutions, Inc. (FLIR).
+//
+// FLIR MAKES NO REPRESENTATIONS OR WARRANTIES ABOUT THE SUITABILITY OF THE
+// SOFTWARE, EITHER EXPRESSED OR IMPLIED, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+// PURPOSE, OR NON-INFRINGEMENT. FLIR SHALL NOT BE LIABLE FOR ANY DAMAGES
+// SUFFERED BY LICENSEE AS A RESULT OF USING, MODIFYING OR DISTRIBUTING
+// THIS SOFTWARE OR ITS DERIVATIVES.
+//=============================================================================
+
+
+#ifndef FLIR_FC2_WARMCAPTURE_H
+#define FLIR_FC2_WARMCAPTURE_H
+
+#include "FlyCapture2Platform.h"
+#include "FlyCapture2Defs.h"
+#include "Error.h"
+#include "Image.h"
+#include "CameraBase.h"
+#include "NumaPlacement.h"
+#include "MemoryBudget.h"
+
+#if !defined(_MSC_VER) && __cplusplus < 201103L
+#error "WarmCapture.h requires C++11"
+#endif
+
+#include <chrono>
+
+namespace FlyCapture2
+{
+	/** Statistics of a WarmCapture. */
+	struct WarmCaptureStats
+	{
+		/** Number of Pause() calls that took effect. */
+		unsigned long long numPauses;
+		/** Number of completed mode switches. */
+		unsigned long long numModeSwitches;
+		/** Duration of the last Pause() or Resume(), in nanoseconds. */
+		long long lastPauseResumeNs;
+		/** Duration of the last mode switch, in nanoseconds. */
+		long long lastModeSwitchNs;
+		/** Largest mode switch duration, in nanoseconds. */
+		long long maxModeSwitchNs;
+
+		WarmCaptureStats()
+		{
+			numPauses = 0;
+			numModeSwitches = 0;
+			lastPauseResumeNs = 0;
+			lastModeSwitchNs = 0;
+			maxModeSwitchNs = 0;
+		}
+	};
+
+	/**
+	 * The WarmCapture class keeps a camera's capture resources alive across
+	 * pauses and mode changes, so that they take a few frame periods
+	 * rather than the hundreds of milliseconds of a full StopCapture() and
+	 * StartCapture() cycle.
+	 *
+	 * Pause() does not stop the stream. It switches the camera to software
+	 * trigger mode without firing any triggers, so the camera stops
+	 * exposing while the receive threads, buffers and isochronous or stream
+	 * channel stay allocated. Resume() restores the previous trigger mode.
+	 *
+	 * Format changes do need the stream to be stopped. AllocateBuffers()
+	 * provides the library with user buffers sized for the largest mode,
+	 * optionally placed on the NUMA node of the camera's interface,
+	 * so SwitchMode() restarts into the same buffers without allocating or
+	 * pinning any memory, as long as the new frame size fits in them.
+	 * ReleaseBuffers(), also called by the destructor, returns the camera
+	 * to library managed buffers before freeing them. With a MemoryBudget,
+	 * the buffers are reserved as capture buffers owned by the controller
+	 * before they are allocated.
+	 *
+	 * The class works with any camera type providing Get/SetTriggerMode()
+	 * and Start/StopCapture(), such as Camera, GigECamera or VirtualCamera.
+	 * AllocateBuffers() and SwitchFormat7() additionally need
+	 * SetUserBuffers() and SetFormat7Configuration(). It is not thread
+	 * safe; use it from one thread.
+	 */
+	template <class CameraT>
+	class WarmCapture
+	{
+		public:
+
+			typedef std::chrono::steady_clock Clock;
+
+			/** Trigger source that selects software triggering. */
+			static const unsigned int sk_softwareTriggerSource = 7;
+
+			/**
+			 * Construct a controller for a camera. The camera and the
+			 * budget must outlive the controller.
+			 *
+			 * @param pCamera The camera to control.
+			 * @param pBudget Optional budget to account the buffers of
+			 *                AllocateBuffers() in.
+			 */
+			explicit WarmCapture( CameraT* pCamera, MemoryBudget* pBudget = NULL )
+				: m_pCamera( pCamera ),
+				  m_pBudget( pBudget ),
+				  m_callbackFn( NULL ),
+				  m_pCallbackData( NULL ),
+				  m_capturing( false ),
+				  m_paused( false ),
+				  m_pBuffers( NULL ),
+				  m_allocatedBytes( 0 ),
+				  m_bufferSize( 0 ),
+				  m_numBuffers( 0 )
+			{
+			}
+
+			/**
+			 * Default destructor. Stops capture and releases the buffers as
+			 * ReleaseBuffers() does. If the library refuses to release
+			 * them, they are leaked rather than freed while the camera may
+			 * still write to them, and stay reserved in the budget.
+			 */
+			~WarmCapture()
+			{
+				Stop();
+				ReleaseBuffers();
+			}
+
+			/**
+			 * Allocate buffers for the largest frame the camera will be
+			 * switched to and hand them to the library. Call while capture
+			 * is stopped. Buffers from an earlier call are only freed once
+			 * the library has accepted the new ones; if it refuses them,
+			 * the earlier buffers stay in use.
+			 *
+			 * @param maxFrameBytes Size of the largest frame.
+			 * @param numBuffers Number of buffers.
+			 * @param packetSize Transfer packet size each buffer is rounded
+			 *                   up to, as described for SetUserBuffers():
+			 *                   1024 for USB3, 1 for GigE.
+			 * @param numaNode NUMA node to place the buffers on, usually
+			 *                 the node of the NIC or USB controller, or -1
+			 *                 for no placement.
+			 * @param pPlacement Optional result of the NUMA placement, as
+			 *                   described for AllocateOnNode(). Set only
+			 *                   if the buffers were allocated.
+			 *
+			 * @return PGRERROR_OK; PGRERROR_ISOCH_ALREADY_STARTED;
+			 *         PGRERROR_INVALID_PARAMETER;
+			 *         PGRERROR_MEMORY_ALLOCATION_FAILED if the buffers could
+			 *         not be allocated or do not fit in the budget; or the
+			 *         error of SetUserBuffers().
+			 */
+			ErrorType AllocateBuffers(
+					unsigned int maxFrameBytes,
+					unsigned int numBuffers,
+					unsigned int packetSize = 1024,
+					int          numaNode = -1,
+					ErrorType*   pPlacement = NULL )
+			{
+				if ( m_capturing )
+				{
+					return PGRERROR_ISOCH_ALREADY_STARTED;
+				}
+				if ( maxFrameBytes == 0 || numBuffers == 0 || packetSize == 0 )
+				{
+					return PGRERROR_INVALID_PARAMETER;
+				}
+
+				const unsigned long long bufferSize =
+					( static_cast<unsigned long long>( maxFrameBytes ) + packetSize - 1 ) / packetSize * packetSize;
+				if ( bufferSize > 0x7fffffffULL )
+				{
+					return PGRERROR_INVALID_PARAMETER;
+				}
+
+				const size_t allocatedBytes = static_cast<size_t>( bufferSize * numBuffers );
+				if ( m_pBudget != NULL )
+				{
+					const ErrorType error = m_pBudget->Reserve( this, MEMORY_CAPTURE_BUFFERS, allocatedBytes );
+					if ( error != PGRERROR_OK )
+					{
+						return error;
+					}
+				}
+
+				unsigned char* pBuffers = static_cast<unsigned char*>( AllocateOnNode( allocatedBytes, numaNode, pPlacement ) );
+				ErrorType error = pBuffers != NULL ?
+					GetErrorType( m_pCamera->SetUserBuffers(
+						pBuffers, static_cast<int>( bufferSize ), static_cast<int>( numBuffers ) ) ) :
+					PGRERROR_MEMORY_ALLOCATION_FAILED;
+				if ( error != PGRERROR_OK )
+				{
+					FreeOnNode( pBuffers, allocatedBytes );
+					if ( m_pBudget != NULL )
+					{
+						m_pBudget->Reserve( this, MEMORY_CAPTURE_BUFFERS, m_allocatedBytes );
+					}
+					return error;
+				}
+
+				FreeOnNode( m_pBuffers, m_allocatedBytes );
+				m_pBuffers = pBuffers;
+				m_allocatedBytes = allocatedBytes;
+				m_bufferSize = static_cast<unsigned int>( bufferSize );
+				m_numBuffers = numBuffers;
+				return PGRERROR_OK;
+			}
+
+			/**
+			 * Return the camera to library managed buffers and free the
+			 * buffers of AllocateBuffers(). Call while capture is stopped.
+			 * The buffers are only freed once the library has let go of
+			 * them.
+			 *
+			 * @return PGRERROR_OK; PGRERROR_ISOCH_ALREADY_STARTED; or the
+			 *         error of SetUserBuffers(), in which case the buffers
+			 *         are kept.
+			 */
+			ErrorType ReleaseBuffers()
+			{
+				if ( m_capturing )
+				{
+					return PGRERROR_ISOCH_ALREADY_STARTED;
+				}
+				if ( m_pBuffers == NULL )
+				{
+					return PGRERROR_OK;
+				}
+
+				const ErrorType error = GetErrorType( m_pCamera->SetUserBuffers( NULL, 0, 0 ) );
+				if ( error != PGRERROR_OK )
+				{
+					return error;
+				}
+
+				FreeOnNode( m_pBuffers, m_allocatedBytes );
+				m_pBuffers = NULL;
+				m_allocatedBytes = 0;
+				m_bufferSize = 0;
+				m_numBuffers = 0;
+				if ( m_pBudget != NULL )
+				{
+					m_pBudget->Release( this, MEMORY_CAPTURE_BUFFERS );
+				}
+				return PGRERROR_OK;
+			}
+
+			/**
+			 * Get the size of each user buffer.
+			 *
+			 * @return The buffer size, or 0 if AllocateBuffers() has not
+			 *         been called and the library manages the buffers.
+			 */
+			unsigned int GetBufferSize() const
+			{
+				return m_bufferSize;
+			}
+
+			/**
+			 * Start capture. The callback is kept for restarts.
+			 *
+			 * @param callbackFn Optional image callback.
+			 * @param pCallbackData Data passed to the callback.
+			 *
+			 * @return The result of StartCapture().
+			 */
+			ErrorType Start( ImageEventCallback callbackFn = NULL, const void* pCallbackData = NULL )
+			{
+				m_callbackFn = callbackFn;
+				m_pCallbackData = pCallbackData;
+				const ErrorType error = GetErrorType( m_pCamera->StartCapture( callbackFn, pCallbackData ) );
+				m_capturing = error == PGRERROR_OK;
+				return error;
+			}
+
+			/**
+			 * Stop capture, resuming first if paused.
+			 *
+			 * @return PGRERROR_OK, or the first error encountered.
+			 */
+			ErrorType Stop()
+			{
+				ErrorType result = PGRERROR_OK;
+				if ( m_paused )
+				{
+					result = Resume();
+				}
+				if ( m_capturing )
+				{
+					const ErrorType error = GetErrorType( m_pCamera->StopCapture() );
+					m_capturing = false;
+					if ( result == PGRERROR_OK )
+					{
+						result = error;
+					}
+				}
+				return result;
+			}
+
+			/**
+			 * Stop the camera from producing frames while keeping the
+			 * stream and its resources allocated. Frames already in flight
+			 * can still be retrieved.
+			 *
+			 * @return PGRERROR_OK; PGRERROR_ISOCH_NOT_STARTED; or the error
+			 *         of the trigger mode calls.
+			 */
+			ErrorType Pause()
+			{
+				if ( !m_capturing )
+				{
+					return PGRERROR_ISOCH_NOT_STARTED;
+				}
+				if ( m_paused )
+				{
+					return PGRERROR_OK;
+				}
+
+				const Clock::time_point start = Clock::now();
+				ErrorType error = GetErrorType( m_pCamera->GetTriggerMode( &m_savedTriggerMode ) );
+				if ( error != PGRERROR_OK )
+				{
+					return error;
+				}
+
+				TriggerMode pauseMode = m_savedTriggerMode;
+				pauseMode.onOff = true;
+				pauseMode.mode = 0;
+				pauseMode.parameter = 0;
+				pauseMode.source = sk_softwareTriggerSource;
+				error = GetErrorType( m_pCamera->SetTriggerMode( &pauseMode ) );
+				if ( error != PGRERROR_OK )
+				{
+					return error;
+				}
+
+				m_paused = true;
+				m_stats.numPauses++;
+				m_stats.lastPauseResumeNs = ElapsedNs( start );
+				return PGRERROR_OK;
+			}
+
+			/**
+			 * Restore the trigger mode in effect before Pause().
+			 *
+			 * @return PGRERROR_OK, or the error of SetTriggerMode().
+			 */
+			ErrorType Resume()
+			{
+				if ( !m_paused )
+				{
+					return PGRERROR_OK;
+				}
+
+				const Clock::time_point start = Clock::now();
+				const ErrorType error = GetErrorType( m_pCamera->SetTriggerMode( &m_savedTriggerMode ) );
+				if ( error != PGRERROR_OK )
+				{
+					return error;
+				}
+
+				m_paused = false;
+				m_stats.lastPauseResumeNs = ElapsedNs( start );
+				return PGRERROR_OK;
+			}
+
+			/**
+			 * Get whether capture is paused.
+			 *
+			 * @return Whether Pause() is in effect.
+			 */
+			bool IsPaused() const
+			{
+				return m_paused;
+			}
+
+			/**
+			 * Change the camera mode, restarting capture into the existing
+			 * buffers.
+			 *
+			 * @param frameBytes Size of a frame in the new mode.
+			 * @param configure Called as configure( CameraT* ) while
+			 *                  capture is stopped to apply the new mode, and
+			 *                  returning an Error or ErrorType.
+			 *
+			 * @return PGRERROR_OK; PGRERROR_BUFFER_TOO_SMALL, without
+			 *         touching the camera, if the frame does not fit in the
+			 *         user buffers, in which case Stop(), AllocateBuffers()
+			 *         and Start() must be used; or the first error of the
+			 *         switch. Capture is restarted even if the new mode
+			 *         failed to apply.
+			 */
+			template <class Configure>
+			ErrorType SwitchMode( unsigned int frameBytes, Configure configure )
+			{
+				if ( m_bufferSize != 0 && frameBytes > m_bufferSize )
+				{
+					return PGRERROR_BUFFER_TOO_SMALL;
+				}
+
+				const Clock::time_point start = Clock::now();
+				const bool wasCapturing = m_capturing;
+				const bool wasPaused = m_paused;
+				ErrorType result = Stop();
+				if ( result != PGRERROR_OK )
+				{
+					return result;
+				}
+
+				result = GetErrorType( configure( m_pCamera ) );
+				if ( wasCapturing )
+				{
+					const ErrorType error = Start( m_callbackFn, m_pCallbackData );
+					if ( result == PGRERROR_OK )
+					{
+						result = error;
+					}
+					if ( error == PGRERROR_OK && wasPaused )
+					{
+						Pause();
+					}
+				}
+
+				if ( result == PGRERROR_OK )
+				{
+					const long long elapsedNs = ElapsedNs( start );
+					m_stats.numModeSwitches++;
+					m_stats.lastModeSwitchNs = elapsedNs;
+					m_stats.maxModeSwitchNs = elapsedNs > m_stats.maxModeSwitchNs ? elapsedNs : m_stats.maxModeSwitchNs;
+				}
+				return result;
+			}
+
+			/**
+			 * Change the Format7 mode, restarting capture into the existing
+			 * buffers.
+			 *
+			 * @param settings The new Format7 settings.
+			 * @param percentSpeed Bus speed percentage.
+			 *
+			 * @return As SwitchMode().
+			 */
+			ErrorType SwitchFormat7( const Format7ImageSettings& settings, float percentSpeed = 100.0f )
+			{
+				const unsigned long long frameBytes = ( static_cast<unsigned long long>( settings.width ) *
+					settings.height * Image::DetermineBitsPerPixel( settings.pixelFormat ) + 7 ) / 8;
+				if ( frameBytes > 0xffffffffULL )
+				{
+					return PGRERROR_BUFFER_TOO_SMALL;
+				}
+
+				return SwitchMode( static_cast<unsigned int>( frameBytes ), [&]( CameraT* pCamera ) {
+					return GetErrorType( pCamera->SetFormat7Configuration( &settings, percentSpeed ) ); } );
+			}
+
+			/**
+			 * Get the statistics of the controller.
+			 *
+			 * @param pStats Receives the statistics.
+			 */
+			void GetStats( WarmCaptureStats* pStats ) const
+			{
+				*pStats = m_stats;
+			}
+
+		private:
+
+			static ErrorType GetErrorType( const Error& error ) { return error.GetType(); }
+			static ErrorType GetErrorType( ErrorType error ) { return error; }
+
+			static long long ElapsedNs( Clock::time_point start )
+			{
+				return std::chrono::duration_cast<std::chrono::nanoseconds>( Clock::now() - start ).count();
+			}
+
+			WarmCapture( const WarmCapture& );
+			WarmCapture& operator=( const WarmCapture& );
+
+			CameraT*            m_pCamera;
+			MemoryBudget*       m_pBudget;
+			ImageEventCallback  m_callbackFn;
+			const void*         m_pCallbackData;
+			bool                m_capturing;
+			bool                m_paused;
+			TriggerMode         m_savedTriggerMode;
+			unsigned char*      m_pBuffers;
+			size_t              m_allocatedBytes;
+			unsigned int        m_bufferSize;
+			unsigned int        m_numBuffers;
+			WarmCaptureStats    m_stats;
+	};
+}
+
+#endif // FLIR_FC2_WARMCAPTURE_H
@@ -0,0 +1,893 @@
+//=============================================================================
+// Copyright (c) 2001-2018 FLIR Systems, Inc. All Rights Reserved.
+//
+// This software is the confidential and proprietary information of FLIR
+// Integrated Imaging Solutions, Inc. ("Confidential Information"). You
+// shall not disclose such Confidential Information and shall use it only in
+// accordance with the terms of the license agreement you entered into
+// with FLIR Integrated Imaging Solutions, Inc. (FLIR).
+//
+// FLIR MAKES NO REPRESENTATIONS OR WARRANTIES ABOUT THE SUITABILITY OF THE
+// SOFTWARE, EITHER EXPRESSED OR IMPLIED, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+// PURPOSE, OR NON-INFRINGEMENT. FLIR SHALL NOT BE LIABLE FOR ANY DAMAGES
+// SUFFERED BY LICENSEE AS A RESULT OF USING, MODIFYING OR DISTRIBUTING
+// THIS SOFTWARE OR ITS DERIVATIVES.
+//=============================================================================
+
+//=============================================================================
+// ImageProcessingBench
+//
+// Measures the image processing functions of the library on synthetic data:
+// Image::Convert() for every pair of pixel formats and, for Bayer sources,
+// every ColorProcessingAlgorithm; Image::CalculateStatistics(); and every
+// Image::Save() format and option. Each case runs at every requested
+// resolution and thread count, with warm and cold caches, and the results
+// are written as JSON so they can be compared between SDK releases.
+//
+// Threads run independent copies of the same workload, so aggregate
+// throughput shows how the library scales across cores. Cold cache runs
+// overwrite an eviction buffer before every timed iteration; only the
+// call itself is timed. Save timings include writing the file.
+//
+// Build with the Makefile in this directory, which links libflycapture and
+// places the binary in bin; run ImageProcessingBench --help for the options.
+//=============================================================================
+
+#include "FlyCapture2.h"
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <iostream>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+using namespace FlyCapture2;
+using namespace std;
+
+namespace
+{
+    typedef std::chrono::steady_clock Clock;
+
+    struct NamedPixelFormat
+    {
+        PixelFormat format;
+        const char* pName;
+    };
+
+    const NamedPixelFormat sk_pixelFormats[] =
+    {
+        { PIXEL_FORMAT_MONO8, "MONO8" },
+        { PIXEL_FORMAT_MONO12, "MONO12" },
+        { PIXEL_FORMAT_MONO16, "MONO16" },
+        { PIXEL_FORMAT_S_MONO16, "S_MONO16" },
+        { PIXEL_FORMAT_RAW8, "RAW8" },
+        { PIXEL_FORMAT_RAW12, "RAW12" },
+        { PIXEL_FORMAT_RAW16, "RAW16" },
+        { PIXEL_FORMAT_411YUV8, "411YUV8" },
+        { PIXEL_FORMAT_422YUV8, "422YUV8" },
+        { PIXEL_FORMAT_444YUV8, "444YUV8" },
+        { PIXEL_FORMAT_RGB8, "RGB8" },
+        { PIXEL_FORMAT_BGR, "BGR" },
+        { PIXEL_FORMAT_RGBU, "RGBU" },
+        { PIXEL_FORMAT_BGRU, "BGRU" },
+        { PIXEL_FORMAT_RGB16, "RGB16" },
+        { PIXEL_FORMAT_S_RGB16, "S_RGB16" },
+        { PIXEL_FORMAT_BGR16, "BGR16" },
+        { PIXEL_FORMAT_BGRU16, "BGRU16" },
+    };
+
+    struct NamedAlgorithm
+    {
+        ColorProcessingAlgorithm algorithm;
+        const char* pName;
+    };
+
+    const NamedAlgorithm sk_algorithms[] =
+    {
+        { DEFAULT, "DEFAULT" },
+        { NO_COLOR_PROCESSING, "NO_COLOR_PROCESSING" },
+        { NEAREST_NEIGHBOR, "NEAREST_NEIGHBOR" },
+        { EDGE_SENSING, "EDGE_SENSING" },
+        { HQ_LINEAR, "HQ_LINEAR" },
+        { RIGOROUS, "RIGOROUS" },
+        { IPP, "IPP" },
+        { DIRECTIONAL_FILTER, "DIRECTIONAL_FILTER" },
+        { WEIGHTED_DIRECTIONAL_FILTER, "WEIGHTED_DIRECTIONAL_FILTER" },
+    };
+
+    // Pixel formats used as the source of Image::Save() and
+    // Image::CalculateStatistics().
+    const PixelFormat sk_saveFormats[] =
+    {
+        PIXEL_FORMAT_MONO8,
+        PIXEL_FORMAT_MONO16,
+        PIXEL_FORMAT_RGB8,
+        PIXEL_FORMAT_RGB16,
+    };
+
+    enum SaveKind
+    {
+        SAVE_PLAIN,
+        SAVE_PGM,
+        SAVE_PPM,
+        SAVE_BMP,
+        SAVE_JPEG,
+        SAVE_JPEG2000,
+        SAVE_TIFF,
+        SAVE_PNG
+    };
+
+    struct SaveVariant
+    {
+        const char* pName;
+        const char* pExtension;
+        SaveKind kind;
+        ImageFileFormat format;
+        // Option values; the meaning depends on the kind.
+        unsigned int value;
+        bool flag;
+    };
+
+    const SaveVariant sk_saveVariants[] =
+    {
+        { "PGM_BINARY", "pgm", SAVE_PGM, PGM, 0, true },
+        { "PGM_ASCII", "pgm", SAVE_PGM, PGM, 0, false },
+        { "PPM_BINARY", "ppm", SAVE_PPM, PPM, 0, true },
+        { "PPM_ASCII", "ppm", SAVE_PPM, PPM, 0, false },
+        { "BMP", "bmp", SAVE_BMP, BMP, 0, false },
+        { "BMP_INDEXED8", "bmp", SAVE_BMP, BMP, 0, true },
+        { "JPEG_Q50", "jpg", SAVE_JPEG, JPEG, 50, false },
+        { "JPEG_Q75", "jpg", SAVE_JPEG, JPEG, 75, false },
+        { "JPEG_Q95", "jpg", SAVE_JPEG, JPEG, 95, false },
+        { "JPEG_Q75_PROGRESSIVE", "jpg", SAVE_JPEG, JPEG, 75, true },
+        { "JPEG2000_Q16", "jp2", SAVE_JPEG2000, JPEG2000, 16, false },
+        { "JPEG2000_Q128", "jp2", SAVE_JPEG2000, JPEG2000, 128, false },
+        { "TIFF_NONE", "tif", SAVE_TIFF, TIFF, TIFFOption::NONE, false },
+        { "TIFF_PACKBITS", "tif", SAVE_TIFF, TIFF, TIFFOption::PACKBITS, false },
+        { "TIFF_DEFLATE", "tif", SAVE_TIFF, TIFF, TIFFOption::DEFLATE, false },
+        { "TIFF_ADOBE_DEFLATE", "tif", SAVE_TIFF, TIFF, TIFFOption::ADOBE_DEFLATE, false },
+        { "TIFF_CCITTFAX3", "tif", SAVE_TIFF, TIFF, TIFFOption::CCITTFAX3, false },
+        { "TIFF_CCITTFAX4", "tif", SAVE_TIFF, TIFF, TIFFOption::CCITTFAX4, false },
+        { "TIFF_LZW", "tif", SAVE_TIFF, TIFF, TIFFOption::LZW, false },
+        { "TIFF_JPEG", "tif", SAVE_TIFF, TIFF, TIFFOption::JPEG, false },
+        { "PNG_L0", "png", SAVE_PNG, PNG, 0, false },
+        { "PNG_L1", "png", SAVE_PNG, PNG, 1, false },
+        { "PNG_L6", "png", SAVE_PNG, PNG, 6, false },
+        { "PNG_L9", "png", SAVE_PNG, PNG, 9, false },
+        { "PNG_L6_INTERLACED", "png", SAVE_PNG, PNG, 6, true },
+        { "RAW", "raw", SAVE_PLAIN, RAW, 0, false },
+    };
+
+    struct Options
+    {
+        vector< pair<unsigned int, unsigned int> > resolutions;
+        vector<unsigned int> threadCounts;
+        double minTimeMs;
+        unsigned int minIterations;
+        size_t evictBytes;
+        bool runWarm;
+        bool runCold;
+        bool runConvert;
+        bool runStatistics;
+        bool runSave;
+        string filter;
+        string outputPath;
+        string saveDirectory;
+
+        Options()
+            : minTimeMs( 200.0 ),
+              minIterations( 3 ),
+              evictBytes( 64 * 1024 * 1024 ),
+              runWarm( true ),
+              runCold( true ),
+              runConvert( true ),
+              runStatistics( true ),
+              runSave( true ),
+              saveDirectory( "/tmp" )
+        {
+        }
+    };
+
+    struct Measurement
+    {
+        ErrorType error;
+        string errorDescription;
+        unsigned long long iterations;
+        // Sum of timed iterations over all threads.
+        double totalSeconds;
+        // Longest timed total of a single thread.
+        double maxThreadSeconds;
+    };
+
+    // A benchmark body, called with the index of the calling thread.
+    typedef std::function<Error( unsigned int )> Workload;
+
+    const char* GetFormatName( PixelFormat format )
+    {
+        for ( size_t i = 0; i < sizeof(sk_pixelFormats) / sizeof(sk_pixelFormats[0]); i++ )
+        {
+            if ( sk_pixelFormats[i].format == format )
+            {
+                return sk_pixelFormats[i].pName;
+            }
+        }
+        return "UNKNOWN";
+    }
+
+    bool IsRawFormat( PixelFormat format )
+    {
+        return format == PIXEL_FORMAT_RAW8 ||
+            format == PIXEL_FORMAT_RAW12 ||
+            format == PIXEL_FORMAT_RAW16;
+    }
+
+    void FillNoise( vector<unsigned char>* pData, unsigned int seed )
+    {
+        unsigned int state = seed | 1;
+        for ( size_t i = 0; i < pData->size(); i++ )
+        {
+            state ^= state << 13;
+            state ^= state >> 17;
+            state ^= state << 5;
+            (*pData)[i] = static_cast<unsigned char>( state >> 24 );
+        }
+    }
+
+    // A synthetic source image owned by one thread.
+    struct SourceImage
+    {
+        vector<unsigned char> data;
+        Image image;
+
+        void Create( unsigned int rows, unsigned int cols, PixelFormat format, unsigned int seed )
+        {
+            const unsigned int stride = ( cols * Image::DetermineBitsPerPixel( format ) + 7 ) / 8;
+            data.resize( static_cast<size_t>( rows ) * stride );
+            FillNoise( &data, seed );
+            image.SetDimensions( rows, cols, stride, format, IsRawFormat( format ) ? RGGB : NONE );
+            image.SetData( &data[0], static_cast<unsigned int>( data.size() ) );
+        }
+    };
+
+    class Evictor
+    {
+        public:
+
+            Evictor( size_t totalBytes, unsigned int numThreads )
+                : m_buffers( numThreads )
+            {
+                const size_t perThread = max<size_t>( totalBytes / numThreads, 1024 * 1024 );
+                for ( size_t i = 0; i < m_buffers.size(); i++ )
+                {
+                    m_buffers[i].assign( perThread, 0 );
+                }
+            }
+
+            void Evict( unsigned int threadIndex )
+            {
+                vector<unsigned char>& buffer = m_buffers[threadIndex];
+                for ( size_t i = 0; i < buffer.size(); i += 64 )
+                {
+                    buffer[i]++;
+                }
+            }
+
+        private:
+
+            vector< vector<unsigned char> > m_buffers;
+    };
+
+    // Run a workload on several threads, each until it has accumulated the
+    // minimum run time and iteration count.
+    Measurement Measure(
+        const Options&  options,
+        unsigned int    numThreads,
+        bool            cold,
+        const Workload& workload )
+    {
+        Measurement measurement;
+        measurement.error = PGRERROR_OK;
+        measurement.iterations = 0;
+        measurement.totalSeconds = 0.0;
+        measurement.maxThreadSeconds = 0.0;
+
+        // A first untimed call per thread allocates outputs and detects
+        // unsupported cases.
+        for ( unsigned int i = 0; i < numThreads; i++ )
+        {
+            Error error = workload( i );
+            if ( error != PGRERROR_OK )
+            {
+                measurement.error = error.GetType();
+                measurement.errorDescription = error.GetDescription();
+                return measurement;
+            }
+        }
+
+        Evictor evictor( cold ? options.evictBytes : 0, numThreads );
+        vector<unsigned long long> iterations( numThreads, 0 );
+        vector<double> seconds( numThreads, 0.0 );
+        vector<ErrorType> errors( numThreads, PGRERROR_OK );
+
+        mutex startMutex;
+        condition_variable startCondition;
+        bool started = false;
+
+        vector<thread> threads;
+        for ( unsigned int t = 0; t < numThreads; t++ )
+        {
+            threads.push_back( thread( [&, t]()
+            {
+                {
+                    unique_lock<mutex> lock( startMutex );
+                    startCondition.wait( lock, [&] { return started; } );
+                }
+
+                const double minSeconds = options.minTimeMs / 1000.0;
+                while ( seconds[t] < minSeconds || iterations[t] < options.minIterations )
+                {
+                    if ( cold )
+                    {
+                        evictor.Evict( t );
+                    }
+
+                    const Clock::time_point begin = Clock::now();
+                    Error error = workload( t );
+                    const Clock::time_point end = Clock::now();
+                    if ( error != PGRERROR_OK )
+                    {
+                        errors[t] = error.GetType();
+                        return;
+                    }
+
+                    seconds[t] += chrono::duration<double>( end - begin ).count();
+                    iterations[t]++;
+                }
+            } ) );
+        }
+
+        {
+            lock_guard<mutex> lock( startMutex );
+            started = true;
+        }
+        startCondition.notify_all();
+
+        for ( size_t t = 0; t < threads.size(); t++ )
+        {
+            threads[t].join();
+        }
+
+        for ( unsigned int t = 0; t < numThreads; t++ )
+        {
+            if ( errors[t] != PGRERROR_OK )
+            {
+                measurement.error = errors[t];
+            }
+            measurement.iterations += iterations[t];
+            measurement.totalSeconds += seconds[t];
+            measurement.maxThreadSeconds = max( measurement.maxThreadSeconds, seconds[t] );
+        }
+        return measurement;
+    }
+
+    string EscapeJson( const string& value )
+    {
+        string escaped;
+        for ( size_t i = 0; i < value.size(); i++ )
+        {
+            const char c = value[i];
+            if ( c == '"' || c == '\\' )
+            {
+                escaped += '\\';
+                escaped += c;
+            }
+            else if ( static_cast<unsigned char>( c ) < 0x20 )
+            {
+                char code[8];
+                snprintf( code, sizeof(code), "\\u%04x", c );
+                escaped += code;
+            }
+            else
+            {
+                escaped += c;
+            }
+        }
+        return escaped;
+    }
+
+    class ResultWriter
+    {
+        public:
+
+            ResultWriter() : m_numResults( 0 ) {}
+
+            // Record one measurement. The case description is a list of
+            // JSON members identifying the benchmark.
+            void Add(
+                const string&      name,
+                const string&      caseMembers,
+                unsigned int       rows,
+                unsigned int       cols,
+                unsigned int       numThreads,
+                bool               cold,
+                const Measurement& measurement )
+            {
+                ostringstream result;
+                result << "    {\"name\": \"" << EscapeJson( name ) << "\", " << caseMembers
+                       << ", \"width\": " << cols
+                       << ", \"height\": " << rows
+                       << ", \"threads\": " << numThreads
+                       << ", \"cache\": \"" << ( cold ? "cold" : "warm" ) << "\"";
+
+                if ( measurement.error != PGRERROR_OK )
+                {
+                    result << ", \"status\": \"error\", \"error\": " << measurement.error
+                           << ", \"error_description\": \"" << EscapeJson( measurement.errorDescription ) << "\"}";
+                }
+                else
+                {
+                    const double pixels = static_cast<double>( rows ) * cols;
+                    const double nsPerPixel = measurement.totalSeconds * 1e9 / ( pixels * measurement.iterations );
+                    const double megapixelsPerSecond =
+                        pixels * measurement.iterations / measurement.maxThreadSeconds / 1e6;
+                    result << ", \"status\": \"ok\""
+                           << ", \"iterations\": " << measurement.iterations
+                           << ", \"ns_per_pixel\": " << nsPerPixel
+                           << ", \"megapixels_per_second\": " << megapixelsPerSecond
+                           << ", \"megapixels_per_second_per_thread\": " << megapixelsPerSecond / numThreads
+                           << "}";
+                }
+
+                m_results << ( m_numResults++ == 0 ? "" : ",\n" ) << result.str();
+                cerr << name << " " << cols << "x" << rows << " t" << numThreads
+                     << ( cold ? " cold" : " warm" )
+                     << ( measurement.error != PGRERROR_OK ? " error" : "" ) << endl;
+            }
+
+            void Write( ostream& out, const Options& options ) const
+            {
+                FC2Version version;
+                Utilities::GetLibraryVersion( &version );
+
+                out << "{\n"
+                    << "  \"tool\": \"ImageProcessingBench\",\n"
+                    << "  \"library_version\": \"" << version.major << "." << version.minor << "."
+                    << version.type << "." << version.build << "\",\n"
+                    << "  \"build_date\": \"" << __DATE__ << " " << __TIME__ << "\",\n"
+                    << "  \"hardware_threads\": " << thread::hardware_concurrency() << ",\n"
+                    << "  \"min_time_ms\": " << options.minTimeMs << ",\n"
+                    << "  \"min_iterations\": " << options.minIterations << ",\n"
+                    << "  \"evict_bytes\": " << options.evictBytes << ",\n"
+                    << "  \"results\": [\n"
+                    << m_results.str() << "\n"
+                    << "  ]\n"
+                    << "}\n";
+            }
+
+        private:
+
+            ostringstream m_results;
+            unsigned int m_numResults;
+    };
+
+    bool Matches( const Options& options, const string& name )
+    {
+        return options.filter.empty() || name.find( options.filter ) != string::npos;
+    }
+
+    // Run a workload with every thread count and cache state.
+    void RunCase(
+        const Options&  options,
+        ResultWriter*   pWriter,
+        const string&   name,
+        const string&   caseMembers,
+        unsigned int    rows,
+        unsigned int    cols,
+        const std::function<void( unsigned int )>& prepare,
+        const Workload& workload )
+    {
+        for ( size_t t = 0; t < options.threadCounts.size(); t++ )
+        {
+            const unsigned int numThreads = options.threadCounts[t];
+            prepare( numThreads );
+
+            for ( int pass = 0; pass < 2; pass++ )
+            {
+                const bool cold = pass == 1;
+                if ( ( cold && !options.runCold ) || ( !cold && !options.runWarm ) )
+                {
+                    continue;
+                }
+
+                const Measurement measurement = Measure( options, numThreads, cold, workload );
+                pWriter->Add( name, caseMembers, rows, cols, numThreads, cold, measurement );
+                if ( measurement.error != PGRERROR_OK )
+                {
+                    // An unsupported case fails the same way for every
+                    // thread count and cache state.
+                    return;
+                }
+            }
+        }
+    }
+
+    void RunConvertBenchmarks( const Options& options, unsigned int rows, unsigned int cols, ResultWriter* pWriter )
+    {
+        const size_t numFormats = sizeof(sk_pixelFormats) / sizeof(sk_pixelFormats[0]);
+        for ( size_t s = 0; s < numFormats; s++ )
+        {
+            const PixelFormat source = sk_pixelFormats[s].format;
+            const size_t numAlgorithms = IsRawFormat( source ) ? sizeof(sk_algorithms) / sizeof(sk_algorithms[0]) : 1;
+
+            for ( size_t d = 0; d < numFormats; d++ )
+            {
+                const PixelFormat destination = sk_pixelFormats[d].format;
+                for ( size_t a = 0; a < numAlgorithms; a++ )
+                {
+                    const ColorProcessingAlgorithm algorithm = sk_algorithms[a].algorithm;
+                    const string name = string( "convert/" ) + sk_pixelFormats[s].pName + "/" +
+                        sk_pixelFormats[d].pName + "/" + sk_algorithms[a].pName;
+                    if ( !Matches( options, name ) )
+                    {
+                        continue;
+                    }
+
+                    vector<SourceImage> sources;
+                    vector<Image> destinations;
+                    const std::function<void( unsigned int )> prepare = [&]( unsigned int numThreads )
+                    {
+                        sources.clear();
+                        sources.resize( numThreads );
+                        destinations.clear();
+                        destinations.resize( numThreads );
+                        for ( unsigned int i = 0; i < numThreads; i++ )
+                        {
+                            sources[i].Create( rows, cols, source, i + 1 );
+                            sources[i].image.SetColorProcessing( algorithm );
+                        }
+                    };
+                    const Workload workload = [&]( unsigned int i ) -> Error
+                    {
+                        return sources[i].image.Convert( destination, &destinations[i] );
+                    };
+
+                    ostringstream members;
+                    members << "\"benchmark\": \"convert\", \"source\": \"" << sk_pixelFormats[s].pName
+                            << "\", \"destination\": \"" << sk_pixelFormats[d].pName
+                            << "\", \"algorithm\": \"" << sk_algorithms[a].pName << "\"";
+                    RunCase( options, pWriter, name, members.str(), rows, cols, prepare, workload );
+                }
+            }
+        }
+    }
+
+    void RunStatisticsBenchmarks( const Options& options, unsigned int rows, unsigned int cols, ResultWriter* pWriter )
+    {
+        for ( size_t s = 0; s < sizeof(sk_saveFormats) / sizeof(sk_saveFormats[0]); s++ )
+        {
+            const PixelFormat source = sk_saveFormats[s];
+            const string name = string( "statistics/" ) + GetFormatName( source );
+            if ( !Matches( options, name ) )
+            {
+                continue;
+            }
+
+            vector<SourceImage> sources;
+            vector<ImageStatistics> statistics;
+            const std::function<void( unsigned int )> prepare = [&]( unsigned int numThreads )
+            {
+                sources.clear();
+                sources.resize( numThreads );
+                statistics.clear();
+                statistics.resize( numThreads );
+                for ( unsigned int i = 0; i < numThreads; i++ )
+                {
+                    sources[i].Create( rows, cols, source, i + 1 );
+                    statistics[i].EnableAll();
+                }
+            };
+            const Workload workload = [&]( unsigned int i ) -> Error
+            {
+                return sources[i].image.CalculateStatistics( &statistics[i] );
+            };
+
+            ostringstream members;
+            members << "\"benchmark\": \"statistics\", \"source\": \"" << GetFormatName( source ) << "\"";
+            RunCase( options, pWriter, name, members.str(), rows, cols, prepare, workload );
+        }
+    }
+
+    Error SaveVariantImage( Image* pImage, const string& filename, const SaveVariant& variant )
+    {
+        switch ( variant.kind )
+        {
+            case SAVE_PGM:
+                {
+                    PGMOption option;
+                    option.binaryFile = variant.flag;
+                    return pImage->Save( filename.c_str(), &option );
+                }
+            case SAVE_PPM:
+                {
+                    PPMOption option;
+                    option.binaryFile = variant.flag;
+                    return pImage->Save( filename.c_str(), &option );
+                }
+            case SAVE_BMP:
+                {
+                    BMPOption option;
+                    option.indexedColor_8bit = variant.flag;
+                    return pImage->Save( filename.c_str(), &option );
+                }
+            case SAVE_JPEG:
+                {
+                    JPEGOption option;
+                    option.quality = variant.value;
+                    option.progressive = variant.flag;
+                    return pImage->Save( filename.c_str(), &option );
+                }
+            case SAVE_JPEG2000:
+                {
+                    JPG2Option option;
+                    option.quality = variant.value;
+                    return pImage->Save( filename.c_str(), &option );
+                }
+            case SAVE_TIFF:
+                {
+                    TIFFOption option;
+                    option.compression = static_cast<TIFFOption::CompressionMethod>( variant.value );
+                    return pImage->Save( filename.c_str(), &option );
+                }
+            case SAVE_PNG:
+                {
+                    PNGOption option;
+                    option.compressionLevel = variant.value;
+                    option.interlaced = variant.flag;
+                    return pImage->Save( filename.c_str(), &option );
+                }
+            default:
+                return pImage->Save( filename.c_str(), variant.format );
+        }
+    }
+
+    void RunSaveBenchmarks( const Options& options, unsigned int rows, unsigned int cols, ResultWriter* pWriter )
+    {
+        for ( size_t s = 0; s < sizeof(sk_saveFormats) / sizeof(sk_saveFormats[0]); s++ )
+        {
+            const PixelFormat source = sk_saveFormats[s];
+            for ( size_t v = 0; v < sizeof(sk_saveVariants) / sizeof(sk_saveVariants[0]); v++ )
+            {
+                const SaveVariant& variant = sk_saveVariants[v];
+                const string name = string( "save/" ) + GetFormatName( source ) + "/" + variant.pName;
+                if ( !Matches( options, name ) )
+                {
+                    continue;
+                }
+
+                vector<SourceImage> sources;
+                vector<string> filenames;
+                const std::function<void( unsigned int )> prepare = [&]( unsigned int numThreads )
+                {
+                    sources.clear();
+                    sources.resize( numThreads );
+                    filenames.clear();
+                    for ( unsigned int i = 0; i < numThreads; i++ )
+                    {
+                        sources[i].Create( rows, cols, source, i + 1 );
+
+                        ostringstream filename;
+                        filename << options.saveDirectory << "/ImageProcessingBench-" << i << "." << variant.pExtension;
+                        filenames.push_back( filename.str() );
+                    }
+                };
+                const Workload workload = [&]( unsigned int i ) -> Error
+                {
+                    return SaveVariantImage( &sources[i].image, filenames[i], variant );
+                };
+
+                ostringstream members;
+                members << "\"benchmark\": \"save\", \"source\": \"" << GetFormatName( source )
+                        << "\", \"variant\": \"" << variant.pName << "\"";
+                RunCase( options, pWriter, name, members.str(), rows, cols, prepare, workload );
+
+                for ( size_t i = 0; i < filenames.size(); i++ )
+                {
+                    remove( filenames[i].c_str() );
+                }
+            }
+        }
+    }
+
+    void PrintUsage()
+    {
+        cerr << "Usage: ImageProcessingBench [options]\n"
+             << "  --resolutions WxH[,WxH...]  Image sizes (default 640x480,1920x1200)\n"
+             << "  --threads N[,N...]          Thread counts (default 1 and all cores)\n"
+             << "  --min-time MS               Minimum timed run per case (default 200)\n"
+             << "  --min-iterations N          Minimum iterations per thread (default 3)\n"
+             << "  --evict-mb MB               Cold cache eviction size (default 64)\n"
+             << "  --cache warm|cold|both      Cache states to run (default both)\n"
+             << "  --only convert|statistics|save\n"
+             << "                              Run one benchmark group\n"
+             << "  --filter TEXT               Run cases whose name contains TEXT,\n"
+             << "                              e.g. convert/RAW8/BGR/\n"
+             << "  --save-dir DIR              Directory for Save() output (default /tmp)\n"
+             << "  --output FILE               Write JSON to FILE instead of stdout\n";
+    }
+
+    bool ParseList( const string& text, vector<unsigned int>* pValues )
+    {
+        istringstream stream( text );
+        string item;
+        while ( getline( stream, item, ',' ) )
+        {
+            const unsigned int value = static_cast<unsigned int>( strtoul( item.c_str(), NULL, 10 ) );
+            if ( value == 0 )
+            {
+                return false;
+            }
+            pValues->push_back( value );
+        }
+        return !pValues->empty();
+    }
+
+    bool ParseResolutions( const string& text, vector< pair<unsigned int, unsigned int> >* pResolutions )
+    {
+        istringstream stream( text );
+        string item;
+        while ( getline( stream, item, ',' ) )
+        {
+            unsigned int cols;
+            unsigned int rows;
+            if ( sscanf( item.c_str(), "%ux%u", &cols, &rows ) != 2 || cols == 0 || rows == 0 )
+            {
+                return false;
+            }
+            pResolutions->push_back( make_pair( cols, rows ) );
+        }
+        return !pResolutions->empty();
+    }
+
+    bool ParseOptions( int argc, char** argv, Options* pOptions )
+    {
+        for ( int i = 1; i < argc; i++ )
+        {
+            const string arg = argv[i];
+            if ( i + 1 >= argc )
+            {
+                return false;
+            }
+
+            const string value = argv[++i];
+            if ( arg == "--resolutions" )
+            {
+                if ( !ParseResolutions( value, &pOptions->resolutions ) )
+                {
+                    return false;
+                }
+            }
+            else if ( arg == "--threads" )
+            {
+                if ( !ParseList( value, &pOptions->threadCounts ) )
+                {
+                    return false;
+                }
+            }
+            else if ( arg == "--min-time" )
+            {
+                pOptions->minTimeMs = atof( value.c_str() );
+            }
+            else if ( arg == "--min-iterations" )
+            {
+                pOptions->minIterations = static_cast<unsigned int>( strtoul( value.c_str(), NULL, 10 ) );
+            }
+            else if ( arg == "--evict-mb" )
+            {
+                pOptions->evictBytes = static_cast<size_t>( strtoul( value.c_str(), NULL, 10 ) ) * 1024 * 1024;
+            }
+            else if ( arg == "--cache" )
+            {
+                pOptions->runWarm = value != "cold";
+                pOptions->runCold = value != "warm";
+            }
+            else if ( arg == "--only" )
+            {
+                pOptions->runConvert = value == "convert";
+                pOptions->runStatistics = value == "statistics";
+                pOptions->runSave = value == "save";
+            }
+            else if ( arg == "--filter" )
+            {
+                pOptions->filter = value;
+            }
+            else if ( arg == "--save-dir" )
+            {
+                pOptions->saveDirectory = value;
+            }
+            else if ( arg == "--output" )
+            {
+                pOptions->outputPath = value;
+            }
+            else
+            {
+                return false;
+            }
+        }
+
+        if ( pOptions->resolutions.empty() )
+        {
+            pOptions->resolutions.push_back( make_pair( 640u, 480u ) );
+            pOptions->resolutions.push_back( make_pair( 1920u, 1200u ) );
+        }
+        if ( pOptions->threadCounts.empty() )
+        {
+            pOptions->threadCounts.push_back( 1 );
+            const unsigned int numCores = thread::hardware_concurrency();
+            if ( numCores > 1 )
+            {
+                pOptions->threadCounts.push_back( numCores );
+            }
+        }
+        return true;
+    }
+}
+
+int main( int argc, char** argv )
+{
+    Options options;
+    if ( !ParseOptions( argc, argv, &options ) )
+    {
+        PrintUsage();
+        return -1;
+    }
+
+    ResultWriter writer;
+    for ( size_t r = 0; r < options.resolutions.size(); r++ )
+    {
+        const unsigned int cols = options.resolutions[r].first;
+        const unsigned int rows = options.resolutions[r].second;
+
+        if ( options.runConvert )
+        {
+            RunConvertBenchmarks( options, rows, cols, &writer );
+        }
+        if ( options.runStatistics )
+        {
+            RunStatisticsBenchmarks( options, rows, cols, &writer );
+        }
+        if ( options.runSave )
+        {
+            RunSaveBenchmarks( options, rows, cols, &writer );
+        }
+    }
+
+    if ( options.outputPath.empty() )
+    {
+        writer.Write( cout, options );
+    }
+    else
+    {
+        FILE* pFile = fopen( options.outputPath.c_str(), "w" );
+        if ( pFile == NULL )
+        {
+            cerr << "Failed to open " << options.outputPath << endl;
+            return -1;
+        }
+
+        ostringstream json;
+        writer.Write( json, options );
+        fputs( json.str().c_str(), pFile );
+        fclose( pFile );
+    }
+
+    return 0;
+}
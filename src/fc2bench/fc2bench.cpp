@@ -0,0 +1,1414 @@
+//=============================================================================
+// Copyright (c) 2001-2018 FLIR Systems, Inc. All Rights Reserved.
+//
+// This software is the confidential and proprietary information of FLIR
+// Integrated Imaging Solutions, Inc. ("Confidential Information"). You
+// shall not disclose such Confidential Information and shall use it only in
+// accordance with the terms of the license agreement you entered into
+// with FLIR Integrated Imaging Solutions, Inc. (FLIR).
+//
+// FLIR MAKES NO REPRESENTATIONS OR WARRANTIES ABOUT THE SUITABILITY OF THE
+// SOFTWARE, EITHER EXPRESSED OR IMPLIED, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+// PURPOSE, OR NON-INFRINGEMENT. FLIR SHALL NOT BE LIABLE FOR ANY DAMAGES
+// SUFFERED BY LICENSEE AS A RESULT OF USING, MODIFYING OR DISTRIBUTING
+// THIS SOFTWARE OR ITS DERIVATIVES.
+//=============================================================================
+
+//=============================================================================
+// fc2bench
+//
+// Headless capture throughput benchmark. Runs one or more real or simulated
+// cameras in polling, callback or synchronized capture mode for a fixed
+// duration and reports, per camera and per reporting interval:
+//
+//   - delivered frames per second and frames that failed to retrieve
+//   - drop and corruption counters from GetStats(), counted over the
+//     interval
+//   - latency percentiles, from the image time stamp to delivery
+//   - process CPU time per frame
+//   - payload bandwidth: bytes received, plus bytes written by conversion
+//
+// Results are written as JSON Lines: one "interval" record per reporting
+// interval followed by a "summary" record.
+//
+// With --property-rate, a thread per camera reads the shutter, gain and
+// frame rate properties at the specified rate while frames are captured,
+// as a camera control dialog does. The run is split into a phase reading
+// the properties from the camera and a phase reading them through a
+// PropertyCache, and each phase reports the jitter of frame delivery: the
+// change in the interval between consecutive frames, measured on the
+// host. Records carry the phase they belong to.
+//
+// With --sweep, the benchmark runs simulated cameras only, once for each
+// camera count in the list, and writes one "sweep" record per count with
+// the process CPU time, thread count, aggregate frame rate and latency and
+// jitter percentiles over all cameras, to show how per-camera cost grows
+// with the number of cameras in the process.
+//
+// With --trigger-skew, the benchmark fires software triggers on simulated
+// cameras whose register access takes --control-latency microseconds,
+// first by writing to each camera in turn and then through a
+// MultiCameraTrigger, which writes to all cameras concurrently. It writes
+// one "trigger_skew" record per method with the issue skew, the spread of
+// the times the writes were issued, and the completion skew, the spread of
+// the times they completed, which bounds the skew between exposures.
+//
+// Latency is measured against the host time stamp of each image. Simulated
+// cameras report it out of band, in the VirtualFrameInfo passed to
+// RetrieveBuffer() or to the frame callback. Synchronized capture uses
+// Camera::StartSyncCapture() for real cameras; simulated cameras are
+// started in sequence.
+//
+// Build with the Makefile in this directory, which links libflycapture and
+// places the binary in bin; run fc2bench --help for the options.
+//=============================================================================
+
+#include "FlyCapture2.h"
+#include "SimulatedCamera.h"
+#include "PropertyCache.h"
+#include "MultiCameraTrigger.h"
+
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include <math.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if !defined(_WIN32)
+#include <sys/resource.h>
+#endif
+
+using namespace FlyCapture2;
+using namespace std;
+
+namespace
+{
+    typedef std::chrono::steady_clock Clock;
+
+    enum CaptureMode
+    {
+        CAPTURE_POLL,
+        CAPTURE_CALLBACK,
+        CAPTURE_SYNC
+    };
+
+    enum PropertySource
+    {
+        PROPERTY_DIRECT,
+        PROPERTY_CACHE,
+        PROPERTY_BOTH
+    };
+
+    struct Options
+    {
+        unsigned int numCameras;
+        unsigned int numSimulated;
+        CaptureMode mode;
+        double durationSeconds;
+        double intervalSeconds;
+        unsigned int numBuffers;
+        GrabMode grabMode;
+        PixelFormat convertFormat;
+        SimulatedCameraSettings simulated;
+        double propertyRateHz;
+        PropertySource propertySource;
+        vector<unsigned int> sweepCounts;
+        unsigned int numSkewCameras;
+        unsigned int controlLatencyUs;
+        unsigned int numTriggers;
+        string outputPath;
+
+        Options()
+            : numCameras( 0 ),
+              numSimulated( 0 ),
+              mode( CAPTURE_POLL ),
+              durationSeconds( 10.0 ),
+              intervalSeconds( 1.0 ),
+              numBuffers( 10 ),
+              grabMode( BUFFER_FRAMES ),
+              convertFormat( UNSPECIFIED_PIXEL_FORMAT ),
+              propertyRateHz( 0.0 ),
+              propertySource( PROPERTY_BOTH ),
+              numSkewCameras( 0 ),
+              controlLatencyUs( 500 ),
+              numTriggers( 1000 )
+        {
+        }
+    };
+
+    atomic<bool> s_stopRequested( false );
+
+    void OnSignal( int )
+    {
+        s_stopRequested = true;
+    }
+
+    ErrorType GetErrorType( const Error& error ) { return error.GetType(); }
+    ErrorType GetErrorType( ErrorType error ) { return error; }
+
+    double GetCpuSeconds()
+    {
+#if defined(_WIN32)
+        return 0.0;
+#else
+        struct rusage usage;
+        getrusage( RUSAGE_SELF, &usage );
+        return usage.ru_utime.tv_sec + usage.ru_stime.tv_sec +
+            ( usage.ru_utime.tv_usec + usage.ru_stime.tv_usec ) / 1e6;
+#endif
+    }
+
+    // Number of threads in the process, or 0 if unknown.
+    unsigned int GetThreadCount()
+    {
+        ifstream status( "/proc/self/status" );
+        string line;
+        while ( getline( status, line ) )
+        {
+            if ( line.compare( 0, 8, "Threads:" ) == 0 )
+            {
+                return static_cast<unsigned int>( strtoul( line.c_str() + 8, NULL, 10 ) );
+            }
+        }
+        return 0;
+    }
+
+    // Latency histogram with about 1.5% resolution from 1 us to over an
+    // hour, in constant memory.
+    class LatencyHistogram
+    {
+        public:
+
+            LatencyHistogram() : m_counts( sk_numBuckets, 0 ), m_total( 0 ), m_max( 0 ) {}
+
+            void Add( unsigned long long micros )
+            {
+                m_counts[ GetBucket( micros ) ]++;
+                m_total++;
+                m_max = max( m_max, micros );
+            }
+
+            void Merge( const LatencyHistogram& other )
+            {
+                for ( size_t i = 0; i < m_counts.size(); i++ )
+                {
+                    m_counts[i] += other.m_counts[i];
+                }
+                m_total += other.m_total;
+                m_max = max( m_max, other.m_max );
+            }
+
+            unsigned long long GetCount() const { return m_total; }
+            unsigned long long GetMax() const { return m_max; }
+
+            // Upper bound of the bucket holding the specified percentile.
+            unsigned long long GetPercentile( double percentile ) const
+            {
+                if ( m_total == 0 )
+                {
+                    return 0;
+                }
+
+                const unsigned long long rank =
+                    static_cast<unsigned long long>( ceil( percentile / 100.0 * m_total ) );
+                unsigned long long seen = 0;
+                for ( size_t i = 0; i < m_counts.size(); i++ )
+                {
+                    seen += m_counts[i];
+                    if ( seen >= rank && seen != 0 )
+                    {
+                        return min( GetBucketLimit( i ), m_max );
+                    }
+                }
+                return m_max;
+            }
+
+        private:
+
+            static const unsigned int sk_subBucketBits = 6;
+            static const unsigned int sk_subBuckets = 1u << sk_subBucketBits;
+            static const size_t sk_numBuckets = sk_subBuckets * 40;
+
+            static size_t GetBucket( unsigned long long value )
+            {
+                if ( value < sk_subBuckets )
+                {
+                    return static_cast<size_t>( value );
+                }
+
+                unsigned int exponent = 0;
+                while ( ( value >> exponent ) >= 2 * sk_subBuckets )
+                {
+                    exponent++;
+                }
+                const size_t bucket = ( exponent + 1 ) * sk_subBuckets +
+                    static_cast<size_t>( ( value >> exponent ) - sk_subBuckets );
+                return min( bucket, sk_numBuckets - 1 );
+            }
+
+            static unsigned long long GetBucketLimit( size_t bucket )
+            {
+                if ( bucket < sk_subBuckets )
+                {
+                    return bucket;
+                }
+
+                const unsigned int exponent = static_cast<unsigned int>( bucket / sk_subBuckets - 1 );
+                const unsigned long long mantissa = bucket % sk_subBuckets + sk_subBuckets;
+                return ( ( mantissa + 1 ) << exponent ) - 1;
+            }
+
+            vector<unsigned long long> m_counts;
+            unsigned long long m_total;
+            unsigned long long m_max;
+    };
+
+    // Counters accumulated for a camera over a reporting interval.
+    struct Counters
+    {
+        unsigned long long frames;
+        unsigned long long errors;
+        unsigned long long bytesReceived;
+        unsigned long long bytesConverted;
+        unsigned long long conversionErrors;
+        unsigned long long propertyReads;
+        unsigned long long imageDropped;
+        unsigned long long imageCorrupt;
+        unsigned long long imageXmitFailed;
+        unsigned long long imageDriverDropped;
+        LatencyHistogram latency;
+        LatencyHistogram jitter;
+
+        Counters()
+            : frames( 0 ), errors( 0 ), bytesReceived( 0 ), bytesConverted( 0 ), conversionErrors( 0 ),
+              propertyReads( 0 ), imageDropped( 0 ), imageCorrupt( 0 ), imageXmitFailed( 0 ),
+              imageDriverDropped( 0 )
+        {
+        }
+
+        // Add the driver counters accumulated between two GetStats() calls.
+        void AddStats( const CameraStats& current, const CameraStats& previous )
+        {
+            imageDropped += current.imageDropped - previous.imageDropped;
+            imageCorrupt += current.imageCorrupt - previous.imageCorrupt;
+            imageXmitFailed += current.imageXmitFailed - previous.imageXmitFailed;
+            imageDriverDropped += current.imageDriverDropped - previous.imageDriverDropped;
+        }
+
+        void Merge( const Counters& other )
+        {
+            frames += other.frames;
+            errors += other.errors;
+            bytesReceived += other.bytesReceived;
+            bytesConverted += other.bytesConverted;
+            conversionErrors += other.conversionErrors;
+            propertyReads += other.propertyReads;
+            imageDropped += other.imageDropped;
+            imageCorrupt += other.imageCorrupt;
+            imageXmitFailed += other.imageXmitFailed;
+            imageDriverDropped += other.imageDriverDropped;
+            latency.Merge( other.latency );
+            jitter.Merge( other.jitter );
+        }
+    };
+
+    class CameraRunner
+    {
+        public:
+
+            virtual ~CameraRunner() {}
+
+            virtual ErrorType Configure( const Options& options ) = 0;
+            virtual ErrorType Start( CaptureMode mode ) = 0;
+            virtual void Stop() = 0;
+            virtual void GetStats( CameraStats* pStats ) = 0;
+            virtual unsigned int GetSerialNumber() = 0;
+
+            // Read properties at the specified rate until
+            // StopPropertyLoad(), from the camera or through a cache.
+            virtual ErrorType StartPropertyLoad( double rateHz, bool useCache ) = 0;
+            virtual void StopPropertyLoad() = 0;
+
+            // Take the counters accumulated since the previous call.
+            Counters TakeCounters()
+            {
+                lock_guard<mutex> lock( m_mutex );
+                Counters counters = m_counters;
+                m_counters = Counters();
+                return counters;
+            }
+
+            // Restart delivery jitter measurement, for a new phase.
+            void ResetDeliveryTiming()
+            {
+                lock_guard<mutex> lock( m_mutex );
+                m_hasLastDelivery = false;
+                m_lastInterval = Clock::duration::zero();
+            }
+
+        protected:
+
+            CameraRunner()
+                : m_convertFormat( UNSPECIFIED_PIXEL_FORMAT ),
+                  m_hasLastDelivery( false ),
+                  m_lastInterval( Clock::duration::zero() )
+            {
+            }
+
+            void RecordFrame( Image* pImage, const TimeStamp& timeStamp )
+            {
+                unsigned long long bytesConverted = 0;
+                bool conversionFailed = false;
+                if ( m_convertFormat != UNSPECIFIED_PIXEL_FORMAT )
+                {
+                    // Only the thread delivering this camera's frames uses
+                    // the conversion destination.
+                    if ( pImage->Convert( m_convertFormat, &m_converted ) == PGRERROR_OK )
+                    {
+                        bytesConverted = m_converted.GetDataSize();
+                    }
+                    else
+                    {
+                        conversionFailed = true;
+                    }
+                }
+
+                const long long now = chrono::duration_cast<chrono::microseconds>(
+                    chrono::system_clock::now().time_since_epoch() ).count();
+                const long long stamped = timeStamp.seconds * 1000000 + timeStamp.microSeconds;
+                const Clock::time_point delivered = Clock::now();
+
+                lock_guard<mutex> lock( m_mutex );
+                if ( m_hasLastDelivery )
+                {
+                    const Clock::duration interval = delivered - m_lastDelivery;
+                    if ( m_lastInterval != Clock::duration::zero() )
+                    {
+                        const Clock::duration change = interval > m_lastInterval ?
+                            interval - m_lastInterval : m_lastInterval - interval;
+                        m_counters.jitter.Add( static_cast<unsigned long long>(
+                            chrono::duration_cast<chrono::microseconds>( change ).count() ) );
+                    }
+                    m_lastInterval = interval;
+                }
+                m_lastDelivery = delivered;
+                m_hasLastDelivery = true;
+
+                m_counters.frames++;
+                m_counters.bytesReceived += pImage->GetDataSize();
+                m_counters.bytesConverted += bytesConverted;
+                m_counters.conversionErrors += conversionFailed ? 1 : 0;
+                if ( timeStamp.seconds != 0 && now >= stamped )
+                {
+                    m_counters.latency.Add( static_cast<unsigned long long>( now - stamped ) );
+                }
+            }
+
+            void RecordError()
+            {
+                lock_guard<mutex> lock( m_mutex );
+                m_counters.errors++;
+            }
+
+            void RecordPropertyReads( unsigned int numReads )
+            {
+                lock_guard<mutex> lock( m_mutex );
+                m_counters.propertyReads += numReads;
+            }
+
+            PixelFormat m_convertFormat;
+
+        private:
+
+            mutex m_mutex;
+            Counters m_counters;
+            Image m_converted;
+            bool m_hasLastDelivery;
+            Clock::time_point m_lastDelivery;
+            Clock::duration m_lastInterval;
+    };
+
+    // Properties read by the property load, as a control dialog showing
+    // exposure settings would.
+    const PropertyType sk_loadProperties[] = { SHUTTER, GAIN, FRAME_RATE };
+    const unsigned int sk_numLoadProperties = sizeof(sk_loadProperties) / sizeof(sk_loadProperties[0]);
+    const unsigned int sk_propertyCachePeriodMs = 100;
+
+    // Start capture with a callback that receives the host time stamp of
+    // each frame.
+    template <class RunnerT>
+    ErrorType StartCallbackCapture( Camera* pCamera, RunnerT* pRunner )
+    {
+        return pCamera->StartCapture( &RunnerT::OnImage, pRunner ).GetType();
+    }
+
+    template <class RunnerT>
+    ErrorType StartCallbackCapture( VirtualCamera* pCamera, RunnerT* pRunner )
+    {
+        return pCamera->StartCaptureWithFrameInfo( &RunnerT::OnFrame, pRunner );
+    }
+
+    ErrorType StartSynchronized( vector<Camera*>& cameras )
+    {
+        vector<const Camera*> pointers( cameras.begin(), cameras.end() );
+        return Camera::StartSyncCapture( static_cast<unsigned int>( pointers.size() ), &pointers[0] ).GetType();
+    }
+
+    // Acquisition loop for one camera of any type with the CameraBase
+    // acquisition interface.
+    template <class CameraT>
+    class TypedCameraRunner : public CameraRunner
+    {
+        public:
+
+            explicit TypedCameraRunner( CameraT* pCamera )
+                : m_pCamera( pCamera ),
+                  m_running( false ),
+                  m_propertyCache( pCamera ),
+                  m_propertyLoadRunning( false )
+            {
+            }
+
+            virtual ~TypedCameraRunner()
+            {
+                StopPropertyLoad();
+                Stop();
+            }
+
+            virtual ErrorType Configure( const Options& options )
+            {
+                m_convertFormat = options.convertFormat;
+
+                FC2Config config;
+                ErrorType error = GetErrorType( m_pCamera->GetConfiguration( &config ) );
+                if ( error != PGRERROR_OK )
+                {
+                    return error;
+                }
+
+                config.numBuffers = options.numBuffers;
+                config.grabMode = options.grabMode;
+                config.grabTimeout = 1000;
+                return GetErrorType( m_pCamera->SetConfiguration( &config ) );
+            }
+
+            virtual ErrorType Start( CaptureMode mode )
+            {
+                ErrorType error;
+                if ( mode == CAPTURE_CALLBACK )
+                {
+                    error = StartCallbackCapture( m_pCamera, this );
+                }
+                else
+                {
+                    if ( mode == CAPTURE_POLL )
+                    {
+                        error = GetErrorType( m_pCamera->StartCapture() );
+                        if ( error != PGRERROR_OK )
+                        {
+                            return error;
+                        }
+                    }
+
+                    m_running = true;
+                    m_thread = thread( &TypedCameraRunner::PollLoop, this );
+                    error = PGRERROR_OK;
+                }
+
+                m_pCamera->ResetStats();
+                return error;
+            }
+
+            virtual void Stop()
+            {
+                m_running = false;
+                if ( m_thread.joinable() )
+                {
+                    m_thread.join();
+                }
+                m_pCamera->StopCapture();
+            }
+
+            virtual void GetStats( CameraStats* pStats )
+            {
+                m_pCamera->GetStats( pStats );
+            }
+
+            virtual unsigned int GetSerialNumber()
+            {
+                CameraInfo info;
+                return GetErrorType( m_pCamera->GetCameraInfo( &info ) ) == PGRERROR_OK ? info.serialNumber : 0;
+            }
+
+            virtual ErrorType StartPropertyLoad( double rateHz, bool useCache )
+            {
+                StopPropertyLoad();
+                if ( useCache )
+                {
+                    const ErrorType error = m_propertyCache.Start(
+                        sk_loadProperties, sk_numLoadProperties, sk_propertyCachePeriodMs );
+                    if ( error != PGRERROR_OK )
+                    {
+                        return error;
+                    }
+                }
+
+                m_propertyLoadRunning = true;
+                m_propertyThread = thread( &TypedCameraRunner::PropertyLoop, this, rateHz, useCache );
+                return PGRERROR_OK;
+            }
+
+            virtual void StopPropertyLoad()
+            {
+                m_propertyLoadRunning = false;
+                if ( m_propertyThread.joinable() )
+                {
+                    m_propertyThread.join();
+                }
+                m_propertyCache.Stop();
+            }
+
+            static void OnImage( Image* pImage, const void* pCallbackData )
+            {
+                TypedCameraRunner* pRunner = static_cast<TypedCameraRunner*>( const_cast<void*>( pCallbackData ) );
+                pRunner->RecordFrame( pImage, pImage->GetTimeStamp() );
+            }
+
+            static void OnFrame( Image* pImage, const VirtualFrameInfo* pInfo, const void* pCallbackData )
+            {
+                TypedCameraRunner* pRunner = static_cast<TypedCameraRunner*>( const_cast<void*>( pCallbackData ) );
+                pRunner->RecordFrame( pImage, pInfo->timeStamp );
+            }
+
+        private:
+
+            void PollLoop()
+            {
+                Image image;
+                while ( m_running )
+                {
+                    TimeStamp timeStamp;
+                    ImageMetadata metadata;
+                    const ErrorType error = Detail::RetrieveBufferWithInfo( m_pCamera, &image, &timeStamp, &metadata );
+                    if ( error == PGRERROR_OK )
+                    {
+                        RecordFrame( &image, timeStamp );
+                    }
+                    else if ( m_running && error != PGRERROR_ISOCH_NOT_STARTED )
+                    {
+                        RecordError();
+                    }
+                }
+            }
+
+            void PropertyLoop( double rateHz, bool useCache )
+            {
+                const Clock::duration period = chrono::duration_cast<Clock::duration>(
+                    chrono::duration<double>( 1.0 / rateHz ) );
+                Clock::time_point next = Clock::now();
+                while ( m_propertyLoadRunning )
+                {
+                    for ( unsigned int i = 0; i < sk_numLoadProperties; i++ )
+                    {
+                        Property prop( sk_loadProperties[i] );
+                        if ( useCache )
+                        {
+                            m_propertyCache.GetProperty( &prop );
+                        }
+                        else
+                        {
+                            m_pCamera->GetProperty( &prop );
+                        }
+                    }
+                    RecordPropertyReads( sk_numLoadProperties );
+
+                    next += period;
+                    this_thread::sleep_until( next );
+                }
+            }
+
+            CameraT*                 m_pCamera;
+            atomic<bool>             m_running;
+            thread                   m_thread;
+            PropertyCache<CameraT>   m_propertyCache;
+            atomic<bool>             m_propertyLoadRunning;
+            thread                   m_propertyThread;
+    };
+
+    struct PixelFormatName
+    {
+        PixelFormat format;
+        const char* pName;
+    };
+
+    const PixelFormatName sk_pixelFormatNames[] =
+    {
+        { PIXEL_FORMAT_MONO8, "MONO8" },
+        { PIXEL_FORMAT_MONO12, "MONO12" },
+        { PIXEL_FORMAT_MONO16, "MONO16" },
+        { PIXEL_FORMAT_RAW8, "RAW8" },
+        { PIXEL_FORMAT_RAW12, "RAW12" },
+        { PIXEL_FORMAT_RAW16, "RAW16" },
+        { PIXEL_FORMAT_422YUV8, "422YUV8" },
+        { PIXEL_FORMAT_RGB8, "RGB8" },
+        { PIXEL_FORMAT_BGR, "BGR" },
+        { PIXEL_FORMAT_RGBU, "RGBU" },
+        { PIXEL_FORMAT_BGRU, "BGRU" },
+        { PIXEL_FORMAT_RGB16, "RGB16" },
+        { PIXEL_FORMAT_BGR16, "BGR16" },
+        { PIXEL_FORMAT_BGRU16, "BGRU16" },
+    };
+
+    bool ParsePixelFormat( const string& name, PixelFormat* pFormat )
+    {
+        for ( size_t i = 0; i < sizeof(sk_pixelFormatNames) / sizeof(sk_pixelFormatNames[0]); i++ )
+        {
+            if ( name == sk_pixelFormatNames[i].pName )
+            {
+                *pFormat = sk_pixelFormatNames[i].format;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void PrintUsage()
+    {
+        cerr << "Usage: fc2bench [options]\n"
+             << "  --cameras N           Real cameras to use (default all when no\n"
+             << "                        simulated cameras are requested)\n"
+             << "  --simulated N         Simulated cameras to add\n"
+             << "  --mode poll|callback|sync\n"
+             << "                        Grab mode (default poll)\n"
+             << "  --duration S          Run time in seconds (default 10)\n"
+             << "  --interval S          Reporting interval in seconds (default 1)\n"
+             << "  --buffers N           FC2Config::numBuffers (default 10)\n"
+             << "  --grab-mode buffer|drop\n"
+             << "                        FC2Config::grabMode (default buffer)\n"
+             << "  --convert FORMAT      Convert every frame, e.g. BGR or MONO8\n"
+             << "  --sim-size WxH        Simulated frame size (default 1280x1024)\n"
+             << "  --sim-format FORMAT   Simulated pixel format (default MONO8)\n"
+             << "  --sim-fps F           Simulated frame rate (default 30, 0 for\n"
+             << "                        as fast as possible)\n"
+             << "  --property-rate HZ    Read shutter, gain and frame rate at HZ per\n"
+             << "                        camera while capturing\n"
+             << "  --property-source direct|cache|both\n"
+             << "                        Read properties from the camera, through a\n"
+             << "                        PropertyCache, or half the run each (default\n"
+             << "                        both)\n"
+             << "  --sweep N,N,...       Run simulated cameras only, once per camera\n"
+             << "                        count, e.g. 1,2,4,8,16,32,64, for --duration\n"
+             << "                        seconds each\n"
+             << "  --trigger-skew N      Fire software triggers on N simulated cameras,\n"
+             << "                        in sequence and concurrently, and report the\n"
+             << "                        skew between cameras\n"
+             << "  --control-latency US  Simulated register access latency for\n"
+             << "                        --trigger-skew (default 500)\n"
+             << "  --triggers N          Triggers per method for --trigger-skew\n"
+             << "                        (default 1000)\n"
+             << "  --output FILE         Write JSON Lines to FILE instead of stdout\n";
+    }
+
+    bool ParseOptions( int argc, char** argv, Options* pOptions )
+    {
+        bool camerasSpecified = false;
+        for ( int i = 1; i < argc; i++ )
+        {
+            const string arg = argv[i];
+            if ( i + 1 >= argc )
+            {
+                return false;
+            }
+
+            const string value = argv[++i];
+            if ( arg == "--cameras" )
+            {
+                pOptions->numCameras = static_cast<unsigned int>( strtoul( value.c_str(), NULL, 10 ) );
+                camerasSpecified = true;
+            }
+            else if ( arg == "--simulated" )
+            {
+                pOptions->numSimulated = static_cast<unsigned int>( strtoul( value.c_str(), NULL, 10 ) );
+            }
+            else if ( arg == "--mode" )
+            {
+                if ( value == "poll" )
+                {
+                    pOptions->mode = CAPTURE_POLL;
+                }
+                else if ( value == "callback" )
+                {
+                    pOptions->mode = CAPTURE_CALLBACK;
+                }
+                else if ( value == "sync" )
+                {
+                    pOptions->mode = CAPTURE_SYNC;
+                }
+                else
+                {
+                    return false;
+                }
+            }
+            else if ( arg == "--duration" )
+            {
+                pOptions->durationSeconds = atof( value.c_str() );
+            }
+            else if ( arg == "--interval" )
+            {
+                pOptions->intervalSeconds = atof( value.c_str() );
+            }
+            else if ( arg == "--buffers" )
+            {
+                pOptions->numBuffers = static_cast<unsigned int>( strtoul( value.c_str(), NULL, 10 ) );
+            }
+            else if ( arg == "--grab-mode" )
+            {
+                if ( value == "buffer" )
+                {
+                    pOptions->grabMode = BUFFER_FRAMES;
+                }
+                else if ( value == "drop" )
+                {
+                    pOptions->grabMode = DROP_FRAMES;
+                }
+                else
+                {
+                    return false;
+                }
+            }
+            else if ( arg == "--convert" )
+            {
+                if ( !ParsePixelFormat( value, &pOptions->convertFormat ) )
+                {
+                    return false;
+                }
+            }
+            else if ( arg == "--sim-size" )
+            {
+                if ( sscanf( value.c_str(), "%ux%u", &pOptions->simulated.cols, &pOptions->simulated.rows ) != 2 )
+                {
+                    return false;
+                }
+            }
+            else if ( arg == "--sim-format" )
+            {
+                if ( !ParsePixelFormat( value, &pOptions->simulated.pixelFormat ) )
+                {
+                    return false;
+                }
+                if ( pOptions->simulated.pixelFormat == PIXEL_FORMAT_RAW8 ||
+                     pOptions->simulated.pixelFormat == PIXEL_FORMAT_RAW12 ||
+                     pOptions->simulated.pixelFormat == PIXEL_FORMAT_RAW16 )
+                {
+                    pOptions->simulated.bayerFormat = RGGB;
+                }
+            }
+            else if ( arg == "--sim-fps" )
+            {
+                pOptions->simulated.frameRate = static_cast<float>( atof( value.c_str() ) );
+            }
+            else if ( arg == "--property-rate" )
+            {
+                pOptions->propertyRateHz = atof( value.c_str() );
+            }
+            else if ( arg == "--property-source" )
+            {
+                if ( value == "direct" )
+                {
+                    pOptions->propertySource = PROPERTY_DIRECT;
+                }
+                else if ( value == "cache" )
+                {
+                    pOptions->propertySource = PROPERTY_CACHE;
+                }
+                else if ( value == "both" )
+                {
+                    pOptions->propertySource = PROPERTY_BOTH;
+                }
+                else
+                {
+                    return false;
+                }
+            }
+            else if ( arg == "--sweep" )
+            {
+                istringstream list( value );
+                string count;
+                while ( getline( list, count, ',' ) )
+                {
+                    const unsigned int numCameras = static_cast<unsigned int>( strtoul( count.c_str(), NULL, 10 ) );
+                    if ( numCameras == 0 )
+                    {
+                        return false;
+                    }
+                    pOptions->sweepCounts.push_back( numCameras );
+                }
+            }
+            else if ( arg == "--trigger-skew" )
+            {
+                pOptions->numSkewCameras = static_cast<unsigned int>( strtoul( value.c_str(), NULL, 10 ) );
+            }
+            else if ( arg == "--control-latency" )
+            {
+                pOptions->controlLatencyUs = static_cast<unsigned int>( strtoul( value.c_str(), NULL, 10 ) );
+            }
+            else if ( arg == "--triggers" )
+            {
+                pOptions->numTriggers = static_cast<unsigned int>( strtoul( value.c_str(), NULL, 10 ) );
+            }
+            else if ( arg == "--output" )
+            {
+                pOptions->outputPath = value;
+            }
+            else
+            {
+                return false;
+            }
+        }
+
+        if ( !camerasSpecified && pOptions->numSimulated == 0 && pOptions->sweepCounts.empty() &&
+             pOptions->numSkewCameras == 0 )
+        {
+            pOptions->numCameras = ~0u;
+        }
+        return pOptions->durationSeconds > 0.0 && pOptions->intervalSeconds > 0.0 &&
+            pOptions->propertyRateHz >= 0.0 && pOptions->numTriggers != 0;
+    }
+
+    // Write one JSON Lines record for the specified counters.
+    void WriteRecord(
+        ostream&                         out,
+        const char*                      pType,
+        const char*                      pPhase,
+        double                           elapsedSeconds,
+        double                           periodSeconds,
+        double                           cpuSeconds,
+        const vector<CameraRunner*>&     runners,
+        const vector<Counters>&          counters )
+    {
+        unsigned long long totalFrames = 0;
+        for ( size_t i = 0; i < counters.size(); i++ )
+        {
+            totalFrames += counters[i].frames;
+        }
+
+        out << "{\"type\": \"" << pType << "\""
+            << ", \"phase\": \"" << pPhase << "\""
+            << ", \"elapsed_s\": " << elapsedSeconds
+            << ", \"period_s\": " << periodSeconds
+            << ", \"cpu_s\": " << cpuSeconds
+            << ", \"cpu_us_per_frame\": " << ( totalFrames != 0 ? cpuSeconds * 1e6 / totalFrames : 0.0 )
+            << ", \"cameras\": [";
+
+        for ( size_t i = 0; i < runners.size(); i++ )
+        {
+            const Counters& c = counters[i];
+            out << ( i == 0 ? "" : ", " )
+                << "{\"serial\": " << runners[i]->GetSerialNumber()
+                << ", \"frames\": " << c.frames
+                << ", \"fps\": " << c.frames / periodSeconds
+                << ", \"retrieve_errors\": " << c.errors
+                << ", \"conversion_errors\": " << c.conversionErrors
+                << ", \"image_dropped\": " << c.imageDropped
+                << ", \"image_corrupt\": " << c.imageCorrupt
+                << ", \"image_xmit_failed\": " << c.imageXmitFailed
+                << ", \"image_driver_dropped\": " << c.imageDriverDropped
+                << ", \"received_mb_s\": " << c.bytesReceived / periodSeconds / 1e6
+                << ", \"converted_mb_s\": " << c.bytesConverted / periodSeconds / 1e6
+                << ", \"latency_samples\": " << c.latency.GetCount()
+                << ", \"latency_us\": {\"p50\": " << c.latency.GetPercentile( 50.0 )
+                << ", \"p90\": " << c.latency.GetPercentile( 90.0 )
+                << ", \"p99\": " << c.latency.GetPercentile( 99.0 )
+                << ", \"p99_9\": " << c.latency.GetPercentile( 99.9 )
+                << ", \"max\": " << c.latency.GetMax() << "}"
+                << ", \"property_reads_s\": " << c.propertyReads / periodSeconds
+                << ", \"jitter_us\": {\"p50\": " << c.jitter.GetPercentile( 50.0 )
+                << ", \"p90\": " << c.jitter.GetPercentile( 90.0 )
+                << ", \"p99\": " << c.jitter.GetPercentile( 99.0 )
+                << ", \"p99_9\": " << c.jitter.GetPercentile( 99.9 )
+                << ", \"max\": " << c.jitter.GetMax() << "}}";
+        }
+        out << "]}" << endl;
+    }
+
+    // Counters of a phase over all of its cameras.
+    struct PhaseResult
+    {
+        double elapsedSeconds;
+        double cpuSeconds;
+        Counters totals;
+
+        PhaseResult() : elapsedSeconds( 0.0 ), cpuSeconds( 0.0 ) {}
+    };
+
+    // Report on the running cameras for the specified duration. Interval
+    // records and a summary record for the phase are written if requested.
+    void RunPhase(
+        ostream&                         out,
+        const char*                      pPhase,
+        double                           durationSeconds,
+        double                           intervalSeconds,
+        const vector<CameraRunner*>&     runners,
+        bool                             writeRecords,
+        PhaseResult*                     pResult = NULL )
+    {
+        const Clock::time_point start = Clock::now();
+        const Clock::time_point end = start + chrono::duration_cast<Clock::duration>(
+            chrono::duration<double>( durationSeconds ) );
+        const Clock::duration interval = chrono::duration_cast<Clock::duration>(
+            chrono::duration<double>( intervalSeconds ) );
+
+        vector<Counters> totals( runners.size() );
+        vector<CameraStats> previousStats( runners.size() );
+        for ( size_t i = 0; i < runners.size(); i++ )
+        {
+            runners[i]->GetStats( &previousStats[i] );
+        }
+        const double cpuStart = GetCpuSeconds();
+        double cpuPrevious = cpuStart;
+        Clock::time_point previous = start;
+
+        while ( !s_stopRequested && previous < end )
+        {
+            const Clock::time_point next = min( previous + interval, end );
+            while ( !s_stopRequested && Clock::now() < next )
+            {
+                this_thread::sleep_for( chrono::milliseconds( 10 ) );
+            }
+
+            const Clock::time_point now = Clock::now();
+            const double cpu = GetCpuSeconds();
+            vector<Counters> counters( runners.size() );
+            for ( size_t i = 0; i < runners.size(); i++ )
+            {
+                counters[i] = runners[i]->TakeCounters();
+                CameraStats stats;
+                runners[i]->GetStats( &stats );
+                counters[i].AddStats( stats, previousStats[i] );
+                previousStats[i] = stats;
+                totals[i].Merge( counters[i] );
+            }
+
+            if ( writeRecords )
+            {
+                WriteRecord(
+                    out,
+                    "interval",
+                    pPhase,
+                    chrono::duration<double>( now - start ).count(),
+                    chrono::duration<double>( now - previous ).count(),
+                    cpu - cpuPrevious,
+                    runners,
+                    counters );
+            }
+            previous = now;
+            cpuPrevious = cpu;
+        }
+
+        const double elapsed = chrono::duration<double>( previous - start ).count();
+        if ( writeRecords )
+        {
+            WriteRecord( out, "summary", pPhase, elapsed, elapsed, cpuPrevious - cpuStart, runners, totals );
+        }
+
+        if ( pResult != NULL )
+        {
+            pResult->elapsedSeconds = elapsed;
+            pResult->cpuSeconds = cpuPrevious - cpuStart;
+            pResult->totals = Counters();
+            for ( size_t i = 0; i < totals.size(); i++ )
+            {
+                pResult->totals.Merge( totals[i] );
+            }
+        }
+    }
+
+    unique_ptr<SimulatedCamera> CreateSimulatedCamera( const Options& options, unsigned int serialNumber )
+    {
+        SimulatedCameraSettings settings = options.simulated;
+        settings.serialNumber = serialNumber;
+        unique_ptr<SimulatedCamera> camera( new SimulatedCamera( settings ) );
+        camera->Connect();
+        return camera;
+    }
+
+    // Run each camera count of the sweep in turn and write one record per
+    // count.
+    int RunSweep( ostream& out, const Options& options )
+    {
+        for ( size_t step = 0; step < options.sweepCounts.size() && !s_stopRequested; step++ )
+        {
+            const unsigned int numCameras = options.sweepCounts[step];
+            vector< unique_ptr<SimulatedCamera> > cameras;
+            vector< unique_ptr<CameraRunner> > runners;
+            vector<CameraRunner*> runnerPointers;
+            for ( unsigned int i = 0; i < numCameras; i++ )
+            {
+                cameras.push_back( CreateSimulatedCamera( options, i + 1 ) );
+                runners.push_back( unique_ptr<CameraRunner>( new TypedCameraRunner<VirtualCamera>( cameras.back().get() ) ) );
+                runnerPointers.push_back( runners.back().get() );
+
+                ErrorType error = runners.back()->Configure( options );
+                if ( error == PGRERROR_OK )
+                {
+                    // Simulated cameras have no synchronized start, so
+                    // sync mode polls cameras started in sequence.
+                    error = runners.back()->Start( options.mode == CAPTURE_SYNC ? CAPTURE_POLL : options.mode );
+                }
+                if ( error != PGRERROR_OK )
+                {
+                    cerr << "Failed to start simulated camera " << i << ": error " << error << endl;
+                    return -1;
+                }
+            }
+
+            // Skip start up before measuring.
+            this_thread::sleep_for( chrono::milliseconds( 200 ) );
+            for ( size_t i = 0; i < runners.size(); i++ )
+            {
+                runners[i]->TakeCounters();
+                runners[i]->ResetDeliveryTiming();
+            }
+
+            PhaseResult result;
+            RunPhase( out, "sweep", options.durationSeconds, options.intervalSeconds, runnerPointers, false, &result );
+            const unsigned int numThreads = GetThreadCount();
+
+            for ( size_t i = 0; i < runners.size(); i++ )
+            {
+                runners[i]->Stop();
+            }
+
+            const Counters& c = result.totals;
+            const double elapsed = result.elapsedSeconds > 0.0 ? result.elapsedSeconds : 1.0;
+            out << "{\"type\": \"sweep\""
+                << ", \"num_cameras\": " << numCameras
+                << ", \"threads\": " << numThreads
+                << ", \"elapsed_s\": " << result.elapsedSeconds
+                << ", \"cpu_s\": " << result.cpuSeconds
+                << ", \"cpu_percent\": " << result.cpuSeconds * 100.0 / elapsed
+                << ", \"cpu_us_per_frame\": " << ( c.frames != 0 ? result.cpuSeconds * 1e6 / c.frames : 0.0 )
+                << ", \"frames\": " << c.frames
+                << ", \"fps\": " << c.frames / elapsed
+                << ", \"fps_per_camera\": " << c.frames / elapsed / numCameras
+                << ", \"retrieve_errors\": " << c.errors
+                << ", \"image_dropped\": " << c.imageDropped
+                << ", \"latency_us\": {\"p50\": " << c.latency.GetPercentile( 50.0 )
+                << ", \"p99\": " << c.latency.GetPercentile( 99.0 )
+                << ", \"max\": " << c.latency.GetMax() << "}"
+                << ", \"jitter_us\": {\"p50\": " << c.jitter.GetPercentile( 50.0 )
+                << ", \"p99\": " << c.jitter.GetPercentile( 99.0 )
+                << ", \"max\": " << c.jitter.GetMax() << "}}" << endl;
+
+            runners.clear();
+            for ( size_t i = 0; i < cameras.size(); i++ )
+            {
+                cameras[i]->Disconnect();
+            }
+        }
+        return 0;
+    }
+
+    // Skew histograms of one trigger method, in nanoseconds.
+    struct SkewCounters
+    {
+        LatencyHistogram issueSkew;
+        LatencyHistogram completionSkew;
+        double issueSkewSum;
+        double completionSkewSum;
+        unsigned long long failures;
+
+        SkewCounters() : issueSkewSum( 0.0 ), completionSkewSum( 0.0 ), failures( 0 ) {}
+
+        void Add( chrono::nanoseconds issue, chrono::nanoseconds completion )
+        {
+            issueSkew.Add( static_cast<unsigned long long>( issue.count() ) );
+            completionSkew.Add( static_cast<unsigned long long>( completion.count() ) );
+            issueSkewSum += static_cast<double>( issue.count() );
+            completionSkewSum += static_cast<double>( completion.count() );
+        }
+    };
+
+    void WriteSkewRecord( ostream& out, const char* pMethod, const Options& options, const SkewCounters& c )
+    {
+        const double n = c.issueSkew.GetCount() != 0 ? static_cast<double>( c.issueSkew.GetCount() ) : 1.0;
+        out << "{\"type\": \"trigger_skew\""
+            << ", \"method\": \"" << pMethod << "\""
+            << ", \"num_cameras\": " << options.numSkewCameras
+            << ", \"control_latency_us\": " << options.controlLatencyUs
+            << ", \"triggers\": " << c.issueSkew.GetCount()
+            << ", \"failures\": " << c.failures
+            << ", \"issue_skew_ns\": {\"mean\": " << c.issueSkewSum / n
+            << ", \"p50\": " << c.issueSkew.GetPercentile( 50.0 )
+            << ", \"p99\": " << c.issueSkew.GetPercentile( 99.0 )
+            << ", \"max\": " << c.issueSkew.GetMax() << "}"
+            << ", \"completion_skew_ns\": {\"mean\": " << c.completionSkewSum / n
+            << ", \"p50\": " << c.completionSkew.GetPercentile( 50.0 )
+            << ", \"p99\": " << c.completionSkew.GetPercentile( 99.0 )
+            << ", \"max\": " << c.completionSkew.GetMax() << "}}" << endl;
+    }
+
+    // Fire the same number of triggers on simulated cameras with control
+    // latency, writing to one camera after another and then through a
+    // MultiCameraTrigger, and write the skew of each method.
+    int RunTriggerSkew( ostream& out, const Options& options )
+    {
+        vector< unique_ptr<SimulatedCamera> > cameras;
+        vector<VirtualCamera*> cameraPointers;
+        for ( unsigned int i = 0; i < options.numSkewCameras; i++ )
+        {
+            cameras.push_back( CreateSimulatedCamera( options, i + 1 ) );
+            cameras.back()->SetControlLatency( chrono::microseconds( options.controlLatencyUs ) );
+
+            TriggerMode triggerMode;
+            triggerMode.onOff = true;
+            triggerMode.mode = 0;
+            triggerMode.source = VirtualCamera::sk_softwareTriggerSource;
+            cameras.back()->SetTriggerMode( &triggerMode );
+            cameraPointers.push_back( cameras.back().get() );
+        }
+
+        SkewCounters sequential;
+        vector<Clock::time_point> issueTimes( cameraPointers.size() );
+        vector<Clock::time_point> completionTimes( cameraPointers.size() );
+        for ( unsigned int t = 0; t < options.numTriggers && !s_stopRequested; t++ )
+        {
+            for ( size_t i = 0; i < cameraPointers.size(); i++ )
+            {
+                issueTimes[i] = Clock::now();
+                if ( cameraPointers[i]->FireSoftwareTrigger() != PGRERROR_OK )
+                {
+                    sequential.failures++;
+                }
+                completionTimes[i] = Clock::now();
+            }
+            sequential.Add( issueTimes.back() - issueTimes.front(), completionTimes.back() - completionTimes.front() );
+        }
+        WriteSkewRecord( out, "sequential", options, sequential );
+
+        SkewCounters concurrent;
+        {
+            MultiCameraTrigger<VirtualCamera> trigger;
+            trigger.SetCameras( &cameraPointers[0], static_cast<unsigned int>( cameraPointers.size() ) );
+            for ( unsigned int t = 0; t < options.numTriggers && !s_stopRequested; t++ )
+            {
+                MultiCameraTriggerResult result;
+                trigger.Fire( &result );
+                concurrent.Add( result.issueSkew, result.completionSkew );
+                concurrent.failures += result.numFailures;
+            }
+        }
+        WriteSkewRecord( out, "concurrent", options, concurrent );
+
+        for ( size_t i = 0; i < cameras.size(); i++ )
+        {
+            cameras[i]->Disconnect();
+        }
+        return 0;
+    }
+}
+
+int main( int argc, char** argv )
+{
+    Options options;
+    if ( !ParseOptions( argc, argv, &options ) )
+    {
+        PrintUsage();
+        return -1;
+    }
+
+    signal( SIGINT, OnSignal );
+    signal( SIGTERM, OnSignal );
+
+    ofstream file;
+    if ( !options.outputPath.empty() )
+    {
+        file.open( options.outputPath.c_str() );
+        if ( !file )
+        {
+            cerr << "Failed to open " << options.outputPath << endl;
+            return -1;
+        }
+    }
+    ostream& out = options.outputPath.empty() ? cout : file;
+
+    if ( !options.sweepCounts.empty() )
+    {
+        return RunSweep( out, options );
+    }
+
+    if ( options.numSkewCameras != 0 )
+    {
+        return RunTriggerSkew( out, options );
+    }
+
+    vector< unique_ptr<Camera> > cameras;
+    vector< unique_ptr<SimulatedCamera> > simulatedCameras;
+    vector< unique_ptr<CameraRunner> > runners;
+    vector<CameraRunner*> runnerPointers;
+
+    if ( options.numCameras != 0 )
+    {
+        BusManager busManager;
+        unsigned int numAvailable = 0;
+        Error error = busManager.GetNumOfCameras( &numAvailable );
+        if ( error != PGRERROR_OK )
+        {
+            error.PrintErrorTrace();
+            return -1;
+        }
+
+        const unsigned int numCameras = min( numAvailable, options.numCameras );
+        for ( unsigned int i = 0; i < numCameras; i++ )
+        {
+            PGRGuid guid;
+            error = busManager.GetCameraFromIndex( i, &guid );
+            if ( error == PGRERROR_OK )
+            {
+                cameras.push_back( unique_ptr<Camera>( new Camera() ) );
+                error = cameras.back()->Connect( &guid );
+            }
+            if ( error != PGRERROR_OK )
+            {
+                error.PrintErrorTrace();
+                return -1;
+            }
+
+            runners.push_back( unique_ptr<CameraRunner>( new TypedCameraRunner<Camera>( cameras.back().get() ) ) );
+        }
+    }
+
+    for ( unsigned int i = 0; i < options.numSimulated; i++ )
+    {
+        simulatedCameras.push_back( CreateSimulatedCamera( options, i + 1 ) );
+        runners.push_back( unique_ptr<CameraRunner>(
+            new TypedCameraRunner<VirtualCamera>( simulatedCameras.back().get() ) ) );
+    }
+
+    if ( runners.empty() )
+    {
+        cerr << "No cameras to benchmark" << endl;
+        return -1;
+    }
+
+    for ( size_t i = 0; i < runners.size(); i++ )
+    {
+        const ErrorType error = runners[i]->Configure( options );
+        if ( error != PGRERROR_OK )
+        {
+            cerr << "Failed to configure camera " << i << ": error " << error << endl;
+            return -1;
+        }
+        runnerPointers.push_back( runners[i].get() );
+    }
+
+    if ( options.mode == CAPTURE_SYNC )
+    {
+        vector<Camera*> syncCameras;
+        for ( size_t i = 0; i < cameras.size(); i++ )
+        {
+            syncCameras.push_back( cameras[i].get() );
+        }
+        for ( size_t i = 0; i < simulatedCameras.size(); i++ )
+        {
+            simulatedCameras[i]->StartCapture();
+        }
+        if ( !syncCameras.empty() && StartSynchronized( syncCameras ) != PGRERROR_OK )
+        {
+            cerr << "Failed to start synchronized capture" << endl;
+            return -1;
+        }
+    }
+
+    for ( size_t i = 0; i < runners.size(); i++ )
+    {
+        const ErrorType error = runners[i]->Start( options.mode );
+        if ( error != PGRERROR_OK )
+        {
+            cerr << "Failed to start camera " << i << ": error " << error << endl;
+            return -1;
+        }
+    }
+
+    struct Phase
+    {
+        const char* pName;
+        bool loadProperties;
+        bool useCache;
+        double durationSeconds;
+    };
+
+    vector<Phase> phases;
+    if ( options.propertyRateHz <= 0.0 )
+    {
+        const Phase phase = { "capture", false, false, options.durationSeconds };
+        phases.push_back( phase );
+    }
+    else if ( options.propertySource == PROPERTY_BOTH )
+    {
+        const Phase direct = { "property_direct", true, false, options.durationSeconds / 2 };
+        const Phase cached = { "property_cache", true, true, options.durationSeconds / 2 };
+        phases.push_back( direct );
+        phases.push_back( cached );
+    }
+    else
+    {
+        const bool useCache = options.propertySource == PROPERTY_CACHE;
+        const Phase phase = {
+            useCache ? "property_cache" : "property_direct", true, useCache, options.durationSeconds };
+        phases.push_back( phase );
+    }
+
+    for ( size_t p = 0; p < phases.size() && !s_stopRequested; p++ )
+    {
+        for ( size_t i = 0; i < runners.size(); i++ )
+        {
+            runners[i]->TakeCounters();
+            runners[i]->ResetDeliveryTiming();
+            if ( phases[p].loadProperties )
+            {
+                const ErrorType error = runners[i]->StartPropertyLoad( options.propertyRateHz, phases[p].useCache );
+                if ( error != PGRERROR_OK )
+                {
+                    cerr << "Failed to start property load on camera " << i << ": error " << error << endl;
+                    return -1;
+                }
+            }
+        }
+
+        RunPhase( out, phases[p].pName, phases[p].durationSeconds, options.intervalSeconds, runnerPointers, true );
+
+        for ( size_t i = 0; i < runners.size(); i++ )
+        {
+            runners[i]->StopPropertyLoad();
+        }
+    }
+
+    for ( size_t i = 0; i < runners.size(); i++ )
+    {
+        runners[i]->Stop();
+    }
+
+    runners.clear();
+    for ( size_t i = 0; i < cameras.size(); i++ )
+    {
+        cameras[i]->Disconnect();
+    }
+    for ( size_t i = 0; i < simulatedCameras.size(); i++ )
+    {
+        simulatedCameras[i]->Disconnect();
+    }
+
+    return 0;
+}
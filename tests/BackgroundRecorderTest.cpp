@@ -0,0 +1,212 @@
+//=============================================================================
+// Copyright (c) 2001-2018 FLIR Systems, Inc. All Rights Reserved.
+//
+// This software is the confidential and proprietary information of FLIR
+// Integrated Imaging Solutions, Inc. ("Confidential Information"). You
+// shall not disclose such Confidential Information and shall use it only in
+// accordance with the terms of the license agreement you entered into
+// with FLIR Integrated Imaging Solutions, Inc. (FLIR).
+//
+// FLIR MAKES NO REPRESENTATIONS OR WARRANTIES ABOUT THE SUITABILITY OF THE
+// SOFTWARE, EITHER EXPRESSED OR IMPLIED, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+// PURPOSE, OR NON-INFRINGEMENT. FLIR SHALL NOT BE LIABLE FOR ANY DAMAGES
+// SUFFERED BY LICENSEE AS A RESULT OF USING, MODIFYING OR DISTRIBUTING
+// THIS SOFTWARE OR ITS DERIVATIVES.
+//=============================================================================
+
+
+#include "TestSupport.h"
+#include "BackgroundRecorder.h"
+#include "MemoryBudget.h"
+#include "SimulatedCamera.h"
+
+#include <condition_variable>
+#include <mutex>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace FlyCapture2;
+
+namespace
+{
+	std::string GetTempFilename( const char* pName )
+	{
+		const char* pDirectory = getenv( "TMPDIR" );
+		return std::string( pDirectory != NULL ? pDirectory : "/tmp" ) + "/" + pName;
+	}
+
+	// Holds every write until released, so frames stay in the recorder.
+	class BlockingSink : public RecordingSink
+	{
+		public:
+
+			BlockingSink() : m_released( false ) {}
+
+			ErrorType Write( Image&, const TimeStamp&, const ImageMetadata&, unsigned long long )
+			{
+				std::unique_lock<std::mutex> lock( m_mutex );
+				m_condition.wait( lock, [this] { return m_released; } );
+				return PGRERROR_OK;
+			}
+
+			ErrorType Close()
+			{
+				return PGRERROR_OK;
+			}
+
+			void Release()
+			{
+				std::lock_guard<std::mutex> lock( m_mutex );
+				m_released = true;
+				m_condition.notify_all();
+			}
+
+		private:
+
+			std::mutex              m_mutex;
+			std::condition_variable m_condition;
+			bool                    m_released;
+	};
+
+	void RecordFrame( Image* pImage, const VirtualFrameInfo* pInfo, const void* pCallbackData )
+	{
+		BackgroundRecorder* pRecorder = static_cast<BackgroundRecorder*>( const_cast<void*>( pCallbackData ) );
+		pRecorder->Record( *pImage, pInfo->timeStamp, pInfo->metadata );
+	}
+}
+
+FC2_TEST( RawSequenceSinkKeepsOutOfBandTiming )
+{
+	const std::string filename = GetTempFilename( "fc2-recorder-timing.fc2seq" );
+
+	SimulatedCameraSettings settings;
+	settings.rows = 32;
+	settings.cols = 64;
+	settings.frameRate = 200.0f;
+	SimulatedCamera camera( settings );
+	camera.Connect();
+
+	RawSequenceSink sink( filename.c_str() );
+	BackgroundRecorder recorder( 16 );
+	FC2_CHECK_OK( recorder.Start( &sink ) );
+	FC2_CHECK_OK( camera.StartCaptureWithFrameInfo( &RecordFrame, &recorder ) );
+	FC2_CHECK( FC2Test::WaitFor( [&recorder] {
+		RecorderStats stats;
+		recorder.GetStats( &stats );
+		return stats.numWritten >= 5; } ) );
+	camera.StopCapture();
+	FC2_CHECK_OK( recorder.Stop() );
+
+	RawSequenceReader reader;
+	FC2_CHECK_OK( reader.Open( filename.c_str() ) );
+	FC2_CHECK( reader.GetNumFrames() >= 5 );
+	for ( unsigned long long i = 0; i < reader.GetNumFrames(); i++ )
+	{
+		TimeStamp timeStamp;
+		ImageMetadata metadata;
+		FC2_CHECK_OK( reader.ReadFrameInfo( i, &timeStamp, &metadata ) );
+		FC2_CHECK( timeStamp.seconds != 0 );
+		FC2_CHECK( metadata.embeddedFrameCounter == i );
+	}
+	reader.Close();
+	remove( filename.c_str() );
+}
+
+FC2_TEST( RawSequenceSinkOpensOnFirstWrite )
+{
+	const std::string filename = GetTempFilename( "fc2-recorder-open.fc2seq" );
+	std::vector<unsigned char> data( 8 * 8, 7 );
+	Image frame( 8, 8, 8, &data[0], static_cast<unsigned int>( data.size() ), PIXEL_FORMAT_MONO8 );
+
+	// The index of the first frame does not decide when the file opens,
+	// and a second recording after Close() replaces the file.
+	RawSequenceSink sink( filename.c_str() );
+	FC2_CHECK_OK( sink.Write( frame, TimeStamp(), ImageMetadata(), 5 ) );
+	FC2_CHECK_OK( sink.Write( frame, TimeStamp(), ImageMetadata(), 0 ) );
+	FC2_CHECK_OK( sink.Close() );
+	FC2_CHECK_OK( sink.Write( frame, TimeStamp(), ImageMetadata(), 1 ) );
+	FC2_CHECK_OK( sink.Close() );
+
+	RawSequenceReader reader;
+	FC2_CHECK_OK( reader.Open( filename.c_str() ) );
+	FC2_CHECK( reader.GetNumFrames() == 1 );
+	reader.Close();
+	remove( filename.c_str() );
+}
+
+FC2_TEST( WriteRateFallsWhenWritesStop )
+{
+	const std::string filename = GetTempFilename( "fc2-recorder-rate.fc2seq" );
+	std::vector<unsigned char> data( 256 * 1024 );
+	Image frame( 256, 1024, 1024, &data[0], static_cast<unsigned int>( data.size() ), PIXEL_FORMAT_MONO8 );
+
+	RawSequenceSink sink( filename.c_str() );
+	BackgroundRecorder recorder( 4 );
+	FC2_CHECK_OK( recorder.Start( &sink ) );
+	FC2_CHECK( recorder.Record( frame ) );
+	FC2_CHECK( FC2Test::WaitFor( [&recorder] {
+		RecorderStats stats;
+		recorder.GetStats( &stats );
+		return stats.numWritten == 1; } ) );
+
+	RecorderStats stats;
+	std::this_thread::sleep_for( std::chrono::milliseconds( 1100 ) );
+	recorder.GetStats( &stats );
+	FC2_CHECK( stats.writeRateMBps > 0.0 );
+
+	std::this_thread::sleep_for( std::chrono::milliseconds( 1100 ) );
+	recorder.GetStats( &stats );
+	FC2_CHECK( stats.writeRateMBps == 0.0 );
+
+	FC2_CHECK_OK( recorder.Stop() );
+	recorder.GetStats( &stats );
+	FC2_CHECK( stats.writeRateMBps == 0.0 );
+	FC2_CHECK( stats.bytesWritten == data.size() );
+	remove( filename.c_str() );
+}
+
+FC2_TEST( BackgroundRecorderDropsFramesOverBudget )
+{
+	std::vector<unsigned char> data( 100 * 100 );
+	Image frame( 100, 100, 100, &data[0], static_cast<unsigned int>( data.size() ), PIXEL_FORMAT_MONO8 );
+
+	MemoryBudget budget;
+	budget.SetLimit( 25000 );
+	{
+		BlockingSink sink;
+		BackgroundRecorder recorder( 8, &budget );
+		FC2_CHECK_OK( recorder.Start( &sink ) );
+
+		// The writer holds the first frame, the second is queued, and a
+		// third pool image would exceed the limit.
+		FC2_CHECK( recorder.Record( frame ) );
+		FC2_CHECK( FC2Test::WaitFor( [&recorder] {
+			RecorderStats stats;
+			recorder.GetStats( &stats );
+			return stats.numQueued == 0; } ) );
+		FC2_CHECK( recorder.Record( frame ) );
+		FC2_CHECK( !recorder.Record( frame ) );
+
+		MemoryFootprint footprint;
+		budget.GetFootprint( &recorder, &footprint );
+		FC2_CHECK( footprint.bytes[MEMORY_ENCODER] == 2 * data.size() );
+
+		sink.Release();
+		FC2_CHECK_OK( recorder.Stop() );
+
+		RecorderStats stats;
+		recorder.GetStats( &stats );
+		FC2_CHECK( stats.numWritten == 2 );
+		FC2_CHECK( stats.numDropped == 1 );
+	}
+
+	MemoryFootprint total;
+	budget.GetTotalFootprint( &total );
+	FC2_CHECK( total.GetTotal() == 0 );
+}
+
+FC2_TEST_MAIN()
@@ -0,0 +1,150 @@
+//=============================================================================
+// Copyright (c) 2001-2018 FLIR Systems, Inc. All Rights Reserved.
+//
+// This software is the confidential and proprietary information of FLIR
+// Integrated Imaging Solutions, Inc. ("Confidential Information"). You
+// shall not disclose such Confidential Information and shall use it only in
+// accordance with the terms of the license agreement you entered into
+// with FLIR Integrated Imaging Solutions, Inc. (FLIR).
+//
+// FLIR MAKES NO REPRESENTATIONS OR WARRANTIES ABOUT THE SUITABILITY OF THE
+// SOFTWARE, EITHER EXPRESSED OR IMPLIED, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+// PURPOSE, OR NON-INFRINGEMENT. FLIR SHALL NOT BE LIABLE FOR ANY DAMAGES
+// SUFFERED BY LICENSEE AS A RESULT OF USING, MODIFYING OR DISTRIBUTING
+// THIS SOFTWARE OR ITS DERIVATIVES.
+//=============================================================================
+
+
+#include "TestSupport.h"
+#include "CameraEventQueue.h"
+#include "SimulatedCamera.h"
+
+#include <memory>
+#include <vector>
+#include <poll.h>
+
+using namespace FlyCapture2;
+
+namespace
+{
+	void OnImage( Image*, const void* )
+	{
+	}
+
+	// A small camera delivering frames, and so exposure end events, as
+	// fast as it can.
+	std::unique_ptr<SimulatedCamera> CreateFastCamera( unsigned int serialNumber )
+	{
+		SimulatedCameraSettings settings;
+		settings.serialNumber = serialNumber;
+		settings.rows = 8;
+		settings.cols = 8;
+		std::unique_ptr<SimulatedCamera> camera( new SimulatedCamera( settings ) );
+
+		Property frameRate( FRAME_RATE );
+		camera->GetProperty( &frameRate );
+		frameRate.onOff = false;
+		camera->SetProperty( &frameRate );
+		camera->Connect();
+		return camera;
+	}
+
+	bool IsReadable( int fd, int timeoutMs )
+	{
+		struct pollfd pfd;
+		pfd.fd = fd;
+		pfd.events = POLLIN;
+		pfd.revents = 0;
+		return poll( &pfd, 1, timeoutMs ) == 1;
+	}
+}
+
+FC2_TEST( CameraEventQueueWakesPollingConsumer )
+{
+	const unsigned int numCameras = 3;
+	const unsigned long long numEvents = 20000;
+
+	CameraEventQueue queue;
+	FC2_CHECK( queue.GetFd() >= 0 );
+
+	std::vector< std::unique_ptr<SimulatedCamera> > cameras;
+	for ( unsigned int i = 0; i < numCameras; i++ )
+	{
+		cameras.push_back( CreateFastCamera( i + 1 ) );
+		FC2_CHECK_OK( queue.Attach( cameras.back().get(), VirtualCamera::sk_exposureEndEventName ) );
+	}
+	for ( unsigned int i = 0; i < numCameras; i++ )
+	{
+		FC2_CHECK_OK( cameras[i]->StartCapture( OnImage, NULL ) );
+	}
+
+	// Block on the descriptor only. A lost wakeup leaves events queued
+	// with the descriptor clear, and the poll times out.
+	CameraEvent events[64];
+	unsigned long long numFetched = 0;
+	unsigned long long lastSequence = 0;
+	bool ordered = true;
+	bool woken = true;
+	while ( numFetched < numEvents && woken )
+	{
+		woken = IsReadable( queue.GetFd(), 2000 );
+		const unsigned int count = queue.Fetch( events, 64 );
+		for ( unsigned int i = 0; i < count; i++ )
+		{
+			ordered = ordered && ( numFetched + i == 0 || events[i].sequence > lastSequence );
+			lastSequence = events[i].sequence;
+		}
+		numFetched += count;
+	}
+	FC2_CHECK( woken );
+	FC2_CHECK( ordered );
+
+	for ( unsigned int i = 0; i < numCameras; i++ )
+	{
+		cameras[i]->StopCapture();
+		queue.Detach( cameras[i].get(), VirtualCamera::sk_exposureEndEventName );
+	}
+	numFetched += queue.Fetch( events, 64 );
+
+	CameraEventQueueStats stats;
+	queue.GetStats( &stats );
+	FC2_CHECK( stats.numFetched == numFetched );
+	FC2_CHECK( stats.numReceived == stats.numFetched + stats.numOverflows + queue.GetNumQueued() );
+}
+
+FC2_TEST( CameraEventQueueCountsOverflows )
+{
+	CameraEventQueue queue( 4 );
+	std::unique_ptr<SimulatedCamera> camera = CreateFastCamera( 1 );
+	FC2_CHECK_OK( queue.Attach( camera.get(), VirtualCamera::sk_exposureEndEventName ) );
+	FC2_CHECK_OK( camera->StartCapture( OnImage, NULL ) );
+	FC2_CHECK( FC2Test::WaitFor( [&]() {
+		CameraEventQueueStats stats;
+		queue.GetStats( &stats );
+		return stats.numReceived >= 20; } ) );
+	camera->StopCapture();
+	queue.Detach( camera.get(), VirtualCamera::sk_exposureEndEventName );
+
+	// The oldest events are kept and the rest are counted as overflows.
+	FC2_CHECK( IsReadable( queue.GetFd(), 0 ) );
+	CameraEvent events[16];
+	FC2_CHECK( queue.Fetch( events, 3 ) == 3 );
+	FC2_CHECK( IsReadable( queue.GetFd(), 0 ) );
+	FC2_CHECK( queue.Fetch( events + 3, 13 ) == 1 );
+	FC2_CHECK( !IsReadable( queue.GetFd(), 0 ) );
+	for ( unsigned int i = 0; i < 4; i++ )
+	{
+		FC2_CHECK( events[i].sequence == i );
+		FC2_CHECK( events[i].pCamera == camera.get() );
+		FC2_CHECK( strcmp( events[i].name, VirtualCamera::sk_exposureEndEventName ) == 0 );
+	}
+
+	CameraEventQueueStats stats;
+	queue.GetStats( &stats );
+	FC2_CHECK( stats.numFetched == 4 );
+	FC2_CHECK( stats.numOverflows == stats.numReceived - 4 );
+	FC2_CHECK( stats.highWatermark == 4 );
+}
+
+FC2_TEST_MAIN()
@@ -0,0 +1,245 @@
+//=============================================================================
+// Copyright (c) 2001-2018 FLIR Systems, Inc. All Rights Reserved.
+//
+// This software is the confidential and proprietary information of FLIR
+// Integrated Imaging Solutions, Inc. ("Confidential Information"). You
+// shall not disclose such Confidential Information and shall use it only in
+// accordance with the terms of the license agreement you entered into
+// with FLIR Integrated Imaging Solutions, Inc. (FLIR).
+//
+// FLIR MAKES NO REPRESENTATIONS OR WARRANTIES ABOUT THE SUITABILITY OF THE
+// SOFTWARE, EITHER EXPRESSED OR IMPLIED, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+// PURPOSE, OR NON-INFRINGEMENT. FLIR SHALL NOT BE LIABLE FOR ANY DAMAGES
+// SUFFERED BY LICENSEE AS A RESULT OF USING, MODIFYING OR DISTRIBUTING
+// THIS SOFTWARE OR ITS DERIVATIVES.
+//=============================================================================
+
+
+
+#include "TestSupport.h"
+#include "DisplayConversion.h"
+
+#include <string.h>
+#include <vector>
+
+using namespace FlyCapture2;
+
+namespace
+{
+	struct BayerTile
+	{
+		BayerTileFormat format;
+		// Colour of the top left, top right, bottom left and bottom
+		// right pixel of a quad.
+		const char* pColours;
+	};
+
+	const BayerTile sk_tiles[] =
+	{
+		{ RGGB, "RGGB" },
+		{ GRBG, "GRBG" },
+		{ GBRG, "GBRG" },
+		{ BGGR, "BGGR" },
+	};
+
+	const unsigned int sk_quadsX = 3;
+	const unsigned int sk_quadsY = 3;
+
+	// Sample values of a quad, chosen so that averages land on every
+	// fraction, including exact halves.
+	void GetQuadSamples( unsigned int quad, unsigned int* pR, unsigned int* pG1, unsigned int* pG2, unsigned int* pB )
+	{
+		*pR = ( 7 + 29 * quad ) & 0xFF;
+		*pG1 = ( 100 + 13 * quad ) & 0xFF;
+		*pG2 = ( 3 + 41 * quad ) & 0xFF;
+		*pB = ( 250 - 17 * quad ) & 0xFF;
+	}
+
+	// Build a Bayer image of sk_quadsX by sk_quadsY quads with padded
+	// rows. 16 bit samples are MSB aligned, with noise in the low byte.
+	std::vector<unsigned char> MakeBayerData( const BayerTile& tile, unsigned int bytesPerSample, size_t stride )
+	{
+		std::vector<unsigned char> data( stride * sk_quadsY * 2, 0xEE );
+		for ( unsigned int qy = 0; qy < sk_quadsY; qy++ )
+		{
+			for ( unsigned int qx = 0; qx < sk_quadsX; qx++ )
+			{
+				const unsigned int quad = qy * sk_quadsX + qx;
+				unsigned int r, g1, g2, b;
+				GetQuadSamples( quad, &r, &g1, &g2, &b );
+				unsigned int numGreen = 0;
+				for ( unsigned int i = 0; i < 4; i++ )
+				{
+					unsigned int value;
+					switch ( tile.pColours[i] )
+					{
+						case 'R': value = r; break;
+						case 'B': value = b; break;
+						default: value = numGreen++ == 0 ? g1 : g2; break;
+					}
+					unsigned char* pSample = &data[( qy * 2 + i / 2 ) * stride + ( qx * 2 + i % 2 ) * bytesPerSample];
+					if ( bytesPerSample == 1 )
+					{
+						*pSample = static_cast<unsigned char>( value );
+					}
+					else
+					{
+						const unsigned short sample = static_cast<unsigned short>( ( value << 8 ) | ( ( quad * 37 + i ) & 0xFF ) );
+						memcpy( pSample, &sample, sizeof( sample ) );
+					}
+				}
+			}
+		}
+		return data;
+	}
+
+	// Round half up, as DownscaleCells() does.
+	unsigned int RoundedAverage( unsigned int sum, unsigned int count )
+	{
+		return ( 2 * sum + count ) / ( 2 * count );
+	}
+
+	// Downscale a Bayer image to destCols by destRows RGB8 pixels and
+	// compare with averages computed directly from the quad samples.
+	bool CheckDownscale(
+			const BayerTile& tile,
+			unsigned int     bytesPerSample,
+			unsigned int     destCols,
+			unsigned int     destRows,
+			DisplayFilter    filter )
+	{
+		const size_t stride = sk_quadsX * 2 * bytesPerSample + 6;
+		std::vector<unsigned char> data = MakeBayerData( tile, bytesPerSample, stride );
+		Image source(
+			sk_quadsY * 2,
+			sk_quadsX * 2,
+			static_cast<unsigned int>( stride ),
+			&data[0],
+			static_cast<unsigned int>( data.size() ),
+			bytesPerSample == 1 ? PIXEL_FORMAT_RAW8 : PIXEL_FORMAT_RAW16,
+			tile.format );
+
+		Detail::DisplayCellLayout layout;
+		if ( !Detail::GetDisplayCellLayout( source, &layout ) )
+		{
+			return false;
+		}
+
+		std::vector<unsigned int> colStart( destCols );
+		std::vector<unsigned int> colEnd( destCols );
+		for ( unsigned int x = 0; x < destCols; x++ )
+		{
+			colStart[x] = x * sk_quadsX / destCols;
+			colEnd[x] = ( x + 1 ) * sk_quadsX / destCols;
+		}
+
+		std::vector<unsigned char> dest( destCols * destRows * 3 );
+		if ( bytesPerSample == 1 )
+		{
+			Detail::DownscaleCells<1>( &data[0], stride, layout, sk_quadsY, colStart, colEnd,
+				&dest[0], destCols * 3, destRows, PIXEL_FORMAT_RGB8, filter );
+		}
+		else
+		{
+			Detail::DownscaleCells<2>( &data[0], stride, layout, sk_quadsY, colStart, colEnd,
+				&dest[0], destCols * 3, destRows, PIXEL_FORMAT_RGB8, filter );
+		}
+
+		for ( unsigned int y = 0; y < destRows; y++ )
+		{
+			const unsigned int rowStart = y * sk_quadsY / destRows;
+			const unsigned int rowEnd = filter == DISPLAY_FILTER_NEAREST ? rowStart + 1 : ( y + 1 ) * sk_quadsY / destRows;
+			for ( unsigned int x = 0; x < destCols; x++ )
+			{
+				const unsigned int end = filter == DISPLAY_FILTER_NEAREST ? colStart[x] + 1 : colEnd[x];
+				unsigned int sumR = 0, sumG = 0, sumB = 0, count = 0;
+				for ( unsigned int qy = rowStart; qy < rowEnd; qy++ )
+				{
+					for ( unsigned int qx = colStart[x]; qx < end; qx++ )
+					{
+						unsigned int r, g1, g2, b;
+						GetQuadSamples( qy * sk_quadsX + qx, &r, &g1, &g2, &b );
+						sumR += r;
+						sumG += g1 + g2;
+						sumB += b;
+						count++;
+					}
+				}
+
+				const unsigned char* pPixel = &dest[( y * destCols + x ) * 3];
+				if ( pPixel[0] != RoundedAverage( sumR, count ) ||
+					 pPixel[1] != RoundedAverage( sumG, 2 * count ) ||
+					 pPixel[2] != RoundedAverage( sumB, count ) )
+				{
+					fprintf( stderr, "%s, %u bit, %ux%u, pixel %u,%u: got %u %u %u\n",
+						tile.pColours, bytesPerSample * 8, destCols, destRows, x, y,
+						pPixel[0], pPixel[1], pPixel[2] );
+					return false;
+				}
+			}
+		}
+		return true;
+	}
+}
+
+FC2_TEST( DisplayCellLayoutFindsBayerColours )
+{
+	const size_t stride = 20;
+	unsigned char data[stride * 2] = { 0 };
+	for ( size_t i = 0; i < sizeof(sk_tiles) / sizeof(sk_tiles[0]); i++ )
+	{
+		for ( unsigned int bytesPerSample = 1; bytesPerSample <= 2; bytesPerSample++ )
+		{
+			Image source( 2, 2, stride, data, sizeof(data),
+				bytesPerSample == 1 ? PIXEL_FORMAT_RAW8 : PIXEL_FORMAT_RAW16, sk_tiles[i].format );
+			Detail::DisplayCellLayout layout;
+			FC2_CHECK( Detail::GetDisplayCellLayout( source, &layout ) );
+			FC2_CHECK( layout.cellSize == 2 );
+			FC2_CHECK( layout.bytesPerSample == bytesPerSample );
+			FC2_CHECK( layout.cellBytes == 2 * bytesPerSample );
+
+			// Offset of each position of the quad.
+			const size_t offsets[4] = { 0, bytesPerSample, stride, stride + bytesPerSample };
+			const char* pColours = sk_tiles[i].pColours;
+			FC2_CHECK( pColours[std::find( offsets, offsets + 4, layout.rOffset ) - offsets] == 'R' );
+			FC2_CHECK( pColours[std::find( offsets, offsets + 4, layout.bOffset ) - offsets] == 'B' );
+			FC2_CHECK( pColours[std::find( offsets, offsets + 4, layout.g1Offset ) - offsets] == 'G' );
+			FC2_CHECK( pColours[std::find( offsets, offsets + 4, layout.g2Offset ) - offsets] == 'G' );
+			FC2_CHECK( layout.g1Offset != layout.g2Offset );
+		}
+	}
+}
+
+FC2_TEST( DisplayCellLayoutTreatsRawWithoutTileAsMono )
+{
+	unsigned char data[8] = { 0 };
+	Image source( 2, 2, 4, data, sizeof(data), PIXEL_FORMAT_RAW16, NONE );
+	Detail::DisplayCellLayout layout;
+	FC2_CHECK( Detail::GetDisplayCellLayout( source, &layout ) );
+	FC2_CHECK( layout.cellSize == 1 );
+	FC2_CHECK( layout.cellBytes == 2 );
+	FC2_CHECK( layout.rOffset == 0 && layout.g1Offset == 0 && layout.g2Offset == 0 && layout.bOffset == 0 );
+}
+
+FC2_TEST( DownscaleCellsAveragesBayerQuads )
+{
+	// Sizes giving 1, 2, 3, 4 and 9 quads per displayed pixel.
+	const unsigned int sizes[][2] = { { 3, 3 }, { 2, 2 }, { 1, 3 }, { 3, 1 }, { 1, 1 } };
+	const DisplayFilter filters[] = { DISPLAY_FILTER_NEAREST, DISPLAY_FILTER_BOX };
+	for ( size_t i = 0; i < sizeof(sk_tiles) / sizeof(sk_tiles[0]); i++ )
+	{
+		for ( unsigned int bytesPerSample = 1; bytesPerSample <= 2; bytesPerSample++ )
+		{
+			for ( size_t f = 0; f < sizeof(filters) / sizeof(filters[0]); f++ )
+			{
+				for ( size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++ )
+				{
+					FC2_CHECK( CheckDownscale( sk_tiles[i], bytesPerSample, sizes[s][0], sizes[s][1], filters[f] ) );
+				}
+			}
+		}
+	}
+}
+
+FC2_TEST_MAIN()
@@ -0,0 +1,92 @@
+//=============================================================================
+// Copyright (c) 2001-2018 FLIR Systems, Inc. All Rights Reserved.
+//
+// This software is the confidential and proprietary information of FLIR
+// Integrated Imaging Solutions, Inc. ("Confidential Information"). You
+// shall not disclose such Confidential Information and shall use it only in
+// accordance with the terms of the license agreement you entered into
+// with FLIR Integrated Imaging Solutions, Inc. (FLIR).
+//
+// FLIR MAKES NO REPRESENTATIONS OR WARRANTIES ABOUT THE SUITABILITY OF THE
+// SOFTWARE, EITHER EXPRESSED OR IMPLIED, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+// PURPOSE, OR NON-INFRINGEMENT. FLIR SHALL NOT BE LIABLE FOR ANY DAMAGES
+// SUFFERED BY LICENSEE AS A RESULT OF USING, MODIFYING OR DISTRIBUTING
+// THIS SOFTWARE OR ITS DERIVATIVES.
+//=============================================================================
+
+
+#include "TestSupport.h"
+#include "C/FlyCapture2ImagePool_C.h"
+
+#include <vector>
+
+FC2_TEST( ImagePoolLeasesEveryImageOnce )
+{
+	fc2ImagePool pool;
+	FC2_CHECK( fc2CreateImagePool( &pool, 3 ) == FC2_ERROR_OK );
+
+	fc2Image* pImages[3] = { NULL, NULL, NULL };
+	for ( int i = 0; i < 3; i++ )
+	{
+		FC2_CHECK( fc2AcquirePoolImage( &pool, &pImages[i] ) == FC2_ERROR_OK );
+	}
+	FC2_CHECK( pImages[0] != pImages[1] && pImages[1] != pImages[2] && pImages[0] != pImages[2] );
+
+	fc2Image* pExtra = NULL;
+	FC2_CHECK( fc2AcquirePoolImage( &pool, &pExtra ) == FC2_ERROR_BUFFER_TOO_SMALL );
+
+	// The most recently released image is leased next.
+	FC2_CHECK( fc2ReleasePoolImage( &pool, pImages[1] ) == FC2_ERROR_OK );
+	FC2_CHECK( fc2AcquirePoolImage( &pool, &pExtra ) == FC2_ERROR_OK );
+	FC2_CHECK( pExtra == pImages[1] );
+
+	FC2_CHECK( fc2DestroyImagePool( &pool ) == FC2_ERROR_OK );
+	FC2_CHECK( pool.pImages == NULL && pool.numImages == 0 );
+}
+
+FC2_TEST( ImagePoolRejectsForeignAndDoubleRelease )
+{
+	fc2ImagePool pool;
+	FC2_CHECK( fc2CreateImagePool( &pool, 2 ) == FC2_ERROR_OK );
+
+	fc2Image* pImage = NULL;
+	FC2_CHECK( fc2AcquirePoolImage( &pool, &pImage ) == FC2_ERROR_OK );
+	FC2_CHECK( fc2ReleasePoolImage( &pool, pImage ) == FC2_ERROR_OK );
+	FC2_CHECK( fc2ReleasePoolImage( &pool, pImage ) == FC2_ERROR_INVALID_PARAMETER );
+	FC2_CHECK( pool.numFree == 2 );
+
+	fc2Image foreign;
+	FC2_CHECK( fc2ReleasePoolImage( &pool, &foreign ) == FC2_ERROR_INVALID_PARAMETER );
+	FC2_CHECK( pool.numFree == 2 );
+
+	FC2_CHECK( fc2CreateImagePool( NULL, 2 ) == FC2_ERROR_INVALID_PARAMETER );
+	fc2ImagePool empty;
+	FC2_CHECK( fc2CreateImagePool( &empty, 0 ) == FC2_ERROR_INVALID_PARAMETER );
+	FC2_CHECK( fc2DestroyImagePool( &pool ) == FC2_ERROR_OK );
+}
+
+FC2_TEST( ConvertImageToBufferChecksDestinationSize )
+{
+	fc2ImagePool pool;
+	FC2_CHECK( fc2CreateImagePool( &pool, 2 ) == FC2_ERROR_OK );
+	fc2Image* pSource = NULL;
+	fc2Image* pScratch = NULL;
+	FC2_CHECK( fc2AcquirePoolImage( &pool, &pSource ) == FC2_ERROR_OK );
+	FC2_CHECK( fc2AcquirePoolImage( &pool, &pScratch ) == FC2_ERROR_OK );
+	pSource->rows = 4;
+	pSource->cols = 10;
+
+	// BGRU needs 40 bytes per row.
+	std::vector<unsigned char> buffer( 4 * 40 );
+	FC2_CHECK( fc2ConvertImageToBuffer(
+		FC2_PIXEL_FORMAT_BGRU, pSource, pScratch, &buffer[0], 4 * 40, 39 ) == FC2_ERROR_BUFFER_TOO_SMALL );
+	FC2_CHECK( fc2ConvertImageToBuffer(
+		FC2_PIXEL_FORMAT_BGRU, pSource, pScratch, &buffer[0], 4 * 40 - 1, 40 ) == FC2_ERROR_BUFFER_TOO_SMALL );
+	FC2_CHECK( fc2ConvertImageToBuffer(
+		FC2_PIXEL_FORMAT_BGRU, pSource, NULL, &buffer[0], 4 * 40, 40 ) == FC2_ERROR_INVALID_PARAMETER );
+
+	FC2_CHECK( fc2DestroyImagePool( &pool ) == FC2_ERROR_OK );
+}
+
+FC2_TEST_MAIN()
@@ -0,0 +1,107 @@
+//=============================================================================
+// Copyright (c) 2001-2018 FLIR Systems, Inc. All Rights Reserved.
+//
+// This software is the confidential and proprietary information of FLIR
+// Integrated Imaging Solutions, Inc. ("Confidential Information"). You
+// shall not disclose such Confidential Information and shall use it only in
+// accordance with the terms of the license agreement you entered into
+// with FLIR Integrated Imaging Solutions, Inc. (FLIR).
+//
+// FLIR MAKES NO REPRESENTATIONS OR WARRANTIES ABOUT THE SUITABILITY OF THE
+// SOFTWARE, EITHER EXPRESSED OR IMPLIED, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+// PURPOSE, OR NON-INFRINGEMENT. FLIR SHALL NOT BE LIABLE FOR ANY DAMAGES
+// SUFFERED BY LICENSEE AS A RESULT OF USING, MODIFYING OR DISTRIBUTING
+// THIS SOFTWARE OR ITS DERIVATIVES.
+//=============================================================================
+
+
+#include "TestSupport.h"
+#include "MemoryBudget.h"
+#include "AlignedImage.h"
+#include "SimulatedCamera.h"
+#include "WarmCapture.h"
+
+using namespace FlyCapture2;
+
+namespace
+{
+	// Accepts user buffers but refuses to give them back.
+	class StuckBufferCamera
+	{
+		public:
+
+			ErrorType SetUserBuffers( unsigned char* pBuffers, int, int )
+			{
+				return pBuffers != NULL ? PGRERROR_OK : PGRERROR_FAILED;
+			}
+
+			ErrorType StopCapture() { return PGRERROR_OK; }
+
+			ErrorType SetTriggerMode( TriggerMode* ) { return PGRERROR_OK; }
+	};
+}
+
+FC2_TEST( MemoryBudgetCountsDefaultCaptureBuffers )
+{
+	FC2Config config;
+	config.numBuffers = 0;
+	FC2_CHECK( EstimateCaptureBufferBytes( config, 1000, 1024 ) == 1024ULL * sk_defaultNumCaptureBuffers );
+
+	// SetConfiguration() keeps the current number of buffers when it is 0.
+	SimulatedCamera camera;
+	camera.Connect();
+	MemoryBudget budget;
+	config.numBuffers = 4;
+	FC2_CHECK_OK( BudgetedSetConfiguration( &camera, &config, 1024, &budget ) );
+	config.numBuffers = 0;
+	FC2_CHECK_OK( BudgetedSetConfiguration( &camera, &config, 1024, &budget ) );
+
+	MemoryFootprint footprint;
+	budget.GetFootprint( &camera, &footprint );
+	FC2_CHECK( footprint.bytes[MEMORY_CAPTURE_BUFFERS] == 4 * 1024 );
+}
+
+FC2_TEST( AlignedImageReservesConversionMemory )
+{
+	MemoryBudget budget;
+	budget.SetLimit( 1000 );
+	{
+		AlignedImage image( 64 );
+		FC2_CHECK_OK( image.SetMemoryBudget( &budget ) );
+		FC2_CHECK_OK( image.Allocate( 10, 10, PIXEL_FORMAT_MONO8 ) );
+
+		MemoryFootprint footprint;
+		budget.GetFootprint( &image, &footprint );
+		FC2_CHECK( footprint.bytes[MEMORY_CONVERSION] == 10 * 64 );
+
+		FC2_CHECK( image.Allocate( 20, 10, PIXEL_FORMAT_MONO8 ) == PGRERROR_MEMORY_ALLOCATION_FAILED );
+		FC2_CHECK( image.GetImage().GetRows() == 10 );
+		FC2_CHECK_OK( image.Allocate( 5, 10, PIXEL_FORMAT_MONO8 ) );
+		budget.GetFootprint( &image, &footprint );
+		FC2_CHECK( footprint.bytes[MEMORY_CONVERSION] == 10 * 64 );
+	}
+
+	MemoryFootprint total;
+	budget.GetTotalFootprint( &total );
+	FC2_CHECK( total.GetTotal() == 0 );
+	FC2_CHECK( budget.GetNumRejections() == 1 );
+}
+
+FC2_TEST( WarmCaptureKeepsLeakedBuffersReserved )
+{
+	MemoryBudget budget;
+	StuckBufferCamera camera;
+	{
+		WarmCapture<StuckBufferCamera> warmCapture( &camera, &budget );
+		FC2_CHECK_OK( warmCapture.AllocateBuffers( 1000, 4 ) );
+		FC2_CHECK( warmCapture.ReleaseBuffers() == PGRERROR_FAILED );
+	}
+
+	// The buffers were leaked, not freed, so they still count.
+	MemoryFootprint total;
+	budget.GetTotalFootprint( &total );
+	FC2_CHECK( total.bytes[MEMORY_CAPTURE_BUFFERS] == 4 * 1024 );
+}
+
+FC2_TEST_MAIN()
@@ -0,0 +1,255 @@
+//=============================================================================
+// Copyright (c) 2001-2018 FLIR Systems, Inc. All Rights Reserved.
+//
+// This software is the confidential and proprietary information of FLIR
+// Integrated Imaging Solutions, Inc. ("Confidential Information"). You
+// shall not disclose such Confidential Information and shall use it only in
+// accordance with the terms of the license agreement you entered into
+// with FLIR Integrated Imaging Solutions, Inc. (FLIR).
+//
+// FLIR MAKES NO REPRESENTATIONS OR WARRANTIES ABOUT THE SUITABILITY OF THE
+// SOFTWARE, EITHER EXPRESSED OR IMPLIED, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+// PURPOSE, OR NON-INFRINGEMENT. FLIR SHALL NOT BE LIABLE FOR ANY DAMAGES
+// SUFFERED BY LICENSEE AS A RESULT OF USING, MODIFYING OR DISTRIBUTING
+// THIS SOFTWARE OR ITS DERIVATIVES.
+//=============================================================================
+
+
+#include "TestSupport.h"
+#include "PipelinedTrigger.h"
+#include "SimulatedCamera.h"
+
+using namespace FlyCapture2;
+
+namespace
+{
+	void SetTrigger( VirtualCamera* pCamera, bool onOff )
+	{
+		TriggerMode triggerMode;
+		triggerMode.onOff = onOff;
+		triggerMode.mode = 0;
+		triggerMode.source = VirtualCamera::sk_softwareTriggerSource;
+		pCamera->SetTriggerMode( &triggerMode );
+	}
+
+	void SetShutterAndTimeout( VirtualCamera* pCamera, float shutterMs, int grabTimeoutMs )
+	{
+		Property shutter( SHUTTER );
+		pCamera->GetProperty( &shutter );
+		shutter.absValue = shutterMs;
+		pCamera->SetProperty( &shutter );
+
+		FC2Config config;
+		pCamera->GetConfiguration( &config );
+		config.grabTimeout = grabTimeoutMs;
+		pCamera->SetConfiguration( &config );
+	}
+
+	// Embed the frame counter alone, so it occupies the first four bytes.
+	void EmbedFrameCounter( VirtualCamera* pCamera )
+	{
+		EmbeddedImageInfo embedded;
+		pCamera->GetEmbeddedImageInfo( &embedded );
+		embedded.timestamp.onOff = false;
+		embedded.frameCounter.onOff = true;
+		pCamera->SetEmbeddedImageInfo( &embedded );
+	}
+
+	unsigned int GetFrameCounter( const Image& image )
+	{
+		const unsigned char* pData = image.GetData();
+		return ( static_cast<unsigned int>( pData[0] ) << 24 ) | ( pData[1] << 16 ) | ( pData[2] << 8 ) | pData[3];
+	}
+
+	// Answers every trigger with one frame, in order, and can fail a
+	// retrieval after taking the frame, as a damaged frame does.
+	class ScriptedCamera
+	{
+		public:
+
+			ScriptedCamera()
+				: m_numTriggers( 0 ),
+				  m_numFrames( 0 ),
+				  m_lastFrame( 0 ),
+				  m_nextError( PGRERROR_OK )
+			{
+			}
+
+			ErrorType FireSoftwareTrigger()
+			{
+				m_numTriggers++;
+				return PGRERROR_OK;
+			}
+
+			ErrorType RetrieveBuffer( Image* /*pImage*/ )
+			{
+				if ( m_numFrames == m_numTriggers )
+				{
+					return PGRERROR_TIMEOUT;
+				}
+
+				m_lastFrame = m_numFrames++;
+				const ErrorType error = m_nextError;
+				m_nextError = PGRERROR_OK;
+				return error;
+			}
+
+			void FailNextRetrieve( ErrorType error ) { m_nextError = error; }
+
+			unsigned int GetLastFrame() const { return m_lastFrame; }
+
+		private:
+
+			unsigned int m_numTriggers;
+			unsigned int m_numFrames;
+			unsigned int m_lastFrame;
+			ErrorType    m_nextError;
+	};
+}
+
+FC2_TEST( PipelinedTriggerMatchesFramesInOrder )
+{
+	SimulatedCamera camera;
+	camera.Connect();
+	EmbedFrameCounter( &camera );
+	SetShutterAndTimeout( &camera, 1.0f, 1000 );
+	FC2_CHECK_OK( camera.StartCapture() );
+	SetTrigger( &camera, true );
+
+	PipelinedTrigger<VirtualCamera> pipeline( &camera );
+	FC2_CHECK_OK( pipeline.Start( 2, 5 ) );
+	FC2_CHECK( pipeline.GetNumInFlight() == 2 );
+
+	Image image;
+	for ( unsigned long long i = 0; i < 5; i++ )
+	{
+		TriggeredFrameInfo info;
+		FC2_CHECK_OK( pipeline.RetrieveBuffer( &image, &info ) );
+		FC2_CHECK( info.triggerIndex == i );
+		FC2_CHECK( GetFrameCounter( image ) == i );
+	}
+	FC2_CHECK( pipeline.RetrieveBuffer( &image ) == PGRERROR_ISOCH_NOT_STARTED );
+	camera.StopCapture();
+}
+
+FC2_TEST( PipelinedTriggerRetriesFailedTrigger )
+{
+	SimulatedCamera camera;
+	camera.Connect();
+	SetShutterAndTimeout( &camera, 1.0f, 1000 );
+	FC2_CHECK_OK( camera.StartCapture() );
+
+	// The camera refuses software triggers until trigger mode is on.
+	PipelinedTrigger<VirtualCamera> pipeline( &camera );
+	FC2_CHECK( pipeline.Start( 1, 2 ) == PGRERROR_TRIGGER_FAILED );
+	FC2_CHECK( pipeline.GetNumInFlight() == 0 );
+
+	Image image;
+	FC2_CHECK( pipeline.RetrieveBuffer( &image ) == PGRERROR_TRIGGER_FAILED );
+
+	SetTrigger( &camera, true );
+	TriggeredFrameInfo info;
+	FC2_CHECK_OK( pipeline.RetrieveBuffer( &image, &info ) );
+	FC2_CHECK( info.triggerIndex == 0 );
+	FC2_CHECK_OK( pipeline.RetrieveBuffer( &image, &info ) );
+	FC2_CHECK( info.triggerIndex == 1 );
+
+	PipelinedTriggerStats stats;
+	pipeline.GetStats( &stats );
+	FC2_CHECK( stats.numTriggers == 2 );
+	FC2_CHECK( stats.numTriggerFailures == 2 );
+	camera.StopCapture();
+}
+
+FC2_TEST( PipelinedTriggerDiscardsLateFrame )
+{
+	SimulatedCamera camera;
+	camera.Connect();
+	EmbedFrameCounter( &camera );
+	SetShutterAndTimeout( &camera, 100.0f, 60 );
+	FC2_CHECK_OK( camera.StartCapture() );
+	SetTrigger( &camera, true );
+
+	// The first frame arrives after the grab timeout. It must not be
+	// matched to the trigger fired after the timeout.
+	PipelinedTrigger<VirtualCamera> pipeline( &camera );
+	FC2_CHECK_OK( pipeline.Start( 1 ) );
+
+	Image image;
+	FC2_CHECK( pipeline.RetrieveBuffer( &image ) == PGRERROR_TIMEOUT );
+
+	SetShutterAndTimeout( &camera, 100.0f, 1000 );
+	TriggeredFrameInfo info;
+	FC2_CHECK_OK( pipeline.RetrieveBuffer( &image, &info ) );
+	FC2_CHECK( info.triggerIndex == 1 );
+	FC2_CHECK( GetFrameCounter( image ) == 1 );
+
+	PipelinedTriggerStats stats;
+	pipeline.GetStats( &stats );
+	FC2_CHECK( stats.numLost == 1 );
+	FC2_CHECK( stats.numDiscarded == 1 );
+	pipeline.Stop();
+	camera.StopCapture();
+}
+
+FC2_TEST( PipelinedTriggerRetiresDamagedFrame )
+{
+	ScriptedCamera camera;
+	PipelinedTrigger<ScriptedCamera> pipeline( &camera );
+	FC2_CHECK_OK( pipeline.Start( 2, 5 ) );
+
+	Image image;
+	TriggeredFrameInfo info;
+	FC2_CHECK_OK( pipeline.RetrieveBuffer( &image, &info ) );
+	FC2_CHECK( info.triggerIndex == 0 );
+
+	camera.FailNextRetrieve( PGRERROR_IMAGE_CONSISTENCY_ERROR );
+	FC2_CHECK( pipeline.RetrieveBuffer( &image, &info ) == PGRERROR_IMAGE_CONSISTENCY_ERROR );
+	FC2_CHECK( pipeline.GetNumInFlight() == 2 );
+
+	for ( unsigned int i = 2; i < 5; i++ )
+	{
+		FC2_CHECK_OK( pipeline.RetrieveBuffer( &image, &info ) );
+		FC2_CHECK( info.triggerIndex == i );
+		FC2_CHECK( camera.GetLastFrame() == i );
+	}
+	FC2_CHECK( pipeline.RetrieveBuffer( &image ) == PGRERROR_ISOCH_NOT_STARTED );
+
+	PipelinedTriggerStats stats;
+	pipeline.GetStats( &stats );
+	FC2_CHECK( stats.numFrames == 4 );
+	FC2_CHECK( stats.numLost == 1 );
+	FC2_CHECK( stats.numDiscarded == 0 );
+}
+
+FC2_TEST( PipelinedTriggerResyncsAfterRetrieveError )
+{
+	ScriptedCamera camera;
+	PipelinedTrigger<ScriptedCamera> pipeline( &camera );
+	FC2_CHECK_OK( pipeline.Start( 2, 5 ) );
+
+	Image image;
+	TriggeredFrameInfo info;
+	FC2_CHECK_OK( pipeline.RetrieveBuffer( &image, &info ) );
+
+	// Whether the failed retrieval took a frame is unknown, so the frames
+	// in flight are discarded and triggering starts again.
+	camera.FailNextRetrieve( PGRERROR_ISOCH_RETRIEVE_BUFFER_FAILED );
+	FC2_CHECK( pipeline.RetrieveBuffer( &image, &info ) == PGRERROR_ISOCH_RETRIEVE_BUFFER_FAILED );
+	FC2_CHECK( pipeline.GetNumInFlight() == 2 );
+
+	for ( unsigned int i = 3; i < 5; i++ )
+	{
+		FC2_CHECK_OK( pipeline.RetrieveBuffer( &image, &info ) );
+		FC2_CHECK( info.triggerIndex == i );
+		FC2_CHECK( camera.GetLastFrame() == i );
+	}
+
+	PipelinedTriggerStats stats;
+	pipeline.GetStats( &stats );
+	FC2_CHECK( stats.numLost == 2 );
+	FC2_CHECK( stats.numDiscarded == 1 );
+}
+
+FC2_TEST_MAIN()
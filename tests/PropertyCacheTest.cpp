@@ -0,0 +1,175 @@
+//=============================================================================
+// Copyright (c) 2001-2018 FLIR Systems, Inc. All Rights Reserved.
+//
+// This software is the confidential and proprietary information of FLIR
+// Integrated Imaging Solutions, Inc. ("Confidential Information"). You
+// shall not disclose such Confidential Information and shall use it only in
+// accordance with the terms of the license agreement you entered into
+// with FLIR Integrated Imaging Solutions, Inc. (FLIR).
+//
+// FLIR MAKES NO REPRESENTATIONS OR WARRANTIES ABOUT THE SUITABILITY OF THE
+// SOFTWARE, EITHER EXPRESSED OR IMPLIED, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+// PURPOSE, OR NON-INFRINGEMENT. FLIR SHALL NOT BE LIABLE FOR ANY DAMAGES
+// SUFFERED BY LICENSEE AS A RESULT OF USING, MODIFYING OR DISTRIBUTING
+// THIS SOFTWARE OR ITS DERIVATIVES.
+//=============================================================================
+
+
+#include "TestSupport.h"
+#include "PropertyCache.h"
+#include "SimulatedCamera.h"
+
+#include <atomic>
+#include <thread>
+
+using namespace FlyCapture2;
+
+namespace
+{
+	const PropertyType sk_exposure[] = { SHUTTER, GAIN };
+}
+
+FC2_TEST( PropertyCacheServesStartedProperties )
+{
+	SimulatedCamera camera;
+	camera.Connect();
+
+	PropertyCache<VirtualCamera> cache( &camera );
+	FC2_CHECK_OK( cache.Start( sk_exposure, 2, 10 ) );
+	FC2_CHECK( cache.GetNumPropertyReads() == 2 );
+
+	Property gain( GAIN );
+	FC2_CHECK( cache.GetProperty( &gain ) );
+	Property direct( GAIN );
+	camera.GetProperty( &direct );
+	FC2_CHECK( gain.absValue == direct.absValue );
+
+	Property frameRate( FRAME_RATE );
+	FC2_CHECK( !cache.GetProperty( &frameRate ) );
+	cache.Stop();
+}
+
+FC2_TEST( PropertyCacheWritesThrough )
+{
+	SimulatedCamera camera;
+	camera.Connect();
+
+	PropertyCache<VirtualCamera> cache( &camera );
+	FC2_CHECK_OK( cache.Start( sk_exposure, 2, 1000 ) );
+
+	Property shutter( SHUTTER );
+	cache.GetProperty( &shutter );
+	shutter.absValue = 12.5f;
+	FC2_CHECK_OK( cache.SetProperty( shutter ) );
+
+	Property cached( SHUTTER );
+	FC2_CHECK( cache.GetProperty( &cached ) && cached.absValue == 12.5f );
+	Property direct( SHUTTER );
+	camera.GetProperty( &direct );
+	FC2_CHECK( direct.absValue == 12.5f );
+
+	shutter.absValue = -1.0f;
+	FC2_CHECK( cache.SetProperty( shutter ) == PGRERROR_INVALID_PARAMETER );
+	FC2_CHECK( cache.GetProperty( &cached ) && cached.absValue == 12.5f );
+	cache.Stop();
+}
+
+FC2_TEST( PropertyCacheRefreshesExternalChanges )
+{
+	SimulatedCamera camera;
+	camera.Connect();
+
+	PropertyCache<VirtualCamera> cache( &camera );
+	FC2_CHECK_OK( cache.Start( sk_exposure, 2, 5 ) );
+
+	Property gain( GAIN );
+	camera.GetProperty( &gain );
+	gain.absValue = 6.0f;
+	camera.SetProperty( &gain );
+
+	// Virtual cameras have no register block, so every pass reads the
+	// active properties in full.
+	FC2_CHECK( FC2Test::WaitFor( [&cache] {
+		Property cached( GAIN );
+		return cache.GetProperty( &cached ) && cached.absValue == 6.0f; } ) );
+	FC2_CHECK( cache.GetNumBlockReads() == 0 );
+	cache.Stop();
+}
+
+FC2_TEST( PropertyCacheShortensPeriodWhenCaptureStops )
+{
+	SimulatedCamera camera;
+	camera.Connect();
+
+	PropertyCache<VirtualCamera> cache( &camera );
+	cache.SetCaptureRefreshPeriod( 60000 );
+	cache.SetCapturing( true );
+	FC2_CHECK_OK( cache.Start( sk_exposure, 2, 20 ) );
+
+	// The refresh thread is now waiting out the capture period.
+	std::this_thread::sleep_for( std::chrono::milliseconds( 100 ) );
+	const unsigned long long refreshCount = cache.GetRefreshCount();
+	cache.SetCapturing( false );
+	FC2_CHECK( FC2Test::WaitFor( [&cache, refreshCount] {
+		return cache.GetRefreshCount() > refreshCount + 2; } ) );
+	cache.Stop();
+}
+
+FC2_TEST( PropertyCacheLoadsActivePropertiesLazily )
+{
+	SimulatedCamera camera;
+	camera.Connect();
+
+	PropertyCache<VirtualCamera> cache( &camera );
+	FC2_CHECK_OK( cache.Start( NULL, 0, 1000 ) );
+
+	const PropertyType page[] = { FRAME_RATE };
+	FC2_CHECK_OK( cache.SetActiveProperties( page, 1 ) );
+	FC2_CHECK( FC2Test::WaitFor( [&cache] {
+		Property frameRate( FRAME_RATE );
+		return cache.GetProperty( &frameRate ); } ) );
+
+	const PropertyType invalid[] = { UNSPECIFIED_PROPERTY_TYPE };
+	FC2_CHECK( cache.SetActiveProperties( invalid, 1 ) == PGRERROR_INVALID_PARAMETER );
+	cache.Stop();
+}
+
+FC2_TEST( PropertyCacheReadsAreConsistentUnderWrites )
+{
+	SimulatedCamera camera;
+	camera.Connect();
+
+	PropertyCache<VirtualCamera> cache( &camera );
+	FC2_CHECK_OK( cache.Start( sk_exposure, 2, 1000 ) );
+
+	// The writer keeps valueA and absValue equal, so a torn read shows
+	// up as a mismatch.
+	std::atomic<bool> running( true );
+	std::thread writer( [&] {
+		for ( unsigned int i = 1; running; i++ )
+		{
+			Property gain( GAIN );
+			gain.valueA = i % 48;
+			gain.absValue = static_cast<float>( i % 48 );
+			cache.SetProperty( gain );
+		}
+	} );
+
+	bool consistent = true;
+	for ( unsigned int i = 0; i < 100000; i++ )
+	{
+		Property gain( GAIN );
+		if ( cache.GetProperty( &gain ) && gain.valueA != 0 &&
+			 static_cast<float>( gain.valueA ) != gain.absValue )
+		{
+			consistent = false;
+		}
+	}
+	running = false;
+	writer.join();
+	FC2_CHECK( consistent );
+	cache.Stop();
+}
+
+FC2_TEST_MAIN()
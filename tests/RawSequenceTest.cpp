@@ -0,0 +1,109 @@
+//=============================================================================
+// Copyright (c) 2001-2018 FLIR Systems, Inc. All Rights Reserved.
+//
+// This software is the confidential and proprietary information of FLIR
+// Integrated Imaging Solutions, Inc. ("Confidential Information"). You
+// shall not disclose such Confidential Information and shall use it only in
+// accordance with the terms of the license agreement you entered into
+// with FLIR Integrated Imaging Solutions, Inc. (FLIR).
+//
+// FLIR MAKES NO REPRESENTATIONS OR WARRANTIES ABOUT THE SUITABILITY OF THE
+// SOFTWARE, EITHER EXPRESSED OR IMPLIED, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+// PURPOSE, OR NON-INFRINGEMENT. FLIR SHALL NOT BE LIABLE FOR ANY DAMAGES
+// SUFFERED BY LICENSEE AS A RESULT OF USING, MODIFYING OR DISTRIBUTING
+// THIS SOFTWARE OR ITS DERIVATIVES.
+//=============================================================================
+
+
+#include "TestSupport.h"
+#include "RawSequence.h"
+
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+#include <sys/resource.h>
+#include <vector>
+
+using namespace FlyCapture2;
+
+namespace
+{
+	std::string GetTempFilename( const char* pName )
+	{
+		const char* pDirectory = getenv( "TMPDIR" );
+		return std::string( pDirectory != NULL ? pDirectory : "/tmp" ) + "/" + pName;
+	}
+}
+
+FC2_TEST( RawSequenceHeaderIsLittleEndian )
+{
+	RawSequenceHeader header;
+	header.rows = 0x01020304;
+	header.recordSize = 64;
+	unsigned char encoded[Detail::sk_rawSequenceHeaderSize];
+	Detail::EncodeRawSequenceHeader( header, encoded );
+
+	// version at 8, headerSize at 12, rows at 16
+	FC2_CHECK( encoded[8] == 1 && encoded[9] == 0 && encoded[10] == 0 && encoded[11] == 0 );
+	FC2_CHECK( encoded[12] == 64 && encoded[15] == 0 );
+	FC2_CHECK( encoded[16] == 0x04 && encoded[17] == 0x03 && encoded[18] == 0x02 && encoded[19] == 0x01 );
+
+	TimeStamp timeStamp;
+	timeStamp.seconds = 0x0000000123456789ll;
+	timeStamp.microSeconds = 999999;
+	ImageMetadata metadata;
+	metadata.embeddedFrameCounter = 42;
+	unsigned char record[Detail::sk_rawSequenceRecordHeaderSize];
+	Detail::EncodeRawSequenceRecord( timeStamp, metadata, record );
+	FC2_CHECK( record[0] == 0x89 && record[4] == 0x01 && record[7] == 0x00 );
+
+	TimeStamp decodedTimeStamp;
+	ImageMetadata decodedMetadata;
+	Detail::DecodeRawSequenceRecord( record, &decodedTimeStamp, &decodedMetadata );
+	FC2_CHECK( decodedTimeStamp.seconds == timeStamp.seconds );
+	FC2_CHECK( decodedTimeStamp.microSeconds == timeStamp.microSeconds );
+	FC2_CHECK( decodedMetadata.embeddedFrameCounter == 42 );
+}
+
+FC2_TEST( RawSequenceWriterRecoversFromPartialWrite )
+{
+	const std::string filename = GetTempFilename( "fc2-partial-write.fc2seq" );
+	const unsigned int rows = 256;
+	const unsigned int stride = 1024;
+	std::vector<unsigned char> frame( rows * stride );
+
+	RawSequenceWriter writer;
+	FC2_CHECK_OK( writer.Open( filename.c_str(), rows, stride, stride, PIXEL_FORMAT_MONO8 ) );
+	TimeStamp timeStamp;
+	ImageMetadata metadata;
+	metadata.embeddedFrameCounter = 0;
+	FC2_CHECK_OK( writer.Append( &frame[0], timeStamp, metadata ) );
+	FC2_CHECK_OK( writer.Flush() );
+
+	// Cap the file size halfway through the second record.
+	struct rlimit limit;
+	getrlimit( RLIMIT_FSIZE, &limit );
+	const struct rlimit saved = limit;
+	limit.rlim_cur = Detail::sk_rawSequenceHeaderSize + 3 * frame.size() / 2;
+	signal( SIGXFSZ, SIG_IGN );
+	FC2_CHECK( setrlimit( RLIMIT_FSIZE, &limit ) == 0 );
+	metadata.embeddedFrameCounter = 1;
+	FC2_CHECK( writer.Append( &frame[0], timeStamp, metadata ) == PGRERROR_FAILED );
+	setrlimit( RLIMIT_FSIZE, &saved );
+
+	metadata.embeddedFrameCounter = 2;
+	FC2_CHECK_OK( writer.Append( &frame[0], timeStamp, metadata ) );
+	FC2_CHECK_OK( writer.Close() );
+
+	RawSequenceReader reader;
+	FC2_CHECK_OK( reader.Open( filename.c_str() ) );
+	FC2_CHECK( reader.GetNumFrames() == 2 );
+	FC2_CHECK_OK( reader.ReadFrameInfo( 1, &timeStamp, &metadata ) );
+	FC2_CHECK( metadata.embeddedFrameCounter == 2 );
+	reader.Close();
+	remove( filename.c_str() );
+}
+
+FC2_TEST_MAIN()
@@ -0,0 +1,100 @@
+//=============================================================================
+// Copyright (c) 2001-2018 FLIR Systems, Inc. All Rights Reserved.
+//
+// This software is the confidential and proprietary information of FLIR
+// Integrated Imaging Solutions, Inc. ("Confidential Information"). You
+// shall not disclose such Confidential Information and shall use it only in
+// accordance with the terms of the license agreement you entered into
+// with FLIR Integrated Imaging Solutions, Inc. (FLIR).
+//
+// FLIR MAKES NO REPRESENTATIONS OR WARRANTIES ABOUT THE SUITABILITY OF THE
+// SOFTWARE, EITHER EXPRESSED OR IMPLIED, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+// PURPOSE, OR NON-INFRINGEMENT. FLIR SHALL NOT BE LIABLE FOR ANY DAMAGES
+// SUFFERED BY LICENSEE AS A RESULT OF USING, MODIFYING OR DISTRIBUTING
+// THIS SOFTWARE OR ITS DERIVATIVES.
+//=============================================================================
+
+
+#include "TestSupport.h"
+#include "SimulatedCamera.h"
+
+#include <string.h>
+#include <vector>
+
+using namespace FlyCapture2;
+
+namespace
+{
+	// Capture two consecutive frames of a simulated camera.
+	bool CaptureTwoFrames(
+			PixelFormat                 format,
+			std::vector<unsigned char>* pFirst,
+			std::vector<unsigned char>* pSecond )
+	{
+		SimulatedCameraSettings settings;
+		settings.rows = 64;
+		settings.cols = 128;
+		settings.pixelFormat = format;
+		settings.pattern = SIMULATED_PATTERN_CHECKERBOARD;
+		settings.frameRate = 200.0f;
+		SimulatedCamera camera( settings );
+		camera.Connect();
+		if ( camera.StartCapture() != PGRERROR_OK )
+		{
+			return false;
+		}
+
+		Image image;
+		bool ok = camera.RetrieveBuffer( &image ) == PGRERROR_OK;
+		if ( ok )
+		{
+			pFirst->assign( image.GetData(), image.GetData() + image.GetDataSize() );
+			ok = camera.RetrieveBuffer( &image ) == PGRERROR_OK;
+		}
+		if ( ok )
+		{
+			pSecond->assign( image.GetData(), image.GetData() + image.GetDataSize() );
+		}
+		camera.StopCapture();
+		return ok;
+	}
+}
+
+FC2_TEST( SimulatedCameraScrollsWholePixels )
+{
+	std::vector<unsigned char> first;
+	std::vector<unsigned char> second;
+	FC2_CHECK( CaptureTwoFrames( PIXEL_FORMAT_MONO16, &first, &second ) );
+	FC2_CHECK( first.size() == 64 * 128 * 2 );
+	FC2_CHECK( first != second );
+}
+
+FC2_TEST( SimulatedCameraKeepsPackedFormatsStatic )
+{
+	const PixelFormat packed[] = { PIXEL_FORMAT_MONO12, PIXEL_FORMAT_RAW12, PIXEL_FORMAT_411YUV8 };
+	for ( size_t i = 0; i < sizeof(packed) / sizeof(packed[0]); i++ )
+	{
+		std::vector<unsigned char> first;
+		std::vector<unsigned char> second;
+		FC2_CHECK( CaptureTwoFrames( packed[i], &first, &second ) );
+		FC2_CHECK( !first.empty() && first == second );
+	}
+}
+
+FC2_TEST( SimulatedCameraClampsInitialFrameRate )
+{
+	SimulatedCameraSettings settings;
+	settings.frameRate = 0.01f;
+	SimulatedCamera slow( settings );
+	Property frameRate( FRAME_RATE );
+	FC2_CHECK_OK( slow.GetProperty( &frameRate ) );
+	FC2_CHECK( frameRate.onOff && frameRate.absValue == 0.1f );
+
+	settings.frameRate = 0.0f;
+	SimulatedCamera freeRunning( settings );
+	FC2_CHECK_OK( freeRunning.GetProperty( &frameRate ) );
+	FC2_CHECK( !frameRate.onOff );
+}
+
+FC2_TEST_MAIN()
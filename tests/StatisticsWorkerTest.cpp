@@ -0,0 +1,55 @@
+//=============================================================================
+// Copyright (c) 2001-2018 FLIR Systems, Inc. All Rights Reserved.
+//
+// This software is the confidential and proprietary information of FLIR
+// Integrated Imaging Solutions, Inc. ("Confidential Information"). You
+// shall not disclose such Confidential Information and shall use it only in
+// accordance with the terms of the license agreement you entered into
+// with FLIR Integrated Imaging Solutions, Inc. (FLIR).
+//
+// FLIR MAKES NO REPRESENTATIONS OR WARRANTIES ABOUT THE SUITABILITY OF THE
+// SOFTWARE, EITHER EXPRESSED OR IMPLIED, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+// PURPOSE, OR NON-INFRINGEMENT. FLIR SHALL NOT BE LIABLE FOR ANY DAMAGES
+// SUFFERED BY LICENSEE AS A RESULT OF USING, MODIFYING OR DISTRIBUTING
+// THIS SOFTWARE OR ITS DERIVATIVES.
+//=============================================================================
+
+
+#include "TestSupport.h"
+#include "StatisticsWorker.h"
+
+#include <vector>
+
+using namespace FlyCapture2;
+
+FC2_TEST( StatisticsWorkerAcceptsRestartedSequence )
+{
+	std::vector<unsigned char> data( 16 * 16, 100 );
+	Image frame( 16, 16, 16, &data[0], static_cast<unsigned int>( data.size() ), PIXEL_FORMAT_MONO8 );
+
+	StatisticsWorker worker;
+	worker.SetMaxRate( 0.0 );
+	FC2_CHECK_OK( worker.Start() );
+
+	FrameTag tag;
+	tag.sequence = 5;
+	FC2_CHECK( worker.Submit( frame, tag ) );
+	FC2_CHECK( FC2Test::WaitFor( [&worker] { return worker.GetGeneration() == 1; } ) );
+
+	// A restarted pipeline numbers its frames from 0 again.
+	worker.Stop();
+	FC2_CHECK_OK( worker.Start() );
+	tag.sequence = 0;
+	FC2_CHECK( worker.Submit( frame, tag ) );
+	FC2_CHECK( FC2Test::WaitFor( [&worker] { return worker.GetGeneration() == 2; } ) );
+	FC2_CHECK( worker.GetLatest()->tag.sequence == 0 );
+	FC2_CHECK( worker.GetLatest()->channels[ImageStatistics::GREY].mean == 100.0f );
+	worker.Stop();
+
+	StatisticsWorkerStats stats;
+	worker.GetStats( &stats );
+	FC2_CHECK( stats.numErrors == 0 );
+}
+
+FC2_TEST_MAIN()
@@ -0,0 +1,117 @@
+//=============================================================================
+// Copyright (c) 2001-2018 FLIR Systems, Inc. All Rights Reserved.
+//
+// This software is the confidential and proprietary information of FLIR
+// Integrated Imaging Solutions, Inc. ("Confidential Information"). You
+// shall not disclose such Confidential Information and shall use it only in
+// accordance with the terms of the license agreement you entered into
+// with FLIR Integrated Imaging Solutions, Inc. (FLIR).
+//
+// FLIR MAKES NO REPRESENTATIONS OR WARRANTIES ABOUT THE SUITABILITY OF THE
+// SOFTWARE, EITHER EXPRESSED OR IMPLIED, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+// PURPOSE, OR NON-INFRINGEMENT. FLIR SHALL NOT BE LIABLE FOR ANY DAMAGES
+// SUFFERED BY LICENSEE AS A RESULT OF USING, MODIFYING OR DISTRIBUTING
+// THIS SOFTWARE OR ITS DERIVATIVES.
+//=============================================================================
+
+
+//=============================================================================
+// Minimal test support shared by the header tests. Each test is a function
+// registered with FC2_TEST; failed checks are reported with their location
+// and make the executable return a non-zero exit code.
+//=============================================================================
+
+#ifndef FLIR_FC2_TESTS_TESTSUPPORT_H
+#define FLIR_FC2_TESTS_TESTSUPPORT_H
+
+#include "FlyCapture2Defs.h"
+
+#include <chrono>
+#include <functional>
+#include <stdio.h>
+#include <thread>
+#include <vector>
+
+namespace FC2Test
+{
+	struct TestCase
+	{
+		const char* pName;
+		void (*pFunction)();
+	};
+
+	inline std::vector<TestCase>& GetTests()
+	{
+		static std::vector<TestCase> s_tests;
+		return s_tests;
+	}
+
+	inline unsigned int& GetFailureCount()
+	{
+		static unsigned int s_failures = 0;
+		return s_failures;
+	}
+
+	struct Registrar
+	{
+		Registrar( const char* pName, void (*pFunction)() )
+		{
+			const TestCase test = { pName, pFunction };
+			GetTests().push_back( test );
+		}
+	};
+
+	inline void ReportFailure( const char* pFile, int line, const char* pExpression )
+	{
+		fprintf( stderr, "%s:%d: check failed: %s\n", pFile, line, pExpression );
+		GetFailureCount()++;
+	}
+
+	/**
+	 * Poll a condition until it holds or the timeout expires.
+	 *
+	 * @return Whether the condition held.
+	 */
+	inline bool WaitFor( std::function<bool()> condition, unsigned int timeoutMs = 2000 )
+	{
+		const std::chrono::steady_clock::time_point end =
+			std::chrono::steady_clock::now() + std::chrono::milliseconds( timeoutMs );
+		while ( !condition() )
+		{
+			if ( std::chrono::steady_clock::now() >= end )
+			{
+				return false;
+			}
+			std::this_thread::sleep_for( std::chrono::milliseconds( 1 ) );
+		}
+		return true;
+	}
+
+	inline int RunAll()
+	{
+		std::vector<TestCase>& tests = GetTests();
+		for ( size_t i = 0; i < tests.size(); i++ )
+		{
+			const unsigned int failuresBefore = GetFailureCount();
+			tests[i].pFunction();
+			printf( "%s %s\n", GetFailureCount() == failuresBefore ? "[ OK ]" : "[FAIL]", tests[i].pName );
+		}
+		return GetFailureCount() == 0 ? 0 : 1;
+	}
+}
+
+#define FC2_TEST( name ) \
+	static void name(); \
+	static FC2Test::Registrar s_registrar_##name( #name, &name ); \
+	static void name()
+
+#define FC2_CHECK( expression ) \
+	do { if ( !( expression ) ) { FC2Test::ReportFailure( __FILE__, __LINE__, #expression ); } } while ( 0 )
+
+#define FC2_CHECK_OK( expression ) FC2_CHECK( ( expression ) == FlyCapture2::PGRERROR_OK )
+
+#define FC2_TEST_MAIN() \
+	int main() { return FC2Test::RunAll(); }
+
+#endif // FLIR_FC2_TESTS_TESTSUPPORT_H
@@ -0,0 +1,141 @@
+//=============================================================================
+// Copyright (c) 2001-2018 FLIR Systems, Inc. All Rights Reserved.
+//
+// This software is the confidential and proprietary information of FLIR
+// Integrated Imaging Solutions, Inc. ("Confidential Information"). You
+// shall not disclose such Confidential Information and shall use it only in
+// accordance with the terms of the license agreement you entered into
+// with FLIR Integrated Imaging Solutions, Inc. (FLIR).
+//
+// FLIR MAKES NO REPRESENTATIONS OR WARRANTIES ABOUT THE SUITABILITY OF THE
+// SOFTWARE, EITHER EXPRESSED OR IMPLIED, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+// PURPOSE, OR NON-INFRINGEMENT. FLIR SHALL NOT BE LIABLE FOR ANY DAMAGES
+// SUFFERED BY LICENSEE AS A RESULT OF USING, MODIFYING OR DISTRIBUTING
+// THIS SOFTWARE OR ITS DERIVATIVES.
+//=============================================================================
+
+
+#include "TestSupport.h"
+#include "TriggerScheduler.h"
+#include "SimulatedCamera.h"
+
+#include <chrono>
+#include <vector>
+
+using namespace FlyCapture2;
+
+namespace
+{
+	void EnableSoftwareTrigger( VirtualCamera* pCamera )
+	{
+		TriggerMode triggerMode;
+		triggerMode.onOff = true;
+		triggerMode.mode = 0;
+		triggerMode.source = VirtualCamera::sk_softwareTriggerSource;
+		pCamera->SetTriggerMode( &triggerMode );
+	}
+}
+
+FC2_TEST( TriggerSchedulerRejectsEmptySchedule )
+{
+	SimulatedCamera camera;
+	camera.Connect();
+	VirtualCamera* pCamera = &camera;
+
+	TriggerScheduler<VirtualCamera> scheduler;
+	scheduler.SetCameras( &pCamera, 1 );
+	FC2_CHECK( scheduler.StartSchedule( std::vector<std::chrono::nanoseconds>() ) == PGRERROR_INVALID_PARAMETER );
+	FC2_CHECK( !scheduler.IsRunning() );
+}
+
+FC2_TEST( TriggerSchedulerRejectsUnorderedSchedule )
+{
+	SimulatedCamera camera;
+	camera.Connect();
+	VirtualCamera* pCamera = &camera;
+
+	std::vector<std::chrono::nanoseconds> offsets;
+	offsets.push_back( std::chrono::milliseconds( 2 ) );
+	offsets.push_back( std::chrono::milliseconds( 1 ) );
+
+	TriggerScheduler<VirtualCamera> scheduler;
+	scheduler.SetCameras( &pCamera, 1 );
+	FC2_CHECK( scheduler.StartSchedule( offsets ) == PGRERROR_INVALID_PARAMETER );
+	FC2_CHECK( !scheduler.IsRunning() );
+}
+
+FC2_TEST( TriggerSchedulerFiresEveryOffset )
+{
+	SimulatedCamera camera;
+	camera.Connect();
+	EnableSoftwareTrigger( &camera );
+	VirtualCamera* pCamera = &camera;
+
+	std::vector<std::chrono::nanoseconds> offsets;
+	offsets.push_back( std::chrono::milliseconds( 1 ) );
+	offsets.push_back( std::chrono::milliseconds( 3 ) );
+	offsets.push_back( std::chrono::milliseconds( 10 ) );
+
+	TriggerScheduler<VirtualCamera> scheduler;
+	scheduler.SetCameras( &pCamera, 1 );
+	FC2_CHECK_OK( scheduler.StartSchedule( offsets ) );
+	FC2_CHECK( FC2Test::WaitFor( [&]() { return !scheduler.IsRunning(); } ) );
+
+	TriggerSchedulerStats stats;
+	scheduler.GetStats( &stats );
+	FC2_CHECK( stats.numFired == offsets.size() );
+	FC2_CHECK( stats.numFailures == 0 );
+
+	TriggerRecord first;
+	FC2_CHECK( scheduler.GetTriggerRecord( 0, &first ) );
+	for ( unsigned long long i = 1; i < offsets.size(); i++ )
+	{
+		TriggerRecord record;
+		FC2_CHECK( scheduler.GetTriggerRecord( i, &record ) );
+		FC2_CHECK( record.scheduledTime - first.scheduledTime == offsets[i] - offsets[0] );
+		FC2_CHECK( record.firedTime >= record.scheduledTime );
+	}
+	FC2_CHECK( !scheduler.GetTriggerRecord( offsets.size(), &first ) );
+}
+
+FC2_TEST( TriggerSchedulerStopsAfterPeriodicCount )
+{
+	SimulatedCamera camera;
+	camera.Connect();
+	EnableSoftwareTrigger( &camera );
+	VirtualCamera* pCamera = &camera;
+
+	TriggerScheduler<VirtualCamera> scheduler;
+	scheduler.SetCameras( &pCamera, 1 );
+	FC2_CHECK( scheduler.StartPeriodic( 0.0 ) == PGRERROR_INVALID_PARAMETER );
+	FC2_CHECK_OK( scheduler.StartPeriodic( 500.0, 5 ) );
+	FC2_CHECK( scheduler.StartPeriodic( 500.0, 5 ) == PGRERROR_ISOCH_ALREADY_STARTED );
+	FC2_CHECK( FC2Test::WaitFor( [&]() { return !scheduler.IsRunning(); } ) );
+
+	TriggerSchedulerStats stats;
+	scheduler.GetStats( &stats );
+	FC2_CHECK( stats.numFired + stats.numMissed == 5 );
+	FC2_CHECK( stats.numFailures == 0 );
+}
+
+FC2_TEST( TriggerSchedulerCountsRejectedTriggers )
+{
+	SimulatedCamera camera;
+	camera.Connect();
+	VirtualCamera* pCamera = &camera;
+
+	std::vector<std::chrono::nanoseconds> offsets( 1, std::chrono::milliseconds( 1 ) );
+
+	TriggerScheduler<VirtualCamera> scheduler;
+	scheduler.SetCameras( &pCamera, 1 );
+	FC2_CHECK_OK( scheduler.StartSchedule( offsets ) );
+	FC2_CHECK( FC2Test::WaitFor( [&]() { return !scheduler.IsRunning(); } ) );
+
+	TriggerSchedulerStats stats;
+	scheduler.GetStats( &stats );
+	FC2_CHECK( stats.numFired == 1 );
+	FC2_CHECK( stats.numFailures == 1 );
+}
+
+FC2_TEST_MAIN()
@@ -0,0 +1,68 @@
+//=============================================================================
+// Copyright (c) 2001-2018 FLIR Systems, Inc. All Rights Reserved.
+//
+// This software is the confidential and proprietary information of FLIR
+// Integrated Imaging Solutions, Inc. ("Confidential Information"). You
+// shall not disclose such Confidential Information and shall use it only in
+// accordance with the terms of the license agreement you entered into
+// with FLIR Integrated Imaging Solutions, Inc. (FLIR).
+//
+// FLIR MAKES NO REPRESENTATIONS OR WARRANTIES ABOUT THE SUITABILITY OF THE
+// SOFTWARE, EITHER EXPRESSED OR IMPLIED, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+// PURPOSE, OR NON-INFRINGEMENT. FLIR SHALL NOT BE LIABLE FOR ANY DAMAGES
+// SUFFERED BY LICENSEE AS A RESULT OF USING, MODIFYING OR DISTRIBUTING
+// THIS SOFTWARE OR ITS DERIVATIVES.
+//=============================================================================
+
+
+
+#include "TestSupport.h"
+#include "ViewerPipeline.h"
+
+using namespace FlyCapture2;
+
+namespace
+{
+	void PublishSequence( LatestFrameSlot* pSlot, Image** ppImage, unsigned long long sequence )
+	{
+		FrameTag tag;
+		tag.sequence = sequence;
+		pSlot->Publish( ppImage, tag );
+	}
+}
+
+FC2_TEST( LatestFrameSlotCountsOverwrittenAndStaleFrames )
+{
+	LatestFrameSlot slot;
+	Image* pImage = new Image();
+
+	PublishSequence( &slot, &pImage, 1 );
+	PublishSequence( &slot, &pImage, 2 );
+	PublishSequence( &slot, &pImage, 1 );
+
+	FC2_CHECK( slot.GetNumOverwritten() == 1 );
+	FC2_CHECK( slot.GetNumStale() == 1 );
+	delete pImage;
+}
+
+FC2_TEST( LatestFrameSlotResetClearsCounters )
+{
+	LatestFrameSlot slot;
+	Image* pImage = new Image();
+
+	PublishSequence( &slot, &pImage, 5 );
+	PublishSequence( &slot, &pImage, 6 );
+	PublishSequence( &slot, &pImage, 4 );
+	slot.Reset();
+
+	FC2_CHECK( slot.GetNumOverwritten() == 0 );
+	FC2_CHECK( slot.GetNumStale() == 0 );
+
+	// Sequence numbers start again after a reset.
+	PublishSequence( &slot, &pImage, 1 );
+	FC2_CHECK( slot.GetNumStale() == 0 );
+	delete pImage;
+}
+
+FC2_TEST_MAIN()